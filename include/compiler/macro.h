@@ -20,6 +20,9 @@
 /* return min value */
 #define MIN(a,b)			(((a)<(b))?(a):(b))
 
+/* return max value */
+#define MAX(a,b)			(((a)>(b))?(a):(b))
+
 /* return size of a struct member - to be used in BUILD_BUG occurrences */
 #define MEMBER_SIZE(type, member)	(sizeof(((type*)0)->member))
 
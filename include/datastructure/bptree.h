@@ -0,0 +1,180 @@
+/*
+ * bptree.h
+ *
+ *  Created on: 17/10/2026
+ *      Author: paulo
+ */
+
+#ifndef INCLUDE_DATASTRUCTURE_BPTREE_H_
+#define INCLUDE_DATASTRUCTURE_BPTREE_H_
+
+#include <compiler/common.h>
+
+/*
+ * B+tree: values live in leaves only, inner nodes just route lookups. Leaves are linked to their
+ * neighbours so ranges of keys can be walked in either direction without going back up the tree.
+ * Keys are unique and referenced rather than copied, so they must stay put while they're in the tree.
+ */
+struct bptree_node {
+	/* leaves only: neighbours in key order */
+	struct bptree_node *prev;
+	struct bptree_node *next;
+	int key_count;
+	bool is_leaf;
+	void **keys;
+	/* leaves: values, inner nodes: children (key_count + 1 of them) */
+	void **ptrs;
+};
+
+/**
+ * struct bptree_head - B+tree head
+ *
+ * @order: max number of keys each node can hold
+ * @count: number of entries
+ * @cmp_fn: pointer to a function that knows how to compare keys
+ */
+struct bptree_head {
+	struct bptree_node *root;
+	int order;
+	size_t count;
+	int (*cmp_fn)(void*, void*);
+};
+
+/**
+ * struct bptree_cursor - position within a B+tree
+ *
+ * @node: leaf the cursor points into (NULL once it moved past either end)
+ * @idx: entry within the leaf
+ *
+ * Cursors are invalidated by insertions and removals.
+ */
+struct bptree_cursor {
+	struct bptree_node *node;
+	int idx;
+};
+
+/**
+ * bptree_init - initialise a B+tree
+ *
+ * @order: max number of keys each node can hold (at least 3)
+ * @cmp_fn: pointer to a function that knows how to compare keys
+ *
+ * This function returns bptree_head* or NULL if it fails to alloc memory
+ */
+struct bptree_head* __must_check bptree_init(int order, int (*cmp_fn)(void*, void*));
+
+/**
+ * bptree_destroy - destroy B+tree
+ *
+ * @head: the B+tree head to destroy
+ */
+void bptree_destroy(struct bptree_head **head);
+
+/**
+ * bptree_lookup - look up a key in the B+tree
+ *
+ * @head: the B+tree to look in
+ * @key: the key to look up
+ *
+ * This function returns the value for the given key, or NULL.
+ */
+void* bptree_lookup(struct bptree_head *head, void *key);
+
+/**
+ * bptree_insert - insert an entry in the B+tree
+ *
+ * @head: the B+tree to update
+ * @key: the key to insert
+ * @val: the value to be inserted (must not be %NULL)
+ *
+ * This function returns 0 if the entry was inserted, -MIDORIDB_ERROR if the key is in the tree
+ * already or -MIDORIDB_NOMEM if memory couldn't be allocated. (tree is left untouched then)
+ */
+int __must_check bptree_insert(struct bptree_head *head, void *key, void *val);
+
+/**
+ * bptree_bulk_load - build an empty B+tree out of sorted entries
+ *
+ * @head: the B+tree to fill up (must be empty)
+ * @keys: keys in strictly ascending order
+ * @vals: values of each key (none of them %NULL)
+ * @count: number of entries
+ *
+ * The tree is built bottom-up with leaves filled up, rather than splitting nodes
+ * one insertion at a time.
+ *
+ * This function returns 0 if the tree was built, -MIDORIDB_ERROR if it isn't empty or
+ * -MIDORIDB_NOMEM if memory couldn't be allocated. (tree is left untouched then)
+ */
+int __must_check bptree_bulk_load(struct bptree_head *head, void **keys, void **vals, size_t count);
+
+/**
+ * bptree_remove - remove an entry from the B+tree
+ *
+ * @head: the B+tree to update
+ * @key: the key to remove
+ *
+ * This function returns true if the entry was removed, false if it couldn't be found
+ */
+bool bptree_remove(struct bptree_head *head, void *key);
+
+/**
+ * bptree_foreach - call a function for every entry of the B+tree (in key order)
+ *
+ * @head: head of the B+tree
+ * @fn: function to be called
+ * @arg: argument to be passed to fn
+ */
+void bptree_foreach(struct bptree_head *head, void (*fn)(void *key, void *value, void *arg), void *arg);
+
+/**
+ * bptree_seek_ge - point cursor to the first entry whose key is greater than or equal to a key
+ *
+ * @head: head of the B+tree
+ * @cur: cursor to be positioned
+ * @key: lower bound (NULL for the first entry)
+ *
+ * This function returns true if there's such an entry, false otherwise
+ */
+bool bptree_seek_ge(struct bptree_head *head, struct bptree_cursor *cur, void *key);
+
+/**
+ * bptree_seek_le - point cursor to the last entry whose key is less than or equal to a key
+ *
+ * @head: head of the B+tree
+ * @cur: cursor to be positioned
+ * @key: upper bound (NULL for the last entry)
+ *
+ * This function returns true if there's such an entry, false otherwise
+ */
+bool bptree_seek_le(struct bptree_head *head, struct bptree_cursor *cur, void *key);
+
+/**
+ * bptree_next - move cursor to the next entry
+ *
+ * @cur: cursor reference
+ *
+ * This function returns true if there's such an entry, false if the cursor moved past the last one
+ */
+bool bptree_next(struct bptree_cursor *cur);
+
+/**
+ * bptree_prev - move cursor to the previous entry
+ *
+ * @cur: cursor reference
+ *
+ * This function returns true if there's such an entry, false if the cursor moved past the first one
+ */
+bool bptree_prev(struct bptree_cursor *cur);
+
+static inline void* bptree_cursor_key(struct bptree_cursor *cur)
+{
+	return cur->node->keys[cur->idx];
+}
+
+static inline void* bptree_cursor_value(struct bptree_cursor *cur)
+{
+	return cur->node->ptrs[cur->idx];
+}
+
+#endif /* INCLUDE_DATASTRUCTURE_BPTREE_H_ */
@@ -0,0 +1,183 @@
+/*
+ * bptree_i64.h
+ *
+ *  Created on: 17/10/2026
+ *      Author: paulo
+ */
+
+#ifndef INCLUDE_DATASTRUCTURE_BPTREE_I64_H_
+#define INCLUDE_DATASTRUCTURE_BPTREE_I64_H_
+
+#include <compiler/common.h>
+
+#define BPTREE_I64_CACHE_LINE		64
+
+/* default size of the key array of a node, in bytes */
+#define BPTREE_I64_DEFAULT_NODE_SIZE	512
+
+/*
+ * B+tree specialised for 64-bit integer keys (INTEGER, DATE and DATETIME values). It works like
+ * struct bptree_head but keys are stored inline in a cache-line aligned array of each node rather than
+ * referenced, so nodes are searched with SIMD compares instead of calling a comparison function on
+ * memory spread all over the heap.
+ */
+struct bptree_i64_node {
+	/* leaves only: neighbours in key order */
+	struct bptree_i64_node *prev;
+	struct bptree_i64_node *next;
+	int key_count;
+	bool is_leaf;
+	/* leaves: values, inner nodes: children (key_count + 1 of them) */
+	void **ptrs;
+	__align(BPTREE_I64_CACHE_LINE) int64_t keys[];
+};
+
+/**
+ * struct bptree_i64_head - integer-key B+tree head
+ *
+ * @order: max number of keys each node can hold
+ * @count: number of entries
+ * @lower_bound: in-node search picked for the CPU at hand
+ */
+struct bptree_i64_head {
+	struct bptree_i64_node *root;
+	int order;
+	size_t count;
+	int (*lower_bound)(const int64_t *keys, int n, int64_t key);
+};
+
+/**
+ * struct bptree_i64_cursor - position within an integer-key B+tree
+ *
+ * @node: leaf the cursor points into (NULL once it moved past either end)
+ * @idx: entry within the leaf
+ *
+ * Cursors are invalidated by insertions and removals.
+ */
+struct bptree_i64_cursor {
+	struct bptree_i64_node *node;
+	int idx;
+};
+
+/**
+ * bptree_i64_init - initialise an integer-key B+tree
+ *
+ * @node_size: size of the key array of each node in bytes, a multiple of BPTREE_I64_CACHE_LINE. (nodes
+ * 	that fit in L1 along with the path leading to them search faster, see BPTREE_I64_DEFAULT_NODE_SIZE)
+ *
+ * This function returns bptree_i64_head* or NULL if it fails to alloc memory
+ */
+struct bptree_i64_head* __must_check bptree_i64_init(size_t node_size);
+
+/**
+ * bptree_i64_destroy - destroy integer-key B+tree
+ *
+ * @head: the B+tree head to destroy
+ */
+void bptree_i64_destroy(struct bptree_i64_head **head);
+
+/**
+ * bptree_i64_lookup - look up a key in the B+tree
+ *
+ * @head: the B+tree to look in
+ * @key: the key to look up
+ *
+ * This function returns the value for the given key, or NULL.
+ */
+void* bptree_i64_lookup(struct bptree_i64_head *head, int64_t key);
+
+/**
+ * bptree_i64_insert - insert an entry in the B+tree
+ *
+ * @head: the B+tree to update
+ * @key: the key to insert
+ * @val: the value to be inserted (must not be %NULL)
+ *
+ * This function returns 0 if the entry was inserted, -MIDORIDB_ERROR if the key is in the tree
+ * already or -MIDORIDB_NOMEM if memory couldn't be allocated. (tree is left untouched then)
+ */
+int __must_check bptree_i64_insert(struct bptree_i64_head *head, int64_t key, void *val);
+
+/**
+ * bptree_i64_bulk_load - build an empty B+tree out of sorted entries
+ *
+ * @head: the B+tree to fill up (must be empty)
+ * @keys: keys in strictly ascending order
+ * @vals: values of each key (none of them %NULL)
+ * @count: number of entries
+ *
+ * This function returns 0 if the tree was built, -MIDORIDB_ERROR if it isn't empty or
+ * -MIDORIDB_NOMEM if memory couldn't be allocated. (tree is left untouched then)
+ */
+int __must_check bptree_i64_bulk_load(struct bptree_i64_head *head, const int64_t *keys, void **vals, size_t count);
+
+/**
+ * bptree_i64_remove - remove an entry from the B+tree
+ *
+ * @head: the B+tree to update
+ * @key: the key to remove
+ *
+ * This function returns true if the entry was removed, false if it couldn't be found
+ */
+bool bptree_i64_remove(struct bptree_i64_head *head, int64_t key);
+
+/**
+ * bptree_i64_foreach - call a function for every entry of the B+tree (in key order)
+ *
+ * @head: head of the B+tree
+ * @fn: function to be called
+ * @arg: argument to be passed to fn
+ */
+void bptree_i64_foreach(struct bptree_i64_head *head, void (*fn)(int64_t key, void *value, void *arg), void *arg);
+
+/**
+ * bptree_i64_seek_ge - point cursor to the first entry whose key is greater than or equal to a key
+ *
+ * @head: head of the B+tree
+ * @cur: cursor to be positioned
+ * @key: lower bound
+ *
+ * This function returns true if there's such an entry, false otherwise
+ */
+bool bptree_i64_seek_ge(struct bptree_i64_head *head, struct bptree_i64_cursor *cur, int64_t key);
+
+/**
+ * bptree_i64_seek_le - point cursor to the last entry whose key is less than or equal to a key
+ *
+ * @head: head of the B+tree
+ * @cur: cursor to be positioned
+ * @key: upper bound
+ *
+ * This function returns true if there's such an entry, false otherwise
+ */
+bool bptree_i64_seek_le(struct bptree_i64_head *head, struct bptree_i64_cursor *cur, int64_t key);
+
+/**
+ * bptree_i64_next - move cursor to the next entry
+ *
+ * @cur: cursor reference
+ *
+ * This function returns true if there's such an entry, false if the cursor moved past the last one
+ */
+bool bptree_i64_next(struct bptree_i64_cursor *cur);
+
+/**
+ * bptree_i64_prev - move cursor to the previous entry
+ *
+ * @cur: cursor reference
+ *
+ * This function returns true if there's such an entry, false if the cursor moved past the first one
+ */
+bool bptree_i64_prev(struct bptree_i64_cursor *cur);
+
+static inline int64_t bptree_i64_cursor_key(struct bptree_i64_cursor *cur)
+{
+	return cur->node->keys[cur->idx];
+}
+
+static inline void* bptree_i64_cursor_value(struct bptree_i64_cursor *cur)
+{
+	return cur->node->ptrs[cur->idx];
+}
+
+#endif /* INCLUDE_DATASTRUCTURE_BPTREE_I64_H_ */
@@ -85,6 +85,15 @@ int __must_check btree_insert(struct btree_head *head, void *key, void *val);
  */
 int __must_check btree_remove(struct btree_head *head, void *key);
 
+/**
+ * btree_foreach - call a function for every entry of the btree (in key order)
+ *
+ * @head: head of the btree
+ * @fn: function to be called
+ * @arg: argument to be passed to fn
+ */
+void btree_foreach(struct btree_head *head, void (*fn)(void *key, void *value, void *arg), void *arg);
+
 /**
  * btree_traverse - utility method for traversing the btree. Mostly used for debugging purposes
  *
@@ -113,6 +113,18 @@ void hashtable_foreach(struct hashtable *hashtable, hashtable_callback_fn *callb
  */
 bool hashtable_str_compare(const void *key1, size_t key1_len, const void *key2, size_t key2_len);
 
+/**
+ * hashtable_mem_compare - compare binary keys
+ * @key1: first key
+ * @key1_len: size of first key in bytes
+ * @key2: second key
+ * @key2_len: size of second key in bytes
+ *
+ * this function returns true if keys have the same size and content, false otherwise.
+ * hashtable_str_hash hashes every byte of the key so it can be used alongside this function
+ */
+bool hashtable_mem_compare(const void *key1, size_t key1_len, const void *key2, size_t key2_len);
+
 /**
  * hashtable_str_hash - hash string key
  * @key: key to be hashed
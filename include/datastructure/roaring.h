@@ -0,0 +1,152 @@
+/*
+ * roaring.h
+ *
+ *  Created on: 17/10/2026
+ *      Author: paulo
+ */
+
+#ifndef INCLUDE_DATASTRUCTURE_ROARING_H_
+#define INCLUDE_DATASTRUCTURE_ROARING_H_
+
+#include <compiler/common.h>
+
+/* array containers holding more values than this are turned into bitmaps (8KB either way) */
+#define ROARING_ARRAY_MAX	4096
+
+/* 64-bit words of a bitmap container */
+#define ROARING_BITMAP_WORDS	1024
+
+/*
+ * Compressed bitmap of 64-bit values, roaring-style. Values are split into chunks sharing their upper
+ * 48 bits (the container key), and each chunk holds the lower 16 bits either as a sorted array, while
+ * it's sparse, or as a plain 65536-bit bitmap once it's dense.
+ */
+struct roaring_container {
+	uint64_t key;
+	/* number of values held */
+	uint32_t card;
+	/* array containers only: number of slots allocated */
+	uint32_t cap;
+	bool is_bitmap;
+	union {
+		uint16_t *array;
+		uint64_t *bitmap;
+	};
+};
+
+/**
+ * struct roaring - compressed bitmap
+ *
+ * @containers: containers sorted by key, none of them empty
+ * @count: number of containers
+ * @cap: number of containers allocated
+ */
+struct roaring {
+	struct roaring_container *containers;
+	size_t count;
+	size_t cap;
+};
+
+/**
+ * struct roaring_iter - iterator over the values of a compressed bitmap, in ascending order
+ *
+ * Iterators are invalidated by any change to the bitmap.
+ */
+struct roaring_iter {
+	const struct roaring *bitmap;
+	size_t container;
+	uint32_t pos;
+};
+
+/**
+ * roaring_init - initialise an empty compressed bitmap
+ * @bitmap: bitmap reference
+ */
+void roaring_init(struct roaring *bitmap);
+
+/**
+ * roaring_free - free compressed bitmap content, the bitmap is left empty
+ * @bitmap: bitmap reference
+ */
+void roaring_free(struct roaring *bitmap);
+
+/**
+ * roaring_add - add a value to a compressed bitmap
+ * @bitmap: bitmap reference
+ * @val: value to add, adding a value that is already there is a no-op
+ *
+ * Appending values in ascending order is the cheap path.
+ *
+ * this function returns true if value could be added, false if it failed to alloc memory
+ */
+bool __must_check roaring_add(struct roaring *bitmap, uint64_t val);
+
+/**
+ * roaring_remove - remove a value from a compressed bitmap
+ * @bitmap: bitmap reference
+ * @val: value to remove
+ *
+ * this function returns true if value was there, false otherwise
+ */
+bool roaring_remove(struct roaring *bitmap, uint64_t val);
+
+/**
+ * roaring_contains - check if a compressed bitmap holds a value
+ * @bitmap: bitmap reference
+ * @val: value to look for
+ */
+bool roaring_contains(const struct roaring *bitmap, uint64_t val);
+
+/**
+ * roaring_cardinality - number of values held by a compressed bitmap
+ * @bitmap: bitmap reference
+ */
+size_t roaring_cardinality(const struct roaring *bitmap);
+
+/**
+ * roaring_and - intersection of two compressed bitmaps
+ * @dst: initialised empty bitmap that gets the result, must be neither a nor b
+ * @a: bitmap reference
+ * @b: bitmap reference
+ *
+ * this function returns true on success, false if it failed to alloc memory (dst is left empty)
+ */
+bool __must_check roaring_and(struct roaring *dst, const struct roaring *a, const struct roaring *b);
+
+/**
+ * roaring_or - union of two compressed bitmaps
+ * @dst: initialised empty bitmap that gets the result, must be neither a nor b
+ * @a: bitmap reference
+ * @b: bitmap reference
+ *
+ * this function returns true on success, false if it failed to alloc memory (dst is left empty)
+ */
+bool __must_check roaring_or(struct roaring *dst, const struct roaring *a, const struct roaring *b);
+
+/**
+ * roaring_xor - symmetric difference of two compressed bitmaps
+ * @dst: initialised empty bitmap that gets the result, must be neither a nor b
+ * @a: bitmap reference
+ * @b: bitmap reference
+ *
+ * this function returns true on success, false if it failed to alloc memory (dst is left empty)
+ */
+bool __must_check roaring_xor(struct roaring *dst, const struct roaring *a, const struct roaring *b);
+
+/**
+ * roaring_iter_init - position an iterator before the smallest value of a compressed bitmap
+ * @iter: iterator reference
+ * @bitmap: bitmap reference
+ */
+void roaring_iter_init(struct roaring_iter *iter, const struct roaring *bitmap);
+
+/**
+ * roaring_iter_next - move an iterator to the next value
+ * @iter: iterator reference
+ * @val: gets the value
+ *
+ * this function returns false once every value was visited
+ */
+bool roaring_iter_next(struct roaring_iter *iter, uint64_t *val);
+
+#endif /* INCLUDE_DATASTRUCTURE_ROARING_H_ */
@@ -0,0 +1,70 @@
+/*
+ * autovacuum.h
+ *
+ *  Created on: 17/10/2026
+ *      Author: paulo
+ */
+
+#ifndef INCLUDE_ENGINE_AUTOVACUUM_H_
+#define INCLUDE_ENGINE_AUTOVACUUM_H_
+
+#include <compiler/common.h>
+#include <primitive/table.h>
+
+/* share of dead rows (deleted / deleted + live), in percent, a table needs to get compacted */
+#define AUTOVACUUM_DEAD_PCT	20
+
+/* and the least number of them, compacting small tables isn't worth the trouble */
+#define AUTOVACUUM_MIN_DEAD	256
+
+/* row slots looked at per step, i.e. how long the table lock is held for at most */
+#define AUTOVACUUM_STEP_SLOTS	1024
+
+/* default time between two rounds over the tables of a database, in milliseconds */
+#define AUTOVACUUM_NAPTIME_MS	100
+
+struct database;
+
+/*
+ * Background thread compacting tables of a database that have piled up enough deleted rows. Tables
+ * are compacted in bounded steps (see table_vacuum_step) and the table lock is let go in between,
+ * so statements never wait on more than a step. Tables pinned by statements are left alone.
+ */
+struct autovacuum {
+	pthread_t thread;
+	/* is the thread running? */
+	bool running;
+	bool stop;
+	/* time between rounds, in milliseconds */
+	unsigned int naptime_ms;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+};
+
+/**
+ * autovacuum_needed - check if a table has piled up enough deleted rows to get compacted
+ * @table: table reference
+ *
+ * Note: this method is not thread-safe. It is the caller's responsibility to
+ * call table_lock() before calling this method.
+ */
+bool autovacuum_needed(struct table *table);
+
+/**
+ * autovacuum_start - start compacting tables of a database in the background
+ * @db: database reference
+ * @naptime_ms: time between rounds over the tables of the database, in milliseconds
+ *
+ * Returns: 0 if successful, < 0 otherwise. See <error.h> for details.
+ */
+int autovacuum_start(struct database *db, unsigned int naptime_ms);
+
+/**
+ * autovacuum_stop - stop and join the autovacuum thread of a database (if running)
+ * @db: database reference
+ *
+ * a pass a table was halfway through is carried on with by the next one.
+ */
+void autovacuum_stop(struct database *db);
+
+#endif /* INCLUDE_ENGINE_AUTOVACUUM_H_ */
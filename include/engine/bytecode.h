@@ -0,0 +1,160 @@
+/*
+ * bytecode.h
+ *
+ *  Created on: 17/10/2026
+ *      Author: paulo
+ */
+
+#ifndef INCLUDE_ENGINE_BYTECODE_H_
+#define INCLUDE_ENGINE_BYTECODE_H_
+
+#include <compiler/common.h>
+#include <parser/ast.h>
+#include <primitive/table.h>
+#include <primitive/row.h>
+#include <datastructure/vector.h>
+
+#define BYTECODE_MAX_REGS	16
+
+/*
+ * WHERE/ON-clauses (of SELECT, DELETE and UPDATE statements) are lowered into a flat program for a
+ * small register-based interpreter before rows are scanned. Column offsets, types and literals are
+ * resolved at compile time so running the program doesn't need to walk the AST anymore.
+ */
+enum bc_opcode {
+	/* reg[dst] = imm.bool_val */
+	BC_LOAD_BOOL,
+	/* reg[dst] = column <cmp_type> literal (false if column is NULL) */
+	BC_CMP_INT_IMM,
+	BC_CMP_DBL_IMM,
+	BC_CMP_BOOL_IMM,
+	BC_CMP_TIME_IMM,
+	BC_CMP_STR_IMM,
+	/* reg[dst] = column_1 <cmp_type> column_2 (false if any of them is NULL) */
+	BC_CMP_INT_COL,
+	BC_CMP_DBL_COL,
+	BC_CMP_BOOL_COL,
+	BC_CMP_TIME_COL,
+	BC_CMP_STR_COL,
+	/* reg[dst] = column IS NULL ^ imm.bool_val */
+	BC_ISNULL,
+	/* reg[dst] ^= reg[src] */
+	BC_XOR,
+	/* if reg[dst] is false (or true) jump to target */
+	BC_JMP_FALSE,
+	BC_JMP_TRUE,
+};
+
+struct bc_insn {
+	enum bc_opcode opcode;
+	enum ast_comparison_type cmp_type;
+	uint8_t dst;
+	uint8_t src;
+	/* column operands */
+	int col_idx_1;
+	int col_idx_2;
+	size_t offset_1;
+	size_t offset_2;
+	/* jump target (instruction index) */
+	size_t target;
+	/* literal operand */
+	union {
+		int64_t int_val;
+		double double_val;
+		bool bool_val;
+		time_t time_val;
+		char *str_val;
+	} imm;
+};
+
+/*
+ * The predicate is also recorded as set operations on the rows each comparison matches (the set
+ * plan), in postfix order, so rows can be narrowed down through bitmap indexes before the program
+ * is run.
+ */
+enum bc_set_op {
+	/* rows instruction arg holds true for */
+	BC_SET_LEAF,
+	/* intersection / union / symmetric difference of the topmost arg results */
+	BC_SET_AND,
+	BC_SET_OR,
+	BC_SET_XOR,
+};
+
+struct bc_set_node {
+	enum bc_set_op op;
+	size_t arg;
+};
+
+struct bytecode {
+	/* struct bc_insn */
+	struct vector insns;
+	/* struct bc_set_node */
+	struct vector set_plan;
+	/* every instruction narrows reg 0 down (AND'ed comparisons only) */
+	bool is_conjunction;
+};
+
+/**
+ * bytecode_compile - lower a predicate AST into a program for the given table layout
+ * @prog: program to be initialised
+ * @table: table (layout) rows will belong to
+ * @node: predicate root. (CMP, LOGOP, IS NULL, IN nodes or any node whose children are AND'ed:
+ * 	WHERE, ON, DELETE and UPDATE nodes)
+ *
+ * literal strings are referenced rather than copied so the AST must outlive the program.
+ *
+ * this function returns true if the program could be compiled, false otherwise
+ */
+bool bytecode_compile(struct bytecode *prog, struct table *table, struct ast_node *node);
+
+/**
+ * bytecode_run - run program against a row
+ * @prog: program reference
+ * @row: row to be evaluated
+ *
+ * this function returns true if the row satisfies the predicate, false otherwise
+ */
+bool bytecode_run(struct bytecode *prog, struct row *row);
+
+/**
+ * bytecode_filter - run program against a batch of rows
+ * @prog: program reference
+ * @rows: rows of the batch
+ * @sel: selection vector (indices into rows) - narrowed down in place
+ * @sel_count: number of entries in the selection vector
+ *
+ * this function returns the number of entries left in the selection vector
+ */
+size_t bytecode_filter(struct bytecode *prog, struct row **rows, uint16_t *sel, size_t sel_count);
+
+/**
+ * bytecode_next_cmp_imm - iterate over the 'column {=,<,<=,>,>=} literal' comparisons of a conjunction
+ * @prog: program reference
+ * @pos: iterator state. (0 to start with)
+ *
+ * every row matched by the program satisfies all of these comparisons so any of them can be
+ * used to narrow rows down (e.g. through an index) before the program is run.
+ *
+ * this function returns the next comparison or NULL if there aren't any left
+ */
+struct bc_insn* bytecode_next_cmp_imm(struct bytecode *prog, size_t *pos);
+
+/**
+ * bytecode_next_null_test - iterate over the 'column IS [NOT] NULL' tests of a conjunction
+ * @prog: program reference
+ * @pos: iterator state. (0 to start with)
+ *
+ * same as bytecode_next_cmp_imm, imm.bool_val of the tests returned is set for IS NOT NULL.
+ *
+ * this function returns the next test or NULL if there aren't any left
+ */
+struct bc_insn* bytecode_next_null_test(struct bytecode *prog, size_t *pos);
+
+/**
+ * bytecode_free - free program
+ * @prog: program reference
+ */
+void bytecode_free(struct bytecode *prog);
+
+#endif /* INCLUDE_ENGINE_BYTECODE_H_ */
@@ -11,10 +11,18 @@
 #include <compiler/common.h>
 #include <primitive/table.h>
 #include <datastructure/hashtable.h>
+#include <engine/worker.h>
+#include <engine/autovacuum.h>
 
 struct database {
 	struct hashtable *tables;
 	pthread_mutex_t mutex;
+	/* threads scans are split across */
+	struct worker_pool pool;
+	/* compacts tables with many deleted rows in the background */
+	struct autovacuum autovacuum;
+	/* streamed result sets still open (see query_detach_results) */
+	struct list_head results;
 };
 
 /**
@@ -28,9 +36,33 @@ int database_open(struct database *db);
 /**
  * database_close - close a database
  * @db: database to close 
+ *
+ * Note: result sets still open are materialised, they can be read (and freed) afterwards.
  */
 void database_close(struct database *db);
 
+/**
+ * database_set_threads - set number of threads statements can use to scan tables
+ * @db: database reference
+ * @nthreads: number of threads. (1 disables parallel scans)
+ *
+ * Note: this method is not thread-safe. No statements may be running while it is called.
+ *
+ * Returns: 0 if successful, < 0 otherwise. See <error.h> for details.
+ */
+int database_set_threads(struct database *db, size_t nthreads);
+
+/**
+ * database_set_autovacuum - set how often tables are looked at by the autovacuum thread
+ * @db: database reference
+ * @naptime_ms: time between rounds over the tables of the database in milliseconds. (0 disables it)
+ *
+ * Note: this method is not thread-safe. No statements may be running while it is called.
+ *
+ * Returns: 0 if successful, < 0 otherwise. See <error.h> for details.
+ */
+int database_set_autovacuum(struct database *db, unsigned int naptime_ms);
+
 /**
  * database_table_add - add a table to a database
  * @db: database reference
@@ -0,0 +1,75 @@
+/*
+ * filter.h
+ *
+ *  Created on: 17/10/2026
+ *      Author: paulo
+ */
+
+#ifndef INCLUDE_ENGINE_FILTER_H_
+#define INCLUDE_ENGINE_FILTER_H_
+
+#include <compiler/common.h>
+#include <parser/ast.h>
+
+/*
+ * Comparison kernels: compare a vector of values against a constant and set bit i of the output
+ * bitmap if the i-th value satisfies the comparison (bitmaps are arrays of uint64_t words, bit i lives
+ * in word i / 64). There is an AVX2, an SSE4.2 and a scalar flavour of each kernel, the best one the
+ * CPU supports is picked the first time a kernel runs.
+ *
+ * NULLs are not a concern here, callers are expected to clear their bits afterwards.
+ */
+enum filter_isa {
+	FILTER_ISA_SCALAR,
+	FILTER_ISA_SSE42,
+	FILTER_ISA_AVX2,
+};
+
+#define FILTER_BITMAP_WORDS(n)	(((n) + 63) / 64)
+
+/**
+ * filter_isa_get - get the instruction set kernels are currently running with
+ *
+ * this function returns the instruction set in use
+ */
+enum filter_isa filter_isa_get(void);
+
+/**
+ * filter_isa_set - force kernels to run with a given instruction set
+ * @isa: instruction set
+ *
+ * this function returns true if the CPU supports the instruction set, false otherwise
+ */
+bool filter_isa_set(enum filter_isa isa);
+
+/**
+ * filter_int64 - compare INTEGER (and DATE/DATETIME) values against a constant
+ * @cmp_type: comparison operator
+ * @vals: values
+ * @n: number of values
+ * @rhs: right-hand side of the comparison
+ * @bitmap: output bitmap (FILTER_BITMAP_WORDS(n) words)
+ */
+void filter_int64(enum ast_comparison_type cmp_type, const int64_t *vals, size_t n, int64_t rhs, uint64_t *bitmap);
+
+/**
+ * filter_double - compare DOUBLE values against a constant
+ * @cmp_type: comparison operator
+ * @vals: values
+ * @n: number of values
+ * @rhs: right-hand side of the comparison
+ * @bitmap: output bitmap (FILTER_BITMAP_WORDS(n) words)
+ */
+void filter_double(enum ast_comparison_type cmp_type, const double *vals, size_t n, double rhs, uint64_t *bitmap);
+
+/**
+ * filter_bool - compare TINYINT values against a constant
+ * @cmp_type: comparison operator. (booleans are not ordered so only '=' and '<>' ever match)
+ * @vals: values
+ * @n: number of values
+ * @rhs: right-hand side of the comparison
+ * @bitmap: output bitmap (FILTER_BITMAP_WORDS(n) words)
+ */
+void filter_bool(enum ast_comparison_type cmp_type, const bool *vals, size_t n, bool rhs, uint64_t *bitmap);
+
+#endif /* INCLUDE_ENGINE_FILTER_H_ */
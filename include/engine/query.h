@@ -21,10 +21,40 @@ enum query_output_status {
 	ST_ERROR
 };
 
+struct row;
+struct ast_node;
+
+/*
+ * pull-based (Volcano-style) operator. SELECT statements without blocking operators (GROUP BY,
+ * COUNT) hand a pipeline of these over to the result set rather than materialising every row.
+ */
+struct sel_operator {
+	/* fetch next row: MIDORIDB_ROW, MIDORIDB_OK once exhausted or < 0 on errors */
+	int (*next)(struct sel_operator *op, struct row **out);
+	/* free operator and its children */
+	void (*free)(struct sel_operator *op);
+	/* does the operator (or any of its children) read rows of @table? */
+	bool (*reads)(struct sel_operator *op, struct table *table);
+};
+
 struct result_set {
+	/* result columns (and rows if results were materialised) */
 	struct table *table;
 	struct datablock *cursor_blk;
+	/* position of cursor_blk (see struct block_dir) */
+	size_t cursor_pos;
 	size_t cursor_offset;
+	/* streamed results - NULL if results were materialised */
+	struct sel_operator *pipeline;
+	/* AST is still evaluated while rows are streamed so it lives as long as the pipeline */
+	struct ast_node *ast;
+	/* current row */
+	struct row *cursor_row;
+	/* database streamed results are registered with, NULL once they're materialised */
+	struct database *db;
+	struct list_head head;
+	/* error hit while materialising streamed results, returned once the rows kept run out */
+	int err;
 };
 
 struct query_output_error {
@@ -46,7 +76,8 @@ struct query_output* query_execute(struct database *db, char *query);
  *
  * @res: result_set reference
  *
- * Returns: MIDORIDB_OK (0) if end of result_set is reached, MIDORIDB_ROW (4) if next row is available
+ * Returns: MIDORIDB_OK (0) if end of result_set is reached, MIDORIDB_ROW (4) if next row is available,
+ * 	< 0 if rows are streamed and fetching the next one failed
  */
 int query_cur_step(struct result_set *res);
 
@@ -61,6 +92,21 @@ int query_cur_step(struct result_set *res);
 int64_t query_column_int64(struct result_set *res, int col_idx);
 
 
+/**
+ * query_detach_results - materialise streamed result sets reading a table
+ *
+ * @db: database reference
+ * @table: table about to be changed. (NULL for every table)
+ *
+ * Streamed results point straight at the rows of their base tables. Before the table changes,
+ * rows they haven't returned yet are copied into their own result table (the current row
+ * included) and the pipeline is freed, so they carry on from where they left off as if the
+ * change never happened.
+ *
+ * Returns: 0 if successful, < 0 otherwise. See <error.h> for details.
+ */
+int query_detach_results(struct database *db, struct table *table);
+
 /**
  * query_free - free resources alloc'ed when running queries against the database
  *
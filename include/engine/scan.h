@@ -0,0 +1,198 @@
+/*
+ * scan.h
+ *
+ *  Created on: 17/10/2026
+ *      Author: paulo
+ */
+
+#ifndef INCLUDE_ENGINE_SCAN_H_
+#define INCLUDE_ENGINE_SCAN_H_
+
+#include <compiler/common.h>
+#include <primitive/table.h>
+#include <primitive/row.h>
+#include <primitive/datablock.h>
+#include <datastructure/vector.h>
+#include <engine/worker.h>
+#include <engine/bytecode.h>
+#include <primitive/index.h>
+#include <primitive/zonemap.h>
+#include <primitive/bloom.h>
+
+/* number of datablocks handed out to a worker at once */
+#define SCAN_MORSEL_BLOCKS	16
+
+/* scans with no end position go on to the last datablock of the table */
+#define SCAN_END		SIZE_MAX
+
+/*
+ * Cursor over the live (neither empty nor deleted) rows of a range of datablocks
+ */
+struct scan_cursor {
+	struct table *table;
+	/* position of the current datablock (see struct block_dir) */
+	size_t pos;
+	/* position the scan stops at (SCAN_END for full scans) */
+	size_t end;
+	/* next row slot within the current datablock */
+	size_t idx;
+	size_t row_size;
+	/* row slots per datablock */
+	size_t slots;
+	/* datablocks this returns false for are skipped altogether (optional) */
+	bool (*block_filter)(struct table *table, struct datablock *blk, void *arg);
+	void *filter_arg;
+};
+
+/*
+ * Morsel-driven scans: a table is split into morsels of SCAN_MORSEL_BLOCKS datablocks and a wave of
+ * morsels is processed in parallel by the database's worker pool. Each morsel has its own output
+ * buffer so workers never share anything, buffers are then consumed in storage order by the caller.
+ */
+struct morsel {
+	/* position of the first datablock */
+	size_t first;
+	/* position right after the last datablock */
+	size_t end;
+	/* thread-local output buffer */
+	struct vector out;
+	size_t count;
+	int ret;
+};
+
+struct morsel_scan {
+	struct worker_pool *pool;
+	struct table *table;
+	void (*fn)(struct morsel_scan *scan, struct morsel *morsel);
+	void *arg;
+	/* position of the first datablock of the next wave */
+	size_t pos;
+	/* current wave */
+	struct morsel *morsels;
+	size_t nmorsels;
+	size_t cap;
+};
+
+/**
+ * scan_cursor_init - initialise cursor
+ * @cur: cursor reference
+ * @table: table to be scanned
+ * @first: position of the first datablock. (0 for full scans)
+ * @end: position right after the last datablock to be scanned. (SCAN_END for full scans)
+ */
+void scan_cursor_init(struct scan_cursor *cur, struct table *table, size_t first, size_t end);
+
+/**
+ * scan_cursor_filter - skip datablocks that can't hold any row of interest
+ * @cur: cursor reference (before the first call to scan_cursor_next)
+ * @fn: called once per datablock, returns false if none of its rows are of interest
+ * @arg: argument passed on to fn
+ */
+void scan_cursor_filter(struct scan_cursor *cur, bool (*fn)(struct table *table, struct datablock *blk, void *arg),
+		void *arg);
+
+/**
+ * scan_cursor_next - move on to the next live row
+ * @cur: cursor reference
+ * @blk: datablock the row lives in. (optional)
+ * @offset: offset of the row within the datablock. (optional)
+ *
+ * this function returns the row or NULL if there aren't any rows left
+ */
+struct row* scan_cursor_next(struct scan_cursor *cur, struct datablock **blk, size_t *offset);
+
+/**
+ * scan_block_may_match - check a datablock against a predicate through its zone maps / Bloom filters
+ * @table: table reference
+ * @blk: datablock reference
+ * @prog: predicate compiled against the table layout
+ *
+ * only comparisons to literals and IS [NOT] NULL tests every match must satisfy are checked, rows
+ * themselves aren't looked at. (VARCHAR columns only through '=' if they have Bloom filters)
+ *
+ * this function returns false if no row of the datablock can match the predicate, true otherwise
+ */
+bool scan_block_may_match(struct table *table, struct datablock *blk, struct bytecode *prog);
+
+/**
+ * scan_index_lookup - find the rows a set of AND'ed predicates matches through column indexes
+ * @table: table reference
+ * @progs: predicates compiled against the table layout
+ * @count: number of predicates
+ * @locs: empty vector matches are pushed to as struct row_location. (in storage order)
+ *
+ * only comparisons to literals every match must satisfy are looked up through B-tree and hash
+ * indexes: 'column = literal' if there's one, otherwise the range an ordered index is bounded to by
+ * '<', '<=', '>' and '>=' comparisons. Before falling back to ranges, comparisons of TINYINT
+ * columns with bitmap indexes are combined as bitmaps, following the AND/OR/XOR structure of the
+ * predicates. (see struct bc_set_node) Either way, lookups that hold too many rows are given up on.
+ * The predicates are then run against the rows found.
+ *
+ * this function returns true if an index could be used, false if the table has to be scanned
+ */
+bool scan_index_lookup(struct table *table, struct bytecode **progs, size_t count, struct vector *locs);
+
+/**
+ * scan_index_bounds - narrow a range of values of an indexed column down to what a predicate matches
+ * @table: table reference
+ * @col_idx: column with a IT_BTREE index
+ * @prog: predicate compiled against the table layout
+ * @range: range to be narrowed down. (zeroed out to start with an unbounded one)
+ *
+ * keys are referenced from within the program so it must outlive the range.
+ *
+ * this function returns true if the predicate bounds the column at all, false otherwise
+ */
+bool scan_index_bounds(struct table *table, int col_idx, struct bytecode *prog, struct index_range *range);
+
+/**
+ * morsel_scan_is_parallel - check if scanning a table is worth splitting it up
+ * @pool: worker pool reference
+ * @table: table reference
+ *
+ * this function returns true if the table spans more than one morsel and there are threads to
+ * run them, false otherwise
+ */
+bool morsel_scan_is_parallel(struct worker_pool *pool, struct table *table);
+
+/**
+ * morsel_scan_init - initialise morsel-driven scan
+ * @scan: scan reference
+ * @pool: worker pool reference
+ * @table: table to be scanned
+ * @fn: called once for each morsel, possibly from different threads at the same time
+ * @arg: argument fn can get hold of through scan->arg
+ *
+ * this function returns true if the scan could be initialised, false otherwise
+ */
+bool morsel_scan_init(struct morsel_scan *scan, struct worker_pool *pool, struct table *table,
+		void (*fn)(struct morsel_scan *scan, struct morsel *morsel), void *arg);
+
+/**
+ * morsel_scan_wave - process the next wave of morsels
+ * @scan: scan reference
+ *
+ * output buffers of the previous wave are cleared before the new one starts.
+ *
+ * this function returns the number of morsels in the wave, 0 once the whole table was scanned
+ */
+size_t morsel_scan_wave(struct morsel_scan *scan);
+
+/**
+ * morsel_scan_match - morsel function collecting the rows a predicate matches
+ * @scan: scan reference. (scan->arg must point to the struct bytecode to be run)
+ * @morsel: morsel to be scanned
+ *
+ * matches are pushed to morsel->out as struct row_location in storage order and morsel->count is set to
+ * their number. datablocks whose zone maps rule the predicate out are skipped. Rows are left untouched
+ * so the caller can modify them safely afterwards.
+ */
+void morsel_scan_match(struct morsel_scan *scan, struct morsel *morsel);
+
+/**
+ * morsel_scan_free - free morsel-driven scan
+ * @scan: scan reference
+ */
+void morsel_scan_free(struct morsel_scan *scan);
+
+#endif /* INCLUDE_ENGINE_SCAN_H_ */
@@ -0,0 +1,71 @@
+/*
+ * worker.h
+ *
+ *  Created on: 17/10/2026
+ *      Author: paulo
+ */
+
+#ifndef INCLUDE_ENGINE_WORKER_H_
+#define INCLUDE_ENGINE_WORKER_H_
+
+#include <compiler/common.h>
+
+/*
+ * Fixed-size pool of worker threads. A job is made of 'ntasks' independent tasks (e.g. morsels of a
+ * table) that are handed out one at a time to whichever thread asks for one first, the thread that
+ * submitted the job lends a hand too. Threads are only spawned the first time a job needs them.
+ */
+struct worker_pool {
+	/* total parallelism, including the thread submitting jobs */
+	size_t nthreads;
+	pthread_t *threads;
+	size_t nspawned;
+	pthread_mutex_t mutex;
+	pthread_cond_t job_cond;
+	pthread_cond_t done_cond;
+	/* current job */
+	void (*fn)(void *arg, size_t task);
+	void *arg;
+	size_t ntasks;
+	size_t next_task;
+	uint64_t generation;
+	/* workers that picked the current job up / are still running it */
+	size_t joined;
+	size_t active;
+	bool stop;
+	/* only one job at a time, concurrent statements run theirs on their own thread */
+	pthread_mutex_t run_mutex;
+};
+
+/**
+ * worker_pool_default_threads - number of threads pools get by default
+ *
+ * this function returns the number of online CPUs
+ */
+size_t worker_pool_default_threads(void);
+
+/**
+ * worker_pool_init - initialise a worker pool
+ * @pool: pool to be initialised
+ * @nthreads: number of threads that will run jobs. (1 means jobs are run by the caller alone)
+ *
+ * this function returns true if the pool could be initialised, false otherwise
+ */
+bool worker_pool_init(struct worker_pool *pool, size_t nthreads);
+
+/**
+ * worker_pool_destroy - stop and join worker threads
+ * @pool: pool reference
+ */
+void worker_pool_destroy(struct worker_pool *pool);
+
+/**
+ * worker_pool_run - run a job and wait for all of its tasks to complete
+ * @pool: pool reference
+ * @ntasks: number of tasks
+ * @fn: function called once for every task (0..ntasks-1), possibly from different threads
+ * @arg: argument given to fn
+ */
+void worker_pool_run(struct worker_pool *pool, size_t ntasks, void (*fn)(void *arg, size_t task), void *arg);
+
+#endif /* INCLUDE_ENGINE_WORKER_H_ */
@@ -111,6 +111,8 @@ struct ast_crt_create_node {
 	char table_name[255 + 1 /*NUL char */];
 	bool if_not_exists;
 	int column_count;
+	/* datablock size (BLOCK_SIZE = n), 0 if datablocks are sized from the row width */
+	int block_size;
 };
 
 struct ast_crt_column_def_node {
@@ -129,6 +131,7 @@ struct ast_crt_column_def_node {
 	bool attr_uniq_key;
 	bool attr_auto_inc;
 	bool attr_prim_key;
+	bool attr_bloom;
 };
 
 /* Indexes -> Index || Primary Keys */
@@ -713,6 +716,8 @@ struct ast_sel_select_node {
 	struct list_head head;
 	/* DISTINCT keyword used */
 	bool distinct;
+	/* COUNT(*) can be answered from the table's row counter (set by optimiser) */
+	bool count_from_counter;
 };
 
 /* Select Statements - end */
@@ -0,0 +1,62 @@
+/*
+ * bloom.h
+ *
+ *  Created on: 17/10/2026
+ *      Author: paulo
+ */
+
+#ifndef INCLUDE_PRIMITIVE_BLOOM_H_
+#define INCLUDE_PRIMITIVE_BLOOM_H_
+
+#include <compiler/common.h>
+#include <primitive/table.h>
+#include <primitive/column.h>
+#include <primitive/row.h>
+#include <primitive/datablock.h>
+
+/* bits per row slot of a datablock - about 1% of false positives once the datablock is full */
+#define BLOOM_BITS_PER_ROW	10
+
+/* bits set per value */
+#define BLOOM_HASHES		7
+
+/*
+ * Bloom filters of the values of columns created with the BLOOM attribute, one per column per
+ * datablock. Equality predicates on those columns skip datablocks whose filter rules the literal
+ * out without following a single VARCHAR pointer.
+ *
+ * Values can't be taken out of a Bloom filter so deleted (or updated) rows linger until the
+ * datablock is rebuilt, i.e. vacuum and column changes.
+ */
+
+/**
+ * table_bloom_rebuild - recompute Bloom filters of a datablock from its live rows
+ * @table: table reference
+ * @blk: datablock reference
+ *
+ * datablocks of tables without BLOOM columns or that we couldn't get hold of the memory for are
+ * left without filters, they're never skipped then.
+ */
+void table_bloom_rebuild(struct table *table, struct datablock *blk);
+
+/**
+ * table_bloom_add_row - add a row's values to the Bloom filters of a datablock
+ * @table: table reference
+ * @blk: datablock the row lives in
+ * @row: live row that was just added to (or updated in) the datablock
+ */
+void table_bloom_add_row(struct table *table, struct datablock *blk, struct row *row);
+
+/**
+ * table_bloom_may_contain - check if a datablock may hold a value
+ * @table: table reference
+ * @blk: datablock reference
+ * @col_idx: column index
+ * @key: NUL-terminated string
+ *
+ * this function returns false if no live row of the datablock holds key in the column, true if some
+ * might (or the column has no Bloom filters)
+ */
+bool table_bloom_may_contain(struct table *table, struct datablock *blk, int col_idx, const char *key);
+
+#endif /* INCLUDE_PRIMITIVE_BLOOM_H_ */
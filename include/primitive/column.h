@@ -46,6 +46,8 @@ struct column {
 	bool primary_key;
 	/* is this column holding count(*) info */
 	bool is_count;
+	/* do datablocks keep a Bloom filter of this column's values ? (see primitive/bloom.h) */
+	bool bloom;
 };
 
 /**
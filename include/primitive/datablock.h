@@ -4,16 +4,189 @@
 #include "compiler/common.h"
 #include "datastructure/linkedlist.h"
 
+/* smallest datablock size (and the one tables start with), sizes are powers of 2 */
 #define DATABLOCK_PAGE_SIZE	4096
 
+/* largest datablock size */
+#define DATABLOCK_MAX_SIZE	(2 * 1024 * 1024)
+
+/*
+ * datablocks are carved out of regions this big (and aligned to it) - a huge page on x86-64.
+ * Regions of arenas whose datablocks don't fit are as many times bigger as it takes
+ */
+#define DATABLOCK_REGION_SIZE	(2 * 1024 * 1024)
+
+struct zone_map;
+
 struct datablock {
 	uint64_t block_id;
-	char data[DATABLOCK_PAGE_SIZE];
 	struct list_head head;
+	/* one per table column, NULL if there are none (see primitive/zonemap.h) */
+	struct zone_map *zones;
+	/* Bloom filters of BLOOM columns, NULL if there are none (see primitive/bloom.h) */
+	uint64_t *blooms;
+	/* slots of deleted rows inserts can reuse, NULL if there are none (see primitive/freespace.h) */
+	uint64_t *free_slots;
+	/* number of bits set in free_slots */
+	uint32_t free_count;
+	/* link within the free-space map of the table, only while free_count isn't 0 */
+	struct list_head free_link;
+	/* region the datablock was carved out of */
+	struct datablock_region *region;
+	/* as big as the arena the datablock came from says, within the data of its region */
+	char *data;
+};
+
+/*
+ * region datablocks are carved out of. Headers are kept apart from the mmap'ed data so the data of
+ * the datablocks is packed back to back, each one aligned to its size
+ */
+struct datablock_region {
+	struct list_head head;
+	/* datablocks carved out so far */
+	size_t carved;
+	/* datablocks carved out that haven't been freed */
+	size_t used;
+	/* region_size bytes aligned to it, the data of the i-th datablock starts i * block_size in */
+	char *data;
+	/* headers of the datablocks, region_blocks of them */
+	struct datablock blocks[];
+};
+
+/**
+ * struct datablock_arena - where the datablocks of a table come from
+ *
+ * @regions: struct datablock_region, the last one is the one new datablocks are carved out of
+ * @free_list: datablocks that were freed, (linked through their head) reused before carving
+ * 	new ones out
+ * @block_size: size of the data of each datablock
+ * @region_size: size of the data of each region, a power of 2 no smaller than block_size
+ * @region_blocks: number of datablocks a region holds, region_size / block_size
+ * @next_block_id: id of the next datablock handed out
+ *
+ * Datablocks of a table end up next to each other rather than all over the heap, and regions are
+ * backed by huge pages where the system lets us (MADV_HUGEPAGE) so scans miss the TLB a lot less.
+ */
+struct datablock_arena {
+	struct list_head regions;
+	struct list_head free_list;
+	size_t block_size;
+	size_t region_size;
+	size_t region_blocks;
+	uint64_t next_block_id;
+};
+
+/**
+ * struct block_dir - datablocks of a table by position, in the same order as its datablock list
+ *
+ * @blocks: datablock references
+ * @len: number of datablocks
+ * @cap: number of references there's room for
+ *
+ * The n-th datablock of a table is a lookup away rather than a walk down the list, so cursors and
+ * morsels can be kept as plain positions. Positions only shift when datablocks are released.
+ */
+struct block_dir {
+	struct datablock **blocks;
+	size_t len;
+	size_t cap;
 };
 
 struct list_head* __must_check datablock_init(void);
-struct datablock* __must_check datablock_alloc(struct list_head *head);
-void datablock_free(struct datablock *block);
+
+/**
+ * block_dir_init - initialise an empty block directory
+ * @dir: block directory reference
+ */
+void block_dir_init(struct block_dir *dir);
+
+/**
+ * block_dir_free - free a block directory (datablocks are left alone)
+ * @dir: block directory reference
+ */
+void block_dir_free(struct block_dir *dir);
+
+/**
+ * block_dir_push - append a datablock to a block directory
+ * @dir: block directory reference
+ * @block: datablock reference
+ *
+ * this function returns false if it fails to alloc memory
+ */
+bool __must_check block_dir_push(struct block_dir *dir, struct datablock *block);
+
+/**
+ * block_dir_del - drop the datablock at a given position, the ones after it move one position down
+ * @dir: block directory reference
+ * @pos: position of the datablock
+ */
+void block_dir_del(struct block_dir *dir, size_t pos);
+
+/**
+ * block_dir_find - find the position of a datablock through its id
+ * @dir: block directory reference
+ * @from: position the search starts at
+ * @block_id: id of the datablock
+ *
+ * block ids grow along the directory so this is a binary search.
+ *
+ * this function returns the position of the datablock, dir->len if it isn't there
+ */
+size_t block_dir_find(const struct block_dir *dir, size_t from, uint64_t block_id);
+
+/**
+ * block_dir_at - get the datablock at a given position
+ * @dir: block directory reference
+ * @pos: position of the datablock
+ *
+ * this function returns the datablock or NULL if the position is past the last one
+ */
+static inline struct datablock* block_dir_at(const struct block_dir *dir, size_t pos)
+{
+	return pos < dir->len ? dir->blocks[pos] : NULL;
+}
+
+/**
+ * datablock_size_valid - check if datablocks can be of a given size
+ * @size: size of the data of each datablock
+ *
+ * this function returns true if size is a power of 2 from DATABLOCK_PAGE_SIZE to DATABLOCK_MAX_SIZE
+ */
+bool datablock_size_valid(size_t size);
+
+/**
+ * datablock_arena_init - initialise an empty arena
+ * @arena: arena reference
+ * @block_size: size of the data of each datablock (see datablock_size_valid)
+ */
+void datablock_arena_init(struct datablock_arena *arena, size_t block_size);
+
+/**
+ * datablock_arena_destroy - unmap every region of an arena
+ * @arena: arena reference
+ *
+ * every datablock the arena handed out is gone afterwards, whether it was freed or not.
+ */
+void datablock_arena_destroy(struct datablock_arena *arena);
+
+/**
+ * datablock_alloc - get hold of a new datablock
+ * @arena: arena the datablock is taken from
+ * @head: list the datablock is appended to
+ *
+ * datablock content is left as is. (a freed datablock may be reused)
+ *
+ * this function returns the datablock or NULL if it fails to alloc memory
+ */
+struct datablock* __must_check datablock_alloc(struct datablock_arena *arena, struct list_head *head);
+
+/**
+ * datablock_free - give a datablock back to the arena it came from
+ * @arena: arena reference
+ * @block: datablock reference, unlinked from its list
+ *
+ * regions left without datablocks in use are unmapped, except for the last one.
+ */
+void datablock_free(struct datablock_arena *arena, struct datablock *block);
 
 #endif /* MM_DATABLOCK_H */
@@ -0,0 +1,59 @@
+/*
+ * freespace.h
+ *
+ *  Created on: 17/10/2026
+ *      Author: paulo
+ */
+
+#ifndef INCLUDE_PRIMITIVE_FREESPACE_H_
+#define INCLUDE_PRIMITIVE_FREESPACE_H_
+
+#include <compiler/common.h>
+#include <primitive/table.h>
+#include <primitive/datablock.h>
+
+/*
+ * Slots of deleted rows are handed back to inserts rather than left alone until the next vacuum.
+ * Each datablock keeps a bitmap of its deleted row slots and the table keeps the datablocks that
+ * have any (the free-space map) sorted in table order, so holes get filled from the start of the
+ * table and the tail is the part left for vacuum to release.
+ *
+ * Slots that couldn't be tracked (out of memory) simply stay deleted until vacuum.
+ */
+
+/**
+ * table_free_space_rebuild - recompute the free-slot bitmap of a datablock from its deleted rows
+ * @table: table reference
+ * @blk: datablock reference
+ */
+void table_free_space_rebuild(struct table *table, struct datablock *blk);
+
+/**
+ * table_free_slot_add - make the slot of a deleted row available to inserts
+ * @table: table reference
+ * @blk: datablock the row lives in
+ * @offset: offset to row inside datablock
+ */
+void table_free_slot_add(struct table *table, struct datablock *blk, size_t offset);
+
+/**
+ * table_free_slot_del - stop handing the slot of a deleted row out to inserts
+ * @table: table reference
+ * @blk: datablock the row lives in
+ * @offset: offset to row inside datablock
+ */
+void table_free_slot_del(struct table *table, struct datablock *blk, size_t offset);
+
+/**
+ * table_free_slot_take - get hold of the first slot inserts can reuse
+ * @table: table reference
+ * @blk: gets the datablock the slot lives in
+ * @offset: gets the offset to the slot inside the datablock
+ *
+ * the slot is no longer tracked afterwards, table_free_slot_add() gives it back.
+ *
+ * this function returns false if there are no free slots
+ */
+bool table_free_slot_take(struct table *table, struct datablock **blk, size_t *offset);
+
+#endif /* INCLUDE_PRIMITIVE_FREESPACE_H_ */
@@ -0,0 +1,295 @@
+/*
+ * index.h
+ *
+ *  Created on: 17/10/2026
+ *      Author: paulo
+ */
+
+#ifndef INCLUDE_PRIMITIVE_INDEX_H_
+#define INCLUDE_PRIMITIVE_INDEX_H_
+
+#include <compiler/common.h>
+#include <primitive/table.h>
+#include <primitive/row.h>
+#include <datastructure/bptree.h>
+#include <datastructure/bptree_i64.h>
+#include <datastructure/hashtable.h>
+#include <datastructure/roaring.h>
+#include <datastructure/vector.h>
+
+#define INDEX_BPTREE_ORDER	64
+
+/* bytes of keys per node of INTEGER/DATE/DATETIME indexes - tune to the cache size */
+#define INDEX_BPTREE_I64_NODE_SIZE	BPTREE_I64_DEFAULT_NODE_SIZE
+
+/* min number of rows for the sort of a bulk build to be split across a worker pool */
+#define INDEX_BULK_PARALLEL_MIN		65536
+
+/* runs of a bulk build sort that are short enough to be insertion sorted */
+#define INDEX_BULK_INSERTION_SORT	16
+
+/* bitmaps of a IT_BITMAP index, rows holding false and true are found at their own value */
+#define INDEX_BITMAP_NULL	2
+#define INDEX_BITMAP_COUNT	3
+
+struct worker_pool;
+
+/* where a row lives */
+struct row_location {
+	struct datablock *blk;
+	/* offset of the row within the datablock */
+	size_t offset;
+};
+
+enum INDEX_TYPE {
+	/* ordered, any number of rows may hold the same value */
+	IT_BTREE,
+	/* unordered, values are held by a single row - backs UNIQUE / PRIMARY KEY columns */
+	IT_HASH,
+	/* compressed bitmap of rows per value, NULLs included - TINYINT columns only */
+	IT_BITMAP,
+};
+
+/*
+ * Secondary index on a single column. Keys are column values (NULLs aren't indexed, except by
+ * IT_BITMAP indexes) and each of them maps to the location of every live row holding that value.
+ */
+struct index {
+	/* indexed column */
+	int col_idx;
+	/* offset of the column within row data */
+	size_t col_offset;
+	enum INDEX_TYPE type;
+	/* IT_BTREE on a INTEGER/DATE/DATETIME column (itree is used then) */
+	bool int_keys;
+	/* IT_BITMAP only: a row move couldn't be recorded, lookups are turned down from then on */
+	bool is_stale;
+	union {
+		/* value -> struct index_entry */
+		struct bptree_head *tree;
+		/* INTEGER/DATE/DATETIME value -> struct index_entry */
+		struct bptree_i64_head *itree;
+		/* value -> struct row_location */
+		struct hashtable *hash;
+		/* value (or INDEX_BITMAP_NULL) -> rows, see table_index_row_id() */
+		struct roaring *bitmaps;
+	};
+};
+
+/*
+ * Range of values of an IT_BTREE index, either bound can be left out (NULL) to leave it open
+ */
+struct index_range {
+	void *lo;
+	void *hi;
+	bool lo_incl;
+	bool hi_incl;
+};
+
+/**
+ * table_index_create - create index on a column and populate it with existing rows
+ *
+ * @table: table reference
+ * @col_idx: column to be indexed
+ * @type: index type. (IT_HASH indexes can't be created if existing rows hold duplicate values,
+ * 	IT_BITMAP ones are for TINYINT columns only)
+ * @pool: worker pool existing rows can be sorted with, NULL if they must be sorted by this thread alone
+ *
+ * IT_BTREE indexes are built bottom-up out of existing rows sorted by value rather than inserting
+ * them one at a time.
+ *
+ * Note: this method is not thread-safe. It is the caller's responsibility to
+ * call table_lock() before calling this method.
+ *
+ * This function returns true if the index could be created, false otherwise
+ */
+bool table_index_create(struct table *table, int col_idx, enum INDEX_TYPE type, struct worker_pool *pool);
+
+/**
+ * table_index_destroy - drop index on a column (if any)
+ *
+ * @table: table reference
+ * @col_idx: indexed column
+ *
+ * Note: this method is not thread-safe. It is the caller's responsibility to
+ * call table_lock() before calling this method.
+ */
+void table_index_destroy(struct table *table, int col_idx);
+
+/**
+ * table_index_move_row - point every index of a table to the new location of a row
+ *
+ * @table: table reference
+ * @blk: pointer to datablock where row resides
+ * @offset: offset to row inside datablock
+ * @new_blk: pointer to datablock row is being moved to
+ * @new_offset: offset to row inside the new datablock
+ *
+ * Must be called before the row is copied over (or changed in any way) for live rows only. Rows
+ * can't be moved past each other: the relative storage order of every row must be preserved.
+ *
+ * Note: this method is not thread-safe. It is the caller's responsibility to
+ * call table_lock() before calling this method.
+ */
+void table_index_move_row(struct table *table, struct datablock *blk, size_t offset, struct datablock *new_blk,
+		size_t new_offset);
+
+/**
+ * table_index_remap_columns - let indexes know columns have been shifted around
+ *
+ * @table: table reference
+ *
+ * Indexes are expected to have been moved along with their columns within table->indexes.
+ *
+ * Note: this method is not thread-safe. It is the caller's responsibility to
+ * call table_lock() before calling this method.
+ */
+void table_index_remap_columns(struct table *table);
+
+/**
+ * table_index_insert_row - add row to every index of a table
+ *
+ * @table: table reference
+ * @blk: pointer to datablock where row resides
+ * @offset: offset to row inside datablock
+ *
+ * Note: this method is not thread-safe. It is the caller's responsibility to
+ * call table_lock() before calling this method.
+ *
+ * This function returns true if successful, false otherwise. (indexes are left untouched then)
+ */
+bool table_index_insert_row(struct table *table, struct datablock *blk, size_t offset);
+
+/**
+ * table_index_delete_row - remove row from every index of a table
+ *
+ * @table: table reference
+ * @blk: pointer to datablock where row resides
+ * @offset: offset to row inside datablock
+ *
+ * Note: this method is not thread-safe. It is the caller's responsibility to
+ * call table_lock() before calling this method.
+ *
+ * This function returns true if successful, false otherwise. (indexes are left untouched then)
+ */
+bool table_index_delete_row(struct table *table, struct datablock *blk, size_t offset);
+
+/**
+ * table_index_lookup - look up rows holding a given value
+ *
+ * @table: table reference
+ * @col_idx: indexed column
+ * @key: value to look up. (in the same format it is stored in rows, except VARCHARs
+ * 	which are given as plain strings)
+ * @out: vector struct row_location entries are appended to - in storage order
+ *
+ * This function returns true if successful, false otherwise
+ */
+bool table_index_lookup(struct table *table, int col_idx, void *key, struct vector *out);
+
+/**
+ * table_index_range_bound - narrow a range of values of an index down
+ *
+ * @table: table reference
+ * @col_idx: column with a IT_BTREE index
+ * @range: range to be narrowed down. (zeroed out to start with an unbounded one)
+ * @key: value of the new bound. (same format as table_index_lookup)
+ * @lower: whether that's a lower bound ('>' or '>=') or an upper one ('<' or '<=')
+ * @incl: whether the value itself is within the range
+ *
+ * the new bound only replaces the current one if it's tighter. keys are referenced rather than
+ * copied so they must outlive the range.
+ */
+void table_index_range_bound(struct table *table, int col_idx, struct index_range *range, void *key,
+		bool lower, bool incl);
+
+/**
+ * table_index_range - look up rows holding values within a range
+ *
+ * @table: table reference
+ * @col_idx: column with a IT_BTREE index
+ * @range: range of values
+ * @desc: whether values are walked in descending order rather than ascending
+ * @limit: max number of rows to be looked up
+ * @out: vector struct row_location entries are appended to - in value order, then in storage
+ * 	order for rows holding the same value
+ *
+ * This function returns MIDORIDB_OK if successful, -MIDORIDB_NOMEM if memory couldn't be allocated
+ * or -MIDORIDB_ERROR if there are more rows than @limit within the range. (@out holds some of them then)
+ */
+int table_index_range(struct table *table, int col_idx, struct index_range *range, bool desc, size_t limit,
+		struct vector *out);
+
+/**
+ * table_index_bitmap - get hold of the rows of a IT_BITMAP index holding a given value
+ *
+ * @table: table reference
+ * @col_idx: indexed column
+ * @value: false, true or INDEX_BITMAP_NULL
+ *
+ * Bitmaps are made of table_index_row_id() values and belong to the index, they're only valid
+ * until the table is changed.
+ *
+ * This function returns the bitmap or NULL if the column hasn't got a usable IT_BITMAP index
+ */
+const struct roaring* table_index_bitmap(struct table *table, int col_idx, int value);
+
+/**
+ * table_index_row_id - id of a row within IT_BITMAP indexes
+ *
+ * @loc: row location
+ *
+ * ids sort the same way rows are stored.
+ */
+static inline uint64_t table_index_row_id(struct row_location *loc)
+{
+	return loc->blk->block_id << 32 | loc->offset;
+}
+
+/**
+ * table_index_bitmap_locs - turn a bitmap of row ids into row locations
+ *
+ * @table: table reference
+ * @rows: bitmap of table_index_row_id() values of live rows of the table
+ * @out: vector struct row_location entries are appended to - in storage order
+ *
+ * This function returns true if successful, false otherwise
+ */
+bool table_index_bitmap_locs(struct table *table, const struct roaring *rows, struct vector *out);
+
+/**
+ * row_location_cmp - compare row locations by storage order (qsort comparator)
+ *
+ * @loc1: struct row_location reference
+ * @loc2: struct row_location reference
+ */
+int row_location_cmp(const void *loc1, const void *loc2);
+
+/**
+ * table_index_is_duplicate - check if a value is taken by a row other than a given one
+ *
+ * @table: table reference
+ * @col_idx: column with a IT_HASH index
+ * @key: value to look up. (same format as table_index_lookup)
+ * @blk: pointer to datablock where row resides. (NULL for rows that haven't been inserted yet)
+ * @offset: offset to row inside datablock
+ *
+ * This function returns true if another row holds that value already, false otherwise
+ */
+bool table_index_is_duplicate(struct table *table, int col_idx, void *key, struct datablock *blk, size_t offset);
+
+/**
+ * table_index_find_duplicates - find UNIQUE values of new rows that are taken already
+ *
+ * @table: table reference
+ * @rows: rows about to be inserted
+ * @count: number of rows
+ * @dup_col: index of the first column whose value is taken (output)
+ *
+ * Values repeated among @rows count as taken too.
+ *
+ * Returns: 0 if there are none, -MIDORIDB_ERROR if a value is taken, < 0 otherwise. See <error.h> for details.
+ */
+int table_index_find_duplicates(struct table *table, struct row **rows, size_t count, int *dup_col);
+
+#endif /* INCLUDE_PRIMITIVE_INDEX_H_ */
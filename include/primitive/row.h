@@ -39,6 +39,19 @@ struct row {
  */
 bool table_insert_row(struct table *table, struct row *row, size_t len);
 
+/**
+ * table_insert_row_loc - insert row into a table and tell where it went
+ *
+ * @table: table reference
+ * @row: struct row pointer to be inserted into table
+ * @len: size of row data to be read from row ptr
+ * @blk: set to the datablock the row was put in
+ * @offset: set to the offset of the row inside that datablock
+ *
+ * Same as table_insert_row, so the caller can take the row back out with table_delete_row.
+ */
+bool table_insert_row_loc(struct table *table, struct row *row, size_t len, struct datablock **blk, size_t *offset);
+
 /**
  * table_delete_row - delete row from table
  *
@@ -52,7 +65,7 @@ bool table_insert_row(struct table *table, struct row *row, size_t len);
 bool table_delete_row(struct table *table, struct datablock *blk, size_t offset);
 
 /**
- * table_update_row - delete row from table
+ * table_update_row - update row content
  *
  * @table: table reference
  * @blk: pointer to datablock where row resides
@@ -62,6 +75,8 @@ bool table_delete_row(struct table *table, struct datablock *blk, size_t offset)
  * 
  * Note: this method is not thread-safe. It is the caller's responsibility to
  * call table_lock() before calling this method.
+ *
+ * This function returns true if successful, false otherwise. (row and indexes are left as they were then)
  */
 bool table_update_row(struct table *table, struct datablock *blk, size_t offset, struct row *row, size_t len);
 
@@ -90,4 +105,25 @@ size_t table_calc_row_size(struct table *table);
  */
 void table_free_row_content(struct table *table, struct row *row);
 
+/**
+ * table_dup_row - copy a row, VARCHAR content included
+ *
+ * @table: table reference
+ * @row: row reference
+ *
+ * The copy owns its VARCHAR buffers, free it with table_free_row_content() and free().
+ *
+ * This function returns the copy or NULL if it fails to alloc memory
+ */
+struct row* __must_check table_dup_row(struct table *table, struct row *row);
+
+/**
+ * table_copy_row_content - copy a row's content over another row
+ *
+ * @table: table reference
+ * @dst: row to be overwritten. (its VARCHAR buffers are kept, content is copied into them)
+ * @src: row to be copied
+ */
+void table_copy_row_content(struct table *table, struct row *dst, struct row *src);
+
 #endif /* INCLUDE_PRIMITIVE_ROW_H_ */
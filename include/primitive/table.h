@@ -16,10 +16,35 @@
 #define TABLE_MAX_COLUMNS		128
 #define TABLE_MAX_NAME			127
 
+/* datablocks sized from the row width hold at least that many rows (unless rows are too wide) */
+#define TABLE_BLOCK_MIN_ROWS		32
+
 /* sanity checks */
 BUILD_BUG(TABLE_MAX_COLUMNS > 8, "TABLE_MAX_COLUMNS has to be greater than 8");
 BUILD_BUG(IS_POWER_OF_2(TABLE_MAX_COLUMNS), "TABLE_MAX_COLUMNS must be a power of 2");
 
+struct index;
+
+/**
+ * struct vacuum_cursor - where an incremental vacuum pass is at (see table_vacuum_step)
+ *
+ * @active: is a pass under way?
+ * @dst: position of the datablock live rows are slid into (see struct block_dir)
+ * @dst_slot: slot the next live row goes to
+ * @src: position of the datablock of the next slot to be looked at, dst or the one right after it
+ * @src_slot: next slot to be looked at
+ *
+ * Slots in between dst and src are deleted rows left out of the free-space map, so nothing but the
+ * pass itself ever fills them.
+ */
+struct vacuum_cursor {
+	bool active;
+	size_t dst;
+	size_t dst_slot;
+	size_t src;
+	size_t src_slot;
+};
+
 struct table {
 
 	char name[TABLE_MAX_NAME + 1 /*NUL char */];
@@ -28,8 +53,29 @@ struct table {
 	int column_count;
 
 	struct list_head *datablock_head;
+	/* the same datablocks by position */
+	struct block_dir blocks;
+	/* where datablocks come from and go back to, it knows how big they are */
+	struct datablock_arena arena;
+	/* was the datablock size chosen at CREATE TABLE? otherwise it follows the row width */
+	bool fixed_block_size;
 	/* offset from the last datablock item with free space available */
 	size_t free_dtbkl_offset;
+	/* datablocks with slots of deleted rows inserts can reuse, in table order (see primitive/freespace.h) */
+	struct list_head free_space;
+
+	/* number of rows that are neither empty nor deleted */
+	size_t row_count;
+	/* number of rows marked as deleted that are yet to be vacuumed */
+	size_t deleted_row_count;
+
+	/* incremental vacuum pass under way, if any */
+	struct vacuum_cursor vacuum;
+	/* statements using the table right now, background maintenance leaves pinned tables alone */
+	size_t pins;
+
+	/* secondary index of each column, NULL if the column isn't indexed (see primitive/index.h) */
+	struct index *indexes[TABLE_MAX_COLUMNS];
 
 	/*
 	 * using mutex locks as it is POSIX.
@@ -80,6 +126,24 @@ struct table* __must_check table_init(char *name);
  */
 bool table_destroy(struct table **table);
 
+/**
+ * table_pin - let background maintenance know a statement is using a table
+ *
+ * @table: table reference
+ *
+ * Rows of a pinned table stay where they are until it is unpinned.
+ *
+ * Returns: 0 if successful, < 0 otherwise. See <error.h> for details.
+ */
+int __must_check table_pin(struct table *table);
+
+/**
+ * table_unpin - drop a pin taken with table_pin()
+ *
+ * @table: table reference
+ */
+void table_unpin(struct table *table);
+
 /**
  * table_vacuum - perform table vaccum on existing datablocks
  *
@@ -90,14 +154,71 @@ bool table_destroy(struct table **table);
  */
 bool table_vacuum(struct table *table);
 
+/**
+ * table_vacuum_step - compact a table a little at a time
+ *
+ * @table: table reference
+ * @budget: number of row slots that may be looked at
+ *
+ * Live rows are slid towards the start of the table, in order, picking up where the last step
+ * left off. A new pass starts at the first datablock with free slots. Datablocks left with
+ * nothing but deleted rows are released as soon as the pass is done with them, and deleted rows
+ * are trimmed off the end of the table once it gets there.
+ *
+ * Note: this method is not thread-safe. It is the caller's responsibility to
+ * call table_lock() before calling this method.
+ *
+ * This function returns true once the pass is complete, false if there is more to do
+ */
+bool table_vacuum_step(struct table *table, size_t budget);
+
 /**
  * table_datablock_init - initialise datablock for a given table
  *
  * @table: table reference
+ * @block: datablock reference
  * @offset: row offset
  * @row_size: size of each row
  */
-void table_datablock_init(struct datablock *block, size_t offset, size_t row_size);
+void table_datablock_init(struct table *table, struct datablock *block, size_t offset, size_t row_size);
+
+/**
+ * table_block_size - size of the datablocks of a table
+ *
+ * @table: table reference
+ */
+static inline size_t table_block_size(const struct table *table)
+{
+	return table->arena.block_size;
+}
+
+/**
+ * table_calc_block_size - calculate the datablock size for rows of a given size
+ *
+ * @row_size: size of each row
+ *
+ * that is the smallest one holding TABLE_BLOCK_MIN_ROWS rows, or the largest one if none does.
+ *
+ * this function returns the datablock size or 0 if rows don't fit even in the largest one
+ */
+size_t table_calc_block_size(size_t row_size);
+
+/**
+ * table_set_block_size - choose the size of the datablocks of a table
+ *
+ * @table: table reference
+ * @size: a power of 2 from DATABLOCK_PAGE_SIZE to DATABLOCK_MAX_SIZE, 0 to size them from the
+ * 	row width (see table_calc_block_size) as columns are added and removed
+ *
+ * datablocks of a table are all the same size so it can only be changed while it has none.
+ *
+ * Note: this method is not thread-safe. It is the caller's responsibility to
+ * call table_lock() before calling this method.
+ *
+ * This function returns true if successful, false if the table has datablocks already, the size is
+ * invalid or rows wouldn't fit
+ */
+bool table_set_block_size(struct table *table, size_t size);
 
 /**
  * table_validate_name - valida name of table
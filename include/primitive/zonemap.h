@@ -0,0 +1,89 @@
+/*
+ * zonemap.h
+ *
+ *  Created on: 17/10/2026
+ *      Author: paulo
+ */
+
+#ifndef INCLUDE_PRIMITIVE_ZONEMAP_H_
+#define INCLUDE_PRIMITIVE_ZONEMAP_H_
+
+#include <compiler/common.h>
+#include <primitive/table.h>
+#include <primitive/column.h>
+#include <primitive/row.h>
+#include <primitive/datablock.h>
+
+/* TINYINT, INTEGER, DATE and DATETIME values are held as int_val */
+union zone_value {
+	int64_t int_val;
+	double double_val;
+};
+
+/*
+ * Summary of the values a fixed-width column holds across the live rows of a datablock, scans
+ * skip datablocks whose summary rules out every row a predicate could match.
+ *
+ * Bounds are only ever widened while rows come and go (deleting the row that held the min doesn't
+ * tell us what the new one is) so they may be looser than they have to. They're made exact again
+ * whenever the whole datablock is walked anyway, i.e. vacuum and column changes.
+ */
+struct zone_map {
+	/* smallest and biggest non-NULL values, only valid if value_count isn't 0 */
+	union zone_value min;
+	union zone_value max;
+	/* number of live rows holding a non-NULL value */
+	uint32_t value_count;
+	/* number of live rows holding NULL */
+	uint32_t null_count;
+};
+
+/**
+ * zone_map_tracks - check if values of a column type are summarised
+ * @type: column type
+ *
+ * this function returns true for fixed-width types, false otherwise
+ */
+static inline bool zone_map_tracks(enum COLUMN_TYPE type)
+{
+	return type != CT_VARCHAR;
+}
+
+/**
+ * table_zone_rebuild - recompute zone maps of a datablock from its live rows
+ * @table: table reference
+ * @blk: datablock reference
+ *
+ * zone maps are allocated if the datablock has none yet. Datablocks we couldn't get hold of the
+ * memory for are left without them, they're never skipped then.
+ */
+void table_zone_rebuild(struct table *table, struct datablock *blk);
+
+/**
+ * table_zone_add_row - widen zone maps of a datablock to a row's values
+ * @table: table reference
+ * @blk: datablock the row lives in
+ * @row: live row that was just added to (or updated in) the datablock
+ */
+void table_zone_add_row(struct table *table, struct datablock *blk, struct row *row);
+
+/**
+ * table_zone_del_row - take a row out of the counts of the zone maps of a datablock
+ * @table: table reference
+ * @blk: datablock the row lives in
+ * @row: live row about to be deleted (or updated)
+ */
+void table_zone_del_row(struct table *table, struct datablock *blk, struct row *row);
+
+/**
+ * zone_value_cmp - compare a summarised value to a column value
+ * @type: column type
+ * @val: summarised value
+ * @key: column value (int64_t, double, bool or time_t according to the type)
+ *
+ * this function returns a negative number, zero or a positive number if val is less than,
+ * equal to or greater than key
+ */
+int zone_value_cmp(enum COLUMN_TYPE type, union zone_value *val, const void *key);
+
+#endif /* INCLUDE_PRIMITIVE_ZONEMAP_H_ */
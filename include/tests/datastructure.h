@@ -22,6 +22,21 @@ void test_btree_insert__increase_height(void);
 void test_btree_update(void);
 void test_btree_remove(void);
 
+void test_bptree_init(void);
+void test_bptree_insert(void);
+void test_bptree_remove(void);
+void test_bptree_cursor(void);
+void test_bptree_bulk_load(void);
+
+void test_bptree_i64_insert(void);
+void test_bptree_i64_remove(void);
+void test_bptree_i64_cursor(void);
+void test_bptree_i64_bulk_load(void);
+
+void test_roaring_add(void);
+void test_roaring_remove(void);
+void test_roaring_set_ops(void);
+
 void test_vector_init(void);
 void test_vector_push(void);
 void test_vector_free(void);
@@ -46,5 +61,6 @@ void test_hashtable_put(void);
 void test_hashtable_get(void);
 void test_hashtable_remove(void);
 void test_hashtable_iterate(void);
+void test_hashtable_mem_compare(void);
 
 #endif /* TESTS_DATASTRUCTURE_H */
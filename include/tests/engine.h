@@ -10,6 +10,8 @@
 
 #include <tests/unittest.h>
 
+struct database;
+
 /* test suites */
 bool engine_init_suite(void);
 
@@ -18,10 +20,13 @@ void test_executor_run(void);
 
 void test_optimiser_run(void);
 
+void test_filter_run(void);
+
 void test_database_open(void);
 void test_database_close(void);
 void test_database_add_table(void);
 void test_database_table_exists(void);
+void test_database_autovacuum(void);
 
 /* sub tests */
 void test_optimiser_insert(void);
@@ -33,4 +38,7 @@ void test_executor_delete(void);
 void test_executor_update(void);
 void test_executor_select(void);
 
+/* utility functions used across engine test suites */
+int count_rows(struct database *db, char *query);
+
 #endif /* INCLUDE_TESTS_ENGINE_H_ */
@@ -4,8 +4,15 @@
 #include <primitive/table.h>
 #include <primitive/column.h>
 #include <primitive/row.h>
+#include <primitive/index.h>
 #include <tests/unittest.h>
 
+/* row of the tables create_indexed_test_table returns, "str" is "row_<id>" */
+struct indexed_test_row {
+	int64_t id;
+	char *str;
+} __packed;
+
 /* test suites */
 bool primitive_init_suite(void);
 
@@ -13,20 +20,40 @@ bool primitive_init_suite(void);
 void test_datablock_init(void);
 void test_datablock_alloc(void);
 void test_datablock_free(void);
+void test_datablock_arena(void);
 void test_datablock_iterate(void);
+void test_datablock_dir(void);
 
 void test_table_init(void);
 void test_table_destroy(void);
+void test_table_block_size(void);
 void test_table_add_column(void);
 void test_table_rem_column(void);
 void test_table_insert_row(void);
 void test_table_delete_row(void);
 void test_table_update_row(void);
 void test_table_vacuum(void);
+void test_table_vacuum_step(void);
+
+void test_table_index(void);
+void test_table_index_bulk(void);
+void test_table_index_bitmap(void);
+
+void test_table_zone_map(void);
+
+void test_table_bloom(void);
+
+void test_table_free_space(void);
 
 /* utility functions used across primitive test suites */
 void create_test_table_fixed_precision_columns(struct table **out, size_t column_count);
 void create_test_table_var_precision_columns(struct table **out, size_t column_precision, size_t column_count);
 void create_test_table_mixed_precision_columns(struct table **out, size_t column_precision, size_t column_count);
 
+/* table of an indexed INTEGER id and a VARCHAR str column */
+struct table* create_indexed_test_table(void);
+void indexed_test_insert(struct table *table, int64_t id);
+/* row of a given id found through the index, NULL if there is none */
+struct row* indexed_test_lookup(struct table *table, int64_t id, struct row_location *loc);
+
 #endif /* TESTS_MM_H */
@@ -41,6 +41,6 @@ CCFLAGS		:= -std=gnu11 \
 			-fstack-protector-strong \
 			-Wvla \
 			-Wimplicit-fallthrough 
-LDFLAGS		:= -lm -lfl
+LDFLAGS		:= -lm -lfl -lpthread
 TEST_LDFLAGS	:= $(LDFLAGS) -lcunit
 MAKE_FLAGS	:= --quiet --no-print-directory
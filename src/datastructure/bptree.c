@@ -0,0 +1,624 @@
+/*
+ * bptree.c
+ *
+ * Notes to myself:
+ * 	- inner node keys are copies of leaf key pointers, keys[i] being the smallest key held by
+ * 		children[i + 1]. Keys >= keys[i] are routed right.
+ * 	- removing the smallest key of a subtree leaves its pointer behind as a separator. Keys are
+ * 		owned by callers (and usually freed right after removal) so separators matching the removed
+ * 		key are swapped for its successor before bptree_remove returns.
+ * 	- nodes are allocated with room for one extra key so insertions can overflow before splitting.
+ * 		Splits allocate their new node before anything is touched, that way running out of memory
+ * 		doesn't leave the tree half way through an insertion.
+ * 	- bulk loads build a level at a time from the leaves up. Each level is split into as few nodes
+ * 		as possible with entries spread evenly across them, so they are (nearly) full but never
+ * 		below the minimum the removal code relies on.
+ *
+ *  Created on: 17/10/2026
+ *      Author: paulo
+ */
+
+#include <datastructure/bptree.h>
+
+static inline int bptree_min_keys(struct bptree_head *head)
+{
+	return head->order / 2;
+}
+
+static struct bptree_node* bptree_node_alloc(struct bptree_head *head, bool is_leaf)
+{
+	struct bptree_node *node;
+	size_t size = sizeof(*node) + (2 * head->order + 3) * sizeof(void*);
+
+	if (!(node = zalloc(size)))
+		return NULL;
+
+	node->is_leaf = is_leaf;
+	node->keys = (void**)(node + 1);
+	node->ptrs = node->keys + head->order + 1;
+
+	return node;
+}
+
+/* index of the first key >= key */
+static int bptree_lower_bound(struct bptree_head *head, struct bptree_node *node, void *key)
+{
+	int lo = 0, hi = node->key_count, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+
+		if (head->cmp_fn(node->keys[mid], key) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/* index of the first key > key */
+static int bptree_upper_bound(struct bptree_head *head, struct bptree_node *node, void *key)
+{
+	int lo = 0, hi = node->key_count, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+
+		if (head->cmp_fn(node->keys[mid], key) <= 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+static struct bptree_node* bptree_find_leaf(struct bptree_head *head, void *key)
+{
+	struct bptree_node *node = head->root;
+
+	while (node && !node->is_leaf)
+		node = node->ptrs[bptree_upper_bound(head, node, key)];
+
+	return node;
+}
+
+struct bptree_head* bptree_init(int order, int (*cmp_fn)(void*, void*))
+{
+	struct bptree_head *head = NULL;
+
+	BUG_ON(order < 3);
+	BUG_ON(!cmp_fn);
+
+	if (!(head = zalloc(sizeof(*head))))
+		return NULL;
+
+	head->order = order;
+	head->cmp_fn = cmp_fn;
+
+	return head;
+}
+
+static void __bptree_destroy(struct bptree_node *node)
+{
+	if (!node->is_leaf) {
+		for (int i = 0; i <= node->key_count; i++)
+			__bptree_destroy(node->ptrs[i]);
+	}
+
+	free(node);
+}
+
+void bptree_destroy(struct bptree_head **head)
+{
+	if ((*head)->root)
+		__bptree_destroy((*head)->root);
+
+	free(*head);
+	*head = NULL;
+}
+
+void* bptree_lookup(struct bptree_head *head, void *key)
+{
+	struct bptree_node *leaf;
+	int idx;
+
+	if (!(leaf = bptree_find_leaf(head, key)))
+		return NULL;
+
+	idx = bptree_lower_bound(head, leaf, key);
+
+	if (idx < leaf->key_count && head->cmp_fn(leaf->keys[idx], key) == 0)
+		return leaf->ptrs[idx];
+
+	return NULL;
+}
+
+static void bptree_split_leaf(struct bptree_node *node, struct bptree_node *right, void **up_key)
+{
+	int mid = node->key_count / 2;
+
+	right->key_count = node->key_count - mid;
+	memcpy(right->keys, &node->keys[mid], right->key_count * sizeof(void*));
+	memcpy(right->ptrs, &node->ptrs[mid], right->key_count * sizeof(void*));
+	node->key_count = mid;
+
+	right->next = node->next;
+	right->prev = node;
+	if (right->next)
+		right->next->prev = right;
+	node->next = right;
+
+	*up_key = right->keys[0];
+}
+
+static void bptree_split_inner(struct bptree_node *node, struct bptree_node *right, void **up_key)
+{
+	int mid = node->key_count / 2;
+
+	/* middle key moves up, it isn't kept in either half */
+	*up_key = node->keys[mid];
+
+	right->key_count = node->key_count - mid - 1;
+	memcpy(right->keys, &node->keys[mid + 1], right->key_count * sizeof(void*));
+	memcpy(right->ptrs, &node->ptrs[mid + 1], (right->key_count + 1) * sizeof(void*));
+	node->key_count = mid;
+}
+
+static int bptree_node_insert(struct bptree_head *head, struct bptree_node *node, void *key, void *val,
+		void **up_key, struct bptree_node **up_node)
+{
+	struct bptree_node *right = NULL;
+	struct bptree_node *child_right = NULL;
+	void *child_key;
+	int idx;
+	int ret;
+
+	*up_node = NULL;
+
+	if (node->is_leaf) {
+		idx = bptree_lower_bound(head, node, key);
+
+		if (idx < node->key_count && head->cmp_fn(node->keys[idx], key) == 0)
+			return -MIDORIDB_ERROR;
+
+		if (node->key_count == head->order && !(right = bptree_node_alloc(head, true)))
+			return -MIDORIDB_NOMEM;
+
+		memmove(&node->keys[idx + 1], &node->keys[idx], (node->key_count - idx) * sizeof(void*));
+		memmove(&node->ptrs[idx + 1], &node->ptrs[idx], (node->key_count - idx) * sizeof(void*));
+		node->keys[idx] = key;
+		node->ptrs[idx] = val;
+		node->key_count++;
+
+		if (right) {
+			bptree_split_leaf(node, right, up_key);
+			*up_node = right;
+		}
+
+		return 0;
+	}
+
+	/* node only overflows if the child splits, but by then it'd be too late to back off */
+	if (node->key_count == head->order && !(right = bptree_node_alloc(head, false)))
+		return -MIDORIDB_NOMEM;
+
+	idx = bptree_upper_bound(head, node, key);
+
+	if ((ret = bptree_node_insert(head, node->ptrs[idx], key, val, &child_key, &child_right)))
+		goto out;
+
+	if (!child_right)
+		goto out;
+
+	memmove(&node->keys[idx + 1], &node->keys[idx], (node->key_count - idx) * sizeof(void*));
+	memmove(&node->ptrs[idx + 2], &node->ptrs[idx + 1], (node->key_count - idx) * sizeof(void*));
+	node->keys[idx] = child_key;
+	node->ptrs[idx + 1] = child_right;
+	node->key_count++;
+
+	if (node->key_count > head->order) {
+		bptree_split_inner(node, right, up_key);
+		*up_node = right;
+		return 0;
+	}
+
+out:
+	free(right);
+	return ret;
+}
+
+int bptree_insert(struct bptree_head *head, void *key, void *val)
+{
+	struct bptree_node *new_root = NULL;
+	struct bptree_node *right;
+	void *up_key;
+	int ret;
+
+	BUG_ON(!val);
+
+	if (!head->root && !(head->root = bptree_node_alloc(head, true)))
+		return -MIDORIDB_NOMEM;
+
+	if (head->root->key_count == head->order && !(new_root = bptree_node_alloc(head, false)))
+		return -MIDORIDB_NOMEM;
+
+	if ((ret = bptree_node_insert(head, head->root, key, val, &up_key, &right)))
+		goto out;
+
+	head->count++;
+
+	if (!right)
+		goto out;
+
+	new_root->keys[0] = up_key;
+	new_root->ptrs[0] = head->root;
+	new_root->ptrs[1] = right;
+	new_root->key_count = 1;
+	head->root = new_root;
+
+	return 0;
+
+out:
+	free(new_root);
+	return ret;
+}
+
+/* frees the nodes of a level that's half way built, children are left alone */
+static void bptree_free_level(struct bptree_node **level, size_t built)
+{
+	for (size_t i = 0; i < built; i++)
+		free(level[i]);
+}
+
+int bptree_bulk_load(struct bptree_head *head, void **keys, void **vals, size_t count)
+{
+	struct bptree_node **lower = NULL, **level, *node, *prev = NULL;
+	void **lower_firsts = NULL, **firsts;
+	size_t nlower = 0, nnodes, nitems, pos = 0;
+
+	if (head->count)
+		return -MIDORIDB_ERROR;
+
+	if (!count)
+		return 0;
+
+	/* leaves, entries are spread evenly so none of them is left with less than the minimum */
+	nitems = count;
+	nnodes = (count + head->order - 1) / head->order;
+
+	for (;;) {
+		if (!(level = malloc(nnodes * sizeof(*level))))
+			goto err;
+
+		if (!(firsts = malloc(nnodes * sizeof(*firsts))))
+			goto err_firsts;
+
+		pos = 0;
+
+		for (size_t i = 0; i < nnodes; i++) {
+			size_t n = nitems / nnodes + (i < nitems % nnodes);
+
+			if (!(node = bptree_node_alloc(head, !lower))) {
+				bptree_free_level(level, i);
+				goto err_node;
+			}
+
+			if (!lower) {
+				memcpy(node->keys, &keys[pos], n * sizeof(void*));
+				memcpy(node->ptrs, &vals[pos], n * sizeof(void*));
+				node->key_count = n;
+				firsts[i] = keys[pos];
+
+				node->prev = prev;
+				if (prev)
+					prev->next = node;
+				prev = node;
+			} else {
+				/* separators are the smallest key of every child but the first one */
+				memcpy(node->keys, &lower_firsts[pos + 1], (n - 1) * sizeof(void*));
+				memcpy(node->ptrs, &lower[pos], n * sizeof(void*));
+				node->key_count = n - 1;
+				firsts[i] = lower_firsts[pos];
+			}
+
+			level[i] = node;
+			pos += n;
+		}
+
+		free(lower);
+		free(lower_firsts);
+		lower = level;
+		lower_firsts = firsts;
+		nlower = nnodes;
+
+		if (nnodes == 1)
+			break;
+
+		nitems = nnodes;
+		nnodes = (nnodes + head->order) / (head->order + 1);
+	}
+
+	/* an insertion that ran out of memory may have left an empty leaf behind */
+	free(head->root);
+
+	head->root = lower[0];
+	head->count = count;
+
+	free(lower);
+	free(lower_firsts);
+
+	return 0;
+
+err_node:
+	free(firsts);
+err_firsts:
+	free(level);
+err:
+	/* the level underneath is complete, so are the subtrees hanging from it */
+	for (size_t i = 0; i < nlower; i++)
+		__bptree_destroy(lower[i]);
+
+	free(lower);
+	free(lower_firsts);
+	return -MIDORIDB_NOMEM;
+}
+
+static void bptree_borrow_from_prev(struct bptree_node *parent, int idx)
+{
+	struct bptree_node *child = parent->ptrs[idx];
+	struct bptree_node *sibling = parent->ptrs[idx - 1];
+
+	memmove(&child->keys[1], &child->keys[0], child->key_count * sizeof(void*));
+
+	if (child->is_leaf) {
+		memmove(&child->ptrs[1], &child->ptrs[0], child->key_count * sizeof(void*));
+		child->keys[0] = sibling->keys[sibling->key_count - 1];
+		child->ptrs[0] = sibling->ptrs[sibling->key_count - 1];
+		parent->keys[idx - 1] = child->keys[0];
+	} else {
+		memmove(&child->ptrs[1], &child->ptrs[0], (child->key_count + 1) * sizeof(void*));
+		child->keys[0] = parent->keys[idx - 1];
+		child->ptrs[0] = sibling->ptrs[sibling->key_count];
+		parent->keys[idx - 1] = sibling->keys[sibling->key_count - 1];
+	}
+
+	child->key_count++;
+	sibling->key_count--;
+}
+
+static void bptree_borrow_from_next(struct bptree_node *parent, int idx)
+{
+	struct bptree_node *child = parent->ptrs[idx];
+	struct bptree_node *sibling = parent->ptrs[idx + 1];
+
+	if (child->is_leaf) {
+		child->keys[child->key_count] = sibling->keys[0];
+		child->ptrs[child->key_count] = sibling->ptrs[0];
+		memmove(&sibling->ptrs[0], &sibling->ptrs[1], (sibling->key_count - 1) * sizeof(void*));
+		memmove(&sibling->keys[0], &sibling->keys[1], (sibling->key_count - 1) * sizeof(void*));
+		parent->keys[idx] = sibling->keys[0];
+	} else {
+		child->keys[child->key_count] = parent->keys[idx];
+		child->ptrs[child->key_count + 1] = sibling->ptrs[0];
+		parent->keys[idx] = sibling->keys[0];
+		memmove(&sibling->ptrs[0], &sibling->ptrs[1], sibling->key_count * sizeof(void*));
+		memmove(&sibling->keys[0], &sibling->keys[1], (sibling->key_count - 1) * sizeof(void*));
+	}
+
+	child->key_count++;
+	sibling->key_count--;
+}
+
+/* merges children[idx + 1] into children[idx] */
+static void bptree_merge(struct bptree_node *parent, int idx)
+{
+	struct bptree_node *child = parent->ptrs[idx];
+	struct bptree_node *sibling = parent->ptrs[idx + 1];
+
+	if (child->is_leaf) {
+		memcpy(&child->keys[child->key_count], sibling->keys, sibling->key_count * sizeof(void*));
+		memcpy(&child->ptrs[child->key_count], sibling->ptrs, sibling->key_count * sizeof(void*));
+		child->key_count += sibling->key_count;
+
+		child->next = sibling->next;
+		if (child->next)
+			child->next->prev = child;
+	} else {
+		child->keys[child->key_count] = parent->keys[idx];
+		memcpy(&child->keys[child->key_count + 1], sibling->keys, sibling->key_count * sizeof(void*));
+		memcpy(&child->ptrs[child->key_count + 1], sibling->ptrs, (sibling->key_count + 1) * sizeof(void*));
+		child->key_count += sibling->key_count + 1;
+	}
+
+	memmove(&parent->keys[idx], &parent->keys[idx + 1], (parent->key_count - idx - 1) * sizeof(void*));
+	memmove(&parent->ptrs[idx + 1], &parent->ptrs[idx + 2], (parent->key_count - idx - 1) * sizeof(void*));
+	parent->key_count--;
+
+	free(sibling);
+}
+
+static void bptree_rebalance(struct bptree_head *head, struct bptree_node *parent, int idx)
+{
+	struct bptree_node *prev = idx > 0 ? parent->ptrs[idx - 1] : NULL;
+	struct bptree_node *next = idx < parent->key_count ? parent->ptrs[idx + 1] : NULL;
+
+	if (prev && prev->key_count > bptree_min_keys(head))
+		bptree_borrow_from_prev(parent, idx);
+	else if (next && next->key_count > bptree_min_keys(head))
+		bptree_borrow_from_next(parent, idx);
+	else if (prev)
+		bptree_merge(parent, idx - 1);
+	else
+		bptree_merge(parent, idx);
+}
+
+static bool bptree_node_remove(struct bptree_head *head, struct bptree_node *node, void *key)
+{
+	struct bptree_node *child;
+	int idx;
+
+	if (node->is_leaf) {
+		idx = bptree_lower_bound(head, node, key);
+
+		if (idx == node->key_count || head->cmp_fn(node->keys[idx], key) != 0)
+			return false;
+
+		memmove(&node->keys[idx], &node->keys[idx + 1], (node->key_count - idx - 1) * sizeof(void*));
+		memmove(&node->ptrs[idx], &node->ptrs[idx + 1], (node->key_count - idx - 1) * sizeof(void*));
+		node->key_count--;
+
+		return true;
+	}
+
+	idx = bptree_upper_bound(head, node, key);
+	child = node->ptrs[idx];
+
+	if (!bptree_node_remove(head, child, key))
+		return false;
+
+	if (child->key_count < bptree_min_keys(head))
+		bptree_rebalance(head, node, idx);
+
+	return true;
+}
+
+/* swaps separators still pointing to a removed key for the key that now follows it */
+static void bptree_fix_separators(struct bptree_head *head, void *key)
+{
+	struct bptree_node *node = head->root;
+	struct bptree_node *leftmost;
+	int idx;
+
+	while (node && !node->is_leaf) {
+		idx = bptree_upper_bound(head, node, key);
+
+		if (idx > 0 && head->cmp_fn(node->keys[idx - 1], key) == 0) {
+			for (leftmost = node->ptrs[idx]; !leftmost->is_leaf; leftmost = leftmost->ptrs[0])
+				;
+			node->keys[idx - 1] = leftmost->keys[0];
+		}
+
+		node = node->ptrs[idx];
+	}
+}
+
+bool bptree_remove(struct bptree_head *head, void *key)
+{
+	struct bptree_node *root = head->root;
+
+	if (!root || !bptree_node_remove(head, root, key))
+		return false;
+
+	head->count--;
+
+	if (!root->is_leaf && root->key_count == 0) {
+		head->root = root->ptrs[0];
+		free(root);
+	} else if (root->is_leaf && root->key_count == 0) {
+		head->root = NULL;
+		free(root);
+	}
+
+	bptree_fix_separators(head, key);
+
+	return true;
+}
+
+void bptree_foreach(struct bptree_head *head, void (*fn)(void *key, void *value, void *arg), void *arg)
+{
+	struct bptree_cursor cur;
+	bool more;
+
+	/* fn may free keys, nodes are left alone though */
+	for (more = bptree_seek_ge(head, &cur, NULL); more; more = bptree_next(&cur))
+		fn(bptree_cursor_key(&cur), bptree_cursor_value(&cur), arg);
+}
+
+bool bptree_seek_ge(struct bptree_head *head, struct bptree_cursor *cur, void *key)
+{
+	struct bptree_node *node = head->root;
+
+	cur->node = NULL;
+	cur->idx = 0;
+
+	/* root may be left empty by a failed insertion */
+	if (!node || !head->count)
+		return false;
+
+	if (!key) {
+		while (!node->is_leaf)
+			node = node->ptrs[0];
+
+		cur->node = node;
+		return true;
+	}
+
+	node = bptree_find_leaf(head, key);
+	cur->node = node;
+	cur->idx = bptree_lower_bound(head, node, key);
+
+	/* every key of this leaf is smaller, so it must be the first of the next one */
+	if (cur->idx == node->key_count) {
+		cur->idx--;
+		return bptree_next(cur);
+	}
+
+	return true;
+}
+
+bool bptree_seek_le(struct bptree_head *head, struct bptree_cursor *cur, void *key)
+{
+	struct bptree_node *node = head->root;
+
+	cur->node = NULL;
+	cur->idx = 0;
+
+	/* root may be left empty by a failed insertion */
+	if (!node || !head->count)
+		return false;
+
+	if (!key) {
+		while (!node->is_leaf)
+			node = node->ptrs[node->key_count];
+
+		cur->node = node;
+		cur->idx = node->key_count - 1;
+		return true;
+	}
+
+	node = bptree_find_leaf(head, key);
+	cur->node = node;
+	cur->idx = bptree_upper_bound(head, node, key);
+
+	return bptree_prev(cur);
+}
+
+bool bptree_next(struct bptree_cursor *cur)
+{
+	if (!cur->node)
+		return false;
+
+	if (++cur->idx < cur->node->key_count)
+		return true;
+
+	cur->node = cur->node->next;
+	cur->idx = 0;
+
+	return cur->node != NULL;
+}
+
+bool bptree_prev(struct bptree_cursor *cur)
+{
+	if (!cur->node)
+		return false;
+
+	if (--cur->idx >= 0)
+		return true;
+
+	cur->node = cur->node->prev;
+	cur->idx = cur->node ? cur->node->key_count - 1 : 0;
+
+	return cur->node != NULL;
+}
@@ -0,0 +1,650 @@
+/*
+ * bptree_i64.c
+ *
+ * Notes to myself:
+ * 	- same algorithms as bptree.c, only keys are copied into the nodes so removals don't have to
+ * 		chase separators pointing to freed keys. (stale separators still route lookups correctly)
+ * 	- in-node search is a lower bound only, the first key > x is the first key >= x + 1.
+ * 	- keys are sorted so the mask of a SIMD compare is always a run of ones followed by zeros, the
+ * 		first zero is the answer and the rest of the node doesn't need to be looked at.
+ * 	- key arrays start on a cache line and vectors are loaded at multiples of their width so loads
+ * 		are always aligned. Tails shorter than a vector are left to the scalar loop.
+ *
+ *  Created on: 17/10/2026
+ *      Author: paulo
+ */
+
+#include <datastructure/bptree_i64.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BPTREE_I64_X86
+#include <immintrin.h>
+#endif
+
+BUILD_BUG(offsetof(struct bptree_i64_node, keys) % BPTREE_I64_CACHE_LINE == 0, "keys must start on a cache line");
+
+static int scalar_lower_bound(const int64_t *keys, int n, int64_t key)
+{
+	int lo = 0, hi = n, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+
+		if (keys[mid] < key)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+#ifdef BPTREE_I64_X86
+
+__attribute__((target("sse4.2")))
+static int sse42_lower_bound(const int64_t *keys, int n, int64_t key)
+{
+	__m128i r = _mm_set1_epi64x(key);
+	unsigned int ge;
+	int i;
+
+	for (i = 0; i + 2 <= n; i += 2) {
+		/* keys[i] >= key */
+		ge = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(r, _mm_load_si128((__m128i*)&keys[i])))) ^ 0x3;
+
+		if (ge)
+			return i + __builtin_ctz(ge);
+	}
+
+	for (; i < n && keys[i] < key; i++)
+		;
+
+	return i;
+}
+
+__attribute__((target("avx2")))
+static int avx2_lower_bound(const int64_t *keys, int n, int64_t key)
+{
+	__m256i r = _mm256_set1_epi64x(key);
+	unsigned int ge;
+	int i;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		/* keys[i] >= key */
+		ge = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(r,
+				_mm256_load_si256((__m256i*)&keys[i])))) ^ 0xf;
+
+		if (ge)
+			return i + __builtin_ctz(ge);
+	}
+
+	for (; i < n && keys[i] < key; i++)
+		;
+
+	return i;
+}
+
+#endif /* BPTREE_I64_X86 */
+
+static int (*pick_lower_bound(void))(const int64_t*, int, int64_t)
+{
+#ifdef BPTREE_I64_X86
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2"))
+		return &avx2_lower_bound;
+	else if (__builtin_cpu_supports("sse4.2"))
+		return &sse42_lower_bound;
+#endif
+
+	return &scalar_lower_bound;
+}
+
+/* index of the first key >= key */
+static inline int bptree_i64_lower_bound(struct bptree_i64_head *head, struct bptree_i64_node *node, int64_t key)
+{
+	return head->lower_bound(node->keys, node->key_count, key);
+}
+
+/* index of the first key > key */
+static inline int bptree_i64_upper_bound(struct bptree_i64_head *head, struct bptree_i64_node *node, int64_t key)
+{
+	if (key == INT64_MAX)
+		return node->key_count;
+
+	return head->lower_bound(node->keys, node->key_count, key + 1);
+}
+
+static inline int bptree_i64_min_keys(struct bptree_i64_head *head)
+{
+	return head->order / 2;
+}
+
+static struct bptree_i64_node* bptree_i64_node_alloc(struct bptree_i64_head *head, bool is_leaf)
+{
+	struct bptree_i64_node *node;
+	/* room for one extra key (and child) so nodes can overflow before they're split */
+	size_t keys_size = (head->order + 1) * sizeof(int64_t);
+	size_t size = sizeof(*node) + keys_size + (head->order + 2) * sizeof(void*);
+
+	/* aligned_alloc wants a multiple of the alignment */
+	size = (size + BPTREE_I64_CACHE_LINE - 1) & ~(size_t)(BPTREE_I64_CACHE_LINE - 1);
+
+	if (!(node = aligned_alloc(BPTREE_I64_CACHE_LINE, size)))
+		return NULL;
+
+	memzero(node, size);
+
+	node->is_leaf = is_leaf;
+	node->ptrs = (void**)((char*)node->keys + keys_size);
+
+	return node;
+}
+
+static struct bptree_i64_node* bptree_i64_find_leaf(struct bptree_i64_head *head, int64_t key)
+{
+	struct bptree_i64_node *node = head->root;
+
+	while (node && !node->is_leaf)
+		node = node->ptrs[bptree_i64_upper_bound(head, node, key)];
+
+	return node;
+}
+
+struct bptree_i64_head* bptree_i64_init(size_t node_size)
+{
+	struct bptree_i64_head *head = NULL;
+
+	BUG_ON(node_size < BPTREE_I64_CACHE_LINE || node_size % BPTREE_I64_CACHE_LINE);
+
+	if (!(head = zalloc(sizeof(*head))))
+		return NULL;
+
+	/* last slot is kept for overflows */
+	head->order = node_size / sizeof(int64_t) - 1;
+	head->lower_bound = pick_lower_bound();
+
+	return head;
+}
+
+static void __bptree_i64_destroy(struct bptree_i64_node *node)
+{
+	if (!node->is_leaf) {
+		for (int i = 0; i <= node->key_count; i++)
+			__bptree_i64_destroy(node->ptrs[i]);
+	}
+
+	free(node);
+}
+
+void bptree_i64_destroy(struct bptree_i64_head **head)
+{
+	if ((*head)->root)
+		__bptree_i64_destroy((*head)->root);
+
+	free(*head);
+	*head = NULL;
+}
+
+void* bptree_i64_lookup(struct bptree_i64_head *head, int64_t key)
+{
+	struct bptree_i64_node *leaf;
+	int idx;
+
+	if (!(leaf = bptree_i64_find_leaf(head, key)))
+		return NULL;
+
+	idx = bptree_i64_lower_bound(head, leaf, key);
+
+	if (idx < leaf->key_count && leaf->keys[idx] == key)
+		return leaf->ptrs[idx];
+
+	return NULL;
+}
+
+static void bptree_i64_split_leaf(struct bptree_i64_node *node, struct bptree_i64_node *right, int64_t *up_key)
+{
+	int mid = node->key_count / 2;
+
+	right->key_count = node->key_count - mid;
+	memcpy(right->keys, &node->keys[mid], right->key_count * sizeof(int64_t));
+	memcpy(right->ptrs, &node->ptrs[mid], right->key_count * sizeof(void*));
+	node->key_count = mid;
+
+	right->next = node->next;
+	right->prev = node;
+	if (right->next)
+		right->next->prev = right;
+	node->next = right;
+
+	*up_key = right->keys[0];
+}
+
+static void bptree_i64_split_inner(struct bptree_i64_node *node, struct bptree_i64_node *right, int64_t *up_key)
+{
+	int mid = node->key_count / 2;
+
+	/* middle key moves up, it isn't kept in either half */
+	*up_key = node->keys[mid];
+
+	right->key_count = node->key_count - mid - 1;
+	memcpy(right->keys, &node->keys[mid + 1], right->key_count * sizeof(int64_t));
+	memcpy(right->ptrs, &node->ptrs[mid + 1], (right->key_count + 1) * sizeof(void*));
+	node->key_count = mid;
+}
+
+static int bptree_i64_node_insert(struct bptree_i64_head *head, struct bptree_i64_node *node, int64_t key, void *val,
+		int64_t *up_key, struct bptree_i64_node **up_node)
+{
+	struct bptree_i64_node *right = NULL;
+	struct bptree_i64_node *child_right = NULL;
+	int64_t child_key;
+	int idx;
+	int ret;
+
+	*up_node = NULL;
+
+	if (node->is_leaf) {
+		idx = bptree_i64_lower_bound(head, node, key);
+
+		if (idx < node->key_count && node->keys[idx] == key)
+			return -MIDORIDB_ERROR;
+
+		if (node->key_count == head->order && !(right = bptree_i64_node_alloc(head, true)))
+			return -MIDORIDB_NOMEM;
+
+		memmove(&node->keys[idx + 1], &node->keys[idx], (node->key_count - idx) * sizeof(int64_t));
+		memmove(&node->ptrs[idx + 1], &node->ptrs[idx], (node->key_count - idx) * sizeof(void*));
+		node->keys[idx] = key;
+		node->ptrs[idx] = val;
+		node->key_count++;
+
+		if (right) {
+			bptree_i64_split_leaf(node, right, up_key);
+			*up_node = right;
+		}
+
+		return 0;
+	}
+
+	/* node only overflows if the child splits, but by then it'd be too late to back off */
+	if (node->key_count == head->order && !(right = bptree_i64_node_alloc(head, false)))
+		return -MIDORIDB_NOMEM;
+
+	idx = bptree_i64_upper_bound(head, node, key);
+
+	if ((ret = bptree_i64_node_insert(head, node->ptrs[idx], key, val, &child_key, &child_right)))
+		goto out;
+
+	if (!child_right)
+		goto out;
+
+	memmove(&node->keys[idx + 1], &node->keys[idx], (node->key_count - idx) * sizeof(int64_t));
+	memmove(&node->ptrs[idx + 2], &node->ptrs[idx + 1], (node->key_count - idx) * sizeof(void*));
+	node->keys[idx] = child_key;
+	node->ptrs[idx + 1] = child_right;
+	node->key_count++;
+
+	if (node->key_count > head->order) {
+		bptree_i64_split_inner(node, right, up_key);
+		*up_node = right;
+		return 0;
+	}
+
+out:
+	free(right);
+	return ret;
+}
+
+int bptree_i64_insert(struct bptree_i64_head *head, int64_t key, void *val)
+{
+	struct bptree_i64_node *new_root = NULL;
+	struct bptree_i64_node *right;
+	int64_t up_key;
+	int ret;
+
+	BUG_ON(!val);
+
+	if (!head->root && !(head->root = bptree_i64_node_alloc(head, true)))
+		return -MIDORIDB_NOMEM;
+
+	if (head->root->key_count == head->order && !(new_root = bptree_i64_node_alloc(head, false)))
+		return -MIDORIDB_NOMEM;
+
+	if ((ret = bptree_i64_node_insert(head, head->root, key, val, &up_key, &right)))
+		goto out;
+
+	head->count++;
+
+	if (!right)
+		goto out;
+
+	new_root->keys[0] = up_key;
+	new_root->ptrs[0] = head->root;
+	new_root->ptrs[1] = right;
+	new_root->key_count = 1;
+	head->root = new_root;
+
+	return 0;
+
+out:
+	free(new_root);
+	return ret;
+}
+
+static void bptree_i64_free_level(struct bptree_i64_node **level, size_t built)
+{
+	for (size_t i = 0; i < built; i++)
+		free(level[i]);
+}
+
+int bptree_i64_bulk_load(struct bptree_i64_head *head, const int64_t *keys, void **vals, size_t count)
+{
+	struct bptree_i64_node **lower = NULL, **level, *node, *prev = NULL;
+	int64_t *lower_firsts = NULL, *firsts;
+	size_t nlower = 0, nnodes, nitems, pos = 0;
+
+	if (head->count)
+		return -MIDORIDB_ERROR;
+
+	if (!count)
+		return 0;
+
+	/* see bptree_bulk_load() */
+	nitems = count;
+	nnodes = (count + head->order - 1) / head->order;
+
+	for (;;) {
+		if (!(level = malloc(nnodes * sizeof(*level))))
+			goto err;
+
+		if (!(firsts = malloc(nnodes * sizeof(*firsts))))
+			goto err_firsts;
+
+		pos = 0;
+
+		for (size_t i = 0; i < nnodes; i++) {
+			size_t n = nitems / nnodes + (i < nitems % nnodes);
+
+			if (!(node = bptree_i64_node_alloc(head, !lower))) {
+				bptree_i64_free_level(level, i);
+				goto err_node;
+			}
+
+			if (!lower) {
+				memcpy(node->keys, &keys[pos], n * sizeof(int64_t));
+				memcpy(node->ptrs, &vals[pos], n * sizeof(void*));
+				node->key_count = n;
+				firsts[i] = keys[pos];
+
+				node->prev = prev;
+				if (prev)
+					prev->next = node;
+				prev = node;
+			} else {
+				/* separators are the smallest key of every child but the first one */
+				memcpy(node->keys, &lower_firsts[pos + 1], (n - 1) * sizeof(int64_t));
+				memcpy(node->ptrs, &lower[pos], n * sizeof(void*));
+				node->key_count = n - 1;
+				firsts[i] = lower_firsts[pos];
+			}
+
+			level[i] = node;
+			pos += n;
+		}
+
+		free(lower);
+		free(lower_firsts);
+		lower = level;
+		lower_firsts = firsts;
+		nlower = nnodes;
+
+		if (nnodes == 1)
+			break;
+
+		nitems = nnodes;
+		nnodes = (nnodes + head->order) / (head->order + 1);
+	}
+
+	/* an insertion that ran out of memory may have left an empty leaf behind */
+	free(head->root);
+
+	head->root = lower[0];
+	head->count = count;
+
+	free(lower);
+	free(lower_firsts);
+
+	return 0;
+
+err_node:
+	free(firsts);
+err_firsts:
+	free(level);
+err:
+	/* the level underneath is complete, so are the subtrees hanging from it */
+	for (size_t i = 0; i < nlower; i++)
+		__bptree_i64_destroy(lower[i]);
+
+	free(lower);
+	free(lower_firsts);
+	return -MIDORIDB_NOMEM;
+}
+
+static void bptree_i64_borrow_from_prev(struct bptree_i64_node *parent, int idx)
+{
+	struct bptree_i64_node *child = parent->ptrs[idx];
+	struct bptree_i64_node *sibling = parent->ptrs[idx - 1];
+
+	memmove(&child->keys[1], &child->keys[0], child->key_count * sizeof(int64_t));
+
+	if (child->is_leaf) {
+		memmove(&child->ptrs[1], &child->ptrs[0], child->key_count * sizeof(void*));
+		child->keys[0] = sibling->keys[sibling->key_count - 1];
+		child->ptrs[0] = sibling->ptrs[sibling->key_count - 1];
+		parent->keys[idx - 1] = child->keys[0];
+	} else {
+		memmove(&child->ptrs[1], &child->ptrs[0], (child->key_count + 1) * sizeof(void*));
+		child->keys[0] = parent->keys[idx - 1];
+		child->ptrs[0] = sibling->ptrs[sibling->key_count];
+		parent->keys[idx - 1] = sibling->keys[sibling->key_count - 1];
+	}
+
+	child->key_count++;
+	sibling->key_count--;
+}
+
+static void bptree_i64_borrow_from_next(struct bptree_i64_node *parent, int idx)
+{
+	struct bptree_i64_node *child = parent->ptrs[idx];
+	struct bptree_i64_node *sibling = parent->ptrs[idx + 1];
+
+	if (child->is_leaf) {
+		child->keys[child->key_count] = sibling->keys[0];
+		child->ptrs[child->key_count] = sibling->ptrs[0];
+		memmove(&sibling->ptrs[0], &sibling->ptrs[1], (sibling->key_count - 1) * sizeof(void*));
+		memmove(&sibling->keys[0], &sibling->keys[1], (sibling->key_count - 1) * sizeof(int64_t));
+		parent->keys[idx] = sibling->keys[0];
+	} else {
+		child->keys[child->key_count] = parent->keys[idx];
+		child->ptrs[child->key_count + 1] = sibling->ptrs[0];
+		parent->keys[idx] = sibling->keys[0];
+		memmove(&sibling->ptrs[0], &sibling->ptrs[1], sibling->key_count * sizeof(void*));
+		memmove(&sibling->keys[0], &sibling->keys[1], (sibling->key_count - 1) * sizeof(int64_t));
+	}
+
+	child->key_count++;
+	sibling->key_count--;
+}
+
+/* merges children[idx + 1] into children[idx] */
+static void bptree_i64_merge(struct bptree_i64_node *parent, int idx)
+{
+	struct bptree_i64_node *child = parent->ptrs[idx];
+	struct bptree_i64_node *sibling = parent->ptrs[idx + 1];
+
+	if (child->is_leaf) {
+		memcpy(&child->keys[child->key_count], sibling->keys, sibling->key_count * sizeof(int64_t));
+		memcpy(&child->ptrs[child->key_count], sibling->ptrs, sibling->key_count * sizeof(void*));
+		child->key_count += sibling->key_count;
+
+		child->next = sibling->next;
+		if (child->next)
+			child->next->prev = child;
+	} else {
+		child->keys[child->key_count] = parent->keys[idx];
+		memcpy(&child->keys[child->key_count + 1], sibling->keys, sibling->key_count * sizeof(int64_t));
+		memcpy(&child->ptrs[child->key_count + 1], sibling->ptrs, (sibling->key_count + 1) * sizeof(void*));
+		child->key_count += sibling->key_count + 1;
+	}
+
+	memmove(&parent->keys[idx], &parent->keys[idx + 1], (parent->key_count - idx - 1) * sizeof(int64_t));
+	memmove(&parent->ptrs[idx + 1], &parent->ptrs[idx + 2], (parent->key_count - idx - 1) * sizeof(void*));
+	parent->key_count--;
+
+	free(sibling);
+}
+
+static void bptree_i64_rebalance(struct bptree_i64_head *head, struct bptree_i64_node *parent, int idx)
+{
+	struct bptree_i64_node *prev = idx > 0 ? parent->ptrs[idx - 1] : NULL;
+	struct bptree_i64_node *next = idx < parent->key_count ? parent->ptrs[idx + 1] : NULL;
+
+	if (prev && prev->key_count > bptree_i64_min_keys(head))
+		bptree_i64_borrow_from_prev(parent, idx);
+	else if (next && next->key_count > bptree_i64_min_keys(head))
+		bptree_i64_borrow_from_next(parent, idx);
+	else if (prev)
+		bptree_i64_merge(parent, idx - 1);
+	else
+		bptree_i64_merge(parent, idx);
+}
+
+static bool bptree_i64_node_remove(struct bptree_i64_head *head, struct bptree_i64_node *node, int64_t key)
+{
+	struct bptree_i64_node *child;
+	int idx;
+
+	if (node->is_leaf) {
+		idx = bptree_i64_lower_bound(head, node, key);
+
+		if (idx == node->key_count || node->keys[idx] != key)
+			return false;
+
+		memmove(&node->keys[idx], &node->keys[idx + 1], (node->key_count - idx - 1) * sizeof(int64_t));
+		memmove(&node->ptrs[idx], &node->ptrs[idx + 1], (node->key_count - idx - 1) * sizeof(void*));
+		node->key_count--;
+
+		return true;
+	}
+
+	idx = bptree_i64_upper_bound(head, node, key);
+	child = node->ptrs[idx];
+
+	if (!bptree_i64_node_remove(head, child, key))
+		return false;
+
+	if (child->key_count < bptree_i64_min_keys(head))
+		bptree_i64_rebalance(head, node, idx);
+
+	return true;
+}
+
+bool bptree_i64_remove(struct bptree_i64_head *head, int64_t key)
+{
+	struct bptree_i64_node *root = head->root;
+
+	if (!root || !bptree_i64_node_remove(head, root, key))
+		return false;
+
+	head->count--;
+
+	if (!root->is_leaf && root->key_count == 0) {
+		head->root = root->ptrs[0];
+		free(root);
+	} else if (root->is_leaf && root->key_count == 0) {
+		head->root = NULL;
+		free(root);
+	}
+
+	return true;
+}
+
+void bptree_i64_foreach(struct bptree_i64_head *head, void (*fn)(int64_t key, void *value, void *arg), void *arg)
+{
+	struct bptree_i64_cursor cur;
+	bool more;
+
+	for (more = bptree_i64_seek_ge(head, &cur, INT64_MIN); more; more = bptree_i64_next(&cur))
+		fn(bptree_i64_cursor_key(&cur), bptree_i64_cursor_value(&cur), arg);
+}
+
+bool bptree_i64_seek_ge(struct bptree_i64_head *head, struct bptree_i64_cursor *cur, int64_t key)
+{
+	struct bptree_i64_node *node;
+
+	cur->node = NULL;
+	cur->idx = 0;
+
+	/* root may be left empty by a failed insertion */
+	if (!head->root || !head->count)
+		return false;
+
+	node = bptree_i64_find_leaf(head, key);
+	cur->node = node;
+	cur->idx = bptree_i64_lower_bound(head, node, key);
+
+	/* every key of this leaf is smaller, so it must be the first of the next one */
+	if (cur->idx == node->key_count) {
+		cur->idx--;
+		return bptree_i64_next(cur);
+	}
+
+	return true;
+}
+
+bool bptree_i64_seek_le(struct bptree_i64_head *head, struct bptree_i64_cursor *cur, int64_t key)
+{
+	struct bptree_i64_node *node;
+
+	cur->node = NULL;
+	cur->idx = 0;
+
+	/* root may be left empty by a failed insertion */
+	if (!head->root || !head->count)
+		return false;
+
+	node = bptree_i64_find_leaf(head, key);
+	cur->node = node;
+	cur->idx = bptree_i64_upper_bound(head, node, key);
+
+	return bptree_i64_prev(cur);
+}
+
+bool bptree_i64_next(struct bptree_i64_cursor *cur)
+{
+	if (!cur->node)
+		return false;
+
+	if (++cur->idx < cur->node->key_count)
+		return true;
+
+	cur->node = cur->node->next;
+	cur->idx = 0;
+
+	return cur->node != NULL;
+}
+
+bool bptree_i64_prev(struct bptree_i64_cursor *cur)
+{
+	if (!cur->node)
+		return false;
+
+	if (--cur->idx >= 0)
+		return true;
+
+	cur->node = cur->node->prev;
+	cur->idx = cur->node ? cur->node->key_count - 1 : 0;
+
+	return cur->node != NULL;
+}
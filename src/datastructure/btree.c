@@ -73,7 +73,7 @@ static struct btree_node_tuple* btree_search(struct btree_head *head, struct btr
 	while (i < node->key_count && head->cmp_fn(key, node->keys[i].key) > 0)
 		i++;
 
-	if (node->keys[i].key && head->cmp_fn(node->keys[i].key, key) == 0)
+	if (i < node->key_count && head->cmp_fn(node->keys[i].key, key) == 0)
 		return &node->keys[i];
 
 	if (node->is_leaf)
@@ -323,13 +323,11 @@ static void btree_node_remove_from_leaf(struct btree_head *head, struct btree_no
 {
 	(void)(head);
 	// Move all the keys after the idx-th pos one place backward
-	for (int i = idx + 1; i < node->key_count; ++i) {
+	for (int i = idx + 1; i < node->key_count; ++i)
 		node->keys[i - 1] = node->keys[i];
-		memzero(&node->keys[i], sizeof(struct btree_node_tuple));
-	}
 
 	node->key_count--;
-
+	memzero(&node->keys[node->key_count], sizeof(struct btree_node_tuple));
 }
 
 static struct btree_node_tuple btree_node_get_predecessor(struct btree_node *node, int idx)
@@ -390,10 +388,8 @@ static int __must_check btree_node_merge(struct btree_head *head, struct btree_n
 
 	// Moving all keys after idx in the current node one step before -
 	// to fill the gap created by moving keys[idx] to C[idx]
-	for (int i = idx + 1; i < node->key_count; ++i) {
+	for (int i = idx + 1; i < node->key_count; ++i)
 		node->keys[i - 1] = node->keys[i];
-		memzero(&node->keys[i], sizeof(struct btree_node_tuple));
-	}
 
 	// Moving the child pointers after (idx+1) in the current node one
 	// step before
@@ -402,6 +398,8 @@ static int __must_check btree_node_merge(struct btree_head *head, struct btree_n
 	}
 
 	node->key_count--;
+	memzero(&node->keys[node->key_count], sizeof(struct btree_node_tuple));
+	memzero(&node->children[node->key_count + 1], sizeof(struct btree_node));
 
 	return ret;
 }
@@ -484,6 +482,11 @@ static void btree_node_borrow_from_prev_child(struct btree_node *node, int idx)
 
 	child->key_count += 1;
 	sibling->key_count -= 1;
+
+	// Clearing the slots the sibling doesn't use anymore
+	memzero(&sibling->keys[sibling->key_count], sizeof(struct btree_node_tuple));
+	if (!sibling->is_leaf)
+		memzero(&sibling->children[sibling->key_count + 1], sizeof(struct btree_node));
 }
 
 static void btree_node_borrow_from_next_child(struct btree_node *node, int idx)
@@ -628,6 +631,27 @@ int btree_remove(struct btree_head *head, void *key)
 	return 0;
 }
 
+static void __btree_foreach(struct btree_node *node, void (*fn)(void *key, void *value, void *arg), void *arg)
+{
+	for (int i = 0; i < node->key_count; i++) {
+		if (!node->is_leaf)
+			__btree_foreach(&node->children[i], fn, arg);
+
+		fn(node->keys[i].key, node->keys[i].value, arg);
+	}
+
+	if (!node->is_leaf)
+		__btree_foreach(&node->children[node->key_count], fn, arg);
+}
+
+void btree_foreach(struct btree_head *head, void (*fn)(void *key, void *value, void *arg), void *arg)
+{
+	if (!head->root)
+		return; /* btree hasn't been initialised yet */
+
+	__btree_foreach(head->root, fn, arg);
+}
+
 static void __btree_traverse(struct btree_head *head, struct btree_node *node, int level)
 {
 	for (int j = 0; j < level; j++)
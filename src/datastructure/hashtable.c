@@ -266,6 +266,14 @@ bool hashtable_str_compare(const void *key1, size_t key1_len, const void *key2,
 	return strcmp(key1, key2) == 0;
 }
 
+bool hashtable_mem_compare(const void *key1, size_t key1_len, const void *key2, size_t key2_len)
+{
+	/* sanity checks */
+	BUG_ON(!key1 || !key2 || key1_len == 0 || key2_len == 0);
+
+	return key1_len == key2_len && memcmp(key1, key2, key1_len) == 0;
+}
+
 size_t hashtable_str_hash(const void *key, size_t key_len)
 {
 	/* sanity checks */
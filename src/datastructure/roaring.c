@@ -0,0 +1,596 @@
+/*
+ * roaring.c
+ *
+ * Notes to myself:
+ * 	- containers never hold zero values, the ones that run dry are dropped straight away.
+ * 	- array containers are turned into bitmaps once they'd hold more than ROARING_ARRAY_MAX values
+ * 		and back into arrays once they drop under it. Going back is only best-effort: if we can't
+ * 		get hold of the memory the bitmap just stays, which is correct, only bigger.
+ * 	- set operations on two arrays stay arrays when the result is known to fit, everything else
+ * 		is done on a scratch bitmap and shrunk afterwards if it turned out sparse.
+ *
+ *  Created on: 17/10/2026
+ *      Author: paulo
+ */
+
+#include <datastructure/roaring.h>
+
+#define ROARING_ARRAY_MIN_CAP	4
+
+static inline uint64_t val_key(uint64_t val)
+{
+	return val >> 16;
+}
+
+static inline uint16_t val_low(uint64_t val)
+{
+	return (uint16_t)(val & 0xffff);
+}
+
+static inline bool bit_is_set(const uint64_t *words, uint16_t low)
+{
+	return words[low / 64] & (1ULL << (low % 64));
+}
+
+/* position of the first container whose key is >= key */
+static size_t container_lower_bound(const struct roaring *bitmap, uint64_t key)
+{
+	size_t lo = 0, hi = bitmap->count, mid;
+
+	/* values are mostly appended, check the last container first */
+	if (hi && bitmap->containers[hi - 1].key < key)
+		return hi;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+
+		if (bitmap->containers[mid].key < key)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/* position of the first array entry >= low */
+static uint32_t array_lower_bound(const struct roaring_container *c, uint16_t low)
+{
+	uint32_t lo = 0, hi = c->card, mid;
+
+	if (hi && c->array[hi - 1] < low)
+		return hi;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+
+		if (c->array[mid] < low)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+static void container_free(struct roaring_container *c)
+{
+	if (c->is_bitmap)
+		free(c->bitmap);
+	else
+		free(c->array);
+}
+
+static bool grow_containers(struct roaring *bitmap)
+{
+	struct roaring_container *containers;
+	size_t cap;
+
+	if (bitmap->count < bitmap->cap)
+		return true;
+
+	cap = bitmap->cap ? bitmap->cap * 2 : 4;
+	containers = realloc(bitmap->containers, cap * sizeof(*containers));
+
+	if (!containers)
+		return false;
+
+	bitmap->containers = containers;
+	bitmap->cap = cap;
+
+	return true;
+}
+
+/* takes ownership of c content */
+static bool append_container(struct roaring *bitmap, struct roaring_container *c)
+{
+	if (!grow_containers(bitmap))
+		return false;
+
+	bitmap->containers[bitmap->count++] = *c;
+
+	return true;
+}
+
+static struct roaring_container* insert_container(struct roaring *bitmap, size_t pos, uint64_t key)
+{
+	struct roaring_container *c;
+
+	if (!grow_containers(bitmap))
+		return NULL;
+
+	c = &bitmap->containers[pos];
+	memmove(c + 1, c, (bitmap->count - pos) * sizeof(*c));
+	bitmap->count++;
+
+	memzero(c, sizeof(*c));
+	c->key = key;
+
+	return c;
+}
+
+static void remove_container(struct roaring *bitmap, size_t pos)
+{
+	struct roaring_container *c = &bitmap->containers[pos];
+
+	container_free(c);
+	memmove(c, c + 1, (bitmap->count - pos - 1) * sizeof(*c));
+	bitmap->count--;
+}
+
+static bool array_to_bitmap(struct roaring_container *c)
+{
+	uint64_t *words = calloc(ROARING_BITMAP_WORDS, sizeof(*words));
+
+	if (!words)
+		return false;
+
+	for (uint32_t i = 0; i < c->card; i++)
+		words[c->array[i] / 64] |= 1ULL << (c->array[i] % 64);
+
+	free(c->array);
+	c->bitmap = words;
+	c->is_bitmap = true;
+	c->cap = 0;
+
+	return true;
+}
+
+static void bitmap_to_array(struct roaring_container *c)
+{
+	uint16_t *array = malloc(MAX(c->card, 1) * sizeof(*array));
+	uint32_t n = 0;
+	uint64_t word;
+
+	if (!array)
+		return;
+
+	for (int w = 0; w < ROARING_BITMAP_WORDS; w++) {
+		for (word = c->bitmap[w]; word; word &= word - 1)
+			array[n++] = (uint16_t)(w * 64 + __builtin_ctzll(word));
+	}
+
+	free(c->bitmap);
+	c->array = array;
+	c->is_bitmap = false;
+	c->cap = MAX(c->card, 1);
+}
+
+static bool container_add(struct roaring_container *c, uint16_t low)
+{
+	uint16_t *array;
+	uint32_t pos, cap;
+
+	if (c->is_bitmap) {
+		if (!bit_is_set(c->bitmap, low)) {
+			c->bitmap[low / 64] |= 1ULL << (low % 64);
+			c->card++;
+		}
+		return true;
+	}
+
+	pos = array_lower_bound(c, low);
+
+	if (pos < c->card && c->array[pos] == low)
+		return true;
+
+	if (c->card == ROARING_ARRAY_MAX)
+		return array_to_bitmap(c) && container_add(c, low);
+
+	if (c->card == c->cap) {
+		cap = c->cap ? MIN(c->cap * 2, ROARING_ARRAY_MAX) : ROARING_ARRAY_MIN_CAP;
+		array = realloc(c->array, cap * sizeof(*array));
+
+		if (!array)
+			return false;
+
+		c->array = array;
+		c->cap = cap;
+	}
+
+	memmove(&c->array[pos + 1], &c->array[pos], (c->card - pos) * sizeof(*c->array));
+	c->array[pos] = low;
+	c->card++;
+
+	return true;
+}
+
+static bool container_remove(struct roaring_container *c, uint16_t low)
+{
+	uint32_t pos;
+
+	if (c->is_bitmap) {
+		if (!bit_is_set(c->bitmap, low))
+			return false;
+
+		c->bitmap[low / 64] &= ~(1ULL << (low % 64));
+
+		if (--c->card == ROARING_ARRAY_MAX)
+			bitmap_to_array(c);
+
+		return true;
+	}
+
+	pos = array_lower_bound(c, low);
+
+	if (pos == c->card || c->array[pos] != low)
+		return false;
+
+	memmove(&c->array[pos], &c->array[pos + 1], (c->card - pos - 1) * sizeof(*c->array));
+	c->card--;
+
+	return true;
+}
+
+static bool container_contains(const struct roaring_container *c, uint16_t low)
+{
+	uint32_t pos;
+
+	if (c->is_bitmap)
+		return bit_is_set(c->bitmap, low);
+
+	pos = array_lower_bound(c, low);
+
+	return pos < c->card && c->array[pos] == low;
+}
+
+static bool container_copy(struct roaring_container *dst, const struct roaring_container *src)
+{
+	size_t size = src->is_bitmap ? ROARING_BITMAP_WORDS * sizeof(uint64_t) : src->card * sizeof(uint16_t);
+	void *data = malloc(size);
+
+	if (!data)
+		return false;
+
+	memcpy(data, src->is_bitmap ? (void*)src->bitmap : (void*)src->array, size);
+
+	*dst = *src;
+	dst->cap = src->is_bitmap ? 0 : src->card;
+
+	if (src->is_bitmap)
+		dst->bitmap = data;
+	else
+		dst->array = data;
+
+	return true;
+}
+
+/* ORs (or XORs) a container into a scratch bitmap */
+static void bitmap_merge(uint64_t *words, const struct roaring_container *c, bool is_xor)
+{
+	if (c->is_bitmap) {
+		for (int w = 0; w < ROARING_BITMAP_WORDS; w++)
+			words[w] = is_xor ? words[w] ^ c->bitmap[w] : words[w] | c->bitmap[w];
+		return;
+	}
+
+	for (uint32_t i = 0; i < c->card; i++) {
+		if (is_xor)
+			words[c->array[i] / 64] ^= 1ULL << (c->array[i] % 64);
+		else
+			words[c->array[i] / 64] |= 1ULL << (c->array[i] % 64);
+	}
+}
+
+/* turns a scratch bitmap into a container, words are owned by it afterwards */
+static void bitmap_adopt(struct roaring_container *out, uint64_t *words)
+{
+	out->card = 0;
+
+	for (int w = 0; w < ROARING_BITMAP_WORDS; w++)
+		out->card += (uint32_t)__builtin_popcountll(words[w]);
+
+	out->bitmap = words;
+	out->is_bitmap = true;
+	out->cap = 0;
+
+	if (out->card <= ROARING_ARRAY_MAX)
+		bitmap_to_array(out);
+}
+
+static bool container_and(struct roaring_container *out, const struct roaring_container *a,
+		const struct roaring_container *b)
+{
+	const struct roaring_container *tmp;
+	uint64_t *words;
+	uint32_t i = 0, j = 0;
+
+	out->key = a->key;
+	out->card = 0;
+	out->is_bitmap = false;
+
+	if (a->is_bitmap && b->is_bitmap) {
+		if (!(words = malloc(ROARING_BITMAP_WORDS * sizeof(*words))))
+			return false;
+
+		for (int w = 0; w < ROARING_BITMAP_WORDS; w++)
+			words[w] = a->bitmap[w] & b->bitmap[w];
+
+		bitmap_adopt(out, words);
+		return true;
+	}
+
+	/* the result is never bigger than the array */
+	if (a->is_bitmap) {
+		tmp = a;
+		a = b;
+		b = tmp;
+	}
+
+	if (!(out->array = malloc(MAX(a->card, 1) * sizeof(*out->array))))
+		return false;
+
+	out->cap = MAX(a->card, 1);
+
+	if (b->is_bitmap) {
+		for (i = 0; i < a->card; i++) {
+			if (bit_is_set(b->bitmap, a->array[i]))
+				out->array[out->card++] = a->array[i];
+		}
+		return true;
+	}
+
+	while (i < a->card && j < b->card) {
+		if (a->array[i] < b->array[j]) {
+			i++;
+		} else if (a->array[i] > b->array[j]) {
+			j++;
+		} else {
+			out->array[out->card++] = a->array[i];
+			i++;
+			j++;
+		}
+	}
+
+	return true;
+}
+
+static bool container_or_xor(struct roaring_container *out, const struct roaring_container *a,
+		const struct roaring_container *b, bool is_xor)
+{
+	uint64_t *words;
+	uint32_t i = 0, j = 0;
+
+	out->key = a->key;
+	out->card = 0;
+	out->is_bitmap = false;
+
+	if (a->is_bitmap || b->is_bitmap || a->card + b->card > ROARING_ARRAY_MAX) {
+		if (!(words = calloc(ROARING_BITMAP_WORDS, sizeof(*words))))
+			return false;
+
+		bitmap_merge(words, a, false);
+		bitmap_merge(words, b, is_xor);
+		bitmap_adopt(out, words);
+		return true;
+	}
+
+	if (!(out->array = malloc(MAX(a->card + b->card, 1) * sizeof(*out->array))))
+		return false;
+
+	out->cap = MAX(a->card + b->card, 1);
+
+	while (i < a->card || j < b->card) {
+		if (j == b->card || (i < a->card && a->array[i] < b->array[j])) {
+			out->array[out->card++] = a->array[i++];
+		} else if (i == a->card || a->array[i] > b->array[j]) {
+			out->array[out->card++] = b->array[j++];
+		} else {
+			if (!is_xor)
+				out->array[out->card++] = a->array[i];
+			i++;
+			j++;
+		}
+	}
+
+	return true;
+}
+
+/* appends out to dst, dropping it if it's empty */
+static bool append_result(struct roaring *dst, struct roaring_container *out)
+{
+	if (out->card && append_container(dst, out))
+		return true;
+
+	container_free(out);
+
+	return !out->card;
+}
+
+void roaring_init(struct roaring *bitmap)
+{
+	memzero(bitmap, sizeof(*bitmap));
+}
+
+void roaring_free(struct roaring *bitmap)
+{
+	for (size_t i = 0; i < bitmap->count; i++)
+		container_free(&bitmap->containers[i]);
+
+	free(bitmap->containers);
+	roaring_init(bitmap);
+}
+
+bool roaring_add(struct roaring *bitmap, uint64_t val)
+{
+	struct roaring_container *c;
+	size_t pos = container_lower_bound(bitmap, val_key(val));
+
+	if (pos < bitmap->count && bitmap->containers[pos].key == val_key(val)) {
+		c = &bitmap->containers[pos];
+	} else if (!(c = insert_container(bitmap, pos, val_key(val)))) {
+		return false;
+	}
+
+	if (container_add(c, val_low(val)))
+		return true;
+
+	/* don't leave empty containers behind */
+	if (!c->card)
+		remove_container(bitmap, pos);
+
+	return false;
+}
+
+bool roaring_remove(struct roaring *bitmap, uint64_t val)
+{
+	struct roaring_container *c;
+	size_t pos = container_lower_bound(bitmap, val_key(val));
+
+	if (pos == bitmap->count || bitmap->containers[pos].key != val_key(val))
+		return false;
+
+	c = &bitmap->containers[pos];
+
+	if (!container_remove(c, val_low(val)))
+		return false;
+
+	if (!c->card)
+		remove_container(bitmap, pos);
+
+	return true;
+}
+
+bool roaring_contains(const struct roaring *bitmap, uint64_t val)
+{
+	size_t pos = container_lower_bound(bitmap, val_key(val));
+
+	if (pos == bitmap->count || bitmap->containers[pos].key != val_key(val))
+		return false;
+
+	return container_contains(&bitmap->containers[pos], val_low(val));
+}
+
+size_t roaring_cardinality(const struct roaring *bitmap)
+{
+	size_t card = 0;
+
+	for (size_t i = 0; i < bitmap->count; i++)
+		card += bitmap->containers[i].card;
+
+	return card;
+}
+
+bool roaring_and(struct roaring *dst, const struct roaring *a, const struct roaring *b)
+{
+	struct roaring_container out;
+	size_t i = 0, j = 0;
+
+	while (i < a->count && j < b->count) {
+		if (a->containers[i].key < b->containers[j].key) {
+			i++;
+		} else if (a->containers[i].key > b->containers[j].key) {
+			j++;
+		} else {
+			if (!container_and(&out, &a->containers[i++], &b->containers[j++]))
+				goto err;
+
+			if (!append_result(dst, &out))
+				goto err;
+		}
+	}
+
+	return true;
+
+err:
+	roaring_free(dst);
+	return false;
+}
+
+static bool roaring_merge(struct roaring *dst, const struct roaring *a, const struct roaring *b, bool is_xor)
+{
+	struct roaring_container out;
+	size_t i = 0, j = 0;
+	bool ok;
+
+	while (i < a->count || j < b->count) {
+		if (j == b->count || (i < a->count && a->containers[i].key < b->containers[j].key))
+			ok = container_copy(&out, &a->containers[i++]);
+		else if (i == a->count || a->containers[i].key > b->containers[j].key)
+			ok = container_copy(&out, &b->containers[j++]);
+		else
+			ok = container_or_xor(&out, &a->containers[i++], &b->containers[j++], is_xor);
+
+		if (!ok || !append_result(dst, &out))
+			goto err;
+	}
+
+	return true;
+
+err:
+	roaring_free(dst);
+	return false;
+}
+
+bool roaring_or(struct roaring *dst, const struct roaring *a, const struct roaring *b)
+{
+	return roaring_merge(dst, a, b, false);
+}
+
+bool roaring_xor(struct roaring *dst, const struct roaring *a, const struct roaring *b)
+{
+	return roaring_merge(dst, a, b, true);
+}
+
+void roaring_iter_init(struct roaring_iter *iter, const struct roaring *bitmap)
+{
+	iter->bitmap = bitmap;
+	iter->container = 0;
+	iter->pos = 0;
+}
+
+bool roaring_iter_next(struct roaring_iter *iter, uint64_t *val)
+{
+	const struct roaring_container *c;
+	uint64_t word;
+	uint32_t w;
+
+	for (; iter->container < iter->bitmap->count; iter->container++, iter->pos = 0) {
+		c = &iter->bitmap->containers[iter->container];
+
+		if (!c->is_bitmap) {
+			if (iter->pos < c->card) {
+				*val = c->key << 16 | c->array[iter->pos++];
+				return true;
+			}
+			continue;
+		}
+
+		if (iter->pos >= ROARING_BITMAP_WORDS * 64)
+			continue;
+
+		w = iter->pos / 64;
+		word = c->bitmap[w] & (~0ULL << (iter->pos % 64));
+
+		while (!word && ++w < ROARING_BITMAP_WORDS)
+			word = c->bitmap[w];
+
+		if (word) {
+			iter->pos = w * 64 + (uint32_t)__builtin_ctzll(word);
+			*val = c->key << 16 | iter->pos++;
+			return true;
+		}
+	}
+
+	return false;
+}
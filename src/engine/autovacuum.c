@@ -0,0 +1,174 @@
+/*
+ * autovacuum.c
+ *
+ * Notes to myself:
+ * 	- tables are collected under the database lock and compacted after it's been let go, nothing
+ * 		drops tables while the database is open so the pointers stay good.
+ * 	- statements pin tables under the table lock, so a step never overlaps with one. A pinned table
+ * 		is skipped and the pass it was halfway through is picked up in a later round.
+ * 	- stop is read without the mutex in between steps so closing a database doesn't wait on a big
+ * 		table, it's written with it held anyway so the thread can't miss the wake up.
+ *
+ *  Created on: 17/10/2026
+ *      Author: paulo
+ */
+
+#include <engine/autovacuum.h>
+#include <engine/database.h>
+#include <datastructure/vector.h>
+#include <sched.h>
+
+bool autovacuum_needed(struct table *table)
+{
+	size_t dead = table->deleted_row_count;
+
+	return dead >= AUTOVACUUM_MIN_DEAD && dead * 100 >= (table->row_count + dead) * AUTOVACUUM_DEAD_PCT;
+}
+
+static bool autovacuum_stopping(struct autovacuum *av)
+{
+	return __atomic_load_n(&av->stop, __ATOMIC_RELAXED);
+}
+
+static void collect_table(struct hashtable *hashtable, const void *key, size_t klen, const void *value, size_t vlen,
+		void *arg)
+{
+	UNUSED(hashtable);
+	UNUSED(key);
+	UNUSED(klen);
+
+	/* a table that can't be collected is looked at next round */
+	vector_push((struct vector*)arg, (void*)value, vlen);
+}
+
+static void vacuum_table(struct autovacuum *av, struct table *table)
+{
+	bool done = false;
+
+	while (!done && !autovacuum_stopping(av)) {
+		if (table_lock(table))
+			return;
+
+		/* statements come first */
+		if (table->pins || (!table->vacuum.active && !autovacuum_needed(table)))
+			done = true;
+		else
+			done = table_vacuum_step(table, AUTOVACUUM_STEP_SLOTS);
+
+		table_unlock(table);
+
+		/* give statements waiting on the table lock a chance to get it */
+		sched_yield();
+	}
+}
+
+static void autovacuum_round(struct database *db)
+{
+	struct autovacuum *av = &db->autovacuum;
+	struct vector tables;
+	struct table **entries;
+
+	if (!vector_init(&tables))
+		return;
+
+	if (database_lock(db))
+		goto out;
+
+	hashtable_foreach(db->tables, &collect_table, &tables);
+	database_unlock(db);
+
+	entries = (struct table**)tables.data;
+	for (size_t i = 0; i < tables.len / sizeof(*entries); i++)
+		vacuum_table(av, entries[i]);
+
+out:
+	vector_free(&tables);
+}
+
+static void* autovacuum_main(void *arg)
+{
+	struct database *db = arg;
+	struct autovacuum *av = &db->autovacuum;
+	struct timespec deadline;
+
+	pthread_mutex_lock(&av->mutex);
+
+	while (!av->stop) {
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += av->naptime_ms / 1000;
+		deadline.tv_nsec += (long)(av->naptime_ms % 1000) * 1000000;
+
+		if (deadline.tv_nsec >= 1000000000) {
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000;
+		}
+
+		/* woken up early only to stop */
+		if (pthread_cond_timedwait(&av->cond, &av->mutex, &deadline) == 0 || av->stop)
+			continue;
+
+		pthread_mutex_unlock(&av->mutex);
+		autovacuum_round(db);
+		pthread_mutex_lock(&av->mutex);
+	}
+
+	pthread_mutex_unlock(&av->mutex);
+
+	return NULL;
+}
+
+int autovacuum_start(struct database *db, unsigned int naptime_ms)
+{
+	struct autovacuum *av;
+
+	/* sanity check */
+	BUG_ON(!db || !naptime_ms);
+
+	av = &db->autovacuum;
+	memzero(av, sizeof(*av));
+	av->naptime_ms = naptime_ms;
+
+	if (pthread_mutex_init(&av->mutex, NULL))
+		goto err;
+
+	if (pthread_cond_init(&av->cond, NULL))
+		goto err_cond;
+
+	if (pthread_create(&av->thread, NULL, &autovacuum_main, db))
+		goto err_thread;
+
+	av->running = true;
+
+	return MIDORIDB_OK;
+
+err_thread:
+	pthread_cond_destroy(&av->cond);
+err_cond:
+	pthread_mutex_destroy(&av->mutex);
+err:
+	return -MIDORIDB_INTERNAL;
+}
+
+void autovacuum_stop(struct database *db)
+{
+	struct autovacuum *av;
+
+	/* sanity check */
+	BUG_ON(!db);
+
+	av = &db->autovacuum;
+
+	if (!av->running)
+		return;
+
+	pthread_mutex_lock(&av->mutex);
+	__atomic_store_n(&av->stop, true, __ATOMIC_RELAXED);
+	pthread_cond_signal(&av->cond);
+	pthread_mutex_unlock(&av->mutex);
+
+	pthread_join(av->thread, NULL);
+
+	pthread_cond_destroy(&av->cond);
+	pthread_mutex_destroy(&av->mutex);
+	av->running = false;
+}
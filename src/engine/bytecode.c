@@ -0,0 +1,987 @@
+/*
+ * bytecode.c
+ *
+ * Notes to myself:
+ * 	- SELECT, DELETE and UPDATE have their own AST node types for the very same predicates so the
+ * 		compiler understands the three of them. Once compiled, nobody needs to care anymore.
+ * 	- AND/OR chains are compiled into conditional jumps on the same register, so they
+ * 		short-circuit. XOR is the only thing that needs more registers.
+ * 	- every instruction but jumps is a leaf of the set plan, chains only add the node combining
+ * 		their children once they're done. BC_XOR folds two results so it's a node on its own.
+ *
+ *  Created on: 17/10/2026
+ *      Author: paulo
+ */
+
+#define _XOPEN_SOURCE       /* See feature_test_macros(7) */
+#include <engine/bytecode.h>
+#include <engine/filter.h>
+
+/* operand of a comparison: either a column or a literal */
+struct bc_operand {
+	bool is_col;
+	/* column */
+	enum COLUMN_TYPE type;
+	int col_idx;
+	size_t offset;
+	/* literal */
+	bool is_null;
+	bool is_intnum;
+	bool is_approxnum;
+	bool is_bool;
+	bool is_str;
+	int64_t int_val;
+	double double_val;
+	bool bool_val;
+	char *str_val;
+};
+
+static bool compile_node(struct bytecode *prog, struct table *table, struct ast_node *node, uint8_t dst);
+
+static time_t parse_date_type(char *str, enum COLUMN_TYPE type)
+{
+	time_t time_out;
+	struct tm time_struct = {0};
+	const char *fmt;
+
+	if (type == CT_DATE)
+		fmt = COLUMN_CTDATE_FMT;
+	else
+		fmt = COLUMN_CTDATETIME_FMT;
+
+	/* semantic phase should guarantee that this won't ever fail */
+	strptime(str, fmt, &time_struct);
+
+	time_out = mktime(&time_struct);
+
+	return time_out;
+
+}
+
+static enum ast_comparison_type flip_cmp_type(enum ast_comparison_type cmp_type)
+{
+	switch (cmp_type) {
+	case AST_CMP_GTE_OP:
+		return AST_CMP_LTE_OP;
+	case AST_CMP_GT_OP:
+		return AST_CMP_LT_OP;
+	case AST_CMP_LTE_OP:
+		return AST_CMP_GTE_OP;
+	case AST_CMP_LT_OP:
+		return AST_CMP_GT_OP;
+	default:
+		return cmp_type;
+	}
+}
+
+static bool cmp_int_values(enum ast_comparison_type cmp_type, int64_t val_1, int64_t val_2)
+{
+	switch (cmp_type) {
+	case AST_CMP_DIFF_OP:
+		return val_1 != val_2;
+	case AST_CMP_EQUALS_OP:
+		return val_1 == val_2;
+	case AST_CMP_GTE_OP:
+		return val_1 >= val_2;
+	case AST_CMP_GT_OP:
+		return val_1 > val_2;
+	case AST_CMP_LTE_OP:
+		return val_1 <= val_2;
+	case AST_CMP_LT_OP:
+		return val_1 < val_2;
+	default:
+		/* something went really wrong here */
+		BUG_GENERIC();
+		return false;
+	}
+}
+
+static bool cmp_double_values(enum ast_comparison_type cmp_type, double val_1, double val_2)
+{
+	switch (cmp_type) {
+	case AST_CMP_DIFF_OP:
+		return val_1 != val_2;
+	case AST_CMP_EQUALS_OP:
+		return val_1 == val_2;
+	case AST_CMP_GTE_OP:
+		return val_1 >= val_2;
+	case AST_CMP_GT_OP:
+		return val_1 > val_2;
+	case AST_CMP_LTE_OP:
+		return val_1 <= val_2;
+	case AST_CMP_LT_OP:
+		return val_1 < val_2;
+	default:
+		/* something went really wrong here */
+		BUG_GENERIC();
+		return false;
+	}
+}
+
+static bool cmp_time_values(enum ast_comparison_type cmp_type, time_t val_1, time_t val_2)
+{
+	switch (cmp_type) {
+	case AST_CMP_DIFF_OP:
+		return val_1 != val_2;
+	case AST_CMP_EQUALS_OP:
+		return val_1 == val_2;
+	case AST_CMP_GTE_OP:
+		return val_1 >= val_2;
+	case AST_CMP_GT_OP:
+		return val_1 > val_2;
+	case AST_CMP_LTE_OP:
+		return val_1 <= val_2;
+	case AST_CMP_LT_OP:
+		return val_1 < val_2;
+	default:
+		/* something went really wrong here */
+		BUG_GENERIC();
+		return false;
+	}
+}
+
+static bool cmp_bool_values(enum ast_comparison_type cmp_type, bool val_1, bool val_2)
+{
+	switch (cmp_type) {
+	case AST_CMP_DIFF_OP:
+		return val_1 != val_2;
+	case AST_CMP_EQUALS_OP:
+		return val_1 == val_2;
+	default:
+		return false;
+	}
+}
+
+static bool cmp_str_values(enum ast_comparison_type cmp_type, char *val_1, char *val_2)
+{
+	switch (cmp_type) {
+	case AST_CMP_DIFF_OP:
+		return strcmp(val_1, val_2) != 0;
+	case AST_CMP_EQUALS_OP:
+		return strcmp(val_1, val_2) == 0;
+	default:
+		return false;
+	}
+}
+
+static size_t insn_count(struct bytecode *prog)
+{
+	return prog->insns.len / sizeof(struct bc_insn);
+}
+
+static bool emit_set_op(struct bytecode *prog, enum bc_set_op op, size_t arg)
+{
+	struct bc_set_node node = {.op = op, .arg = arg};
+
+	return vector_push(&prog->set_plan, &node, sizeof(node));
+}
+
+static bool emit(struct bytecode *prog, struct bc_insn *insn)
+{
+	size_t idx = insn_count(prog);
+
+	if (!vector_push(&prog->insns, insn, sizeof(*insn)))
+		return false;
+
+	switch (insn->opcode) {
+	case BC_JMP_FALSE:
+	case BC_JMP_TRUE:
+		return true;
+	case BC_XOR:
+		return emit_set_op(prog, BC_SET_XOR, 2);
+	default:
+		return emit_set_op(prog, BC_SET_LEAF, idx);
+	}
+}
+
+static bool resolve_column(struct table *table, char *name, struct bc_operand *out)
+{
+	size_t offset = 0;
+
+	for (int i = 0; i < table->column_count; i++) {
+		struct column *col = &table->columns[i];
+
+		if (strcmp(col->name, name) == 0) {
+			out->is_col = true;
+			out->type = col->type;
+			out->col_idx = i;
+			out->offset = offset;
+			return true;
+		}
+
+		offset += table_calc_column_space(col);
+	}
+
+	return false;
+}
+
+static bool resolve_fieldname(struct table *table, struct ast_sel_fieldname_node *field, struct bc_operand *out)
+{
+	char key[MEMBER_SIZE(struct ast_sel_fieldname_node, table_name) + 1 /* dot */
+			+ MEMBER_SIZE(struct ast_sel_fieldname_node, col_name)] = {0};
+
+	/* source tables use plain column names whereas the early-mat table uses fully qualified ones */
+	if (strcmp(table->name, field->table_name) == 0)
+		strncpy(key, field->col_name, sizeof(key) - 1);
+	else
+		snprintf(key, sizeof(key) - 1, "%s.%s", field->table_name, field->col_name);
+
+	return resolve_column(table, key, out);
+}
+
+#define COPY_LITERAL(out, val)								\
+	do {										\
+		(out)->is_null = (val)->value_type.is_null;				\
+		(out)->is_intnum = (val)->value_type.is_intnum;				\
+		(out)->is_approxnum = (val)->value_type.is_approxnum;			\
+		(out)->is_bool = (val)->value_type.is_bool;				\
+		(out)->is_str = (val)->value_type.is_str;				\
+		if ((out)->is_intnum)							\
+			(out)->int_val = (val)->int_val;				\
+		else if ((out)->is_approxnum)						\
+			(out)->double_val = (val)->double_val;				\
+		else if ((out)->is_bool)						\
+			(out)->bool_val = (val)->bool_val;				\
+		else if ((out)->is_str)							\
+			(out)->str_val = (val)->str_val;				\
+	} while (0)
+
+static bool get_operand(struct table *table, struct ast_node *node, struct bc_operand *out)
+{
+	struct ast_sel_exprval_node *sel_val;
+	struct ast_del_exprval_node *del_val;
+	struct ast_upd_exprval_node *upd_val;
+
+	memzero(out, sizeof(*out));
+
+	switch (node->node_type) {
+	case AST_TYPE_SEL_FIELDNAME:
+		return resolve_fieldname(table, (struct ast_sel_fieldname_node*)node, out);
+	case AST_TYPE_SEL_EXPRVAL:
+		sel_val = (typeof(sel_val))node;
+
+		if (sel_val->value_type.is_name)
+			return resolve_column(table, sel_val->name_val, out);
+
+		COPY_LITERAL(out, sel_val);
+		return true;
+	case AST_TYPE_DEL_EXPRVAL:
+		del_val = (typeof(del_val))node;
+
+		if (del_val->value_type.is_name)
+			return resolve_column(table, del_val->name_val, out);
+
+		COPY_LITERAL(out, del_val);
+		return true;
+	case AST_TYPE_UPD_EXPRVAL:
+		upd_val = (typeof(upd_val))node;
+
+		if (upd_val->value_type.is_name)
+			return resolve_column(table, upd_val->name_val, out);
+
+		COPY_LITERAL(out, upd_val);
+		return true;
+	default:
+		/* to be implemented */
+		return false;
+	}
+}
+
+static bool fold_literals(enum ast_comparison_type cmp_type, struct bc_operand *val_1, struct bc_operand *val_2)
+{
+	if (val_1->is_null || val_2->is_null)
+		return false; /* no comparison evaluates to true if NULL is one of the operands */
+	else if (val_1->is_approxnum)
+		return cmp_double_values(cmp_type, val_1->double_val, val_2->double_val);
+	else if (val_1->is_bool)
+		return cmp_bool_values(cmp_type, val_1->bool_val, val_2->bool_val);
+	else if (val_1->is_intnum)
+		return cmp_int_values(cmp_type, val_1->int_val, val_2->int_val);
+	else if (val_1->is_str)
+		return cmp_str_values(cmp_type, val_1->str_val, val_2->str_val);
+
+	return false;
+}
+
+static bool emit_cmp_col_imm(struct bytecode *prog, enum ast_comparison_type cmp_type, struct bc_operand *col,
+		struct bc_operand *val, uint8_t dst)
+{
+	struct bc_insn insn = {0};
+
+	insn.dst = dst;
+
+	/* no comparison evaluates to true if NULL is one of the operands */
+	if (val->is_null) {
+		insn.opcode = BC_LOAD_BOOL;
+		insn.imm.bool_val = false;
+		return emit(prog, &insn);
+	}
+
+	insn.cmp_type = cmp_type;
+	insn.col_idx_1 = col->col_idx;
+	insn.offset_1 = col->offset;
+
+	switch (col->type) {
+	case CT_INTEGER:
+		insn.opcode = BC_CMP_INT_IMM;
+		insn.imm.int_val = val->is_approxnum ? (int64_t)val->double_val : val->int_val;
+		break;
+	case CT_DOUBLE:
+		insn.opcode = BC_CMP_DBL_IMM;
+		insn.imm.double_val = val->is_intnum ? (double)val->int_val : val->double_val;
+		break;
+	case CT_TINYINT:
+		insn.opcode = BC_CMP_BOOL_IMM;
+		insn.imm.bool_val = val->is_intnum ? val->int_val != 0 : val->bool_val;
+		break;
+	case CT_DATE:
+	case CT_DATETIME:
+		insn.opcode = BC_CMP_TIME_IMM;
+		insn.imm.time_val = parse_date_type(val->str_val, col->type);
+		break;
+	case CT_VARCHAR:
+		insn.opcode = BC_CMP_STR_IMM;
+		insn.imm.str_val = val->str_val;
+		break;
+	default:
+		/* something went really wrong here */
+		BUG_GENERIC();
+		return false;
+	}
+
+	return emit(prog, &insn);
+}
+
+static bool emit_cmp_col_col(struct bytecode *prog, enum ast_comparison_type cmp_type, struct bc_operand *col_1,
+		struct bc_operand *col_2, uint8_t dst)
+{
+	struct bc_insn insn = {0};
+
+	insn.dst = dst;
+	insn.cmp_type = cmp_type;
+	insn.col_idx_1 = col_1->col_idx;
+	insn.offset_1 = col_1->offset;
+	insn.col_idx_2 = col_2->col_idx;
+	insn.offset_2 = col_2->offset;
+
+	/* semantic phase guarantees that columns will have the same type in CMP nodes */
+	switch (col_1->type) {
+	case CT_INTEGER:
+		insn.opcode = BC_CMP_INT_COL;
+		break;
+	case CT_DOUBLE:
+		insn.opcode = BC_CMP_DBL_COL;
+		break;
+	case CT_TINYINT:
+		insn.opcode = BC_CMP_BOOL_COL;
+		break;
+	case CT_DATE:
+	case CT_DATETIME:
+		insn.opcode = BC_CMP_TIME_COL;
+		break;
+	case CT_VARCHAR:
+		insn.opcode = BC_CMP_STR_COL;
+		break;
+	default:
+		/* something went really wrong here */
+		BUG_GENERIC();
+		return false;
+	}
+
+	return emit(prog, &insn);
+}
+
+static bool compile_cmp(struct bytecode *prog, struct table *table, struct ast_node *node,
+		enum ast_comparison_type cmp_type, uint8_t dst)
+{
+	struct list_head *pos;
+	struct ast_node *tmp_entry, *node_1 = NULL, *node_2 = NULL;
+	struct bc_operand val_1, val_2;
+	struct bc_insn insn = {0};
+
+	list_for_each(pos, node->node_children_head)
+	{
+		tmp_entry = list_entry(pos, typeof(*tmp_entry), head);
+
+		if (!node_1)
+			node_1 = tmp_entry;
+		else
+			node_2 = tmp_entry;
+	}
+
+	if (!node_1 || !node_2)
+		return false;
+
+	if (!get_operand(table, node_1, &val_1) || !get_operand(table, node_2, &val_2))
+		return false;
+
+	if (val_1.is_col && val_2.is_col)
+		return emit_cmp_col_col(prog, cmp_type, &val_1, &val_2, dst);
+	else if (val_1.is_col)
+		return emit_cmp_col_imm(prog, cmp_type, &val_1, &val_2, dst);
+	else if (val_2.is_col)
+		/* 'value op field' is the same as 'field op value' with op flipped */
+		return emit_cmp_col_imm(prog, flip_cmp_type(cmp_type), &val_2, &val_1, dst);
+
+	/* value-to-value comparisons are known upfront */
+	insn.opcode = BC_LOAD_BOOL;
+	insn.dst = dst;
+	insn.imm.bool_val = fold_literals(cmp_type, &val_1, &val_2);
+
+	return emit(prog, &insn);
+}
+
+/* AND/OR: every child is evaluated into dst and we bail out as soon as the result is known */
+static bool compile_chain(struct bytecode *prog, struct table *table, struct ast_node *node,
+		enum bc_opcode jmp_opcode, bool empty_val, uint8_t dst)
+{
+	struct list_head *pos;
+	struct ast_node *tmp_entry;
+	struct bc_insn insn = {0};
+	struct bc_insn *insns;
+	size_t first_jmp, end, count = 0;
+	bool first = true;
+
+	first_jmp = insn_count(prog);
+
+	list_for_each(pos, node->node_children_head)
+	{
+		tmp_entry = list_entry(pos, typeof(*tmp_entry), head);
+
+		/* ASSIGN nodes are not important at this stage, we simply ignore them */
+		if (tmp_entry->node_type == AST_TYPE_UPD_ASSIGN)
+			continue;
+
+		count++;
+
+		if (!first) {
+			memzero(&insn, sizeof(insn));
+			insn.opcode = jmp_opcode;
+			insn.dst = dst;
+
+			if (!emit(prog, &insn))
+				return false;
+		}
+
+		if (!compile_node(prog, table, tmp_entry, dst))
+			return false;
+
+		first = false;
+	}
+
+	if (first) {
+		/* no children at all (e.g. DELETE without WHERE-clause) */
+		memzero(&insn, sizeof(insn));
+		insn.opcode = BC_LOAD_BOOL;
+		insn.dst = dst;
+		insn.imm.bool_val = empty_val;
+
+		return emit(prog, &insn);
+	}
+
+	if (count > 1 && !emit_set_op(prog, jmp_opcode == BC_JMP_FALSE ? BC_SET_AND : BC_SET_OR, count))
+		return false;
+
+	/* patch jumps of this chain (nested chains were already patched) */
+	end = insn_count(prog);
+	insns = (struct bc_insn*)prog->insns.data;
+
+	for (size_t i = first_jmp; i < end; i++) {
+		if (insns[i].opcode == jmp_opcode && insns[i].dst == dst && !insns[i].target)
+			insns[i].target = end;
+	}
+
+	return true;
+}
+
+static bool compile_xor(struct bytecode *prog, struct table *table, struct ast_node *node, uint8_t dst)
+{
+	struct list_head *pos;
+	struct ast_node *tmp_entry;
+	struct bc_insn insn = {0};
+	bool first = true;
+
+	if (dst + 1 >= BYTECODE_MAX_REGS)
+		return false;
+
+	list_for_each(pos, node->node_children_head)
+	{
+		tmp_entry = list_entry(pos, typeof(*tmp_entry), head);
+
+		if (first) {
+			if (!compile_node(prog, table, tmp_entry, dst))
+				return false;
+
+			first = false;
+			continue;
+		}
+
+		if (!compile_node(prog, table, tmp_entry, dst + 1))
+			return false;
+
+		insn.opcode = BC_XOR;
+		insn.dst = dst;
+		insn.src = dst + 1;
+
+		if (!emit(prog, &insn))
+			return false;
+	}
+
+	return !first;
+}
+
+static bool compile_isxnull(struct bytecode *prog, struct table *table, struct ast_node *node, bool is_negation,
+		uint8_t dst)
+{
+	struct list_head *pos;
+	struct ast_node *tmp_entry;
+	struct bc_operand field;
+	struct bc_insn insn = {0};
+
+	list_for_each(pos, node->node_children_head)
+	{
+		tmp_entry = list_entry(pos, typeof(*tmp_entry), head);
+
+		if (!get_operand(table, tmp_entry, &field) || !field.is_col)
+			continue;
+
+		insn.opcode = BC_ISNULL;
+		insn.dst = dst;
+		insn.col_idx_1 = field.col_idx;
+		insn.imm.bool_val = is_negation;
+
+		return emit(prog, &insn);
+	}
+
+	return false;
+}
+
+/*
+ * IN is an OR'ed chain of '=' comparisons whereas NOT IN is an AND'ed chain of '<>' comparisons
+ */
+static bool compile_isxin(struct bytecode *prog, struct table *table, struct ast_node *node, bool is_negation,
+		uint8_t dst)
+{
+	struct list_head *pos;
+	struct ast_node *tmp_entry;
+	struct bc_operand field = {0}, value;
+	struct bc_insn insn = {0};
+	struct bc_insn *insns;
+	enum bc_opcode jmp_opcode = is_negation ? BC_JMP_FALSE : BC_JMP_TRUE;
+	size_t first_jmp, end, count = 0;
+	bool first = true;
+
+	list_for_each(pos, node->node_children_head)
+	{
+		tmp_entry = list_entry(pos, typeof(*tmp_entry), head);
+
+		if (get_operand(table, tmp_entry, &field) && field.is_col)
+			break;
+	}
+
+	if (!field.is_col)
+		return false;
+
+	first_jmp = insn_count(prog);
+
+	list_for_each(pos, node->node_children_head)
+	{
+		tmp_entry = list_entry(pos, typeof(*tmp_entry), head);
+
+		if (!get_operand(table, tmp_entry, &value))
+			return false;
+
+		if (value.is_col)
+			continue; /* same as field we just fetched.. just move on */
+
+		if (!first) {
+			memzero(&insn, sizeof(insn));
+			insn.opcode = jmp_opcode;
+			insn.dst = dst;
+
+			if (!emit(prog, &insn))
+				return false;
+		}
+
+		if (!emit_cmp_col_imm(prog, is_negation ? AST_CMP_DIFF_OP : AST_CMP_EQUALS_OP, &field, &value, dst))
+			return false;
+
+		first = false;
+		count++;
+	}
+
+	if (first)
+		return false;
+
+	if (count > 1 && !emit_set_op(prog, is_negation ? BC_SET_AND : BC_SET_OR, count))
+		return false;
+
+	end = insn_count(prog);
+	insns = (struct bc_insn*)prog->insns.data;
+
+	for (size_t i = first_jmp; i < end; i++) {
+		if (insns[i].opcode == jmp_opcode)
+			insns[i].target = end;
+	}
+
+	return true;
+}
+
+static bool compile_logop(struct bytecode *prog, struct table *table, struct ast_node *node,
+		enum ast_logop_type logop_type, uint8_t dst)
+{
+	switch (logop_type) {
+	case AST_LOGOP_TYPE_AND:
+		return compile_chain(prog, table, node, BC_JMP_FALSE, true, dst);
+	case AST_LOGOP_TYPE_OR:
+		return compile_chain(prog, table, node, BC_JMP_TRUE, false, dst);
+	case AST_LOGOP_TYPE_XOR:
+		return compile_xor(prog, table, node, dst);
+	default:
+		BUG_GENERIC();
+		return false;
+	}
+}
+
+static bool compile_node(struct bytecode *prog, struct table *table, struct ast_node *node, uint8_t dst)
+{
+	switch (node->node_type) {
+	case AST_TYPE_SEL_CMP:
+		return compile_cmp(prog, table, node, ((struct ast_sel_cmp_node*)node)->cmp_type, dst);
+	case AST_TYPE_DEL_CMP:
+		return compile_cmp(prog, table, node, ((struct ast_del_cmp_node*)node)->cmp_type, dst);
+	case AST_TYPE_UPD_CMP:
+		return compile_cmp(prog, table, node, ((struct ast_upd_cmp_node*)node)->cmp_type, dst);
+	case AST_TYPE_SEL_LOGOP:
+		return compile_logop(prog, table, node, ((struct ast_sel_logop_node*)node)->logop_type, dst);
+	case AST_TYPE_DEL_LOGOP:
+		return compile_logop(prog, table, node, ((struct ast_del_logop_node*)node)->logop_type, dst);
+	case AST_TYPE_UPD_LOGOP:
+		return compile_logop(prog, table, node, ((struct ast_upd_logop_node*)node)->logop_type, dst);
+	case AST_TYPE_SEL_EXPRISXNULL:
+		return compile_isxnull(prog, table, node, ((struct ast_sel_isxnull_node*)node)->is_negation, dst);
+	case AST_TYPE_DEL_EXPRISXNULL:
+		return compile_isxnull(prog, table, node, ((struct ast_del_isxnull_node*)node)->is_negation, dst);
+	case AST_TYPE_UPD_EXPRISXNULL:
+		return compile_isxnull(prog, table, node, ((struct ast_upd_isxnull_node*)node)->is_negation, dst);
+	case AST_TYPE_SEL_EXPRISXIN:
+		return compile_isxin(prog, table, node, ((struct ast_sel_isxin_node*)node)->is_negation, dst);
+	case AST_TYPE_DEL_EXPRISXIN:
+		return compile_isxin(prog, table, node, ((struct ast_del_isxin_node*)node)->is_negation, dst);
+	case AST_TYPE_UPD_EXPRISXIN:
+		return compile_isxin(prog, table, node, ((struct ast_upd_isxin_node*)node)->is_negation, dst);
+	case AST_TYPE_SEL_WHERE:
+	case AST_TYPE_SEL_ONEXPR:
+	case AST_TYPE_DEL_DELETEONE:
+	case AST_TYPE_UPD_UPDATE:
+		/* children are AND'ed */
+		return compile_chain(prog, table, node, BC_JMP_FALSE, true, dst);
+	default:
+		/* to be implemented */
+		return false;
+	}
+}
+
+static bool is_conjunction(struct bytecode *prog)
+{
+	struct bc_insn *insns = (struct bc_insn*)prog->insns.data;
+
+	for (size_t i = 0; i < insn_count(prog); i++) {
+		if (insns[i].dst != 0)
+			return false;
+
+		if (insns[i].opcode == BC_JMP_TRUE || insns[i].opcode == BC_XOR)
+			return false;
+
+		if (insns[i].opcode == BC_JMP_FALSE && insns[i].target != insn_count(prog))
+			return false;
+	}
+
+	return true;
+}
+
+bool bytecode_compile(struct bytecode *prog, struct table *table, struct ast_node *node)
+{
+	/* sanity checks */
+	BUG_ON(!prog || !table || !node);
+
+	if (!vector_init(&prog->insns))
+		return false;
+
+	if (!vector_init(&prog->set_plan)) {
+		vector_free(&prog->insns);
+		return false;
+	}
+
+	if (!compile_node(prog, table, node, 0)) {
+		bytecode_free(prog);
+		return false;
+	}
+
+	prog->is_conjunction = is_conjunction(prog);
+
+	return true;
+}
+
+static bool run_insn(struct bc_insn *insn, struct row *row)
+{
+	bool is_null_1, is_null_2;
+
+	if (insn->opcode == BC_LOAD_BOOL)
+		return insn->imm.bool_val;
+
+	is_null_1 = bit_test(row->null_bitmap, insn->col_idx_1, sizeof(row->null_bitmap));
+
+	if (insn->opcode == BC_ISNULL)
+		return is_null_1 ^ insn->imm.bool_val;
+
+	if (is_null_1)
+		return false; /* no comparison evaluates to true if NULL is one of the operands */
+
+	switch (insn->opcode) {
+	case BC_CMP_INT_IMM:
+		return cmp_int_values(insn->cmp_type, *(int64_t*)&row->data[insn->offset_1], insn->imm.int_val);
+	case BC_CMP_DBL_IMM:
+		return cmp_double_values(insn->cmp_type, *(double*)&row->data[insn->offset_1], insn->imm.double_val);
+	case BC_CMP_BOOL_IMM:
+		return cmp_bool_values(insn->cmp_type, *(bool*)&row->data[insn->offset_1], insn->imm.bool_val);
+	case BC_CMP_TIME_IMM:
+		return cmp_time_values(insn->cmp_type, *(time_t*)&row->data[insn->offset_1], insn->imm.time_val);
+	case BC_CMP_STR_IMM:
+		return cmp_str_values(insn->cmp_type, *(char**)&row->data[insn->offset_1], insn->imm.str_val);
+	default:
+		break;
+	}
+
+	is_null_2 = bit_test(row->null_bitmap, insn->col_idx_2, sizeof(row->null_bitmap));
+
+	if (is_null_2)
+		return false;
+
+	switch (insn->opcode) {
+	case BC_CMP_INT_COL:
+		return cmp_int_values(insn->cmp_type,
+					*(int64_t*)&row->data[insn->offset_1],
+					*(int64_t*)&row->data[insn->offset_2]);
+	case BC_CMP_DBL_COL:
+		return cmp_double_values(insn->cmp_type,
+					*(double*)&row->data[insn->offset_1],
+					*(double*)&row->data[insn->offset_2]);
+	case BC_CMP_BOOL_COL:
+		return cmp_bool_values(insn->cmp_type,
+					*(bool*)&row->data[insn->offset_1],
+					*(bool*)&row->data[insn->offset_2]);
+	case BC_CMP_TIME_COL:
+		return cmp_time_values(insn->cmp_type,
+					*(time_t*)&row->data[insn->offset_1],
+					*(time_t*)&row->data[insn->offset_2]);
+	case BC_CMP_STR_COL:
+		return cmp_str_values(insn->cmp_type,
+					*(char**)&row->data[insn->offset_1],
+					*(char**)&row->data[insn->offset_2]);
+	default:
+		/* something went really wrong here */
+		BUG_GENERIC();
+		return false;
+	}
+}
+
+bool bytecode_run(struct bytecode *prog, struct row *row)
+{
+	struct bc_insn *insns = (struct bc_insn*)prog->insns.data;
+	struct bc_insn *insn;
+	size_t count = insn_count(prog);
+	bool regs[BYTECODE_MAX_REGS];
+
+	for (size_t pc = 0; pc < count; pc++) {
+		insn = &insns[pc];
+
+		switch (insn->opcode) {
+		case BC_JMP_FALSE:
+			if (!regs[insn->dst])
+				pc = insn->target - 1;
+			break;
+		case BC_JMP_TRUE:
+			if (regs[insn->dst])
+				pc = insn->target - 1;
+			break;
+		case BC_XOR:
+			regs[insn->dst] ^= regs[insn->src];
+			break;
+		default:
+			regs[insn->dst] = run_insn(insn, row);
+		}
+	}
+
+	return regs[0];
+}
+
+/*
+ * Rows are stored row-major so values of the column are gathered into a vector first (NULLs are
+ * remembered in a bitmap of their own), then a SIMD kernel compares the whole vector at once and the
+ * selection vector is narrowed down to rows whose bit is set.
+ */
+#define BC_FILTER_CHUNK	512
+
+#define GATHER(rows, sel, count, insn, ctype, vals, nulls)						\
+	do {												\
+		for (size_t __i = 0; __i < (count); __i++) {						\
+			struct row *__row = (rows)[(sel)[__i]];						\
+													\
+			if (bit_test(__row->null_bitmap, (insn)->col_idx_1, sizeof(__row->null_bitmap)))	\
+				(nulls)[__i / 64] |= 1ULL << (__i % 64);				\
+													\
+			(vals)[__i] = *(ctype*)&__row->data[(insn)->offset_1];				\
+		}											\
+	} while (0)
+
+static size_t filter_chunk(struct bc_insn *insn, struct row **rows, uint16_t *sel, size_t count, uint16_t *out)
+{
+	union {
+		int64_t int_vals[BC_FILTER_CHUNK];
+		double double_vals[BC_FILTER_CHUNK];
+		bool bool_vals[BC_FILTER_CHUNK];
+	} vals;
+	uint64_t bitmap[FILTER_BITMAP_WORDS(BC_FILTER_CHUNK)];
+	uint64_t nulls[FILTER_BITMAP_WORDS(BC_FILTER_CHUNK)] = {0};
+	uint64_t word;
+	size_t n = 0;
+
+	switch (insn->opcode) {
+	case BC_CMP_INT_IMM:
+		GATHER(rows, sel, count, insn, int64_t, vals.int_vals, nulls);
+		filter_int64(insn->cmp_type, vals.int_vals, count, insn->imm.int_val, bitmap);
+		break;
+	case BC_CMP_TIME_IMM:
+		GATHER(rows, sel, count, insn, time_t, vals.int_vals, nulls);
+		filter_int64(insn->cmp_type, vals.int_vals, count, insn->imm.time_val, bitmap);
+		break;
+	case BC_CMP_DBL_IMM:
+		GATHER(rows, sel, count, insn, double, vals.double_vals, nulls);
+		filter_double(insn->cmp_type, vals.double_vals, count, insn->imm.double_val, bitmap);
+		break;
+	case BC_CMP_BOOL_IMM:
+		GATHER(rows, sel, count, insn, bool, vals.bool_vals, nulls);
+		filter_bool(insn->cmp_type, vals.bool_vals, count, insn->imm.bool_val, bitmap);
+		break;
+	default:
+		/* something went really wrong here */
+		BUG_GENERIC();
+		return 0;
+	}
+
+	for (size_t w = 0; w < FILTER_BITMAP_WORDS(count); w++) {
+		/* no comparison evaluates to true if NULL is one of the operands */
+		word = bitmap[w] & ~nulls[w];
+
+		while (word) {
+			out[n++] = sel[w * 64 + __builtin_ctzll(word)];
+			word &= word - 1;
+		}
+	}
+
+	return n;
+}
+
+/* narrow the selection down with a single instruction */
+static size_t filter_insn(struct bc_insn *insn, struct row **rows, uint16_t *sel, size_t sel_count)
+{
+	size_t n = 0, count;
+
+	switch (insn->opcode) {
+	case BC_CMP_INT_IMM:
+	case BC_CMP_TIME_IMM:
+	case BC_CMP_DBL_IMM:
+	case BC_CMP_BOOL_IMM:
+		/* entries are only ever moved towards the front so narrowing down in place is fine */
+		for (size_t start = 0; start < sel_count; start += count) {
+			count = MIN(sel_count - start, BC_FILTER_CHUNK);
+			n += filter_chunk(insn, rows, &sel[start], count, &sel[n]);
+		}
+		return n;
+	default:
+		break;
+	}
+
+	for (size_t i = 0; i < sel_count; i++) {
+		if (run_insn(insn, rows[sel[i]]))
+			sel[n++] = sel[i];
+	}
+
+	return n;
+}
+
+size_t bytecode_filter(struct bytecode *prog, struct row **rows, uint16_t *sel, size_t sel_count)
+{
+	struct bc_insn *insns = (struct bc_insn*)prog->insns.data;
+	size_t n = 0;
+
+	/* a chain of AND'ed comparisons is run one comparison at a time over the whole batch */
+	if (prog->is_conjunction) {
+		for (size_t i = 0; i < insn_count(prog) && sel_count; i++) {
+			if (insns[i].opcode != BC_JMP_FALSE)
+				sel_count = filter_insn(&insns[i], rows, sel, sel_count);
+		}
+		return sel_count;
+	}
+
+	/* row at a time */
+	for (size_t i = 0; i < sel_count; i++) {
+		if (bytecode_run(prog, rows[sel[i]]))
+			sel[n++] = sel[i];
+	}
+
+	return n;
+}
+
+struct bc_insn* bytecode_next_cmp_imm(struct bytecode *prog, size_t *pos)
+{
+	struct bc_insn *insn;
+
+	/* comparisons of OR/XOR chains aren't mandatory */
+	if (!prog->is_conjunction)
+		return NULL;
+
+	while (*pos < insn_count(prog)) {
+		insn = &((struct bc_insn*)prog->insns.data)[(*pos)++];
+
+		switch (insn->opcode) {
+		case BC_CMP_INT_IMM:
+		case BC_CMP_DBL_IMM:
+		case BC_CMP_BOOL_IMM:
+		case BC_CMP_TIME_IMM:
+		case BC_CMP_STR_IMM:
+			/* '<>' doesn't narrow anything down */
+			if (insn->cmp_type != AST_CMP_DIFF_OP)
+				return insn;
+			break;
+		default:
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+struct bc_insn* bytecode_next_null_test(struct bytecode *prog, size_t *pos)
+{
+	struct bc_insn *insn;
+
+	if (!prog->is_conjunction)
+		return NULL;
+
+	while (*pos < insn_count(prog)) {
+		insn = &((struct bc_insn*)prog->insns.data)[(*pos)++];
+
+		if (insn->opcode == BC_ISNULL)
+			return insn;
+	}
+
+	return NULL;
+}
+
+void bytecode_free(struct bytecode *prog)
+{
+	vector_free(&prog->insns);
+	vector_free(&prog->set_plan);
+}
@@ -6,6 +6,7 @@
  */
 
 #include <engine/database.h>
+#include <engine/query.h>
 
 int database_open(struct database *db)
 {
@@ -19,8 +20,26 @@ int database_open(struct database *db)
 	if (!hashtable_init(db->tables, &hashtable_str_compare, &hashtable_str_hash))
 		goto err_ht_init;
 
+	if (pthread_mutex_init(&db->mutex, NULL))
+		goto err_mutex;
+
+	list_head_init(&db->results);
+
+	/* use every CPU unless told otherwise */
+	if (!worker_pool_init(&db->pool, worker_pool_default_threads()))
+		goto err_pool;
+
+	if (autovacuum_start(db, AUTOVACUUM_NAPTIME_MS))
+		goto err_autovacuum;
+
 	return MIDORIDB_OK;
 
+err_autovacuum:
+	worker_pool_destroy(&db->pool);
+err_pool:
+	pthread_mutex_destroy(&db->mutex);
+err_mutex:
+	hashtable_free(db->tables);
 err_ht_init:
 	free(db->tables);
 err:
@@ -48,10 +67,45 @@ void database_close(struct database *db)
 	/* sanity check */
 	BUG_ON(!db);
 
+	/* it mustn't be halfway through a table that's about to be freed */
+	autovacuum_stop(db);
+
+	/* result sets still open can't point at tables that are about to go */
+	query_detach_results(db, NULL);
+
 	hashtable_foreach(db->tables, &free_table, NULL);
 	hashtable_free(db->tables);
 	free(db->tables);
 	db->tables = NULL;
+
+	worker_pool_destroy(&db->pool);
+	pthread_mutex_destroy(&db->mutex);
+}
+
+int database_set_threads(struct database *db, size_t nthreads)
+{
+	/* sanity check */
+	BUG_ON(!db);
+
+	worker_pool_destroy(&db->pool);
+
+	if (!worker_pool_init(&db->pool, nthreads))
+		return -MIDORIDB_INTERNAL;
+
+	return MIDORIDB_OK;
+}
+
+int database_set_autovacuum(struct database *db, unsigned int naptime_ms)
+{
+	/* sanity check */
+	BUG_ON(!db);
+
+	autovacuum_stop(db);
+
+	if (naptime_ms && autovacuum_start(db, naptime_ms))
+		return -MIDORIDB_INTERNAL;
+
+	return MIDORIDB_OK;
 }
 
 int database_lock(struct database *db)
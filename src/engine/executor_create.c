@@ -7,6 +7,7 @@
 
 #include <engine/executor.h>
 #include <primitive/table.h>
+#include <primitive/index.h>
 #include <datastructure/linkedlist.h>
 
 static void add_index(struct ast_crt_index_def_node *idx_def_node, struct table *table)
@@ -35,6 +36,7 @@ static void add_index(struct ast_crt_index_def_node *idx_def_node, struct table
 				if (idx_def_node->is_pk) {
 					col->primary_key = true;
 					col->nullable = false;
+					/* single column only, semantic_create turns composite keys down */
 					col->unique = true;
 				}
 			}
@@ -53,6 +55,7 @@ static int add_column(struct ast_crt_column_def_node *col_def_node, struct table
 	column.nullable = col_def_node->attr_null;
 	column.unique = col_def_node->attr_uniq_key;
 	column.auto_inc = col_def_node->attr_auto_inc;
+	column.bloom = col_def_node->attr_bloom;
 
 	/* this can be overridden still if PK is declared after column definition */
 	column.primary_key = col_def_node->attr_prim_key;
@@ -84,6 +87,12 @@ int executor_run_create_stmt(struct database *db, struct ast_crt_create_node *cr
 		goto err_tbl_init;
 	}
 
+	/* before columns are added, they'd size datablocks from the row width otherwise */
+	if (create_node->block_size && !table_set_block_size(table, (size_t)create_node->block_size)) {
+		rc = -MIDORIDB_INTERNAL;
+		goto err_add_col;
+	}
+
 	list_for_each(pos, create_node->node_children_head)
 	{
 		entry = list_entry(pos, typeof(*entry), head);
@@ -96,6 +105,25 @@ int executor_run_create_stmt(struct database *db, struct ast_crt_create_node *cr
 		}
 	}
 
+	for (int i = 0; i < table->column_count; i++) {
+		struct column *col = &table->columns[i];
+		bool ok = true;
+
+		/* UNIQUE / PRIMARY KEY columns are enforced through hash indexes */
+		if (col->unique)
+			ok = table_index_create(table, i, IT_HASH, &db->pool);
+		else if (col->indexed && col->type == CT_TINYINT)
+			/* a couple of values only, a tree would be of little use for them */
+			ok = table_index_create(table, i, IT_BITMAP, &db->pool);
+		else if (col->indexed)
+			ok = table_index_create(table, i, IT_BTREE, &db->pool);
+
+		if (!ok) {
+			rc = -MIDORIDB_NOMEM;
+			goto err_add_col;
+		}
+	}
+
 	rc = database_table_add(db, table);
 
 early_ret:
@@ -106,6 +134,8 @@ early_ret:
 
 err_add_col:
 	//TODO free columns added so far
+	for (int i = 0; i < table->column_count; i++)
+		table_index_destroy(table, i);
 	free(table);
 err_tbl_init:
 	database_unlock(db);
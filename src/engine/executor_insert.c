@@ -10,6 +10,7 @@
 #include <primitive/table.h>
 #include <primitive/column.h>
 #include <primitive/row.h>
+#include <primitive/index.h>
 #include <datastructure/linkedlist.h>
 #include <lib/bit.h>
 
@@ -197,8 +198,13 @@ int executor_run_insertvals_stmt(struct database *db, struct ast_ins_insvals_nod
 	struct list_head *pos;
 	struct ast_node *entry;
 	struct table *table;
-	struct row *row;
+	struct row **rows;
+	struct row_location *locs;
+	size_t row_size;
+	int n_rows = 0;
+	int n_ins = 0;
 	int column_order[TABLE_MAX_COLUMNS];
+	int dup_col;
 	int rc = MIDORIDB_OK;
 
 	if (!database_table_exists(db, ins_node->table_name)) {
@@ -208,42 +214,90 @@ int executor_run_insertvals_stmt(struct database *db, struct ast_ins_insvals_nod
 
 	table = database_table_get(db, ins_node->table_name);
 
+	/* streamed result sets reading the table get hold of the rows they haven't returned yet */
+	if ((rc = query_detach_results(db, table)))
+		goto err;
+
+	/* rows of the table are left alone by autovacuum until we're done */
+	if ((rc = table_pin(table)))
+		goto err;
+
+	row_size = table_calc_row_size(table);
+
+	rows = calloc(ins_node->row_count, sizeof(*rows));
+	if (!rows) {
+		rc = -MIDORIDB_NOMEM;
+		goto err_rows_alloc;
+	}
+
+	/* where the rows went, so they can be taken back out if one of them can't be inserted */
+	locs = calloc(ins_node->row_count, sizeof(*locs));
+	if (!locs) {
+		rc = -MIDORIDB_NOMEM;
+		goto err_locs_alloc;
+	}
+
 	memset(column_order, -1, sizeof(column_order));
 
 	/* columns can be specified in an order that's different from the order defined in the CREATE stmt */
 	build_column_order(table, ins_node, column_order, ARR_SIZE(column_order));
 
+	/* every row is built and checked before any of them is inserted, so the stmt is all or nothing */
 	list_for_each(pos, ins_node->node_children_head)
 	{
 		entry = list_entry(pos, typeof(*entry), head);
 
 		if (entry->node_type == AST_TYPE_INS_VALUES) {
 
-			row = zalloc(table_calc_row_size(table));
+			/* sanity check */
+			BUG_ON(n_rows == ins_node->row_count);
+
+			rows[n_rows] = zalloc(row_size);
 
-			if (!row)
+			if (!rows[n_rows]) {
+				rc = -MIDORIDB_NOMEM;
 				goto err_row_alloc;
+			}
 
-			if ((rc = build_row(table, (struct ast_ins_values_node*)entry, column_order, row, output)))
+			if ((rc = build_row(table, (struct ast_ins_values_node*)entry, column_order, rows[n_rows++], output)))
 				goto err_build_row;
+		}
+	}
 
-			if (!table_insert_row(table, row, table_calc_row_size(table))) {
-				rc = -MIDORIDB_INTERNAL;
-				goto err_ins_row;
-			}
+	/* rows of this stmt are checked against each other as well */
+	if ((rc = table_index_find_duplicates(table, rows, n_rows, &dup_col)))
+		goto err_dup_row;
 
-			free(row);
+	for (n_ins = 0; n_ins < n_rows; n_ins++) {
+		if (!table_insert_row_loc(table, rows[n_ins], row_size, &locs[n_ins].blk, &locs[n_ins].offset)) {
+			rc = -MIDORIDB_INTERNAL;
+			goto err_ins_row;
 		}
 	}
 
 	output->n_rows_aff = ins_node->row_count;
 
-	return rc;
+	goto out;
 
+err_dup_row:
+	if (rc == -MIDORIDB_ERROR)
+		snprintf(output->error.message, sizeof(output->error.message) - 1,
+				"duplicate value for UNIQUE column '%s'\n", table->columns[dup_col].name);
 err_ins_row:
+	/* rows inserted so far are deleted again, last first */
+	while (n_ins--)
+		BUG_ON(!table_delete_row(table, locs[n_ins].blk, locs[n_ins].offset));
 err_build_row:
-	free(row);
 err_row_alloc:
+out:
+	free(locs);
+err_locs_alloc:
+	for (int i = 0; i < n_rows; i++)
+		free(rows[i]);
+
+	free(rows);
+err_rows_alloc:
+	table_unpin(table);
 err:
 	return rc;
 }
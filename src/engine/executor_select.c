@@ -4,13 +4,22 @@
  * Notes to myself:
  * 	- I think I will go for the early materialization approach
  * 		(copy data of table(s) into a new table before returning the query)
+ * 	- Update: rows are now pulled through an operator pipeline (see struct sel_operator) and
+ * 		only statements with GROUP BY/COUNT are still materialised into the early-mat table
  *	- As much as I want to implement the Sort-Merge Join algorithm, I know that
  *		implementing the execution plan for SELECT statements will be hard
  *		already. So for now, I will keep things simple and go for the
  *		Naive-nested loop algorithm first.
  *		As a strech-goal, maybe implement Block-nested-loop algorithm
- *	- Alternatively, if I ever implement Indexes, then a lot of the inefficiencies
- *		of the naive-nested loop should go away
+ *	- Equi-joins (ON A.x = B.y) are now answered with a hash join. The nested loop
+ *		is still used for everything else (e.g. synthetic 'ON 1 = 1' joins)
+ *	- Equi-joins on an indexed inner column probe the index for each outer row instead
+ *	- WHERE/ON-clauses are compiled into bytecode (see engine/bytecode.h) before anything
+ *		is scanned, rows are no longer evaluated by walking the AST
+ *	- Tables spanning more than one morsel are scanned by the database's worker pool
+ *		(see engine/scan.h), rows still come out in storage order
+ *	- ORDER BY is only honoured for single-table statements sorted by one column with an
+ *		ordered index, rows are then walked in index order. Nothing sorts them otherwise (yet)
  *
  *
  *  Created on: 15/11/2023
@@ -19,7 +28,10 @@
 
 #define _XOPEN_SOURCE       /* See feature_test_macros(7) */
 #include <engine/executor.h>
+#include <engine/bytecode.h>
+#include <engine/scan.h>
 #include <primitive/row.h>
+#include <datastructure/vector.h>
 
 #define FQFIELD_NAME_LEN 	MEMBER_SIZE(struct ast_sel_fieldname_node, table_name)			\
 					+ 1 /* dot */ 							\
@@ -43,26 +55,6 @@
 //	printf("};\n");
 //}
 
-static time_t parse_date_type(char *str, enum COLUMN_TYPE type)
-{
-	time_t time_out;
-	struct tm time_struct = {0};
-	const char *fmt;
-
-	if (type == CT_DATE)
-		fmt = COLUMN_CTDATE_FMT;
-	else
-		fmt = COLUMN_CTDATETIME_FMT;
-
-	/* semantic phase should guarantee that this won't ever fail */
-	strptime(str, fmt, &time_struct);
-
-	time_out = mktime(&time_struct);
-
-	return time_out;
-
-}
-
 static void free_hashmap_entries(struct hashtable *hashtable, const void *key, size_t klen,
 		const void *value, size_t vlen, void *arg)
 {
@@ -225,7 +217,35 @@ static int _build_cols_hastable_alias(struct database *db, struct ast_node *node
 	return ret;
 }
 
-static int _build_cols_hashtable_table(struct database *db, struct ast_node *node, struct hashtable *cols_ht)
+static bool is_column_referenced(struct ast_node *node, char *table_name, char *col_name)
+{
+	struct list_head *pos;
+	struct ast_node *tmp_entry;
+	struct ast_sel_fieldname_node *fld_node;
+
+	if (node->node_type == AST_TYPE_SEL_FIELDNAME) {
+		fld_node = (typeof(fld_node))node;
+
+		return strcmp(fld_node->table_name, table_name) == 0 && strcmp(fld_node->col_name, col_name) == 0;
+	}
+
+	list_for_each(pos, node->node_children_head)
+	{
+		tmp_entry = list_entry(pos, typeof(*tmp_entry), head);
+
+		if (is_column_referenced(tmp_entry, table_name, col_name))
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * projection pushdown: only columns referenced somewhere in the statement (SELECT-list, WHERE, ON,
+ * GROUP BY...) make it into the early-mat table. (SELECT * was already expanded by the optimiser)
+ */
+static int _build_cols_hashtable_table(struct database *db, struct ast_node *root, struct ast_node *node,
+		struct hashtable *cols_ht)
 {
 	struct ast_sel_table_node *table_node;
 	struct table *table;
@@ -238,6 +258,9 @@ static int _build_cols_hashtable_table(struct database *db, struct ast_node *nod
 	for (int i = 0; i < table->column_count; i++) {
 		column = &table->columns[i];
 
+		if (!is_column_referenced(root, table_node->table_name, column->name))
+			continue;
+
 		memzero(key, sizeof(key));
 		snprintf(key, sizeof(key) - 1, "%s.%s", table_node->table_name, column->name);
 
@@ -264,7 +287,8 @@ static int _build_cols_hashtable_count(struct ast_node *node, struct hashtable *
 	return MIDORIDB_OK;
 }
 
-static int build_cols_hashtable(struct database *db, struct ast_node *node, struct hashtable *cols_ht)
+static int build_cols_hashtable(struct database *db, struct ast_node *root, struct ast_node *node,
+		struct hashtable *cols_ht)
 {
 	struct list_head *pos;
 	struct ast_node *tmp_entry;
@@ -273,7 +297,7 @@ static int build_cols_hashtable(struct database *db, struct ast_node *node, stru
 	if (node->node_type == AST_TYPE_SEL_ALIAS) {
 		return _build_cols_hastable_alias(db, node, (struct ast_sel_alias_node*)node, cols_ht);
 	} else if (node->node_type == AST_TYPE_SEL_TABLE) {
-		return _build_cols_hashtable_table(db, node, cols_ht);
+		return _build_cols_hashtable_table(db, root, node, cols_ht);
 	} else if (node->node_type == AST_TYPE_SEL_COUNT) {
 		return _build_cols_hashtable_count(node, cols_ht);
 	} else {
@@ -281,7 +305,7 @@ static int build_cols_hashtable(struct database *db, struct ast_node *node, stru
 		{
 			tmp_entry = list_entry(pos, typeof(*tmp_entry), head);
 
-			if ((ret = build_cols_hashtable(db, tmp_entry, cols_ht)))
+			if ((ret = build_cols_hashtable(db, root, tmp_entry, cols_ht)))
 				break;
 		}
 
@@ -357,6 +381,7 @@ static bool cpy_cols(struct table *src, struct row *src_row, struct table *dst,
 
 		/* find offset for target table */
 		dst_offset = 0;
+		dst_col_idx = -1;
 		for (int j = 0; j < dst->column_count; j++) {
 			if (strcmp(dst->columns[j].name, key) == 0) {
 				dst_col_idx = j;
@@ -365,6 +390,12 @@ static bool cpy_cols(struct table *src, struct row *src_row, struct table *dst,
 			dst_offset += table_calc_column_space(&dst->columns[j]);
 		}
 
+		/* column isn't referenced anywhere in the query */
+		if (dst_col_idx < 0) {
+			src_offset += table_calc_column_space(column);
+			continue;
+		}
+
 		if (table_check_var_column(column)) {
 			void *ptr = zalloc(column->precision);
 
@@ -437,809 +468,1192 @@ static int merge_rows(struct table *tbl_1, struct table *tbl_2, struct row *row_
 	return _merge_rows(tbl_1, tbl_2, row_1, row_2, mattbl, out, is_tbl2_earlymat);
 }
 
-static bool cmp_double_value_to_value(enum ast_comparison_type cmp_type, double val_1, double val_2)
-{
-	switch (cmp_type) {
-	case AST_CMP_DIFF_OP:
-		return val_1 != val_2;
-	case AST_CMP_EQUALS_OP:
-		return val_1 == val_2;
-	case AST_CMP_GTE_OP:
-		return val_1 >= val_2;
-	case AST_CMP_GT_OP:
-		return val_1 > val_2;
-	case AST_CMP_LTE_OP:
-		return val_1 <= val_2;
-	case AST_CMP_LT_OP:
-		return val_1 < val_2;
-	default:
-		/* something went really wrong here */
-		BUG_GENERIC();
-		return false;
-	}
-}
-
-static bool cmp_int_value_to_value(enum ast_comparison_type cmp_type, int val_1, int val_2)
-{
-	switch (cmp_type) {
-	case AST_CMP_DIFF_OP:
-		return val_1 != val_2;
-	case AST_CMP_EQUALS_OP:
-		return val_1 == val_2;
-	case AST_CMP_GTE_OP:
-		return val_1 >= val_2;
-	case AST_CMP_GT_OP:
-		return val_1 > val_2;
-	case AST_CMP_LTE_OP:
-		return val_1 <= val_2;
-	case AST_CMP_LT_OP:
-		return val_1 < val_2;
-	default:
-		/* something went really wrong here */
-		BUG_GENERIC();
-		return false;
-	}
-}
+/*
+ * Predicate pushdown: the WHERE-clause is split into its top-level AND'ed conjuncts. Those that only
+ * reference columns of a single table are evaluated while that table is scanned in the FROM-clause
+ * (including both sides of a join) so rows they reject are never materialised. Everything else is
+ * left for proc_where_clause to evaluate on the early-mat table.
+ */
+struct where_conjunct {
+	struct ast_node *node;
+	/* the only table referenced by the conjunct, NULL if it must be evaluated on the early-mat table */
+	char *table_name;
+	/* compiled against the layout of table_name (or the early-mat table) */
+	struct bytecode prog;
+};
 
-static bool cmp_bool_value_to_value(enum ast_comparison_type cmp_type, bool val_1, bool val_2)
+static bool find_conjunct_table(struct ast_node *node, char **table_name)
 {
-	switch (cmp_type) {
-	case AST_CMP_DIFF_OP:
-		return val_1 != val_2;
-	case AST_CMP_EQUALS_OP:
-		return val_1 == val_2;
-	default:
-		return false;
-	}
-}
+	struct list_head *pos;
+	struct ast_node *tmp_entry;
+	struct ast_sel_fieldname_node *fld_node;
 
-static bool cmp_str_value_to_value(enum ast_comparison_type cmp_type, char *val_1, char *val_2)
-{
-	switch (cmp_type) {
-	case AST_CMP_DIFF_OP:
-		return strcmp(val_1, val_2);
-	case AST_CMP_EQUALS_OP:
-		return strcmp(val_1, val_2) == 0;
-	default:
-		return false;
+	if (node->node_type == AST_TYPE_SEL_FIELDNAME) {
+		fld_node = (typeof(fld_node))node;
+
+		if (!*table_name)
+			*table_name = fld_node->table_name;
+
+		return strcmp(*table_name, fld_node->table_name) == 0;
+	} else if (node->node_type == AST_TYPE_SEL_EXPRVAL) {
+		/* names refer to aliases, which only exist in the early-mat table */
+		return !((struct ast_sel_exprval_node*)node)->value_type.is_name;
 	}
-}
 
-static bool cmp_time_value_to_value(enum ast_comparison_type cmp_type, time_t val_1, time_t val_2)
-{
-	switch (cmp_type) {
-	case AST_CMP_DIFF_OP:
-		return val_1 != val_2;
-	case AST_CMP_EQUALS_OP:
-		return val_1 == val_2;
-	case AST_CMP_GTE_OP:
-		return val_1 >= val_2;
-	case AST_CMP_GT_OP:
-		return val_1 > val_2;
-	case AST_CMP_LTE_OP:
-		return val_1 <= val_2;
-	case AST_CMP_LT_OP:
-		return val_1 < val_2;
-	default:
-		/* something went really wrong here */
-		BUG_GENERIC();
-		return false;
+	list_for_each(pos, node->node_children_head)
+	{
+		tmp_entry = list_entry(pos, typeof(*tmp_entry), head);
+
+		if (!find_conjunct_table(tmp_entry, table_name))
+			return false;
 	}
+
+	return true;
 }
 
-static bool cmp_field_to_field(struct table *table, struct row *row, struct ast_sel_cmp_node *node,
-		struct ast_sel_exprval_node *val_1, struct ast_sel_exprval_node *val_2)
+static bool build_where_conjuncts(struct database *db, struct ast_node *node, struct table *mattbl,
+		struct vector *conjuncts)
 {
-	enum COLUMN_TYPE type = 0;
-	size_t tmp_offset = 0, offset_1 = 0, offset_2 = 0;
-	int col_idx_1 = -1, col_idx_2 = -1;
-	bool is_null_1, is_null_2;
+	struct table *table;
+	struct list_head *pos;
+	struct ast_node *tmp_entry;
+	struct where_conjunct conjunct = {0};
 
-	for (int i = 0; i < table->column_count; i++) {
-		struct column *col = &table->columns[i];
+	if (node->node_type == AST_TYPE_SEL_WHERE
+			|| (node->node_type == AST_TYPE_SEL_LOGOP
+					&& ((struct ast_sel_logop_node*)node)->logop_type == AST_LOGOP_TYPE_AND)) {
+
+		list_for_each(pos, node->node_children_head)
+		{
+			tmp_entry = list_entry(pos, typeof(*tmp_entry), head);
 
-		if (strcmp(col->name, val_1->name_val) == 0) {
-			/* semantic phase guarantees that columns will have the same type in CMP nodes */
-			type = col->type;
-			offset_1 = tmp_offset;
-			col_idx_1 = i;
-		} else if (strcmp(col->name, val_2->name_val) == 0) {
-			offset_2 = tmp_offset;
-			col_idx_2 = i;
+			if (!build_where_conjuncts(db, tmp_entry, mattbl, conjuncts))
+				return false;
 		}
-		tmp_offset += table_calc_column_space(col);
-	}
-
-	/* is any field set to null in this row ? */
-	is_null_1 = bit_test(row->null_bitmap, col_idx_1, sizeof(row->null_bitmap));
-	is_null_2 = bit_test(row->null_bitmap, col_idx_2, sizeof(row->null_bitmap));
-
-	if (is_null_1 || is_null_2) {
-		/*
-		 * if even one field is NULL, then no comparison would evaluate to true.
-		 *
-		 * That one was a bit odd as I felt tempted to use a truth table, then again if 2 fields where NULL,
-		 * they ought to return True if I compare field1 = field2, right?
-		 *
-		 * Wrong! (let that sink in for a moment.............. I know, right?)
-		 *
-		 * I noticed that SQLITE implements the following:
-		 *
-		 * sqlite> create table a(f1 int, f2 int);
-		 * sqlite> insert into a values (1,1), (1, NULL), (NULL,1), (NULL,NULL);
-		 * sqlite> select * from a where f1 <> f2;
-		 * 	<nothing...> - baffling, right?
-		 * sqlite> select * from a where f1 == f2;
-		 * f1  f2
-		 * --  --
-		 * 1   1
-		 * 	<I would expect to see NULL, NULL here... but this isn't how it works >
-		 * sqlite>
-		 */
-		return false;
-	} else if (type == CT_DOUBLE) {
-		return cmp_double_value_to_value(node->cmp_type,
-							*(double*)&row->data[offset_1],
-							*(double*)&row->data[offset_2]);
-	} else if (type == CT_TINYINT) {
-		return cmp_bool_value_to_value(node->cmp_type,
-						*(bool*)&row->data[offset_1],
-						*(bool*)&row->data[offset_2]);
-	} else if (type == CT_INTEGER) {
-		return cmp_int_value_to_value(node->cmp_type,
-						*(int64_t*)&row->data[offset_1],
-						*(int64_t*)&row->data[offset_2]);
-	} else if (type == CT_DATE || type == CT_DATETIME) {
-		return cmp_time_value_to_value(node->cmp_type,
-						*(time_t*)&row->data[offset_1],
-						*(time_t*)&row->data[offset_2]);
-	} else if (type == CT_VARCHAR) {
-		return cmp_str_value_to_value(node->cmp_type,
-						*(char**)&row->data[offset_1],
-						*(char**)&row->data[offset_2]);
-	} else {
-		/* something went really wrong here */
-		BUG_GENERIC();
-		return false;
+		return true;
 	}
 
-}
+	conjunct.node = node;
+	if (!find_conjunct_table(node, &conjunct.table_name))
+		conjunct.table_name = NULL;
 
-static bool cmp_field_to_value(struct table *table, struct row *row, struct ast_sel_cmp_node *node,
-		struct ast_sel_exprval_node *field, struct ast_sel_exprval_node *value)
-{
-	enum COLUMN_TYPE type = 0;
-	size_t offset = 0;
-	int col_idx = -1;
-	bool is_null;
+	table = conjunct.table_name ? database_table_get(db, conjunct.table_name) : NULL;
 
-	for (int i = 0; i < table->column_count; i++) {
-		struct column *col = &table->columns[i];
+	/* if it can't be pushed down, it will be evaluated on the early-mat table instead */
+	if (!table || !bytecode_compile(&conjunct.prog, table, node)) {
+		conjunct.table_name = NULL;
 
-		if (strcmp(col->name, field->name_val) == 0) {
-			type = col->type;
-			col_idx = i;
-			break;
-		}
-		offset += table_calc_column_space(col);
+		if (!bytecode_compile(&conjunct.prog, mattbl, node))
+			return false;
 	}
 
-	is_null = bit_test(row->null_bitmap, col_idx, sizeof(row->null_bitmap));
-
-	if (is_null || value->value_type.is_null) {
-		/* no comparison evaluates to true if NULL is one of the operands */
-		return false;
-	} else if (type == CT_DOUBLE) {
-		return cmp_double_value_to_value(node->cmp_type, *(double*)&row->data[offset], value->double_val);
-	} else if (type == CT_TINYINT) {
-		return cmp_bool_value_to_value(node->cmp_type, *(bool*)&row->data[offset], value->bool_val);
-	} else if (type == CT_INTEGER) {
-		return cmp_int_value_to_value(node->cmp_type, *(int64_t*)&row->data[offset], value->int_val);
-	} else if (type == CT_DATE || type == CT_DATETIME) {
-		return cmp_time_value_to_value(node->cmp_type,
-						*(time_t*)&row->data[offset],
-						parse_date_type(value->str_val, type));
-	} else if (type == CT_VARCHAR) {
-		return cmp_str_value_to_value(node->cmp_type, *(char**)&row->data[offset], value->str_val);
-	} else {
-		/* something went really wrong here */
-		BUG_GENERIC();
+	if (!vector_push(conjuncts, &conjunct, sizeof(conjunct))) {
+		bytecode_free(&conjunct.prog);
 		return false;
 	}
 
+	return true;
 }
 
-static bool cmp_value_to_value(struct ast_sel_cmp_node *node, struct ast_sel_exprval_node *val_1, struct ast_sel_exprval_node *val_2)
+static void free_where_conjuncts(struct vector *conjuncts)
 {
-	if (val_1->value_type.is_approxnum) {
-		return cmp_double_value_to_value(node->cmp_type, val_1->double_val, val_2->double_val);
-	} else if (val_1->value_type.is_bool) {
-		return cmp_bool_value_to_value(node->cmp_type, val_1->bool_val, val_2->bool_val);
-	} else if (val_1->value_type.is_intnum) {
-		return cmp_int_value_to_value(node->cmp_type, val_1->int_val, val_2->int_val);
-	} else if (val_1->value_type.is_null) {
-		/* no comparison evaluates to true if NULL is one of the operands */
-		return false;
-	} else if (val_1->value_type.is_str) {
-		return cmp_str_value_to_value(node->cmp_type, val_1->str_val, val_2->str_val);
-	} else {
-		/* something went really wrong here */
-		BUG_GENERIC();
-		return false;
-	}
+	if (!conjuncts)
+		return;
 
+	for (size_t i = 0; i < conjuncts->len / sizeof(struct where_conjunct); i++)
+		bytecode_free(&((struct where_conjunct*)conjuncts->data)[i].prog);
+
+	vector_free(conjuncts);
+	free(conjuncts);
 }
 
-static bool cmp_fieldname_to_fieldname(struct table *table, struct row *row, struct ast_sel_cmp_node *node,
-		struct ast_sel_fieldname_node *val_1, struct ast_sel_fieldname_node *val_2)
+static bool find_column_table(struct table *table, char *col_name, struct column_specs *out)
 {
-	enum COLUMN_TYPE type = 0;
-	size_t offset_1 = 0, offset_2 = 0;
-	int col_idx_1 = -1, col_idx_2 = -1;
-	bool is_null_1, is_null_2;
-	char key[FQFIELD_NAME_LEN];
-
-	for (int i = 0, tmp_offset = 0; i < table->column_count; i++) {
+	for (int i = 0; i < table->column_count; i++) {
 		struct column *col = &table->columns[i];
 
-		memzero(key, sizeof(key));
-		snprintf(key, sizeof(key) - 1, "%s.%s", val_1->table_name, val_1->col_name);
-
-		if (strcmp(col->name, key) == 0) {
-			/* semantic phase guarantees that columns will have the same type in CMP nodes */
-			type = col->type;
-			offset_1 = tmp_offset;
-			col_idx_1 = i;
-			break;
+		if (strcmp(col->name, col_name) == 0) {
+			out->type = col->type;
+			out->col_idx = i;
+			return true;
 		}
-		tmp_offset += table_calc_column_space(col);
-	}
-
-	for (int i = 0, tmp_offset = 0; i < table->column_count; i++) {
-		struct column *col = &table->columns[i];
-
-		memzero(key, sizeof(key));
-		snprintf(key, sizeof(key) - 1, "%s.%s", val_2->table_name, val_2->col_name);
 
-		if (strcmp(col->name, key) == 0) {
-			offset_2 = tmp_offset;
-			col_idx_2 = i;
-			break;
-		}
-		tmp_offset += table_calc_column_space(col);
-	}
-
-	/* is any field set to null in this row ? */
-	is_null_1 = bit_test(row->null_bitmap, col_idx_1, sizeof(row->null_bitmap));
-	is_null_2 = bit_test(row->null_bitmap, col_idx_2, sizeof(row->null_bitmap));
-
-	if (is_null_1 || is_null_2) {
-		/*
-		 * if even one field is NULL, then no comparison would evaluate to true.
-		 *
-		 * That one was a bit odd as I felt tempted to use a truth table, then again if 2 fields where NULL,
-		 * they ought to return True if I compare field1 = field2, right?
-		 *
-		 * Wrong! (let that sink in for a moment.............. I know, right?)
-		 *
-		 * I noticed that SQLITE implements the following:
-		 *
-		 * sqlite> create table a(f1 int, f2 int);
-		 * sqlite> insert into a values (1,1), (1, NULL), (NULL,1), (NULL,NULL);
-		 * sqlite> select * from a where f1 <> f2;
-		 * 	<nothing...> - baffling, right?
-		 * sqlite> select * from a where f1 == f2;
-		 * f1  f2
-		 * --  --
-		 * 1   1
-		 * 	<I would expect to see NULL, NULL here... but this isn't how it works >
-		 * sqlite>
-		 */
-		return false;
-	} else if (type == CT_DOUBLE) {
-		return cmp_double_value_to_value(node->cmp_type,
-							*(double*)&row->data[offset_1],
-							*(double*)&row->data[offset_2]);
-	} else if (type == CT_TINYINT) {
-		return cmp_bool_value_to_value(node->cmp_type,
-						*(bool*)&row->data[offset_1],
-						*(bool*)&row->data[offset_2]);
-	} else if (type == CT_INTEGER) {
-		return cmp_int_value_to_value(node->cmp_type,
-						*(int64_t*)&row->data[offset_1],
-						*(int64_t*)&row->data[offset_2]);
-	} else if (type == CT_DATE || type == CT_DATETIME) {
-		return cmp_time_value_to_value(node->cmp_type,
-						*(time_t*)&row->data[offset_1],
-						*(time_t*)&row->data[offset_2]);
-	} else if (type == CT_VARCHAR) {
-		return cmp_str_value_to_value(node->cmp_type,
-						*(char**)&row->data[offset_1],
-						*(char**)&row->data[offset_2]);
-	} else {
-		/* something went really wrong here */
-		BUG_GENERIC();
-		return false;
+		out->offset += table_calc_column_space(col);
 	}
 
+	return false;
 }
 
-static bool cmp_fieldname_to_value(struct table *table, struct row *row, struct ast_sel_cmp_node *node,
-		struct ast_sel_fieldname_node *field, struct ast_sel_exprval_node *value)
-{
-	enum COLUMN_TYPE type = 0;
-	size_t offset = 0;
-	int col_idx = -1;
-	bool is_null;
-	char key[FQFIELD_NAME_LEN];
-
-	for (int i = 0; i < table->column_count; i++) {
-		struct column *col = &table->columns[i];
+/*
+ * Source tables are scanned in batches of up to SEL_BATCH_SIZE rows. Pushed-down conjuncts are
+ * evaluated over a whole batch at once, narrowing a selection vector (indices of the rows still
+ * qualifying). AND'ed comparisons between a fixed-width column and a literal are answered by tight
+ * per-type loops (see bytecode_filter); anything else runs the conjunct's program for each
+ * selected row.
+ */
+#define SEL_BATCH_SIZE 1024
+
+struct row_batch {
+	struct row *rows[SEL_BATCH_SIZE];
+	size_t count;
+	/* selection vector */
+	uint16_t sel[SEL_BATCH_SIZE];
+	size_t sel_count;
+};
 
-		memzero(key, sizeof(key));
-		snprintf(key, sizeof(key) - 1, "%s.%s", field->table_name, field->col_name);
+/*
+ * Tables spanning several morsels (see engine/scan.h) are filtered by the database's worker pool a
+ * wave of morsels at a time, each worker collecting the rows that qualified in its morsel. Those are
+ * then handed out in storage order so the output is the same as the one of a single-threaded scan.
+ * Either way datablocks whose zone maps rule out a pushed conjunct aren't even looked at.
+ *
+ * Tables with an index on a column compared to a literal by a pushed conjunct ('col = 42', 'col > 42')
+ * skip the scan altogether, only rows the index points to are fetched.
+ *
+ * Ordered cursors hand rows out in the order of an index instead (e.g. 'ORDER BY col DESC'), walking
+ * just the range pushed conjuncts bound the column to. NULLs aren't indexed so they're scanned for
+ * separately, they come first in ascending order and last in descending order.
+ */
+struct batch_cursor {
+	struct scan_cursor cur;
+	/* rows found through an index (struct row_location), only valid if use_index is set */
+	struct vector locs;
+	size_t loc_idx;
+	bool use_index;
+	struct vector *conjuncts;
+	struct row_batch batch;
+	/* next entry of the selection vector to be returned */
+	size_t sel_idx;
+	/* parallel scan (NULL if the table is scanned by this thread alone) */
+	struct morsel_scan *par;
+	/* next row to be returned from the current wave */
+	size_t morsel_idx;
+	size_t row_idx;
+	int ret;
+};
 
-		if (strcmp(col->name, key) == 0) {
-			/* semantic phase guarantees that columns will have the same type in CMP nodes */
-			type = col->type;
-			col_idx = i;
-			break;
-		}
-		offset += table_calc_column_space(col);
-	}
+static bool row_batch_fill(struct row_batch *batch, struct scan_cursor *cur)
+{
+	struct row *row;
 
-	is_null = bit_test(row->null_bitmap, col_idx, sizeof(row->null_bitmap));
+	batch->count = 0;
 
-	if (is_null || value->value_type.is_null) {
-		/* no comparison evaluates to true if NULL is one of the operands */
-		return false;
-	} else if (type == CT_DOUBLE) {
-		return cmp_double_value_to_value(node->cmp_type, *(double*)&row->data[offset], value->double_val);
-	} else if (type == CT_TINYINT) {
-		return cmp_bool_value_to_value(node->cmp_type, *(bool*)&row->data[offset], value->bool_val);
-	} else if (type == CT_INTEGER) {
-		return cmp_int_value_to_value(node->cmp_type, *(int64_t*)&row->data[offset], value->int_val);
-	} else if (type == CT_DATE || type == CT_DATETIME) {
-		return cmp_time_value_to_value(node->cmp_type,
-						*(time_t*)&row->data[offset],
-						parse_date_type(value->str_val, type));
-	} else if (type == CT_VARCHAR) {
-		return cmp_str_value_to_value(node->cmp_type, *(char**)&row->data[offset], value->str_val);
-	} else {
-		/* something went really wrong here */
-		BUG_GENERIC();
-		return false;
+	while (batch->count < SEL_BATCH_SIZE && (row = scan_cursor_next(cur, NULL, NULL))) {
+		batch->sel[batch->count] = batch->count;
+		batch->rows[batch->count++] = row;
 	}
 
+	batch->sel_count = batch->count;
+
+	return batch->count > 0;
 }
 
-static bool cmp_value_to_fieldname(struct table *table, struct row *row, struct ast_sel_cmp_node *node,
-		struct ast_sel_exprval_node *value, struct ast_sel_fieldname_node *field)
+static bool row_batch_fill_locs(struct row_batch *batch, struct vector *locs, size_t *loc_idx)
 {
-	enum COLUMN_TYPE type = 0;
-	size_t offset = 0;
-	int col_idx = -1;
-	bool is_null;
-	char key[FQFIELD_NAME_LEN];
+	struct row_location *loc;
 
-	for (int i = 0; i < table->column_count; i++) {
-		struct column *col = &table->columns[i];
+	batch->count = 0;
 
-		memzero(key, sizeof(key));
-		snprintf(key, sizeof(key) - 1, "%s.%s", field->table_name, field->col_name);
+	while (batch->count < SEL_BATCH_SIZE && *loc_idx < locs->len / sizeof(*loc)) {
+		loc = &((struct row_location*)locs->data)[(*loc_idx)++];
 
-		if (strcmp(col->name, key) == 0) {
-			/* semantic phase guarantees that columns will have the same type in CMP nodes */
-			type = col->type;
-			col_idx = i;
-			break;
-		}
-		offset += table_calc_column_space(col);
+		batch->sel[batch->count] = batch->count;
+		batch->rows[batch->count++] = (struct row*)&loc->blk->data[loc->offset];
 	}
 
-	is_null = bit_test(row->null_bitmap, col_idx, sizeof(row->null_bitmap));
-
-	if (is_null || value->value_type.is_null) {
-		/* no comparison evaluates to true if NULL is one of the operands */
-		return false;
-	} else if (type == CT_DOUBLE) {
-		return cmp_double_value_to_value(node->cmp_type, value->double_val, *(double*)&row->data[offset]);
-	} else if (type == CT_TINYINT) {
-		return cmp_bool_value_to_value(node->cmp_type, value->bool_val, *(bool*)&row->data[offset]);
-	} else if (type == CT_INTEGER) {
-		return cmp_int_value_to_value(node->cmp_type, value->int_val, *(int64_t*)&row->data[offset]);
-	} else if (type == CT_DATE || type == CT_DATETIME) {
-		return cmp_time_value_to_value(node->cmp_type,
-						parse_date_type(value->str_val, type),
-						*(time_t*)&row->data[offset]);
-	} else if (type == CT_VARCHAR) {
-		return cmp_str_value_to_value(node->cmp_type, value->str_val, *(char**)&row->data[offset]);
-	} else {
-		/* something went really wrong here */
-		BUG_GENERIC();
-		return false;
-	}
+	batch->sel_count = batch->count;
 
+	return batch->count > 0;
 }
 
-static bool eval_cmp(struct table *table, struct row *row, struct ast_sel_cmp_node *node)
+static bool batch_index_lookup(struct batch_cursor *bc, struct table *table, struct vector *conjuncts)
 {
-	struct list_head *pos;
-	struct ast_node *tmp_node;
-	struct ast_node *node_1 = NULL, *node_2 = NULL;
-	struct ast_sel_exprval_node *val_1, *val_2;
-	struct ast_sel_fieldname_node *fld_1, *fld_2;
-
-	list_for_each(pos, node->node_children_head)
-	{
-		tmp_node = list_entry(pos, typeof(*tmp_node), head);
-
-		if (!node_1)
-			node_1 = tmp_node;
-		else
-			node_2 = tmp_node;
-	}
-
-	if (node_1->node_type == node_2->node_type && node_1->node_type == AST_TYPE_SEL_EXPRVAL) {
-		val_1 = (typeof(val_1))node_1;
-		val_2 = (typeof(val_2))node_2;
-
-		if (val_1->value_type.is_name && val_2->value_type.is_name) {
-			/* field to field comparison */
-			return cmp_field_to_field(table, row, node, val_1, val_2);
-		} else if (val_1->value_type.is_name && !val_2->value_type.is_name) {
-			/* field-to-value or value-to-field comparison */
-			return cmp_field_to_value(table, row, node, val_1, val_2);
-		} else if (!val_1->value_type.is_name && val_2->value_type.is_name) {
-			/* value-to-field or value-to-field comparison */
-			return cmp_field_to_value(table, row, node, val_2, val_1);
-		} else {
-			/* value-to-value comparison */
-			return cmp_value_to_value(node, val_1, val_2);
-		}
-	} else if (node_1->node_type == node_2->node_type && node_1->node_type == AST_TYPE_SEL_FIELDNAME) {
-		fld_1 = (typeof(fld_1))node_1;
-		fld_2 = (typeof(fld_2))node_2;
+	struct where_conjunct *conjunct;
+	struct bytecode **progs;
+	size_t count = 0;
+	bool found;
 
-		return cmp_fieldname_to_fieldname(table, row, node, fld_1, fld_2);
-	} else if (node_1->node_type == AST_TYPE_SEL_FIELDNAME && node_2->node_type == AST_TYPE_SEL_EXPRVAL) {
-		fld_1 = (typeof(fld_1))node_1;
-		val_2 = (typeof(val_2))node_2;
+	/* conjuncts are looked up together so bitmap indexes can intersect them */
+	if (!(progs = malloc(MAX(conjuncts->len / sizeof(*conjunct), 1) * sizeof(*progs))))
+		return false;
 
-		return cmp_fieldname_to_value(table, row, node, fld_1, val_2);
-	} else if (node_1->node_type == AST_TYPE_SEL_EXPRVAL && node_2->node_type == AST_TYPE_SEL_FIELDNAME) {
-		val_1 = (typeof(val_1))node_1;
-		fld_2 = (typeof(fld_2))node_2;
+	for (size_t i = 0; i < conjuncts->len / sizeof(*conjunct); i++) {
+		conjunct = &((struct where_conjunct*)conjuncts->data)[i];
 
-		return cmp_value_to_fieldname(table, row, node, val_1, fld_2);
-	} else {
-		/* to be implemented */
-		BUG_GENERIC();
-		return false;
+		if (conjunct->table_name && strcmp(conjunct->table_name, table->name) == 0)
+			progs[count++] = &conjunct->prog;
 	}
 
+	found = count && scan_index_lookup(table, progs, count, &bc->locs);
+	free(progs);
+
+	return found;
 }
 
-static bool eval_isxnull(struct table *table, struct row *row, struct ast_sel_isxnull_node *node)
+static void batch_eval_pushed_conjuncts(struct vector *conjuncts, struct table *table, struct row_batch *batch)
 {
-	struct list_head *pos;
-	struct ast_node *tmp_entry;
-	struct ast_sel_fieldname_node *field = NULL;
-	struct ast_sel_exprval_node *val = NULL;
-	int col_idx = -1;
-	bool is_field = false;
-	char key[FQFIELD_NAME_LEN] = {0};
+	struct where_conjunct *conjunct;
 
-	list_for_each(pos, node->node_children_head)
-	{
+	for (size_t i = 0; i < conjuncts->len / sizeof(*conjunct) && batch->sel_count; i++) {
+		conjunct = &((struct where_conjunct*)conjuncts->data)[i];
 
-		tmp_entry = list_entry(pos, typeof(*tmp_entry), head);
-		if (tmp_entry->node_type == AST_TYPE_SEL_FIELDNAME) {
-			field = (typeof(field))tmp_entry;
-			is_field = true;
-			break;
-		} else if (tmp_entry->node_type == AST_TYPE_SEL_EXPRVAL) {
-			val = (typeof(val))tmp_entry;
-			break;
-		}
+		if (!conjunct->table_name || strcmp(conjunct->table_name, table->name) != 0)
+			continue;
+
+		batch->sel_count = bytecode_filter(&conjunct->prog, batch->rows, batch->sel, batch->sel_count);
 	}
+}
 
-	/* sanity check */
-	BUG_ON(!field && !val);
+static bool eval_pushed_conjuncts(struct vector *conjuncts, struct table *table, struct row *row)
+{
+	struct where_conjunct *conjunct;
 
-	if (is_field) {
-		snprintf(key, sizeof(key) - 1, "%s.%s", field->table_name, field->col_name);
-	} else {
-		strncpy(key, val->name_val, sizeof(key) - 1);
-	}
+	for (size_t i = 0; i < conjuncts->len / sizeof(*conjunct); i++) {
+		conjunct = &((struct where_conjunct*)conjuncts->data)[i];
 
-	for (int i = 0; i < table->column_count; i++) {
-		struct column *col = &table->columns[i];
+		if (!conjunct->table_name || strcmp(conjunct->table_name, table->name) != 0)
+			continue;
 
-		if (strcmp(col->name, key) == 0) {
-			col_idx = i;
-			break;
-		}
+		if (!bytecode_run(&conjunct->prog, row))
+			return false;
 	}
 
-	return bit_test(row->null_bitmap, col_idx, sizeof(row->null_bitmap)) ^ node->is_negation;
+	return true;
 }
 
-static bool eval_isxin(struct table *table, struct row *row, struct ast_sel_isxin_node *node)
+/* datablocks that every row of would be filtered out by a pushed conjunct are skipped */
+static bool batch_block_may_match(struct table *table, struct datablock *blk, void *arg)
 {
-	struct list_head *pos;
-	struct ast_node *tmp_entry;
-	struct ast_sel_fieldname_node *field = NULL;
-	struct ast_sel_exprval_node *value = NULL;
-	struct ast_sel_cmp_node cmp_node = {0};
-	bool is_field;
+	struct vector *conjuncts = arg;
+	struct where_conjunct *conjunct;
 
-	if (node->is_negation) {
-		cmp_node.cmp_type = AST_CMP_DIFF_OP;
-	} else {
-		cmp_node.cmp_type = AST_CMP_EQUALS_OP;
-	}
+	for (size_t i = 0; i < conjuncts->len / sizeof(*conjunct); i++) {
+		conjunct = &((struct where_conjunct*)conjuncts->data)[i];
 
-	list_for_each(pos, node->node_children_head)
-	{
-		tmp_entry = list_entry(pos, typeof(*tmp_entry), head);
+		if (!conjunct->table_name || strcmp(conjunct->table_name, table->name) != 0)
+			continue;
 
-		if (tmp_entry->node_type == AST_TYPE_SEL_EXPRVAL) {
-			if (((struct ast_sel_exprval_node*)tmp_entry)->value_type.is_name) {
-				value = (typeof(value))tmp_entry;
-				break;
-			}
-		} else if (tmp_entry->node_type == AST_TYPE_SEL_FIELDNAME) {
-			field = (typeof(field))tmp_entry;
-			is_field = true;
-			break;
-		}
+		if (!scan_block_may_match(table, blk, &conjunct->prog))
+			return false;
 	}
 
-	/* sanity check */
-	BUG_ON(!field && !value);
+	return true;
+}
 
-	list_for_each(pos, node->node_children_head)
-	{
-		tmp_entry = list_entry(pos, typeof(*tmp_entry), head);
+/* runs on worker threads */
+static void batch_filter_morsel(struct morsel_scan *scan, struct morsel *morsel)
+{
+	struct vector *conjuncts = scan->arg;
+	struct scan_cursor cur;
+	struct row_batch batch;
+	struct row *row;
 
-		if (tmp_entry->node_type == AST_TYPE_SEL_FIELDNAME)
-			continue; /*same as field we jus fetched.. just move on */
+	scan_cursor_init(&cur, scan->table, morsel->first, morsel->end);
+	scan_cursor_filter(&cur, &batch_block_may_match, conjuncts);
 
-		BUG_ON(tmp_entry->node_type != AST_TYPE_SEL_EXPRVAL);
+	while (row_batch_fill(&batch, &cur)) {
+		batch_eval_pushed_conjuncts(conjuncts, scan->table, &batch);
 
-		if (!((struct ast_sel_exprval_node*)tmp_entry)->value_type.is_name) {
+		for (size_t i = 0; i < batch.sel_count; i++) {
+			row = batch.rows[batch.sel[i]];
 
-			if (is_field) {
-				if (!cmp_fieldname_to_value(table, row, &cmp_node, field,
-								(struct ast_sel_exprval_node*)tmp_entry))
-					return false; // fail-fast
-			} else {
-				if (!cmp_field_to_value(table, row, &cmp_node, value,
-							(struct ast_sel_exprval_node*)tmp_entry))
-					return false; // fail-fast
+			if (!vector_push(&morsel->out, &row, sizeof(row))) {
+				morsel->ret = -MIDORIDB_NOMEM;
+				return;
 			}
 		}
 	}
-	return true;
 }
 
-static bool eval_row_cond(struct ast_node *node, struct table *table, struct row *row)
+static void batch_cursor_reset(struct batch_cursor *bc, struct table *table, struct vector *conjuncts)
 {
-	struct list_head *pos;
-	struct ast_node *tmp_node;
-	struct ast_sel_logop_node *logop_node;
-	bool ret = true;
+	scan_cursor_init(&bc->cur, table, 0, SCAN_END);
+	scan_cursor_filter(&bc->cur, &batch_block_may_match, conjuncts);
+	bc->conjuncts = conjuncts;
+	bc->batch.count = 0;
+	bc->batch.sel_count = 0;
+	bc->sel_idx = 0;
+	bc->par = NULL;
+	bc->morsel_idx = 0;
+	bc->row_idx = 0;
+	bc->ret = MIDORIDB_OK;
+	bc->loc_idx = 0;
+	bc->use_index = false;
+}
 
-	if (node->node_type == AST_TYPE_SEL_CMP) {
-		return eval_cmp(table, row, (struct ast_sel_cmp_node*)node);
-	} else if (node->node_type == AST_TYPE_SEL_LOGOP) {
-		logop_node = (typeof(logop_node))node;
+/*
+ * @pool: worker pool the table can be scanned with, NULL if it must be scanned by this thread alone
+ */
+static void batch_cursor_init(struct batch_cursor *bc, struct table *table, struct vector *conjuncts,
+		struct worker_pool *pool)
+{
+	batch_cursor_reset(bc, table, conjuncts);
 
-		bool gate_init = false;
+	/* a full scan is still an option if we can't get hold of the memory */
+	if (vector_init(&bc->locs)) {
+		if ((bc->use_index = batch_index_lookup(bc, table, conjuncts)))
+			return;
 
-		list_for_each(pos, logop_node->node_children_head)
-		{
-			tmp_node = list_entry(pos, typeof(*tmp_node), head);
-
-			bool eval = eval_row_cond(tmp_node, table, row);
-
-			if (!gate_init) {
-				gate_init = true;
-				ret = eval;
-			} else if (logop_node->logop_type == AST_LOGOP_TYPE_AND)
-				ret = ret && eval;
-			else if (logop_node->logop_type == AST_LOGOP_TYPE_OR)
-				ret = ret || eval;
-			else if (logop_node->logop_type == AST_LOGOP_TYPE_XOR)
-				ret = ret ^ eval;
-			else
-				BUG_GENERIC();
-		}
+		vector_free(&bc->locs);
+	}
 
-	} else if (node->node_type == AST_TYPE_SEL_EXPRISXIN) {
-		return eval_isxin(table, row, (struct ast_sel_isxin_node*)node);
-	} else if (node->node_type == AST_TYPE_SEL_EXPRISXNULL) {
-		return eval_isxnull(table, row, (struct ast_sel_isxnull_node*)node);
-	} else {
-		list_for_each(pos, node->node_children_head)
-		{
-			tmp_node = list_entry(pos, typeof(*tmp_node), head);
+	if (!morsel_scan_is_parallel(pool, table))
+		return;
 
-			if (!eval_row_cond(tmp_node, table, row))
-				return false;
-		}
+	/* single-threaded scans are still an option if we can't get hold of the memory */
+	if (!(bc->par = malloc(sizeof(*bc->par))))
+		return;
+
+	if (!morsel_scan_init(bc->par, pool, table, &batch_filter_morsel, conjuncts)) {
+		free(bc->par);
+		bc->par = NULL;
 	}
-	return ret;
 }
 
-static int _join_nested_loop_tbl2tbl(struct database *db, struct ast_sel_join_node *join_node,
-		struct ast_sel_onexpr_node *onexpr_node, struct ast_sel_table_node *left_node,
-		struct ast_sel_table_node *right_node, struct table *mattbl)
+static void batch_cursor_free(struct batch_cursor *bc)
 {
-	struct table *left, *right;
-	struct list_head *left_pos, *right_pos;
-	struct datablock *left_blk, *right_blk;
-	size_t left_row_size, right_row_size, new_row_size;
-	struct row *left_row, *right_row, *new_row;
-
-	left = database_table_get(db, left_node->table_name);
-	right = database_table_get(db, right_node->table_name);
-
-	left_row_size = table_calc_row_size(left);
-	right_row_size = table_calc_row_size(right);
-	new_row_size = table_calc_row_size(mattbl);
+	if (bc->use_index) {
+		vector_free(&bc->locs);
+		bc->use_index = false;
+	}
 
-	// TODO add nested-loop for other join types.. for now I will focus on the INNER JOIN
-	BUG_ON(join_node->join_type != AST_SEL_JOIN_INNER);
+	if (!bc->par)
+		return;
 
-	list_for_each(left_pos, left->datablock_head)
-	{
-		left_blk = list_entry(left_pos, typeof(*left_blk), head);
-		for (size_t i = 0; i < (DATABLOCK_PAGE_SIZE / left_row_size); i++) {
-			left_row = (struct row*)&left_blk->data[left_row_size * i];
+	morsel_scan_free(bc->par);
+	free(bc->par);
+	bc->par = NULL;
+}
 
-			if (left_row->flags.empty)
-				break; /* end of the line */
+static int push_null_rows(struct table *table, int col_idx, struct vector *locs)
+{
+	struct scan_cursor cur;
+	struct row_location loc;
+	struct row *row;
 
-			if (left_row->flags.deleted)
-				continue; /* nothing to do here */
+	scan_cursor_init(&cur, table, 0, SCAN_END);
 
-			list_for_each(right_pos, right->datablock_head)
-			{
-				right_blk = list_entry(right_pos, typeof(*right_blk), head);
+	while ((row = scan_cursor_next(&cur, &loc.blk, &loc.offset))) {
+		if (!bit_test(row->null_bitmap, col_idx, sizeof(row->null_bitmap)))
+			continue;
 
-				for (size_t j = 0; j < (DATABLOCK_PAGE_SIZE / right_row_size); j++) {
-					right_row = (struct row*)&right_blk->data[right_row_size * j];
+		if (!vector_push(locs, &loc, sizeof(loc)))
+			return -MIDORIDB_NOMEM;
+	}
 
-					if (right_row->flags.empty)
-						break; /* end of the line */
+	return MIDORIDB_OK;
+}
 
-					if (right_row->flags.deleted)
-						continue; /* nothing to do here */
+/*
+ * @col_idx: column whose IT_BTREE index sets the order rows are handed out in
+ * @desc: whether rows are handed out in descending order rather than ascending
+ */
+static int batch_cursor_init_ordered(struct batch_cursor *bc, struct table *table, struct vector *conjuncts,
+		int col_idx, bool desc)
+{
+	struct where_conjunct *conjunct;
+	struct index_range range = {0};
+	bool bounded = false;
+	bool has_nulls;
+	int ret;
 
-					//TODO figure out how I will populate aliases into the new row
-					// SELECT (f1 + 4) as val FROM A JOIN B ON ....
+	batch_cursor_reset(bc, table, conjuncts);
 
-					/* copy columns of both rows to materialised row */
-					if (merge_rows(left, right, left_row, right_row, mattbl, &new_row))
-						goto err;
+	if (!vector_init(&bc->locs))
+		return -MIDORIDB_NOMEM;
 
-					if (eval_row_cond((struct ast_node*)onexpr_node, mattbl, new_row)) {
+	bc->use_index = true;
 
-						if (!table_insert_row(mattbl, new_row, new_row_size))
-							goto err;
+	for (size_t i = 0; i < conjuncts->len / sizeof(*conjunct); i++) {
+		conjunct = &((struct where_conjunct*)conjuncts->data)[i];
 
-//						print_row(mattbl, new_row);
+		if (!conjunct->table_name || strcmp(conjunct->table_name, table->name) != 0)
+			continue;
 
-					}
-					/* free up used resources */
-					table_free_row_content(mattbl, new_row);
-					free(new_row);
-				}
-			}
-		}
+		if (scan_index_bounds(table, col_idx, &conjunct->prog, &range))
+			bounded = true;
 	}
 
-	return MIDORIDB_OK;
+	/* no comparison matches NULLs, so there's no point looking for them if the column is bounded */
+	has_nulls = !bounded && table->columns[col_idx].nullable;
 
-err:
-	return -MIDORIDB_INTERNAL;
+	if (has_nulls && !desc && (ret = push_null_rows(table, col_idx, &bc->locs)))
+		goto err;
 
+	if ((ret = table_index_range(table, col_idx, &range, desc, SIZE_MAX, &bc->locs)))
+		goto err;
+
+	if (has_nulls && desc && (ret = push_null_rows(table, col_idx, &bc->locs)))
+		goto err;
+
+	return MIDORIDB_OK;
+
+err:
+	batch_cursor_free(bc);
+	return ret;
+}
+
+static struct row* batch_cursor_next_par(struct batch_cursor *bc)
+{
+	struct morsel *morsel;
+
+	for (;;) {
+		if (bc->morsel_idx < bc->par->nmorsels) {
+			morsel = &bc->par->morsels[bc->morsel_idx];
+
+			if (morsel->ret) {
+				bc->ret = morsel->ret;
+				return NULL;
+			}
+
+			if (bc->row_idx < morsel->out.len / sizeof(struct row*))
+				return ((struct row**)morsel->out.data)[bc->row_idx++];
+
+			bc->morsel_idx++;
+			bc->row_idx = 0;
+			continue;
+		}
+
+		if (!morsel_scan_wave(bc->par))
+			return NULL; /* end of the line */
+
+		bc->morsel_idx = 0;
+		bc->row_idx = 0;
+	}
+}
+
+/*
+ * this function returns NULL at the end of the table or on error (bc->ret is set then)
+ */
+static struct row* batch_cursor_next(struct batch_cursor *bc)
+{
+	if (bc->par)
+		return batch_cursor_next_par(bc);
+
+	while (bc->sel_idx >= bc->batch.sel_count) {
+		if (bc->use_index && !row_batch_fill_locs(&bc->batch, &bc->locs, &bc->loc_idx))
+			return NULL; /* end of the line */
+		else if (!bc->use_index && !row_batch_fill(&bc->batch, &bc->cur))
+			return NULL; /* end of the line */
+
+		batch_eval_pushed_conjuncts(bc->conjuncts, bc->cur.table, &bc->batch);
+		bc->sel_idx = 0;
+	}
+
+	return bc->batch.rows[bc->batch.sel[bc->sel_idx++]];
+}
+
+/*
+ * Equi-join: ON-clauses such as 'A.f1 = B.f2' (optionally AND'ed with anything else) can be answered
+ * by hashing the inner table on its join column and probing it with each outer row rather than
+ * merging every pair of rows. The whole ON-clause is still evaluated on each merged row, so anything
+ * other than the equality used for hashing remains a residual predicate.
+ *
+ * If the inner table has an index on its join column, rows matching each outer row are looked up
+ * through it instead (index nested loop). Nothing has to be built up front so that's preferred
+ * whenever such an index exists, e.g. a fact table joined to a dimension by its key. Both columns
+ * must be of the same type though, outer values are used as index keys as they are.
+ */
+struct hash_join {
+	/* join key -> vector of inner rows (struct row*) sharing that key */
+	struct hashtable rows_ht;
+	struct column_specs inner_col;
+	struct column_specs outer_col;
+};
+
+static bool is_equijoin_side(struct ast_sel_fieldname_node *inner_fld, struct ast_sel_fieldname_node *outer_fld,
+		char *inner_tbl, char *outer_tbl)
+{
+	if (strcmp(inner_fld->table_name, inner_tbl) != 0)
+		return false;
+
+	if (outer_tbl)
+		return strcmp(outer_fld->table_name, outer_tbl) == 0;
+
+	return strcmp(outer_fld->table_name, inner_tbl) != 0;
+}
+
+static bool find_equijoin_fields(struct ast_node *node, char *inner_tbl, char *outer_tbl,
+		struct ast_sel_fieldname_node **inner_fld, struct ast_sel_fieldname_node **outer_fld)
+{
+	struct list_head *pos;
+	struct ast_node *tmp_entry;
+	struct ast_node *node_1 = NULL, *node_2 = NULL;
+	struct ast_sel_fieldname_node *fld_1, *fld_2;
+
+	if (node->node_type == AST_TYPE_SEL_ONEXPR
+			|| (node->node_type == AST_TYPE_SEL_LOGOP
+					&& ((struct ast_sel_logop_node*)node)->logop_type == AST_LOGOP_TYPE_AND)) {
+
+		list_for_each(pos, node->node_children_head)
+		{
+			tmp_entry = list_entry(pos, typeof(*tmp_entry), head);
+
+			if (find_equijoin_fields(tmp_entry, inner_tbl, outer_tbl, inner_fld, outer_fld))
+				return true;
+		}
+		return false;
+	}
+
+	if (node->node_type != AST_TYPE_SEL_CMP
+			|| ((struct ast_sel_cmp_node*)node)->cmp_type != AST_CMP_EQUALS_OP)
+		return false;
+
+	list_for_each(pos, node->node_children_head)
+	{
+		tmp_entry = list_entry(pos, typeof(*tmp_entry), head);
+
+		if (!node_1)
+			node_1 = tmp_entry;
+		else
+			node_2 = tmp_entry;
+	}
+
+	if (node_1->node_type != AST_TYPE_SEL_FIELDNAME || node_2->node_type != AST_TYPE_SEL_FIELDNAME)
+		return false;
+
+	fld_1 = (typeof(fld_1))node_1;
+	fld_2 = (typeof(fld_2))node_2;
+
+	/* one field on each side of the join. (outer_tbl is NULL when the outer side is the early-mat table) */
+	if (is_equijoin_side(fld_1, fld_2, inner_tbl, outer_tbl)) {
+		*inner_fld = fld_1;
+		*outer_fld = fld_2;
+		return true;
+	} else if (is_equijoin_side(fld_2, fld_1, inner_tbl, outer_tbl)) {
+		*inner_fld = fld_2;
+		*outer_fld = fld_1;
+		return true;
+	}
+
+	return false;
+}
+
+static bool hash_join_key(struct row *row, struct column_specs *spcs, double *tmp_dbl, const void **key, size_t *key_len)
+{
+	/* no comparison evaluates to true if NULL is one of the operands, so these never join */
+	if (bit_test(row->null_bitmap, spcs->col_idx, sizeof(row->null_bitmap)))
+		return false;
+
+	if (spcs->type == CT_VARCHAR) {
+		*key = *(char**)&row->data[spcs->offset];
+		*key_len = strlen(*key) + 1;
+	} else if (spcs->type == CT_DOUBLE) {
+		/* -0.0 == 0.0 so both have to land on the same bucket */
+		*tmp_dbl = *(double*)&row->data[spcs->offset] + 0.0;
+		*key = tmp_dbl;
+		*key_len = sizeof(*tmp_dbl);
+	} else {
+		*key = &row->data[spcs->offset];
+		*key_len = table_calc_column_precision(spcs->type);
+	}
+
+	return true;
+}
+
+static void free_hash_join_entries(struct hashtable *hashtable, const void *key, size_t klen,
+		const void *value, size_t vlen, void *arg)
+{
+	UNUSED(vlen);
+
+	vector_free((struct vector*)value);
+	free_hashmap_entries(hashtable, key, klen, value, vlen, arg);
+}
+
+static void hash_join_free(struct hash_join *hj)
+{
+	hashtable_foreach(&hj->rows_ht, &free_hash_join_entries, NULL);
+	hashtable_free(&hj->rows_ht);
+}
+
+static int hash_join_build(struct table *inner, struct hash_join *hj, struct vector *conjuncts,
+		struct worker_pool *pool)
+{
+	struct batch_cursor *bc;
+	struct row *row;
+	struct hashtable_value *chain;
+	struct vector new_chain;
+	const void *key;
+	size_t key_len;
+	double tmp_dbl;
+
+	if (!hashtable_init(&hj->rows_ht, &hashtable_mem_compare, &hashtable_str_hash))
+		goto err;
+
+	if (!(bc = malloc(sizeof(*bc))))
+		goto err_ht;
+
+	batch_cursor_init(bc, inner, conjuncts, pool);
+
+	while ((row = batch_cursor_next(bc))) {
+		if (!hash_join_key(row, &hj->inner_col, &tmp_dbl, &key, &key_len))
+			continue;
+
+		if ((chain = hashtable_get(&hj->rows_ht, key, key_len))) {
+			if (!vector_push(chain->content, &row, sizeof(row)))
+				goto err_bc;
+		} else {
+			if (!vector_init(&new_chain))
+				goto err_bc;
+
+			if (!vector_push(&new_chain, &row, sizeof(row))
+					|| !hashtable_put(&hj->rows_ht, key, key_len, &new_chain, sizeof(new_chain))) {
+				vector_free(&new_chain);
+				goto err_bc;
+			}
+		}
+	}
+
+	if (bc->ret)
+		goto err_bc;
+
+	batch_cursor_free(bc);
+	free(bc);
+	return MIDORIDB_OK;
+
+err_bc:
+	batch_cursor_free(bc);
+	free(bc);
+err_ht:
+	hash_join_free(hj);
+err:
+	return -MIDORIDB_INTERNAL;
+}
+
+static bool eval_residual_conjuncts(struct vector *conjuncts, struct row *row)
+{
+	struct where_conjunct *conjunct;
+
+	for (size_t i = 0; i < conjuncts->len / sizeof(*conjunct); i++) {
+		conjunct = &((struct where_conjunct*)conjuncts->data)[i];
+
+		if (conjunct->table_name)
+			continue; /* already evaluated in the FROM-clause */
+
+		if (!bytecode_run(&conjunct->prog, row))
+			return false;
+	}
+
+	return true;
+}
+
+static bool has_residual_conjuncts(struct vector *conjuncts)
+{
+	struct where_conjunct *conjunct;
+
+	for (size_t i = 0; i < conjuncts->len / sizeof(*conjunct); i++) {
+		conjunct = &((struct where_conjunct*)conjuncts->data)[i];
+
+		if (!conjunct->table_name)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * SELECT statements are executed as a pull-based (Volcano-style) operator tree:
+ *
+ *	project <- filter <- join <- ... <- join <- scan
+ *
+ * Rows flow one at a time in the early-mat table layout (the early-mat table is only used as the
+ * row layout here). Joins pull rows from their outer child and match them against an inner source
+ * table; building the hash table of a hash join is the only thing they materialise. Statements with
+ * blocking operators (GROUP BY, COUNT) drain the pipeline into the early-mat table, anything else
+ * is handed over to query_cur_step which pulls rows as the client asks for them.
+ */
+static void op_row_free(struct table *table, struct row **row)
+{
+	if (!(*row))
+		return;
+
+	table_free_row_content(table, *row);
+	free(*row);
+	*row = NULL;
+}
+
+static int copy_row(struct table *src, struct row *src_row, struct table *dst, struct row **out, bool is_src_earlymat)
+{
+	*out = zalloc(table_calc_row_size(dst));
+	if (!(*out))
+		return -MIDORIDB_INTERNAL;
+
+	(*out)->flags.deleted = false;
+	(*out)->flags.empty = false;
+
+	for (int i = 0; i < dst->column_count; i++) {
+		bit_set((*out)->null_bitmap, i, sizeof((*out)->null_bitmap));
+	}
+
+	if (!cpy_cols(src, src_row, dst, *out, is_src_earlymat)) {
+		op_row_free(dst, out);
+		return -MIDORIDB_INTERNAL;
+	}
+
+	init_count_cols(dst, *out);
+
+	return MIDORIDB_OK;
+}
+
+struct scan_op {
+	struct sel_operator op;
+	/* source table, pinned for as long as the operator lives */
+	struct table *table;
+	struct batch_cursor cur;
+	struct table *mattbl;
+	struct row *row;
+};
+
+static int scan_op_next(struct sel_operator *op, struct row **out)
+{
+	struct scan_op *scan = container_of(op, typeof(*scan), op);
+	struct row *row;
+
+	op_row_free(scan->mattbl, &scan->row);
+
+	if (!(row = batch_cursor_next(&scan->cur)))
+		return scan->cur.ret;
+
+	if (copy_row(scan->cur.cur.table, row, scan->mattbl, &scan->row, false))
+		return -MIDORIDB_INTERNAL;
+
+	*out = scan->row;
+	return MIDORIDB_ROW;
+}
+
+static void scan_op_free(struct sel_operator *op)
+{
+	struct scan_op *scan = container_of(op, typeof(*scan), op);
+
+	op_row_free(scan->mattbl, &scan->row);
+	batch_cursor_free(&scan->cur);
+	table_unpin(scan->table);
+	free(scan);
+}
+
+static bool scan_op_reads(struct sel_operator *op, struct table *table)
+{
+	return container_of(op, struct scan_op, op)->table == table;
+}
+
+static int scan_op_new(struct table *table, struct vector *conjuncts, struct table *mattbl, struct worker_pool *pool,
+		struct sel_operator **out)
+{
+	struct scan_op *scan;
+
+	if (!(scan = zalloc(sizeof(*scan))))
+		return -MIDORIDB_NOMEM;
+
+	if (table_pin(table)) {
+		free(scan);
+		return -MIDORIDB_INTERNAL;
+	}
+
+	scan->op.next = &scan_op_next;
+	scan->op.free = &scan_op_free;
+	scan->op.reads = &scan_op_reads;
+	scan->table = table;
+	batch_cursor_init(&scan->cur, table, conjuncts, pool);
+	scan->mattbl = mattbl;
+
+	*out = &scan->op;
+	return MIDORIDB_OK;
+}
+
+/* scan walking the rows of a table in the order of an index (see struct batch_cursor) */
+static int scan_op_new_ordered(struct table *table, struct vector *conjuncts, struct table *mattbl, int col_idx,
+		bool desc, struct sel_operator **out)
+{
+	struct scan_op *scan;
+	int ret;
+
+	if (!(scan = zalloc(sizeof(*scan))))
+		return -MIDORIDB_NOMEM;
+
+	if (table_pin(table)) {
+		free(scan);
+		return -MIDORIDB_INTERNAL;
+	}
+
+	if ((ret = batch_cursor_init_ordered(&scan->cur, table, conjuncts, col_idx, desc))) {
+		table_unpin(table);
+		free(scan);
+		return ret;
+	}
+
+	scan->op.next = &scan_op_next;
+	scan->op.free = &scan_op_free;
+	scan->op.reads = &scan_op_reads;
+	scan->table = table;
+	scan->mattbl = mattbl;
+
+	*out = &scan->op;
+	return MIDORIDB_OK;
+}
+
+struct join_op {
+	struct sel_operator op;
+	/* rows to be matched (early-mat layout) */
+	struct sel_operator *outer;
+	struct row *outer_row;
+	/* source table each outer row is matched against, pinned for as long as the operator lives */
+	struct table *inner;
+	/* hash join (NULL if this is a nested loop) */
+	struct hash_join hash_join;
+	struct hash_join *hj;
+	/* inner rows sharing the outer row's join key */
+	struct vector *chain;
+	size_t chain_idx;
+	/* index nested loop (join columns are in hash_join, hj is NULL) */
+	bool index_probe;
+	/* inner rows sharing the outer row's join key (struct row_location) */
+	struct vector locs;
+	size_t loc_idx;
+	/* nested loop: every inner row is a candidate */
+	struct batch_cursor inner_cur;
+	/* ON-clause compiled against the early-mat table */
+	struct bytecode on_prog;
+	struct vector *conjuncts;
+	struct table *mattbl;
+	struct row *row;
+};
+
+static int join_op_rewind(struct join_op *join)
+{
+	struct hashtable_value *chain;
+	const void *key;
+	size_t key_len;
+	double tmp_dbl;
+
+	if (join->index_probe) {
+		join->locs.len = 0;
+		join->loc_idx = 0;
+
+		/* NULLs never match (and aren't indexed anyway) */
+		if (!hash_join_key(join->outer_row, &join->hash_join.outer_col, &tmp_dbl, &key, &key_len))
+			return MIDORIDB_OK;
+
+		if (!table_index_lookup(join->inner, join->hash_join.inner_col.col_idx, (void*)key, &join->locs))
+			return -MIDORIDB_NOMEM;
+
+		return MIDORIDB_OK;
+	}
+
+	if (!join->hj) {
+		/* rescanned for every outer row, not worth waking the workers up */
+		batch_cursor_free(&join->inner_cur);
+		batch_cursor_init(&join->inner_cur, join->inner, join->conjuncts, NULL);
+		return MIDORIDB_OK;
+	}
+
+	join->chain = NULL;
+	join->chain_idx = 0;
+
+	/* NULLs never match */
+	if (!hash_join_key(join->outer_row, &join->hj->outer_col, &tmp_dbl, &key, &key_len))
+		return MIDORIDB_OK;
+
+	if ((chain = hashtable_get(&join->hj->rows_ht, key, key_len)))
+		join->chain = chain->content;
+
+	return MIDORIDB_OK;
+}
+
+static struct row* join_op_next_candidate(struct join_op *join)
+{
+	struct row_location *loc;
+	struct row *row;
+
+	if (join->index_probe) {
+		while (join->loc_idx < join->locs.len / sizeof(*loc)) {
+			loc = &((struct row_location*)join->locs.data)[join->loc_idx++];
+			row = (struct row*)&loc->blk->data[loc->offset];
+
+			/* hash joins only get to see inner rows the pushed conjuncts let through, neither should we */
+			if (eval_pushed_conjuncts(join->conjuncts, join->inner, row))
+				return row;
+		}
+
+		return NULL;
+	}
+
+	if (join->hj) {
+		if (!join->chain || join->chain_idx >= join->chain->len / sizeof(row))
+			return NULL;
+
+		return ((struct row**)join->chain->data)[join->chain_idx++];
+	}
+
+	return batch_cursor_next(&join->inner_cur);
+}
+
+static int join_op_next(struct sel_operator *op, struct row **out)
+{
+	struct join_op *join = container_of(op, typeof(*join), op);
+	struct row *inner_row;
+	int ret;
+
+	//TODO figure out how I will populate aliases into the new row
+	// SELECT (f1 + 4) as val FROM A JOIN B ON ....
+
+	op_row_free(join->mattbl, &join->row);
+
+	for (;;) {
+		if (!join->outer_row) {
+			if ((ret = join->outer->next(join->outer, &join->outer_row)) != MIDORIDB_ROW) {
+				join->outer_row = NULL;
+				return ret;
+			}
+
+			if ((ret = join_op_rewind(join)))
+				return ret;
+		}
+
+		while ((inner_row = join_op_next_candidate(join))) {
+			/* copy columns of both rows to materialised row */
+			if (merge_rows(join->inner, join->mattbl, inner_row, join->outer_row, join->mattbl, &join->row))
+				return -MIDORIDB_INTERNAL;
+
+			if (bytecode_run(&join->on_prog, join->row)) {
+				*out = join->row;
+				return MIDORIDB_ROW;
+			}
+
+			op_row_free(join->mattbl, &join->row);
+		}
+
+		join->outer_row = NULL;
+	}
+}
+
+static void join_op_free(struct sel_operator *op)
+{
+	struct join_op *join = container_of(op, typeof(*join), op);
+
+	if (join->index_probe)
+		vector_free(&join->locs);
+	else if (join->hj)
+		hash_join_free(join->hj);
+	else
+		batch_cursor_free(&join->inner_cur);
+
+	bytecode_free(&join->on_prog);
+	op_row_free(join->mattbl, &join->row);
+	join->outer->free(join->outer);
+	table_unpin(join->inner);
+	free(join);
+}
+
+static bool join_op_reads(struct sel_operator *op, struct table *table)
+{
+	struct join_op *join = container_of(op, typeof(*join), op);
+
+	return join->inner == table || join->outer->reads(join->outer, table);
+}
+
+/*
+ * @outer_tbl: name of the source table on the outer side, NULL if the outer side is itself a join
+ */
+static int join_op_new(struct sel_operator *outer, char *outer_tbl, struct table *inner,
+		struct ast_sel_join_node *join_node, struct ast_sel_onexpr_node *onexpr_node,
+		struct vector *conjuncts, struct table *mattbl, struct worker_pool *pool, struct sel_operator **out)
+{
+	struct join_op *join;
+	struct ast_sel_fieldname_node *inner_fld, *outer_fld;
+	struct index *index;
+	int ret;
+
+	// TODO add other join types.. for now I will focus on the INNER JOIN
+	BUG_ON(join_node->join_type != AST_SEL_JOIN_INNER);
+
+	if (!(join = zalloc(sizeof(*join))))
+		return -MIDORIDB_NOMEM;
+
+	if (table_pin(inner)) {
+		free(join);
+		return -MIDORIDB_INTERNAL;
+	}
+
+	join->op.next = &join_op_next;
+	join->op.free = &join_op_free;
+	join->op.reads = &join_op_reads;
+	join->outer = outer;
+	join->inner = inner;
+	join->conjuncts = conjuncts;
+	join->mattbl = mattbl;
+
+	if (!bytecode_compile(&join->on_prog, mattbl, (struct ast_node*)onexpr_node)) {
+		ret = -MIDORIDB_INTERNAL;
+		goto err_unpin;
+	}
+
+	if (find_equijoin_fields((struct ast_node*)onexpr_node, inner->name, outer_tbl, &inner_fld, &outer_fld)) {
+		BUG_ON(!find_column_table(inner, inner_fld->col_name, &join->hash_join.inner_col));
+		BUG_ON(!find_column_mattbl(mattbl, (struct ast_node*)outer_fld, &join->hash_join.outer_col));
+
+		/* bitmap indexes would hand out a good part of the table on every probe */
+		index = inner->indexes[join->hash_join.inner_col.col_idx];
+
+		if (index && index->type != IT_BITMAP
+				&& join->hash_join.inner_col.type == join->hash_join.outer_col.type) {
+			if (!vector_init(&join->locs)) {
+				ret = -MIDORIDB_NOMEM;
+				goto err_prog;
+			}
+
+			join->index_probe = true;
+		} else if ((ret = hash_join_build(inner, &join->hash_join, conjuncts, pool))) {
+			goto err_prog;
+		} else {
+			join->hj = &join->hash_join;
+		}
+	}
+
+	*out = &join->op;
+	return MIDORIDB_OK;
+
+err_prog:
+	bytecode_free(&join->on_prog);
+err_unpin:
+	table_unpin(inner);
+	free(join);
+	return ret;
 }
 
-static int _join_nested_loop_tbl2mat(struct database *db, struct ast_sel_join_node *join_node,
-		struct ast_sel_onexpr_node *onexpr_node, struct ast_sel_table_node *table_node_1,
-		struct table *mattbl)
+struct filter_op {
+	struct sel_operator op;
+	struct sel_operator *child;
+	struct vector *conjuncts;
+	struct table *mattbl;
+};
+
+static int filter_op_next(struct sel_operator *op, struct row **out)
 {
-	struct table *table_1, *table_2;
-	struct list_head *tbl1_pos, *tbl2_pos;
-	struct datablock *tbl1_blk, *tbl2_blk;
-	size_t tbl1_row_size, tbl2_row_size, new_row_size;
-	struct row *tbl1_row, *tbl2_row, *new_row;
+	struct filter_op *filter = container_of(op, typeof(*filter), op);
+	int ret;
 
-	table_1 = database_table_get(db, table_node_1->table_name);
-	table_2 = mattbl;
+	while ((ret = filter->child->next(filter->child, out)) == MIDORIDB_ROW) {
+		if (eval_residual_conjuncts(filter->conjuncts, *out))
+			return MIDORIDB_ROW;
+	}
 
-	tbl1_row_size = table_calc_row_size(table_1);
-	tbl2_row_size = table_calc_row_size(table_2);
-	new_row_size = table_calc_row_size(mattbl);
+	return ret;
+}
 
-	// TODO add nested-loop for other join types.. for now I will focus on the INNER JOIN
-	BUG_ON(join_node->join_type != AST_SEL_JOIN_INNER);
+static void filter_op_free(struct sel_operator *op)
+{
+	struct filter_op *filter = container_of(op, typeof(*filter), op);
 
-	list_for_each(tbl1_pos, table_1->datablock_head)
-	{
-		tbl1_blk = list_entry(tbl1_pos, typeof(*tbl1_blk), head);
-		for (size_t i = 0; i < (DATABLOCK_PAGE_SIZE / tbl1_row_size); i++) {
-			tbl1_row = (struct row*)&tbl1_blk->data[tbl1_row_size * i];
+	filter->child->free(filter->child);
+	free(filter);
+}
 
-			if (tbl1_row->flags.empty)
-				break; /* end of the line */
+static bool filter_op_reads(struct sel_operator *op, struct table *table)
+{
+	struct filter_op *filter = container_of(op, typeof(*filter), op);
 
-			if (tbl1_row->flags.deleted)
-				continue; /* nothing to do here */
+	return filter->child->reads(filter->child, table);
+}
+
+static int filter_op_new(struct sel_operator *child, struct vector *conjuncts, struct table *mattbl,
+		struct sel_operator **out)
+{
+	struct filter_op *filter;
 
-			list_for_each(tbl2_pos, table_2->datablock_head)
-			{
-				tbl2_blk = list_entry(tbl2_pos, typeof(*tbl2_blk), head);
+	if (!(filter = zalloc(sizeof(*filter))))
+		return -MIDORIDB_NOMEM;
+
+	filter->op.next = &filter_op_next;
+	filter->op.free = &filter_op_free;
+	filter->op.reads = &filter_op_reads;
+	filter->child = child;
+	filter->conjuncts = conjuncts;
+	filter->mattbl = mattbl;
+
+	*out = &filter->op;
+	return MIDORIDB_OK;
+}
+
+/*
+ * root of a streamed pipeline, it also owns everything the other operators share: WHERE-clause
+ * conjuncts and the early-mat table layout.
+ */
+struct project_op {
+	struct sel_operator op;
+	struct sel_operator *child;
+	struct vector *conjuncts;
+	struct table *mattbl;
+	struct table *outtbl;
+	struct row *row;
+};
 
-				for (size_t j = 0; j < (DATABLOCK_PAGE_SIZE / tbl2_row_size); j++) {
-					tbl2_row = (struct row*)&tbl2_blk->data[tbl2_row_size * j];
+static int project_op_next(struct sel_operator *op, struct row **out)
+{
+	struct project_op *proj = container_of(op, typeof(*proj), op);
+	struct row *row;
+	int ret;
 
-					if (tbl2_row->flags.empty)
-						break; /* end of the line */
+	op_row_free(proj->outtbl, &proj->row);
 
-					if (tbl2_row->flags.deleted)
-						continue; /* nothing to do here */
+	if ((ret = proj->child->next(proj->child, &row)) != MIDORIDB_ROW)
+		return ret;
 
-					//TODO figure out how I will populate aliases into the new row
-					// SELECT (f1 + 4) as val FROM A JOIN B ON ....
+	if (copy_row(proj->mattbl, row, proj->outtbl, &proj->row, true))
+		return -MIDORIDB_INTERNAL;
 
-					/* copy columns of both rows to materialised row */
-					if (merge_rows(table_1, mattbl, tbl1_row, tbl2_row, mattbl, &new_row))
-						goto err;
+	*out = proj->row;
+	return MIDORIDB_ROW;
+}
 
-					if (eval_row_cond((struct ast_node*)onexpr_node, mattbl, new_row)) {
+static void project_op_free(struct sel_operator *op)
+{
+	struct project_op *proj = container_of(op, typeof(*proj), op);
 
-						if (!table_update_row(mattbl, tbl2_blk, tbl2_row_size * j, new_row,
-									new_row_size))
-							goto err;
+	op_row_free(proj->outtbl, &proj->row);
+	proj->child->free(proj->child);
+	free_where_conjuncts(proj->conjuncts);
+	table_destroy(&proj->mattbl);
+	free(proj);
+}
 
-//						print_row(mattbl, new_row);
+static bool project_op_reads(struct sel_operator *op, struct table *table)
+{
+	struct project_op *proj = container_of(op, typeof(*proj), op);
 
-					} else {
-						/* when using materialisation tables,
-						 * if it doesn't match ON-clause then it needs to be discarded
-						 * TODO: this should change once we implement other JOIN types
-						 */
-						table_delete_row(mattbl, tbl2_blk, tbl2_row_size * j);
-					}
+	return proj->child->reads(proj->child, table);
+}
 
-					/* free up used resources */
-					table_free_row_content(mattbl, new_row);
-					free(new_row);
-				}
-			}
-		}
-	}
+static int project_op_new(struct sel_operator *child, struct vector *conjuncts, struct table *mattbl,
+		struct table *outtbl, struct sel_operator **out)
+{
+	struct project_op *proj;
 
-	return MIDORIDB_OK;
+	if (!(proj = zalloc(sizeof(*proj))))
+		return -MIDORIDB_NOMEM;
 
-err:
-	return -MIDORIDB_INTERNAL;
+	proj->op.next = &project_op_next;
+	proj->op.free = &project_op_free;
+	proj->op.reads = &project_op_reads;
+	proj->child = child;
+	proj->conjuncts = conjuncts;
+	proj->mattbl = mattbl;
+	proj->outtbl = outtbl;
 
+	*out = &proj->op;
+	return MIDORIDB_OK;
 }
 
-static int proc_from_clause_join(struct database *db, struct ast_sel_join_node *join_node, struct table *earmattbl)
+static int build_join_pipeline(struct database *db, struct ast_sel_join_node *join_node, struct vector *conjuncts,
+		struct table *mattbl, struct sel_operator **out)
 {
 	struct list_head *pos;
 	struct ast_node *tmp_entry;
-
 	struct ast_sel_onexpr_node *onexpr_node = NULL;
 	struct ast_node *left_node = NULL, *right_node = NULL;
-
-	int early_ret;
+	struct ast_sel_table_node *inner_node;
+	struct sel_operator *outer;
+	char *outer_tbl = NULL;
+	int ret;
 
 	list_for_each(pos, join_node->node_children_head)
 	{
@@ -1255,97 +1669,91 @@ static int proc_from_clause_join(struct database *db, struct ast_sel_join_node *
 	}
 
 	if (left_node->node_type == AST_TYPE_SEL_TABLE && right_node->node_type == AST_TYPE_SEL_TABLE) {
-		return _join_nested_loop_tbl2tbl(db, join_node, onexpr_node,
-							(struct ast_sel_table_node*)left_node,
-							(struct ast_sel_table_node*)right_node, earmattbl);
+		/* left rows are the outer side so they keep their order */
+		outer_tbl = ((struct ast_sel_table_node*)left_node)->table_name;
+		inner_node = (struct ast_sel_table_node*)right_node;
+
+		ret = scan_op_new(database_table_get(db, outer_tbl), conjuncts, mattbl, &db->pool, &outer);
 	} else if (left_node->node_type == AST_TYPE_SEL_JOIN && right_node->node_type == AST_TYPE_SEL_TABLE) {
-		if ((early_ret = proc_from_clause_join(db, (struct ast_sel_join_node*)left_node, earmattbl)))
-			return early_ret;
+		inner_node = (struct ast_sel_table_node*)right_node;
 
-		return _join_nested_loop_tbl2mat(db, join_node, onexpr_node,
-							(struct ast_sel_table_node*)right_node,
-							earmattbl);
+		ret = build_join_pipeline(db, (struct ast_sel_join_node*)left_node, conjuncts, mattbl, &outer);
 	} else if (left_node->node_type == AST_TYPE_SEL_TABLE && right_node->node_type == AST_TYPE_SEL_JOIN) {
-		if ((early_ret = proc_from_clause_join(db, (struct ast_sel_join_node*)right_node, earmattbl)))
-			return early_ret;
+		inner_node = (struct ast_sel_table_node*)left_node;
 
-		return _join_nested_loop_tbl2mat(db, join_node, onexpr_node,
-							(struct ast_sel_table_node*)left_node,
-							earmattbl);
+		ret = build_join_pipeline(db, (struct ast_sel_join_node*)right_node, conjuncts, mattbl, &outer);
 	} else {
 		BUG_GENERIC();
+		return -MIDORIDB_INTERNAL;
 	}
 
-	return MIDORIDB_OK;
+	if (ret)
+		return ret;
+
+	if ((ret = join_op_new(outer, outer_tbl, database_table_get(db, inner_node->table_name), join_node,
+				onexpr_node, conjuncts, mattbl, &db->pool, out)))
+		outer->free(outer);
+
+	return ret;
 }
 
-static int proc_from_clause_table(struct database *db, struct ast_sel_table_node *table_node, struct table *mattbl)
+/*
+ * returns the column a single-table statement can be sorted by through its index, -1 if there are none
+ */
+static int find_orderby_index(struct ast_node *root, struct table *table, bool *desc)
 {
 	struct list_head *pos;
-	struct table *exs_table;
-	struct datablock *exs_block;
-	struct row *exs_row, *new_row;
-	size_t exs_row_size, new_row_size;
-
-	exs_table = database_table_get(db, table_node->table_name);
-
-	exs_row_size = table_calc_row_size(exs_table);
-	new_row_size = table_calc_row_size(mattbl);
-
-	list_for_each(pos, exs_table->datablock_head)
-	{
-		exs_block = list_entry(pos, typeof(*exs_block), head);
+	struct ast_node *orderby_node, *tmp_entry;
+	struct ast_sel_orderbyitem_node *item_node;
+	struct ast_sel_fieldname_node *field_node = NULL;
+	struct index *index;
 
-		for (size_t i = 0; i < (DATABLOCK_PAGE_SIZE / exs_row_size); i++) {
-			exs_row = (typeof(exs_row))&exs_block->data[exs_row_size * i];
+	if (!(orderby_node = find_node(root, AST_TYPE_SEL_ORDERBYLIST)))
+		return -1;
 
-			if (exs_row->flags.empty)
-				break; /* end of line */
+	/* an index only helps with the first item, rows holding the same value wouldn't be sorted */
+	if (list_length(orderby_node->node_children_head) != 1)
+		return -1;
 
-			if (exs_row->flags.deleted)
-				continue; /* nothing to do here */
+	item_node = list_entry(orderby_node->node_children_head->next, typeof(*item_node), head);
 
-			/* rebuild row - needed queries that use COUNT(*) */
-			new_row = zalloc(new_row_size);
-			if (!new_row)
-				goto err;
+	list_for_each(pos, item_node->node_children_head)
+	{
+		tmp_entry = list_entry(pos, typeof(*tmp_entry), head);
 
-			new_row->flags.deleted = false;
-			new_row->flags.empty = false;
+		/* column aliases are left as they are by the optimiser */
+		if (tmp_entry->node_type == AST_TYPE_SEL_FIELDNAME)
+			field_node = (typeof(field_node))tmp_entry;
+	}
 
-			for (int i = 0; i < mattbl->column_count; i++) {
-				bit_set(new_row->null_bitmap, i, sizeof(new_row->null_bitmap));
-			}
+	if (!field_node || strcmp(field_node->table_name, table->name) != 0)
+		return -1;
 
-			if (!cpy_cols(exs_table, exs_row, mattbl, new_row, false))
-				goto err_ptr;
+	for (int i = 0; i < table->column_count; i++) {
+		if (strcmp(table->columns[i].name, field_node->col_name) != 0)
+			continue;
 
-			init_count_cols(mattbl, new_row);
+		index = table->indexes[i];
 
-			if (!table_insert_row(mattbl, new_row, new_row_size)) {
-				goto err_ins;
-			}
+		if (!index || index->type != IT_BTREE)
+			return -1;
 
-//			print_row(mattbl, new_row);
-			table_free_row_content(mattbl, new_row);
-			free(new_row);
-		}
+		*desc = item_node->direction == AST_SEL_ORDERBY_DESC;
+		return i;
 	}
 
-	return MIDORIDB_OK;
-
-err_ins:
-	table_free_row_content(mattbl, new_row);
-err_ptr:
-	free(new_row);
-err:
-	return -MIDORIDB_INTERNAL;
+	return -1;
 }
 
-static int proc_from_clause(struct database *db, struct ast_node *node, struct table *earmattbl)
+static int build_from_pipeline(struct database *db, struct ast_node *node, struct vector *conjuncts,
+		struct table *mattbl, struct sel_operator **out)
 {
 	struct list_head *pos;
 	struct ast_node *tmp_entry;
+	struct ast_sel_table_node *table_node;
+	struct table *table;
+	int col_idx;
+	bool desc;
 
 	list_for_each(pos, node->node_children_head)
 	{
@@ -1353,19 +1761,65 @@ static int proc_from_clause(struct database *db, struct ast_node *node, struct t
 
 		if (tmp_entry->node_type == AST_TYPE_SEL_TABLE) {
 			// single table: SELECT * FROM A;
-			return proc_from_clause_table(db, (struct ast_sel_table_node*)tmp_entry, earmattbl);
+			table_node = (typeof(table_node))tmp_entry;
+			table = database_table_get(db, table_node->table_name);
+
+			if ((col_idx = find_orderby_index(node, table, &desc)) >= 0)
+				return scan_op_new_ordered(table, conjuncts, mattbl, col_idx, desc, out);
+
+			return scan_op_new(table, conjuncts, mattbl, &db->pool, out);
 		} else if (tmp_entry->node_type == AST_TYPE_SEL_JOIN) {
 			/* at least 1 join is found on the FROM-clause.
 			 * additionally, multiple tables are wrapped in synthetic join nodes at the optimisation phase).
 			 * this makes the executor's code slightly simpler
 			 */
-			return proc_from_clause_join(db, (struct ast_sel_join_node*)tmp_entry, earmattbl);
+			return build_join_pipeline(db, (struct ast_sel_join_node*)tmp_entry, conjuncts, mattbl, out);
 		}
 	}
 
 	return -MIDORIDB_INTERNAL;
 }
 
+/*
+ * pipeline for the FROM and WHERE clauses. (SELECT-clause projection is only added when streaming)
+ */
+static int build_pipeline(struct database *db, struct ast_node *node, struct vector *conjuncts,
+		struct table *mattbl, struct sel_operator **out)
+{
+	struct sel_operator *from_op;
+	int ret;
+
+	if ((ret = build_from_pipeline(db, node, conjuncts, mattbl, &from_op)))
+		return ret;
+
+	/* filter out rows that don't match the remaining WHERE-clause conjuncts */
+	if (!has_residual_conjuncts(conjuncts)) {
+		*out = from_op;
+		return MIDORIDB_OK;
+	}
+
+	if ((ret = filter_op_new(from_op, conjuncts, mattbl, out)))
+		from_op->free(from_op);
+
+	return ret;
+}
+
+static int drain_pipeline(struct sel_operator *pipeline, struct table *mattbl)
+{
+	struct row *row;
+	size_t row_size;
+	int ret;
+
+	row_size = table_calc_row_size(mattbl);
+
+	while ((ret = pipeline->next(pipeline, &row)) == MIDORIDB_ROW) {
+		if (!table_insert_row(mattbl, row, row_size))
+			return -MIDORIDB_INTERNAL;
+	}
+
+	return ret;
+}
+
 static int proc_select_clause(struct ast_sel_select_node *node, struct table *outtbl)
 {
 	struct list_head *pos;
@@ -1432,230 +1886,281 @@ static int proc_select_clause(struct ast_sel_select_node *node, struct table *ou
 	return MIDORIDB_OK;
 }
 
-static int proc_where_clause(struct ast_node *node, struct table *table)
+/*
+ * GROUP BY is answered with a hash aggregation: rows are keyed on the whole GROUP BY tuple,
+ * the first row of each group stays in place and accumulates the COUNT(*)s of every other row
+ * of that group, which are then deleted. (groups keep the order in which they first appear)
+ */
+struct groupby_key {
+	struct column_specs fields[TABLE_MAX_COLUMNS];
+	int field_count;
+	size_t count_offsets[TABLE_MAX_COLUMNS];
+	int count_cols;
+	char *buf;
+	size_t buf_len;
+};
+
+static int groupby_key_init(struct ast_node *node, struct table *table, struct groupby_key *key)
+{
+	struct list_head *pos;
+	struct ast_node *tmp_entry;
+	struct column_specs *spcs;
+	size_t offset = 0;
+
+	/* NULL marker + biggest possible value of each field */
+	key->buf_len = 0;
+
+	list_for_each(pos, node->node_children_head)
+	{
+		tmp_entry = list_entry(pos, typeof(*tmp_entry), head);
+		spcs = &key->fields[key->field_count++];
+
+		BUG_ON(!find_column_mattbl(table, tmp_entry, spcs));
+
+		key->buf_len += 1 + table->columns[spcs->col_idx].precision;
+	}
+
+	for (int i = 0; i < table->column_count; i++) {
+		if (table->columns[i].is_count)
+			key->count_offsets[key->count_cols++] = offset;
+
+		offset += table_calc_column_space(&table->columns[i]);
+	}
+
+	key->buf = zalloc(key->buf_len);
+	if (!key->buf)
+		return -MIDORIDB_NOMEM;
+
+	return MIDORIDB_OK;
+}
+
+static size_t groupby_key_build(struct groupby_key *key, struct row *row)
+{
+	struct column_specs *spcs;
+	size_t len = 0, val_len;
+	double tmp_dbl;
+	char *val;
+
+	for (int i = 0; i < key->field_count; i++) {
+		spcs = &key->fields[i];
+
+		/* NULLs are grouped together */
+		if (bit_test(row->null_bitmap, spcs->col_idx, sizeof(row->null_bitmap))) {
+			key->buf[len++] = 1;
+			continue;
+		}
+
+		key->buf[len++] = 0;
+
+		if (spcs->type == CT_VARCHAR) {
+			val = *(char**)&row->data[spcs->offset];
+			val_len = strlen(val) + 1;
+		} else if (spcs->type == CT_DOUBLE) {
+			/* -0.0 == 0.0 so both have to land on the same group */
+			tmp_dbl = *(double*)&row->data[spcs->offset] + 0.0;
+			val = (char*)&tmp_dbl;
+			val_len = sizeof(tmp_dbl);
+		} else {
+			val = &row->data[spcs->offset];
+			val_len = table_calc_column_precision(spcs->type);
+		}
+
+		memcpy(key->buf + len, val, val_len);
+		len += val_len;
+	}
+
+	return len;
+}
+
+static int proc_groupby_clause(struct ast_node *node, struct table *table)
 {
 	struct list_head *pos;
 	struct datablock *blk;
-	struct row *row;
-	size_t row_size;
+	struct row *row, *group_row;
+	struct hashtable groups_ht;
+	struct hashtable_value *group;
+	struct groupby_key key = {0};
+	size_t row_size, key_len;
+	int ret;
 
 	row_size = table_calc_row_size(table);
 
+	if ((ret = groupby_key_init(node, table, &key)))
+		goto err;
+
+	if (!hashtable_init(&groups_ht, &hashtable_mem_compare, &hashtable_str_hash)) {
+		ret = -MIDORIDB_INTERNAL;
+		goto err_key;
+	}
+
 	list_for_each(pos, table->datablock_head)
 	{
 		blk = list_entry(pos, typeof(*blk), head);
-		for (size_t i = 0; i < (DATABLOCK_PAGE_SIZE / row_size); i++) {
+		for (size_t i = 0; i < (table_block_size(table) / row_size); i++) {
 			row = (struct row*)&blk->data[row_size * i];
 
 			if (row->flags.empty)
-				break;
+				break; /* end of the line */
 
 			if (row->flags.deleted)
-				continue;
+				continue; /* nothing to do here */
+
+			key_len = groupby_key_build(&key, row);
 
-			if (!eval_row_cond(node, table, row)) {
-				table_delete_row(table, blk, row_size * i);
+			if (!(group = hashtable_get(&groups_ht, key.buf, key_len))) {
+				/* first row of the group */
+				if (!hashtable_put(&groups_ht, key.buf, key_len, &row, sizeof(row))) {
+					ret = -MIDORIDB_INTERNAL;
+					goto out;
+				}
+				continue;
 			}
-		}
-	}
 
-	return MIDORIDB_OK;
-}
+			/* accumulate COUNT(*)s into the first row of the group */
+			group_row = *(struct row**)group->content;
+			for (int j = 0; j < key.count_cols; j++) {
+				(*(int64_t*)&group_row->data[key.count_offsets[j]]) +=
+						(*(int64_t*)&row->data[key.count_offsets[j]]);
+			}
 
-static int cmp_rows_col_mattbl(struct table *table, struct row *row_1, struct row *row_2, struct ast_node *fld_val)
-{
-	struct column_specs col_spcs = {0};
-	bool is_null_1, is_null_2;
-	int ret = 0;
-
-	BUG_ON(!find_column_mattbl(table, fld_val, &col_spcs));
-
-	is_null_1 = bit_test(row_1->null_bitmap, col_spcs.col_idx, sizeof(row_1->null_bitmap));
-	is_null_2 = bit_test(row_2->null_bitmap, col_spcs.col_idx, sizeof(row_2->null_bitmap));
-
-	/* MySQL and SQLITE seems to evaluate values that are NULL to be smaller than everything else... */
-	if (is_null_1 && is_null_2)
-		ret = 0;
-	else if (is_null_1 && !is_null_2)
-		ret = -1;
-	else if (!is_null_1 && is_null_2)
-		ret = 1;
-	else if (col_spcs.type == CT_DOUBLE) {
-		ret = (*(double*)&row_1->data[col_spcs.offset]) - (*(double*)&row_2->data[col_spcs.offset]);
-	} else if (col_spcs.type == CT_TINYINT) {
-		ret = (*(bool*)&row_1->data[col_spcs.offset]) - (*(bool*)&row_2->data[col_spcs.offset]);
-	} else if (col_spcs.type == CT_INTEGER) {
-		ret = (*(int64_t*)&row_1->data[col_spcs.offset]) - (*(int64_t*)&row_2->data[col_spcs.offset]);
-	} else if (col_spcs.type == CT_DATE || col_spcs.type == CT_DATETIME) {
-		ret = (*(time_t*)&row_1->data[col_spcs.offset]) - (*(time_t*)&row_2->data[col_spcs.offset]);
-	} else if (col_spcs.type == CT_VARCHAR) {
-		ret = strcmp(*(char**)&row_1->data[col_spcs.offset], *(char**)&row_2->data[col_spcs.offset]);
-	} else {
-		/* some new column type that I forgot to add in here */
-		BUG_GENERIC();
+			if (!table_delete_row(table, blk, row_size * i)) {
+				ret = -MIDORIDB_INTERNAL;
+				goto out;
+			}
+		}
 	}
 
+out:
+	hashtable_foreach(&groups_ht, &free_hashmap_entries, NULL);
+	hashtable_free(&groups_ht);
+err_key:
+	free(key.buf);
+err:
 	return ret;
+
 }
 
-static int inc_count_cols(struct table *table, struct datablock *blk, size_t blk_offset, struct row *row, size_t row_size)
+static int set_countonly_row(struct table *table, struct row *row, size_t row_size, int64_t count)
 {
 	struct column *column;
 	size_t offset = 0;
-	bool found = false;
 
 	for (int i = 0; i < table->column_count; i++) {
 		column = &table->columns[i];
 
-		if (column->is_count) {
-			found = true;
-			(*(int64_t*)&row->data[offset])++;
-		}
+		/* there are only COUNT(*) columns at this point */
+		BUG_ON(!column->is_count);
+		bit_clear(row->null_bitmap, i, sizeof(row->null_bitmap));
+		(*(int64_t*)&row->data[offset]) = count;
 
 		offset += table_calc_column_space(column);
 	}
 
-	if (found) {
-		if (!table_update_row(table, blk, blk_offset, row, row_size))
+	/* row is yet to be added to the table */
+	if (row->flags.empty) {
+		row->flags.empty = false;
+		if (!table_insert_row(table, row, row_size))
 			return -MIDORIDB_INTERNAL;
 	}
 
 	return MIDORIDB_OK;
 }
 
-static int proc_groupby_clause(struct ast_node *node, struct table *table)
+static int insert_countonly_row(struct table *table, int64_t count)
 {
-	struct list_head *grppos, *pos1, *pos2;
-	struct ast_node *tmp_entry;
-	struct datablock *blk_1, *blk_2;
-	struct row *row_1, *row_2;
+	struct row *row;
 	size_t row_size;
-	int ret = MIDORIDB_OK;
+	int ret;
 
 	row_size = table_calc_row_size(table);
+	row = zalloc(row_size);
+	if (!row)
+		return -MIDORIDB_NOMEM;
 
-	list_for_each(grppos, node->node_children_head)
-	{
-		/* process each field on the group-by clause list one at a time */
-		tmp_entry = list_entry(grppos, typeof(*tmp_entry), head);
-
-		list_for_each(pos1, table->datablock_head)
-		{
-			blk_1 = list_entry(pos1, typeof(*blk_1), head);
-			for (size_t i = 0; i < (DATABLOCK_PAGE_SIZE / row_size); i++) {
-				row_1 = (struct row*)&blk_1->data[row_size * i];
-
-				if (row_1->flags.empty)
-					break; /* end of the line */
-
-				if (row_1->flags.deleted)
-					continue; /* nothing to do here */
-
-				list_for_each(pos2, table->datablock_head)
-				{
-					blk_2 = list_entry(pos2, typeof(*blk_2), head);
-					for (size_t j = i + 1; j < (DATABLOCK_PAGE_SIZE / row_size); j++) {
-						row_2 = (struct row*)&blk_2->data[row_size * j];
-
-						if (row_2->flags.empty)
-							break; /* end of the line */
-
-						if (row_2->flags.deleted)
-							continue; /* nothing to do here */
-
-						if (cmp_rows_col_mattbl(table, row_1, row_2, tmp_entry) == 0) {
-
-							if (!table_delete_row(table, blk_2, row_size * j)) {
-								ret = -MIDORIDB_INTERNAL;
-								goto out;
-							}
-
-							/* increment counts if any */
-							if ((ret = inc_count_cols(table, blk_1, row_size * i,
-											row_1,
-											row_size)))
-								goto out;
-						}
-					}
-				}
-			}
-		}
-	}
+	row->flags.empty = true;
+	ret = set_countonly_row(table, row, row_size, count);
+	free(row);
 
-out:
 	return ret;
-
 }
 
 static int handle_countonly_case(struct table *table)
 {
-	struct list_head *pos1, *pos2;
-	struct datablock *blk_1, *blk_2;
-	struct row *row_1, *row_2;
+	struct list_head *pos;
+	struct datablock *blk;
+	struct row *row, *count_row = NULL;
 	size_t row_size;
-	int ret = MIDORIDB_OK;
+	int64_t count;
 
 	/* check if we need to do that in the first plae */
-	bool non_count_field = false;
 	for (int i = 0; i < table->column_count; i++) {
-		if (!table->columns[i].is_count) {
-			non_count_field = true;
-			break;
-		}
+		if (!table->columns[i].is_count)
+			return MIDORIDB_OK;
 	}
 
-	if (!non_count_field) {
-		row_size = table_calc_row_size(table);
+	/* every row accounts for one so we keep the first one and discard the others */
+	count = table->row_count;
+	row_size = table_calc_row_size(table);
 
-		list_for_each(pos1, table->datablock_head)
-		{
-			blk_1 = list_entry(pos1, typeof(*blk_1), head);
-			for (size_t i = 0; i < (DATABLOCK_PAGE_SIZE / row_size); i++) {
-				row_1 = (struct row*)&blk_1->data[row_size * i];
-
-				if (row_1->flags.empty)
-					break; /* end of the line */
-
-				if (row_1->flags.deleted)
-					continue; /* nothing to do here */
-
-				list_for_each(pos2, table->datablock_head)
-				{
-					blk_2 = list_entry(pos2, typeof(*blk_2), head);
-					for (size_t j = i + 1; j < (DATABLOCK_PAGE_SIZE / row_size); j++) {
-						row_2 = (struct row*)&blk_2->data[row_size * j];
-
-						if (row_2->flags.empty)
-							break; /* end of the line */
-
-						if (row_2->flags.deleted)
-							continue; /* nothing to do here */
-
-						if (!table_delete_row(table, blk_2, row_size * j)) {
-							ret = -MIDORIDB_INTERNAL;
-							goto out;
-						}
-
-						/* increment counts if any */
-						if ((ret = inc_count_cols(table, blk_1, row_size * i,
-										row_1,
-										row_size)))
-							goto out;
-					}
-				}
+	list_for_each(pos, table->datablock_head)
+	{
+		blk = list_entry(pos, typeof(*blk), head);
+		for (size_t i = 0; i < (table_block_size(table) / row_size); i++) {
+			row = (struct row*)&blk->data[row_size * i];
+
+			if (row->flags.empty)
+				break; /* end of the line */
+
+			if (row->flags.deleted)
+				continue; /* nothing to do here */
+
+			if (!count_row) {
+				count_row = row;
+			} else if (!table_delete_row(table, blk, row_size * i)) {
+				return -MIDORIDB_INTERNAL;
 			}
 		}
 	}
 
-out:
-	return ret;
+	if (count_row)
+		return set_countonly_row(table, count_row, row_size, count);
+
+	/* COUNT(*) of nothing is still a row */
+	return insert_countonly_row(table, 0);
+}
+
+static int proc_count_from_counter(struct database *db, struct ast_sel_select_node *select_node, struct table *outtbl)
+{
+	struct ast_sel_table_node *table_node;
+	struct table *table;
+	int ret;
+
+	table_node = (typeof(table_node))find_node((struct ast_node*)select_node, AST_TYPE_SEL_TABLE);
+	table = database_table_get(db, table_node->table_name);
+
+	/* leave only the COUNT(*) column. (cheap as there are no rows yet) */
+	if ((ret = proc_select_clause(select_node, outtbl)))
+		return ret;
 
+	return insert_countonly_row(outtbl, table->row_count);
+}
+
+static bool has_count_cols(struct table *table)
+{
+	for (int i = 0; i < table->column_count; i++) {
+		if (table->columns[i].is_count)
+			return true;
+	}
+
+	return false;
 }
 
 int executor_run_select_stmt(struct database *db, struct ast_sel_select_node *select_node, struct query_output *output)
 {
 	struct hashtable cols_ht = {0};
-	struct table *table = NULL;
+	struct vector *conjuncts = NULL;
+	struct table *table = NULL, *outtbl = NULL;
+	struct sel_operator *pipeline = NULL;
 	struct ast_node *where_node, *groupby_node;
 	int ret = MIDORIDB_OK;
 
@@ -1666,7 +2171,7 @@ int executor_run_select_stmt(struct database *db, struct ast_sel_select_node *se
 	}
 
 	/* build columns hashtable */
-	if ((ret = build_cols_hashtable(db, (struct ast_node*)select_node, &cols_ht))) {
+	if ((ret = build_cols_hashtable(db, (struct ast_node*)select_node, (struct ast_node*)select_node, &cols_ht))) {
 		snprintf(output->error.message, sizeof(output->error.message),
 				"execution phase: cannot build columns hashtable\n");
 		goto err_bld_ht;
@@ -1679,25 +2184,78 @@ int executor_run_select_stmt(struct database *db, struct ast_sel_select_node *se
 		goto err_bld_ht;
 	}
 
-	/* fill out early-mat table with data from the FROM-clause */
-	if ((ret = proc_from_clause(db, (struct ast_node*)select_node, table))) {
+	/* COUNT(*)-only queries are answered from the table's row counter, no need to scan anything */
+	if (select_node->count_from_counter) {
+		if ((ret = proc_count_from_counter(db, select_node, table))) {
+			snprintf(output->error.message, sizeof(output->error.message),
+					"execution phase: error while processing COUNT-only-case\n");
+			goto err_bld_fc;
+		}
+		goto out;
+	}
+
+	/* split WHERE-clause into conjuncts so single-table ones can be pushed down into the FROM-clause */
+	if (!(conjuncts = zalloc(sizeof(*conjuncts))) || !vector_init(conjuncts)) {
+		snprintf(output->error.message, sizeof(output->error.message), "execution phase: internal error\n");
+		ret = -MIDORIDB_INTERNAL;
+		goto err_bld_wc;
+	}
+
+	where_node = find_node((struct ast_node*)select_node, AST_TYPE_SEL_WHERE);
+	if (where_node && !build_where_conjuncts(db, where_node, table, conjuncts)) {
+		snprintf(output->error.message, sizeof(output->error.message),
+				"execution phase: error while processing WHERE-clause\n");
+		ret = -MIDORIDB_INTERNAL;
+		goto err_bld_wc;
+	}
+
+	/* operator pipeline for the FROM and WHERE clauses */
+	if ((ret = build_pipeline(db, (struct ast_node*)select_node, conjuncts, table, &pipeline))) {
 		snprintf(output->error.message, sizeof(output->error.message),
 				"execution phase: error while processing FROM-clause\n");
-		goto err_bld_fc;
+		goto err_bld_wc;
 	}
 
-	/* filter out rows that don't match WHERE-clause */
-	where_node = find_node((struct ast_node*)select_node, AST_TYPE_SEL_WHERE);
-	if (where_node) {
-		if ((ret = proc_where_clause(where_node, table))) {
+	groupby_node = find_node((struct ast_node*)select_node, AST_TYPE_SEL_GROUPBY);
+
+	/* no blocking operators: rows are streamed as query_cur_step pulls them */
+	if (!groupby_node && !has_count_cols(table)) {
+		if ((ret = build_table_scafold(&cols_ht, &outtbl))) {
 			snprintf(output->error.message, sizeof(output->error.message),
-					"execution phase: error while processing WHERE-clause\n");
-			goto err_bld_fc;
+					"execution phase: cannot build output table\n");
+			goto err_bld_pl;
+		}
+
+		/* leave only columns that were specified in the statements */
+		if ((ret = proc_select_clause(select_node, outtbl))) {
+			snprintf(output->error.message, sizeof(output->error.message),
+					"execution phase: error while processing SELECT-clause\n");
+			goto err_bld_ot;
 		}
+
+		/* the projection takes ownership of the pipeline, conjuncts and early-mat table */
+		if ((ret = project_op_new(pipeline, conjuncts, table, outtbl, &output->results.pipeline))) {
+			snprintf(output->error.message, sizeof(output->error.message), "execution phase: internal error\n");
+			goto err_bld_ot;
+		}
+
+		table = outtbl;
+		goto out;
+	}
+
+	/* fill out early-mat table with the rows coming out of the FROM and WHERE clauses */
+	ret = drain_pipeline(pipeline, table);
+
+	pipeline->free(pipeline);
+	free_where_conjuncts(conjuncts);
+
+	if (ret) {
+		snprintf(output->error.message, sizeof(output->error.message),
+				"execution phase: error while processing FROM-clause\n");
+		goto err_bld_fc;
 	}
 
 	/* collate rows if group-by clause is specified */
-	groupby_node = find_node((struct ast_node*)select_node, AST_TYPE_SEL_GROUPBY);
 	if (groupby_node) {
 		if ((ret = proc_groupby_clause(groupby_node, table))) {
 			snprintf(output->error.message, sizeof(output->error.message),
@@ -1713,8 +2271,8 @@ int executor_run_select_stmt(struct database *db, struct ast_sel_select_node *se
 		goto err_bld_fc;
 	}
 
-	/* handle COUNT(*)-only field edge-case */
-	if ((ret = handle_countonly_case(table))) {
+	/* handle COUNT(*)-only field edge-case (groups were already collated otherwise) */
+	if (!groupby_node && (ret = handle_countonly_case(table))) {
 		snprintf(output->error.message, sizeof(output->error.message),
 				"execution phase: error while processing COUNT-only-case\n");
 		goto err_bld_fc;
@@ -1722,9 +2280,10 @@ int executor_run_select_stmt(struct database *db, struct ast_sel_select_node *se
 
 	/* TODO process distinct */
 
-	/* remove excluded rows from ON-clauses, WHERE-clauses and so on */
+	/* remove excluded rows from GROUP BY and so on */
 	table_vacuum(table);
 
+out:
 	output->results.table = table;
 
 	hashtable_foreach(&cols_ht, &free_hashmap_entries, NULL);
@@ -1732,6 +2291,12 @@ int executor_run_select_stmt(struct database *db, struct ast_sel_select_node *se
 
 	return ret;
 
+err_bld_ot:
+	table_destroy(&outtbl);
+err_bld_pl:
+	pipeline->free(pipeline);
+err_bld_wc:
+	free_where_conjuncts(conjuncts);
 err_bld_fc:
 	table_destroy(&table);
 err_bld_ht:
@@ -7,6 +7,8 @@
 
 #define _XOPEN_SOURCE       /* See feature_test_macros(7) */
 #include <engine/executor.h>
+#include <engine/bytecode.h>
+#include <engine/scan.h>
 #include <primitive/table.h>
 #include <primitive/column.h>
 #include <primitive/row.h>
@@ -32,456 +34,306 @@ static time_t parse_date_type(char *str, enum COLUMN_TYPE type)
 
 }
 
-static bool cmp_double_value_to_value(enum ast_comparison_type cmp_type, double val_1, double val_2)
-{
-	switch (cmp_type) {
-	case AST_CMP_DIFF_OP:
-		return val_1 != val_2;
-	case AST_CMP_EQUALS_OP:
-		return val_1 == val_2;
-	case AST_CMP_GTE_OP:
-		return val_1 >= val_2;
-	case AST_CMP_GT_OP:
-		return val_1 > val_2;
-	case AST_CMP_LTE_OP:
-		return val_1 <= val_2;
-	case AST_CMP_LT_OP:
-		return val_1 < val_2;
-	default:
-		/* something went really wrong here */
-		BUG_GENERIC();
-		return false;
-	}
-}
-
-static bool cmp_int_value_to_value(enum ast_comparison_type cmp_type, int val_1, int val_2)
-{
-	switch (cmp_type) {
-	case AST_CMP_DIFF_OP:
-		return val_1 != val_2;
-	case AST_CMP_EQUALS_OP:
-		return val_1 == val_2;
-	case AST_CMP_GTE_OP:
-		return val_1 >= val_2;
-	case AST_CMP_GT_OP:
-		return val_1 > val_2;
-	case AST_CMP_LTE_OP:
-		return val_1 <= val_2;
-	case AST_CMP_LT_OP:
-		return val_1 < val_2;
-	default:
-		/* something went really wrong here */
-		BUG_GENERIC();
-		return false;
-	}
-}
-
-static bool cmp_bool_value_to_value(enum ast_comparison_type cmp_type, bool val_1, bool val_2)
-{
-	switch (cmp_type) {
-	case AST_CMP_DIFF_OP:
-		return val_1 != val_2;
-	case AST_CMP_EQUALS_OP:
-		return val_1 == val_2;
-	default:
-		return false;
-	}
-}
-
-static bool cmp_str_value_to_value(enum ast_comparison_type cmp_type, char *val_1, char *val_2)
-{
-	switch (cmp_type) {
-	case AST_CMP_DIFF_OP:
-		return strcmp(val_1, val_2);
-	case AST_CMP_EQUALS_OP:
-		return strcmp(val_1, val_2) == 0;
-	default:
-		return false;
-	}
-}
-
-static bool cmp_time_value_to_value(enum ast_comparison_type cmp_type, time_t val_1, time_t val_2)
-{
-	switch (cmp_type) {
-	case AST_CMP_DIFF_OP:
-		return val_1 != val_2;
-	case AST_CMP_EQUALS_OP:
-		return val_1 == val_2;
-	case AST_CMP_GTE_OP:
-		return val_1 >= val_2;
-	case AST_CMP_GT_OP:
-		return val_1 > val_2;
-	case AST_CMP_LTE_OP:
-		return val_1 <= val_2;
-	case AST_CMP_LT_OP:
-		return val_1 < val_2;
-	default:
-		/* something went really wrong here */
-		BUG_GENERIC();
-		return false;
-	}
-}
-
-static bool cmp_field_to_field(struct table *table, struct row *row, struct ast_upd_cmp_node *node, struct ast_upd_exprval_node *val_1, struct ast_upd_exprval_node *val_2)
-{
-	enum COLUMN_TYPE type = 0;
-	size_t tmp_offset = 0, offset_1 = 0, offset_2 = 0;
-	int col_idx_1 = -1, col_idx_2 = -1;
-	bool is_null_1, is_null_2;
-
-	for (int i = 0; i < table->column_count; i++) {
-		struct column *col = &table->columns[i];
-
-		if (strcmp(col->name, val_1->name_val) == 0) {
-			/* semantic phase guarantees that columns will have the same type in CMP nodes */
-			type = col->type;
-			offset_1 = tmp_offset;
-			col_idx_1 = i;
-		} else if (strcmp(col->name, val_2->name_val) == 0) {
-			offset_2 = tmp_offset;
-			col_idx_2 = i;
-		}
-		tmp_offset += table_calc_column_space(col);
-	}
-
-	/* is any field set to null in this row ? */
-	is_null_1 = bit_test(row->null_bitmap, col_idx_1, sizeof(row->null_bitmap));
-	is_null_2 = bit_test(row->null_bitmap, col_idx_2, sizeof(row->null_bitmap));
-
-	if (is_null_1 || is_null_2) {
-		/* if even one field is NULL, then no comparison would evaluate to true */
-		return false;
-	} else if (type == CT_DOUBLE) {
-		return cmp_double_value_to_value(node->cmp_type,
-							*(double*)&row->data[offset_1],
-							*(double*)&row->data[offset_2]);
-	} else if (type == CT_TINYINT) {
-		return cmp_bool_value_to_value(node->cmp_type,
-						*(bool*)&row->data[offset_1],
-						*(bool*)&row->data[offset_2]);
-	} else if (type == CT_INTEGER) {
-		return cmp_int_value_to_value(node->cmp_type,
-						*(int64_t*)&row->data[offset_1],
-						*(int64_t*)&row->data[offset_2]);
-	} else if (type == CT_DATE || type == CT_DATETIME) {
-		return cmp_time_value_to_value(node->cmp_type,
-						*(time_t*)&row->data[offset_1],
-						*(time_t*)&row->data[offset_2]);
-	} else if (type == CT_VARCHAR) {
-		return cmp_str_value_to_value(node->cmp_type,
-						*(char**)&row->data[offset_1],
-						*(char**)&row->data[offset_2]);
-	} else {
-		/* something went really wrong here */
-		BUG_GENERIC();
-		return false;
-	}
-
-}
-
-static bool cmp_field_to_value(struct table *table, struct row *row, struct ast_upd_cmp_node *node,
-		struct ast_upd_exprval_node *field, struct ast_upd_exprval_node *value)
+static void set_field_to_value(struct table *table, struct row *row, struct ast_upd_assign_node *field, struct ast_upd_exprval_node *value)
 {
-	enum COLUMN_TYPE type = 0;
+	struct column *column = NULL;
 	size_t offset = 0;
 	int col_idx = -1;
-	bool is_null;
 
 	for (int i = 0; i < table->column_count; i++) {
-		struct column *col = &table->columns[i];
+		struct column *tmp_col = &table->columns[i];
 
-		if (strcmp(col->name, field->name_val) == 0) {
-			type = col->type;
+		if (strcmp(tmp_col->name, field->field_name) == 0) {
+			column = tmp_col;
 			col_idx = i;
 			break;
 		}
-		offset += table_calc_column_space(col);
+		offset += table_calc_column_space(tmp_col);
 	}
 
-	is_null = bit_test(row->null_bitmap, col_idx, sizeof(row->null_bitmap));
-
-	if (is_null || value->value_type.is_null) {
-		/* no comparison evaluates to true if NULL is one of the operands */
-		return false;
-	} else if (type == CT_DOUBLE) {
-		return cmp_double_value_to_value(node->cmp_type, *(double*)&row->data[offset], value->double_val);
-	} else if (type == CT_TINYINT) {
-		return cmp_bool_value_to_value(node->cmp_type, *(bool*)&row->data[offset], value->bool_val);
-	} else if (type == CT_INTEGER) {
-		return cmp_int_value_to_value(node->cmp_type, *(int64_t*)&row->data[offset], value->int_val);
-	} else if (type == CT_DATE || type == CT_DATETIME) {
-		return cmp_time_value_to_value(node->cmp_type,
-						*(time_t*)&row->data[offset],
-						parse_date_type(value->str_val, type));
-	} else if (type == CT_VARCHAR) {
-		return cmp_str_value_to_value(node->cmp_type, *(char**)&row->data[offset], value->str_val);
-	} else {
-		/* something went really wrong here */
-		BUG_GENERIC();
-		return false;
-	}
-}
+	BUG_ON(!column);
 
-static bool cmp_value_to_value(struct ast_upd_cmp_node *node, struct ast_upd_exprval_node *val_1, struct ast_upd_exprval_node *val_2)
-{
-	if (val_1->value_type.is_approxnum) {
-		return cmp_double_value_to_value(node->cmp_type, val_1->double_val, val_2->double_val);
-	} else if (val_1->value_type.is_bool) {
-		return cmp_bool_value_to_value(node->cmp_type, val_1->bool_val, val_2->bool_val);
-	} else if (val_1->value_type.is_intnum) {
-		return cmp_int_value_to_value(node->cmp_type, val_1->int_val, val_2->int_val);
-	} else if (val_1->value_type.is_null) {
-		/* no comparison evaluates to true if NULL is one of the operands */
-		return false;
-	} else if (val_1->value_type.is_str) {
-		return cmp_str_value_to_value(node->cmp_type, val_1->str_val, val_2->str_val);
+	bit_clear(row->null_bitmap, col_idx, sizeof(row->null_bitmap));
+
+	if (value->value_type.is_null) {
+		bit_set(row->null_bitmap, col_idx, sizeof(row->null_bitmap));
+	} else if (column->type == CT_DOUBLE) {
+		*(double*)&row->data[offset] = value->double_val;
+	} else if (column->type == CT_TINYINT) {
+		*(bool*)&row->data[offset] = value->bool_val;
+	} else if (column->type == CT_INTEGER) {
+		*(int64_t*)&row->data[offset] = value->int_val;
+	} else if (column->type == CT_DATE || column->type == CT_DATETIME) {
+		*(time_t*)&row->data[offset] = parse_date_type(value->str_val, column->type);
+	} else if (column->type == CT_VARCHAR) {
+		strncpy(*(char**)&row->data[offset], value->str_val, column->precision - 1 /* NULL */);
 	} else {
 		/* something went really wrong here */
 		BUG_GENERIC();
-		return false;
 	}
-
 }
 
-static bool eval_cmp(struct table *table, struct row *row, struct ast_upd_cmp_node *node)
+static void update_row(struct table *table, struct row *row, struct ast_node *node)
 {
 	struct list_head *pos;
-	struct ast_node *tmp_node;
-	struct ast_upd_exprval_node *val_1 = NULL, *val_2 = NULL;
+	struct ast_node *tmp_entry;
+	struct ast_upd_assign_node *assign_node;
+	struct ast_upd_exprval_node *val_node = NULL;
 
-	list_for_each(pos, node->node_children_head)
-	{
-		tmp_node = list_entry(pos, typeof(*tmp_node), head);
+	if (node->node_type == AST_TYPE_UPD_ASSIGN) {
+		assign_node = (typeof(assign_node))node;
 
-		if (!val_1)
-			val_1 = (typeof(val_1))tmp_node;
-		else
-			val_2 = (typeof(val_2))tmp_node;
-	}
+		list_for_each(pos, assign_node->node_children_head)
+		{
+			val_node = list_entry(pos, typeof(*val_node), head);
+		}
 
-	if (val_1->value_type.is_name && val_2->value_type.is_name) {
-		/* field to field comparison */
-		return cmp_field_to_field(table, row, node, val_1, val_2);
-	} else if (val_1->value_type.is_name && !val_2->value_type.is_name) {
-		/* field-to-value or value-to-field comparison */
-		return cmp_field_to_value(table, row, node, val_1, val_2);
-	} else if (!val_1->value_type.is_name && val_2->value_type.is_name) {
-		/* value-to-field or value-to-field comparison */
-		return cmp_field_to_value(table, row, node, val_2, val_1);
+		BUG_ON(!val_node);
+
+		set_field_to_value(table, row, assign_node, val_node);
 	} else {
-		/* value-to-value comparison */
-		return cmp_value_to_value(node, val_1, val_2);
+		list_for_each(pos, node->node_children_head)
+		{
+			tmp_entry = list_entry(pos, typeof(*tmp_entry), head);
+			update_row(table, row, tmp_entry);
+		}
 	}
+}
 
+static bool is_duplicate_value(struct table *table, struct row_location *loc, int col_idx,
+		struct ast_upd_exprval_node *value)
+{
+	struct column *column = &table->columns[col_idx];
+	time_t time_val;
+	char *str_val;
+	bool ret;
+
+	switch (column->type) {
+	case CT_DOUBLE:
+		return table_index_is_duplicate(table, col_idx, &value->double_val, loc->blk, loc->offset);
+	case CT_TINYINT:
+		return table_index_is_duplicate(table, col_idx, &value->bool_val, loc->blk, loc->offset);
+	case CT_INTEGER:
+		return table_index_is_duplicate(table, col_idx, &value->int_val, loc->blk, loc->offset);
+	case CT_DATE:
+	case CT_DATETIME:
+		time_val = parse_date_type(value->str_val, column->type);
+		return table_index_is_duplicate(table, col_idx, &time_val, loc->blk, loc->offset);
+	case CT_VARCHAR:
+		/* values are trimmed to fit the column */
+		if (strlen(value->str_val) < (size_t)column->precision)
+			return table_index_is_duplicate(table, col_idx, value->str_val, loc->blk, loc->offset);
+
+		/* can't tell whether it's taken, so better safe than sorry */
+		if (!(str_val = malloc(column->precision)))
+			return true;
+
+		memcpy(str_val, value->str_val, column->precision - 1);
+		str_val[column->precision - 1] = '\0';
+
+		ret = table_index_is_duplicate(table, col_idx, str_val, loc->blk, loc->offset);
+		free(str_val);
+		return ret;
+	default:
+		/* something went really wrong here */
+		BUG_GENERIC();
+		return true;
+	}
 }
 
-static bool eval_isxnull(struct table *table, struct row *row, struct ast_upd_isxnull_node *node)
+/*
+ * returns the first UNIQUE column set to a value other than NULL, -1 if there are none. if a row is
+ * given, only columns whose new value is held by another row are taken into account
+ */
+static int find_unique_assign(struct table *table, struct row_location *loc, struct ast_node *node)
 {
 	struct list_head *pos;
-	struct ast_upd_exprval_node *field = NULL;
-	int col_idx = -1;
+	struct ast_node *tmp_entry;
+	struct ast_upd_assign_node *assign_node;
+	struct ast_upd_exprval_node *val_node = NULL;
+	struct index *index;
+	int col_idx;
 
-	list_for_each(pos, node->node_children_head)
-	{
-		field = list_entry(pos, typeof(*field), head);
-	}
+	if (node->node_type == AST_TYPE_UPD_ASSIGN) {
+		assign_node = (typeof(assign_node))node;
 
-	BUG_ON(!field);
+		list_for_each(pos, assign_node->node_children_head)
+		{
+			val_node = list_entry(pos, typeof(*val_node), head);
+		}
 
-	for (int i = 0; i < table->column_count; i++) {
-		struct column *col = &table->columns[i];
+		BUG_ON(!val_node);
 
-		if (strcmp(col->name, field->name_val) == 0) {
-			col_idx = i;
-			break;
+		for (col_idx = 0; col_idx < table->column_count; col_idx++) {
+			if (strcmp(table->columns[col_idx].name, assign_node->field_name) == 0)
+				break;
 		}
-	}
 
-	return bit_test(row->null_bitmap, col_idx, sizeof(row->null_bitmap)) ^ node->is_negation;
-}
+		index = table->indexes[col_idx];
 
-static bool eval_isxin(struct table *table, struct row *row, struct ast_upd_isxin_node *node)
-{
-	struct list_head *pos;
-	struct ast_upd_exprval_node *tmp_entry;
-	struct ast_upd_exprval_node *field = NULL;
-	struct ast_upd_cmp_node cmp_node = {0};
+		/* NULLs never clash */
+		if (!index || index->type != IT_HASH || val_node->value_type.is_null)
+			return -1;
 
-	if (node->is_negation) {
-		cmp_node.cmp_type = AST_CMP_DIFF_OP;
-	} else {
-		cmp_node.cmp_type = AST_CMP_EQUALS_OP;
-	}
+		if (loc && !is_duplicate_value(table, loc, col_idx, val_node))
+			return -1;
 
-	list_for_each(pos, node->node_children_head)
-	{
-		tmp_entry = list_entry(pos, typeof(*tmp_entry), head);
-
-		if (tmp_entry->value_type.is_name) {
-			field = tmp_entry;
-			break;
-		}
+		return col_idx;
 	}
 
-	BUG_ON(!field);
-
 	list_for_each(pos, node->node_children_head)
 	{
 		tmp_entry = list_entry(pos, typeof(*tmp_entry), head);
 
-		if (!tmp_entry->value_type.is_name) {
-			if (cmp_field_to_value(table, row, &cmp_node, field, tmp_entry))
-				return true;
-		}
+		if ((col_idx = find_unique_assign(table, loc, tmp_entry)) >= 0)
+			return col_idx;
 	}
-	return false;
+
+	return -1;
 }
 
-static bool should_update_row(struct table *table, struct row *row, struct ast_node *node)
+static int update_rows(struct table *table, struct vector *locs, struct ast_node *node,
+		struct query_output *output)
 {
-	struct list_head *pos;
-	struct ast_node *tmp_node;
-	struct ast_upd_logop_node *logop_node;
-	bool ret = true;
-
-	if (node->node_type == AST_TYPE_UPD_CMP) {
-		return eval_cmp(table, row, (struct ast_upd_cmp_node*)node);
-	} else if (node->node_type == AST_TYPE_UPD_EXPRISXNULL) {
-		return eval_isxnull(table, row, (struct ast_upd_isxnull_node*)node);
-	} else if (node->node_type == AST_TYPE_UPD_EXPRISXIN) {
-		return eval_isxin(table, row, (struct ast_upd_isxin_node*)node);
-	} else if (node->node_type == AST_TYPE_UPD_UPDATE) {
-		list_for_each(pos, node->node_children_head)
-		{
-			tmp_node = list_entry(pos, typeof(*tmp_node), head);
-			ret = ret && should_update_row(table, row, tmp_node);
-		}
+	struct row_location *loc;
+	struct row *row, *image;
+	size_t count = locs->len / sizeof(*loc);
+	int dup_col = -1;
+	int ret = MIDORIDB_OK;
+
+	/*
+	 * values are constants so rows updated together would end up sharing them. Either way nothing
+	 * is touched unless every row can be updated
+	 */
+	if (count > 1)
+		dup_col = find_unique_assign(table, NULL, node);
+	else if (count == 1)
+		dup_col = find_unique_assign(table, (struct row_location*)locs->data, node);
+
+	if (dup_col >= 0) {
+		snprintf(output->error.message, sizeof(output->error.message) - 1,
+				"duplicate value for UNIQUE column '%s'\n", table->columns[dup_col].name);
+		return -MIDORIDB_ERROR;
+	}
 
-	} else if (node->node_type == AST_TYPE_UPD_ASSIGN) {
-		/* ASSIGN nodes are not important at this stage, we simply ignore it */
-		return true;
-	} else {
-		/* sanity check */
-		BUG_ON(node->node_type != AST_TYPE_UPD_LOGOP);
+	if (!count)
+		return MIDORIDB_OK;
 
-		logop_node = (typeof(logop_node))node;
+	/* new content is laid out in a row image first, table_update_row() puts the old one back if it fails */
+	loc = (struct row_location*)locs->data;
 
-		bool gate_init = false;
+	if (!(image = table_dup_row(table, (struct row*)&loc->blk->data[loc->offset])))
+		return -MIDORIDB_NOMEM;
 
-		list_for_each(pos, logop_node->node_children_head)
-		{
-			tmp_node = list_entry(pos, typeof(*tmp_node), head);
-
-			bool eval = should_update_row(table, row, tmp_node);
-
-			if (!gate_init) {
-				gate_init = true;
-				ret = eval;
-			} else if (logop_node->logop_type == AST_LOGOP_TYPE_AND)
-				ret = ret && eval;
-			else if (logop_node->logop_type == AST_LOGOP_TYPE_OR)
-				ret = ret || eval;
-			else if (logop_node->logop_type == AST_LOGOP_TYPE_XOR)
-				ret = ret ^ eval;
-			else
-				BUG_GENERIC();
+	for (size_t i = 0; i < count; i++) {
+		loc = &((struct row_location*)locs->data)[i];
+		row = (struct row*)&loc->blk->data[loc->offset];
+
+		table_copy_row_content(table, image, row);
+		update_row(table, image, node);
+
+		if (!table_update_row(table, loc->blk, loc->offset, image, table_calc_row_size(table))) {
+			snprintf(output->error.message, sizeof(output->error.message) - 1,
+					"execution phase: row could not be updated\n");
+			ret = -MIDORIDB_NOMEM;
+			break;
 		}
 
+		output->n_rows_aff++;
 	}
+
+	table_free_row_content(table, image);
+	free(image);
+
 	return ret;
 }
 
-static void set_field_to_value(struct table *table, struct row *row, struct ast_upd_assign_node *field, struct ast_upd_exprval_node *value)
+/* gathers every row matched across all waves of morsels */
+static int collect_morsels(struct worker_pool *pool, struct table *table, struct bytecode *prog,
+		struct vector *locs)
 {
-	struct column *column = NULL;
-	size_t offset = 0;
-	int col_idx = -1;
+	struct morsel_scan scan;
+	int ret = MIDORIDB_OK;
 
-	for (int i = 0; i < table->column_count; i++) {
-		struct column *tmp_col = &table->columns[i];
+	if (!morsel_scan_init(&scan, pool, table, &morsel_scan_match, prog))
+		return -MIDORIDB_NOMEM;
 
-		if (strcmp(tmp_col->name, field->field_name) == 0) {
-			column = tmp_col;
-			col_idx = i;
-			break;
+	while (!ret && morsel_scan_wave(&scan)) {
+		for (size_t i = 0; i < scan.nmorsels && !ret; i++) {
+			if ((ret = scan.morsels[i].ret))
+				break;
+
+			if (scan.morsels[i].count
+					&& !vector_push(locs, scan.morsels[i].out.data, scan.morsels[i].out.len))
+				ret = -MIDORIDB_NOMEM;
 		}
-		offset += table_calc_column_space(tmp_col);
 	}
 
-	BUG_ON(!column);
-
-	bit_clear(row->null_bitmap, col_idx, sizeof(row->null_bitmap));
+	morsel_scan_free(&scan);
 
-	if (value->value_type.is_null) {
-		bit_set(row->null_bitmap, col_idx, sizeof(row->null_bitmap));
-	} else if (column->type == CT_DOUBLE) {
-		*(double*)&row->data[offset] = value->double_val;
-	} else if (column->type == CT_TINYINT) {
-		*(bool*)&row->data[offset] = value->bool_val;
-	} else if (column->type == CT_INTEGER) {
-		*(int64_t*)&row->data[offset] = value->int_val;
-	} else if (column->type == CT_DATE || column->type == CT_DATETIME) {
-		*(time_t*)&row->data[offset] = parse_date_type(value->str_val, column->type);
-	} else if (column->type == CT_VARCHAR) {
-		strncpy(*(char**)&row->data[offset], value->str_val, column->precision - 1 /* NULL */);
-	} else {
-		/* something went really wrong here */
-		BUG_GENERIC();
-	}
+	return ret;
 }
 
-static void update_row(struct table *table, struct row *row, struct ast_node *node)
+static int update_morsels(struct worker_pool *pool, struct table *table, struct bytecode *prog, struct ast_node *node,
+		struct query_output *output)
 {
-	struct list_head *pos;
-	struct ast_node *tmp_entry;
-	struct ast_upd_assign_node *assign_node;
-	struct ast_upd_exprval_node *val_node = NULL;
+	struct morsel_scan scan;
+	int ret = MIDORIDB_OK;
 
-	if (node->node_type == AST_TYPE_UPD_ASSIGN) {
-		assign_node = (typeof(assign_node))node;
+	if (!morsel_scan_init(&scan, pool, table, &morsel_scan_match, prog))
+		return -MIDORIDB_NOMEM;
 
-		list_for_each(pos, assign_node->node_children_head)
-		{
-			val_node = list_entry(pos, typeof(*val_node), head);
+	while (!ret && morsel_scan_wave(&scan)) {
+		for (size_t i = 0; i < scan.nmorsels && !ret; i++) {
+			if (!(ret = scan.morsels[i].ret))
+				ret = update_rows(table, &scan.morsels[i].out, node, output);
 		}
+	}
 
-		BUG_ON(!val_node);
+	morsel_scan_free(&scan);
 
-		set_field_to_value(table, row, assign_node, val_node);
-	} else {
-		list_for_each(pos, node->node_children_head)
-		{
-			tmp_entry = list_entry(pos, typeof(*tmp_entry), head);
-			update_row(table, row, tmp_entry);
-		}
-	}
+	return ret;
 }
 
-static int scan_update(struct table *table, struct ast_node *node, struct query_output *output)
+/*
+ * rows are looked up through a column index if possible. Otherwise the WHERE-clause is evaluated
+ * a wave of morsels at a time by the worker pool, matching rows are then updated in storage order
+ * before the next wave is scanned
+ */
+static int scan_update(struct worker_pool *pool, struct table *table, struct ast_node *node,
+		struct query_output *output)
 {
-	struct list_head *pos;
-	struct datablock *block;
-	struct row *row;
-	size_t row_size;
-
-	row_size = table_calc_row_size(table);
-
-	list_for_each(pos, table->datablock_head)
-	{
-		block = list_entry(pos, typeof(*block), head);
-
-		for (size_t i = 0; i < (DATABLOCK_PAGE_SIZE / row_size); i++) {
-			row = (typeof(row))&block->data[row_size * i];
+	struct vector locs;
+	struct bytecode prog, *progs = &prog;
+	int ret;
+
+	/* WHERE-clause is compiled once against the table layout rather than walked for every row */
+	if (!bytecode_compile(&prog, table, node)) {
+		snprintf(output->error.message, sizeof(output->error.message),
+				"execution phase: error while processing WHERE-clause\n");
+		return -MIDORIDB_INTERNAL;
+	}
 
-			if (!row->flags.deleted && !row->flags.empty && should_update_row(table, row, node)) {
-				update_row(table, row, node);
-				output->n_rows_aff++;
-			}
+	if (!vector_init(&locs)) {
+		ret = -MIDORIDB_NOMEM;
+		goto err_locs;
+	}
 
-		}
+	if (scan_index_lookup(table, &progs, 1, &locs)) {
+		ret = update_rows(table, &locs, node, output);
+	} else if (find_unique_assign(table, NULL, node) >= 0) {
+		/* uniqueness is checked against every row matched before any of them is updated */
+		if (!(ret = collect_morsels(pool, table, &prog, &locs)))
+			ret = update_rows(table, &locs, node, output);
+	} else {
+		ret = update_morsels(pool, table, &prog, node, output);
 	}
 
-	return MIDORIDB_OK;
+	vector_free(&locs);
+err_locs:
+	bytecode_free(&prog);
+
+	return ret;
 }
 
 int executor_run_update_stmt(struct database *db, struct ast_upd_update_node *update_node, struct query_output *output)
@@ -496,7 +348,16 @@ int executor_run_update_stmt(struct database *db, struct ast_upd_update_node *up
 
 	table = database_table_get(db, update_node->table_name);
 
-	rc = scan_update(table, (struct ast_node*)update_node, output);
+	/* streamed result sets reading the table get hold of the rows they haven't returned yet */
+	if ((rc = query_detach_results(db, table)))
+		goto out;
+
+	/* rows of the table are left alone by autovacuum until we're done */
+	if ((rc = table_pin(table)))
+		goto out;
+
+	rc = scan_update(&db->pool, table, (struct ast_node*)update_node, output);
+	table_unpin(table);
 
 out:
 	return rc;
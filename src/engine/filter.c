@@ -0,0 +1,397 @@
+/*
+ * filter.c
+ *
+ * Notes to myself:
+ * 	- every kernel ORs its bits into a bitmap that was zeroed by the public entry points, this
+ * 		way the SIMD flavours can leave the tail (n % width values) to the scalar ones.
+ * 	- the vector width always divides 64 so a vector never straddles two bitmap words.
+ *
+ *  Created on: 17/10/2026
+ *      Author: paulo
+ */
+
+#include <engine/filter.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define FILTER_X86
+#include <immintrin.h>
+#endif
+
+/* DATE/DATETIME columns go through the INTEGER kernels */
+BUILD_BUG(sizeof(time_t) == sizeof(int64_t), "time_t must be 64-bit wide");
+
+struct filter_kernels {
+	enum filter_isa isa;
+	void (*int64)(enum ast_comparison_type cmp_type, const int64_t *vals, size_t start, size_t n, int64_t rhs,
+			uint64_t *bitmap);
+	void (*dbl)(enum ast_comparison_type cmp_type, const double *vals, size_t start, size_t n, double rhs,
+			uint64_t *bitmap);
+	void (*boolean)(enum ast_comparison_type cmp_type, const bool *vals, size_t start, size_t n, bool rhs,
+			uint64_t *bitmap);
+};
+
+#define SCALAR_LOOP(vals, start, n, bitmap, op, rhs)							\
+	do {												\
+		for (size_t __i = (start); __i < (n); __i++)						\
+			(bitmap)[__i / 64] |= (uint64_t)((vals)[__i] op (rhs)) << (__i % 64);		\
+	} while (0)
+
+#define SCALAR_KERNEL(cmp_type, vals, start, n, bitmap, rhs)						\
+	do {												\
+		switch ((cmp_type)) {									\
+		case AST_CMP_DIFF_OP:									\
+			SCALAR_LOOP(vals, start, n, bitmap, !=, rhs);					\
+			break;										\
+		case AST_CMP_EQUALS_OP:									\
+			SCALAR_LOOP(vals, start, n, bitmap, ==, rhs);					\
+			break;										\
+		case AST_CMP_GTE_OP:									\
+			SCALAR_LOOP(vals, start, n, bitmap, >=, rhs);					\
+			break;										\
+		case AST_CMP_GT_OP:									\
+			SCALAR_LOOP(vals, start, n, bitmap, >, rhs);					\
+			break;										\
+		case AST_CMP_LTE_OP:									\
+			SCALAR_LOOP(vals, start, n, bitmap, <=, rhs);					\
+			break;										\
+		case AST_CMP_LT_OP:									\
+			SCALAR_LOOP(vals, start, n, bitmap, <, rhs);					\
+			break;										\
+		default:										\
+			/* something went really wrong here */						\
+			BUG_GENERIC();									\
+		}											\
+	} while (0)
+
+static void scalar_int64(enum ast_comparison_type cmp_type, const int64_t *vals, size_t start, size_t n, int64_t rhs,
+		uint64_t *bitmap)
+{
+	SCALAR_KERNEL(cmp_type, vals, start, n, bitmap, rhs);
+}
+
+static void scalar_double(enum ast_comparison_type cmp_type, const double *vals, size_t start, size_t n, double rhs,
+		uint64_t *bitmap)
+{
+	SCALAR_KERNEL(cmp_type, vals, start, n, bitmap, rhs);
+}
+
+static void scalar_bool(enum ast_comparison_type cmp_type, const bool *vals, size_t start, size_t n, bool rhs,
+		uint64_t *bitmap)
+{
+	switch (cmp_type) {
+	case AST_CMP_DIFF_OP:
+		SCALAR_LOOP(vals, start, n, bitmap, !=, rhs);
+		break;
+	case AST_CMP_EQUALS_OP:
+		SCALAR_LOOP(vals, start, n, bitmap, ==, rhs);
+		break;
+	default:
+		/* booleans are not ordered, nothing matches */
+		break;
+	}
+}
+
+static const struct filter_kernels scalar_kernels = {
+	.isa = FILTER_ISA_SCALAR,
+	.int64 = &scalar_int64,
+	.dbl = &scalar_double,
+	.boolean = &scalar_bool,
+};
+
+#ifdef FILTER_X86
+
+/*
+ * SSE4.2: 2 INTEGERs/DOUBLEs or 16 TINYINTs per instruction
+ */
+__attribute__((target("sse4.2")))
+static inline uint64_t sse42_cmp_int64(enum ast_comparison_type cmp_type, __m128i v, __m128i r)
+{
+	switch (cmp_type) {
+	case AST_CMP_DIFF_OP:
+		return _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(v, r))) ^ 0x3;
+	case AST_CMP_EQUALS_OP:
+		return _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(v, r)));
+	case AST_CMP_GTE_OP:
+		return _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(r, v))) ^ 0x3;
+	case AST_CMP_GT_OP:
+		return _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(v, r)));
+	case AST_CMP_LTE_OP:
+		return _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(v, r))) ^ 0x3;
+	case AST_CMP_LT_OP:
+		return _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(r, v)));
+	default:
+		/* something went really wrong here */
+		BUG_GENERIC();
+		return 0;
+	}
+}
+
+__attribute__((target("sse4.2")))
+static void sse42_int64(enum ast_comparison_type cmp_type, const int64_t *vals, size_t start, size_t n, int64_t rhs,
+		uint64_t *bitmap)
+{
+	__m128i r = _mm_set1_epi64x(rhs);
+	size_t i = start;
+
+	for (; i + 2 <= n; i += 2)
+		bitmap[i / 64] |= sse42_cmp_int64(cmp_type, _mm_loadu_si128((const __m128i*)&vals[i]), r) << (i % 64);
+
+	scalar_int64(cmp_type, vals, i, n, rhs, bitmap);
+}
+
+/* NaNs only ever match '<>', same as the scalar operators */
+__attribute__((target("sse4.2")))
+static inline uint64_t sse42_cmp_double(enum ast_comparison_type cmp_type, __m128d v, __m128d r)
+{
+	switch (cmp_type) {
+	case AST_CMP_DIFF_OP:
+		return _mm_movemask_pd(_mm_cmpneq_pd(v, r));
+	case AST_CMP_EQUALS_OP:
+		return _mm_movemask_pd(_mm_cmpeq_pd(v, r));
+	case AST_CMP_GTE_OP:
+		return _mm_movemask_pd(_mm_cmpge_pd(v, r));
+	case AST_CMP_GT_OP:
+		return _mm_movemask_pd(_mm_cmpgt_pd(v, r));
+	case AST_CMP_LTE_OP:
+		return _mm_movemask_pd(_mm_cmple_pd(v, r));
+	case AST_CMP_LT_OP:
+		return _mm_movemask_pd(_mm_cmplt_pd(v, r));
+	default:
+		/* something went really wrong here */
+		BUG_GENERIC();
+		return 0;
+	}
+}
+
+__attribute__((target("sse4.2")))
+static void sse42_double(enum ast_comparison_type cmp_type, const double *vals, size_t start, size_t n, double rhs,
+		uint64_t *bitmap)
+{
+	__m128d r = _mm_set1_pd(rhs);
+	size_t i = start;
+
+	for (; i + 2 <= n; i += 2)
+		bitmap[i / 64] |= sse42_cmp_double(cmp_type, _mm_loadu_pd(&vals[i]), r) << (i % 64);
+
+	scalar_double(cmp_type, vals, i, n, rhs, bitmap);
+}
+
+__attribute__((target("sse4.2")))
+static void sse42_bool(enum ast_comparison_type cmp_type, const bool *vals, size_t start, size_t n, bool rhs,
+		uint64_t *bitmap)
+{
+	__m128i r = _mm_set1_epi8(rhs);
+	uint64_t mask;
+	size_t i = start;
+
+	if (cmp_type != AST_CMP_EQUALS_OP && cmp_type != AST_CMP_DIFF_OP)
+		return; /* booleans are not ordered, nothing matches */
+
+	for (; i + 16 <= n; i += 16) {
+		mask = (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)&vals[i]), r));
+
+		if (cmp_type == AST_CMP_DIFF_OP)
+			mask ^= 0xFFFF;
+
+		bitmap[i / 64] |= mask << (i % 64);
+	}
+
+	scalar_bool(cmp_type, vals, i, n, rhs, bitmap);
+}
+
+static const struct filter_kernels sse42_kernels = {
+	.isa = FILTER_ISA_SSE42,
+	.int64 = &sse42_int64,
+	.dbl = &sse42_double,
+	.boolean = &sse42_bool,
+};
+
+/*
+ * AVX2: 4 INTEGERs/DOUBLEs or 32 TINYINTs per instruction
+ */
+__attribute__((target("avx2")))
+static inline uint64_t avx2_cmp_int64(enum ast_comparison_type cmp_type, __m256i v, __m256i r)
+{
+	switch (cmp_type) {
+	case AST_CMP_DIFF_OP:
+		return _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v, r))) ^ 0xF;
+	case AST_CMP_EQUALS_OP:
+		return _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v, r)));
+	case AST_CMP_GTE_OP:
+		return _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(r, v))) ^ 0xF;
+	case AST_CMP_GT_OP:
+		return _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(v, r)));
+	case AST_CMP_LTE_OP:
+		return _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(v, r))) ^ 0xF;
+	case AST_CMP_LT_OP:
+		return _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(r, v)));
+	default:
+		/* something went really wrong here */
+		BUG_GENERIC();
+		return 0;
+	}
+}
+
+__attribute__((target("avx2")))
+static void avx2_int64(enum ast_comparison_type cmp_type, const int64_t *vals, size_t start, size_t n, int64_t rhs,
+		uint64_t *bitmap)
+{
+	__m256i r = _mm256_set1_epi64x(rhs);
+	size_t i = start;
+
+	for (; i + 4 <= n; i += 4)
+		bitmap[i / 64] |= avx2_cmp_int64(cmp_type, _mm256_loadu_si256((const __m256i*)&vals[i]), r) << (i % 64);
+
+	scalar_int64(cmp_type, vals, i, n, rhs, bitmap);
+}
+
+/* NaNs only ever match '<>', same as the scalar operators */
+__attribute__((target("avx2")))
+static inline uint64_t avx2_cmp_double(enum ast_comparison_type cmp_type, __m256d v, __m256d r)
+{
+	switch (cmp_type) {
+	case AST_CMP_DIFF_OP:
+		return _mm256_movemask_pd(_mm256_cmp_pd(v, r, _CMP_NEQ_UQ));
+	case AST_CMP_EQUALS_OP:
+		return _mm256_movemask_pd(_mm256_cmp_pd(v, r, _CMP_EQ_OQ));
+	case AST_CMP_GTE_OP:
+		return _mm256_movemask_pd(_mm256_cmp_pd(v, r, _CMP_GE_OQ));
+	case AST_CMP_GT_OP:
+		return _mm256_movemask_pd(_mm256_cmp_pd(v, r, _CMP_GT_OQ));
+	case AST_CMP_LTE_OP:
+		return _mm256_movemask_pd(_mm256_cmp_pd(v, r, _CMP_LE_OQ));
+	case AST_CMP_LT_OP:
+		return _mm256_movemask_pd(_mm256_cmp_pd(v, r, _CMP_LT_OQ));
+	default:
+		/* something went really wrong here */
+		BUG_GENERIC();
+		return 0;
+	}
+}
+
+__attribute__((target("avx2")))
+static void avx2_double(enum ast_comparison_type cmp_type, const double *vals, size_t start, size_t n, double rhs,
+		uint64_t *bitmap)
+{
+	__m256d r = _mm256_set1_pd(rhs);
+	size_t i = start;
+
+	for (; i + 4 <= n; i += 4)
+		bitmap[i / 64] |= avx2_cmp_double(cmp_type, _mm256_loadu_pd(&vals[i]), r) << (i % 64);
+
+	scalar_double(cmp_type, vals, i, n, rhs, bitmap);
+}
+
+__attribute__((target("avx2")))
+static void avx2_bool(enum ast_comparison_type cmp_type, const bool *vals, size_t start, size_t n, bool rhs,
+		uint64_t *bitmap)
+{
+	__m256i r = _mm256_set1_epi8(rhs);
+	uint64_t mask;
+	size_t i = start;
+
+	if (cmp_type != AST_CMP_EQUALS_OP && cmp_type != AST_CMP_DIFF_OP)
+		return; /* booleans are not ordered, nothing matches */
+
+	for (; i + 32 <= n; i += 32) {
+		mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)&vals[i]), r));
+
+		if (cmp_type == AST_CMP_DIFF_OP)
+			mask ^= 0xFFFFFFFF;
+
+		bitmap[i / 64] |= mask << (i % 64);
+	}
+
+	scalar_bool(cmp_type, vals, i, n, rhs, bitmap);
+}
+
+static const struct filter_kernels avx2_kernels = {
+	.isa = FILTER_ISA_AVX2,
+	.int64 = &avx2_int64,
+	.dbl = &avx2_double,
+	.boolean = &avx2_bool,
+};
+
+#endif /* FILTER_X86 */
+
+static const struct filter_kernels *kernels;
+static pthread_once_t kernels_once = PTHREAD_ONCE_INIT;
+
+static bool isa_supported(enum filter_isa isa)
+{
+#ifdef FILTER_X86
+	__builtin_cpu_init();
+
+	if (isa == FILTER_ISA_AVX2)
+		return __builtin_cpu_supports("avx2");
+	else if (isa == FILTER_ISA_SSE42)
+		return __builtin_cpu_supports("sse4.2");
+#endif
+
+	return isa == FILTER_ISA_SCALAR;
+}
+
+static const struct filter_kernels* isa_kernels(enum filter_isa isa)
+{
+	switch (isa) {
+#ifdef FILTER_X86
+	case FILTER_ISA_AVX2:
+		return &avx2_kernels;
+	case FILTER_ISA_SSE42:
+		return &sse42_kernels;
+#endif
+	default:
+		return &scalar_kernels;
+	}
+}
+
+static void kernels_init(void)
+{
+	if (isa_supported(FILTER_ISA_AVX2))
+		kernels = isa_kernels(FILTER_ISA_AVX2);
+	else if (isa_supported(FILTER_ISA_SSE42))
+		kernels = isa_kernels(FILTER_ISA_SSE42);
+	else
+		kernels = isa_kernels(FILTER_ISA_SCALAR);
+}
+
+static const struct filter_kernels* get_kernels(void)
+{
+	pthread_once(&kernels_once, &kernels_init);
+	return kernels;
+}
+
+enum filter_isa filter_isa_get(void)
+{
+	return get_kernels()->isa;
+}
+
+bool filter_isa_set(enum filter_isa isa)
+{
+	/* make sure CPU detection won't override us later on */
+	get_kernels();
+
+	if (!isa_supported(isa))
+		return false;
+
+	kernels = isa_kernels(isa);
+	return true;
+}
+
+void filter_int64(enum ast_comparison_type cmp_type, const int64_t *vals, size_t n, int64_t rhs, uint64_t *bitmap)
+{
+	memzero(bitmap, FILTER_BITMAP_WORDS(n) * sizeof(*bitmap));
+	get_kernels()->int64(cmp_type, vals, 0, n, rhs, bitmap);
+}
+
+void filter_double(enum ast_comparison_type cmp_type, const double *vals, size_t n, double rhs, uint64_t *bitmap)
+{
+	memzero(bitmap, FILTER_BITMAP_WORDS(n) * sizeof(*bitmap));
+	get_kernels()->dbl(cmp_type, vals, 0, n, rhs, bitmap);
+}
+
+void filter_bool(enum ast_comparison_type cmp_type, const bool *vals, size_t n, bool rhs, uint64_t *bitmap)
+{
+	memzero(bitmap, FILTER_BITMAP_WORDS(n) * sizeof(*bitmap));
+	get_kernels()->boolean(cmp_type, vals, 0, n, rhs, bitmap);
+}
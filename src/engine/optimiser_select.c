@@ -526,6 +526,36 @@ int replace_entries_from(struct ast_node *node)
 	}
 }
 
+/*
+ * SELECT COUNT(*) FROM A; doesn't need to scan / materialise anything given that tables
+ * keep track of how many live rows they have.
+ */
+static void hint_count_from_counter(struct ast_sel_select_node *node)
+{
+	struct list_head *pos;
+	struct ast_node *tmp_entry;
+	int count_table = 0;
+	int count_count = 0;
+
+	if (node->distinct)
+		return;
+
+	list_for_each(pos, node->node_children_head)
+	{
+		tmp_entry = list_entry(pos, typeof(*tmp_entry), head);
+
+		if (tmp_entry->node_type == AST_TYPE_SEL_TABLE)
+			count_table++;
+		else if (tmp_entry->node_type == AST_TYPE_SEL_COUNT
+				&& ((struct ast_sel_count_node*)tmp_entry)->all)
+			count_count++;
+		else
+			return; /* filters, grouping, joins, other fields and so on */
+	}
+
+	node->count_from_counter = count_table == 1 && count_count > 0;
+}
+
 int optimiser_run_select_stmt(struct database *db, struct ast_sel_select_node *node, struct query_output *output)
 {
 	struct hashtable table_alias = {0};
@@ -565,6 +595,9 @@ int optimiser_run_select_stmt(struct database *db, struct ast_sel_select_node *n
 		goto cleanup_tbl_ht;
 	}
 
+	/* answer COUNT(*)-only queries from the table's row counter when possible */
+	hint_count_from_counter(node);
+
 cleanup_tbl_ht:
 	hashtable_foreach(&column_alias, &free_hashmap_entries, NULL);
 	hashtable_free(&column_alias);
@@ -88,7 +88,18 @@ struct query_output* query_execute(struct database *db, char *query)
 
 	/* clean up */
 	queue_free(&queue);
-	ast_free(node);
+
+	if (output->results.pipeline) {
+		output->results.ast = node;
+
+		/* writes to its tables have to find the result set from now on */
+		BUG_ON(database_lock(db));
+		output->results.db = db;
+		list_add(&output->results.head, &db->results);
+		database_unlock(db);
+	} else {
+		ast_free(node);
+	}
 
 	return output;
 
@@ -109,28 +120,41 @@ int query_cur_step(struct result_set *res)
 {
 	struct row *row;
 	size_t row_size;
+	int ret;
 
 	/* sanity checks */
 	BUG_ON(!res || !res->table);
 
+	/* streamed results are pulled from the pipeline one row at a time */
+	if (res->pipeline) {
+		if ((ret = res->pipeline->next(res->pipeline, &res->cursor_row)) != MIDORIDB_ROW)
+			res->cursor_row = NULL;
+
+		return ret;
+	}
+
 	row_size = table_calc_row_size(res->table);
 
 	/* is this the first time ? */
 	if (!res->cursor_blk) {
 
-		res->cursor_blk = container_of(res->table->datablock_head->next, typeof(struct datablock), head);
+		/* empty result set */
+		if (!(res->cursor_blk = block_dir_at(&res->table->blocks, 0)))
+			return res->err;
+
+		res->cursor_pos = 0;
 		res->cursor_offset = 0;
 	} else {
-		if (res->cursor_offset + row_size > DATABLOCK_PAGE_SIZE) {
-			res->cursor_blk = container_of(res->cursor_blk->head.next, typeof(struct datablock), head);
+		res->cursor_offset += row_size;
+
+		/* same rule as table_insert_row: a row never ends at the very edge of the datablock */
+		if (res->cursor_offset + row_size >= table_block_size(res->table)) {
 			res->cursor_offset = 0;
 
-			if (&res->cursor_blk->head == res->table->datablock_head) {
+			if (!(res->cursor_blk = block_dir_at(&res->table->blocks, ++res->cursor_pos))) {
 				/* end of the line */
-				return MIDORIDB_OK;
+				return res->err;
 			}
-		} else {
-			res->cursor_offset += row_size;
 		}
 	}
 
@@ -140,8 +164,9 @@ int query_cur_step(struct result_set *res)
 
 	if (row->flags.empty)
 		/* end of the line */
-		return MIDORIDB_OK;
+		return res->err;
 
+	res->cursor_row = row;
 	return MIDORIDB_ROW;
 }
 
@@ -152,9 +177,9 @@ int64_t query_column_int64(struct result_set *res, int col_idx)
 	int64_t ret = 0;
 
 	/* sanity checks */
-	BUG_ON(!res || !res->table || !res->cursor_blk || col_idx > res->table->column_count - 1);
+	BUG_ON(!res || !res->table || !res->cursor_row || col_idx > res->table->column_count - 1);
 
-	row = (typeof(row))&res->cursor_blk->data[res->cursor_offset];
+	row = res->cursor_row;
 
 	/* sounds like user neither invoked query_cur_step nor checked if it returned MIDORIDB_ROW */
 	BUG_ON_CUSTOM_MSG(row->flags.deleted || row->flags.empty, "cursor is pointing at an invalid row\n");
@@ -166,9 +191,74 @@ int64_t query_column_int64(struct result_set *res, int col_idx)
 	return ret;
 }
 
+/* copies rows the stream has yet to return into the result table and lets go of the pipeline */
+static void result_set_detach(struct result_set *res)
+{
+	size_t row_size = table_calc_row_size(res->table);
+	bool has_row = res->cursor_row != NULL;
+	struct row *row;
+	int ret = MIDORIDB_OK;
+
+	/* the current row goes first so it can still be read, the cursor is left pointing at it */
+	if (has_row && !table_insert_row(res->table, res->cursor_row, row_size))
+		ret = -MIDORIDB_NOMEM;
+
+	while (!ret && (ret = res->pipeline->next(res->pipeline, &row)) == MIDORIDB_ROW)
+		ret = table_insert_row(res->table, row, row_size) ? MIDORIDB_OK : -MIDORIDB_NOMEM;
+
+	res->pipeline->free(res->pipeline);
+	res->pipeline = NULL;
+	res->err = ret;
+
+	list_del(&res->head);
+	res->db = NULL;
+
+	res->cursor_row = NULL;
+	res->cursor_blk = NULL;
+
+	if (has_row && (res->cursor_blk = block_dir_at(&res->table->blocks, 0))) {
+		res->cursor_pos = 0;
+		res->cursor_offset = 0;
+		res->cursor_row = (struct row*)res->cursor_blk->data;
+	}
+}
+
+int query_detach_results(struct database *db, struct table *table)
+{
+	struct list_head *pos, *tmp_pos;
+	struct result_set *res;
+	int ret;
+
+	if ((ret = database_lock(db)))
+		return ret;
+
+	list_for_each_safe(pos, tmp_pos, &db->results)
+	{
+		res = list_entry(pos, typeof(*res), head);
+
+		/* failures are kept by the result set itself, the table is free to change either way */
+		if (!table || res->pipeline->reads(res->pipeline, table))
+			result_set_detach(res);
+	}
+
+	return database_unlock(db);
+}
+
 void query_free(struct query_output* output)
 {
 	if (output->status == ST_OK_WITH_RESULTS){
+		if (output->results.db) {
+			BUG_ON(database_lock(output->results.db));
+			list_del(&output->results.head);
+			database_unlock(output->results.db);
+		}
+
+		if (output->results.pipeline)
+			output->results.pipeline->free(output->results.pipeline);
+
+		if (output->results.ast)
+			ast_free(output->results.ast);
+
 		table_destroy(&output->results.table);
 	}
 
@@ -0,0 +1,593 @@
+/*
+ * scan.c
+ *
+ *  Created on: 17/10/2026
+ *      Author: paulo
+ */
+
+#include <engine/scan.h>
+
+/* morsels per thread in a wave, a few extra ones smooth out morsels of uneven cost */
+#define SCAN_WAVE_MORSELS_PER_THREAD	4
+
+/* range lookups are given up on once they match more than 1/ratio of the rows of a table */
+#define SCAN_INDEX_RANGE_RATIO	4
+
+void scan_cursor_init(struct scan_cursor *cur, struct table *table, size_t first, size_t end)
+{
+	cur->table = table;
+	cur->row_size = table_calc_row_size(table);
+	cur->slots = table_block_size(table) / cur->row_size;
+	cur->pos = first;
+	cur->end = end;
+	cur->idx = 0;
+	cur->block_filter = NULL;
+	cur->filter_arg = NULL;
+}
+
+void scan_cursor_filter(struct scan_cursor *cur, bool (*fn)(struct table *table, struct datablock *blk, void *arg),
+		void *arg)
+{
+	cur->block_filter = fn;
+	cur->filter_arg = arg;
+}
+
+struct row* scan_cursor_next(struct scan_cursor *cur, struct datablock **blk, size_t *offset)
+{
+	struct datablock *tmp_blk;
+	struct row *row;
+
+	for (;;) {
+		if (cur->idx >= cur->slots) {
+			cur->pos++;
+			cur->idx = 0;
+
+			/* datablocks are pages apart, the hardware prefetcher won't cross over to the next one */
+			if (cur->pos + 1 < MIN(cur->end, cur->table->blocks.len))
+				__builtin_prefetch(cur->table->blocks.blocks[cur->pos + 1]->data);
+		}
+
+		if (cur->pos >= cur->end || !(tmp_blk = block_dir_at(&cur->table->blocks, cur->pos)))
+			return NULL; /* end of the line */
+
+		/* datablocks are checked once, as soon as the cursor gets to them */
+		if (!cur->idx && cur->block_filter && !cur->block_filter(cur->table, tmp_blk, cur->filter_arg)) {
+			cur->idx = cur->slots;
+			continue;
+		}
+		row = (struct row*)&tmp_blk->data[cur->row_size * cur->idx];
+
+		if (row->flags.empty) {
+			/* nothing else in this datablock */
+			cur->idx = cur->slots;
+			continue;
+		}
+
+		cur->idx++;
+
+		if (row->flags.deleted)
+			continue; /* nothing to do here */
+
+		if (blk)
+			*blk = tmp_blk;
+
+		if (offset)
+			*offset = cur->row_size * (cur->idx - 1);
+
+		return row;
+	}
+}
+
+static void* insn_key(struct bc_insn *insn)
+{
+	switch (insn->opcode) {
+	case BC_CMP_INT_IMM:
+		return &insn->imm.int_val;
+	case BC_CMP_DBL_IMM:
+		return &insn->imm.double_val;
+	case BC_CMP_BOOL_IMM:
+		return &insn->imm.bool_val;
+	case BC_CMP_TIME_IMM:
+		return &insn->imm.time_val;
+	default:
+		return insn->imm.str_val;
+	}
+}
+
+/* could any value within the bounds of the zone satisfy the comparison ? */
+static bool zone_may_match(struct zone_map *zone, enum COLUMN_TYPE type, struct bc_insn *insn)
+{
+	/* no comparison evaluates to true if NULL is one of the operands */
+	if (!zone->value_count)
+		return false;
+
+	switch (insn->cmp_type) {
+	case AST_CMP_EQUALS_OP:
+		return zone_value_cmp(type, &zone->min, insn_key(insn)) <= 0
+				&& zone_value_cmp(type, &zone->max, insn_key(insn)) >= 0;
+	case AST_CMP_GT_OP:
+		return zone_value_cmp(type, &zone->max, insn_key(insn)) > 0;
+	case AST_CMP_GTE_OP:
+		return zone_value_cmp(type, &zone->max, insn_key(insn)) >= 0;
+	case AST_CMP_LT_OP:
+		return zone_value_cmp(type, &zone->min, insn_key(insn)) < 0;
+	case AST_CMP_LTE_OP:
+		return zone_value_cmp(type, &zone->min, insn_key(insn)) <= 0;
+	default:
+		return true;
+	}
+}
+
+bool scan_block_may_match(struct table *table, struct datablock *blk, struct bytecode *prog)
+{
+	struct bc_insn *insn;
+	struct zone_map *zone;
+	size_t pos = 0;
+
+	while ((insn = bytecode_next_cmp_imm(prog, &pos))) {
+		if (insn->opcode == BC_CMP_STR_IMM) {
+			if (insn->cmp_type == AST_CMP_EQUALS_OP
+					&& !table_bloom_may_contain(table, blk, insn->col_idx_1, insn->imm.str_val))
+				return false;
+			continue;
+		}
+
+		/* fixed-width columns from here on */
+		if (blk->zones && !zone_may_match(&blk->zones[insn->col_idx_1], table->columns[insn->col_idx_1].type, insn))
+			return false;
+	}
+
+	for (pos = 0; blk->zones && (insn = bytecode_next_null_test(prog, &pos));) {
+		zone = &blk->zones[insn->col_idx_1];
+
+		if (!zone_map_tracks(table->columns[insn->col_idx_1].type))
+			continue;
+
+		/* IS NOT NULL needs a value, IS NULL needs a NULL */
+		if (!(insn->imm.bool_val ? zone->value_count : zone->null_count))
+			return false;
+	}
+
+	return true;
+}
+
+bool scan_index_bounds(struct table *table, int col_idx, struct bytecode *prog, struct index_range *range)
+{
+	struct bc_insn *insn;
+	size_t pos = 0;
+	bool found = false;
+
+	while ((insn = bytecode_next_cmp_imm(prog, &pos))) {
+		if (insn->col_idx_1 != col_idx)
+			continue;
+
+		switch (insn->cmp_type) {
+		case AST_CMP_EQUALS_OP:
+			table_index_range_bound(table, col_idx, range, insn_key(insn), true, true);
+			table_index_range_bound(table, col_idx, range, insn_key(insn), false, true);
+			break;
+		case AST_CMP_GT_OP:
+		case AST_CMP_GTE_OP:
+			table_index_range_bound(table, col_idx, range, insn_key(insn), true,
+					insn->cmp_type == AST_CMP_GTE_OP);
+			break;
+		default:
+			table_index_range_bound(table, col_idx, range, insn_key(insn), false,
+					insn->cmp_type == AST_CMP_LTE_OP);
+			break;
+		}
+
+		found = true;
+	}
+
+	return found;
+}
+
+/* rows found through a range are scattered all over the table, past a point a scan is cheaper */
+static size_t range_scan_limit(struct table *table)
+{
+	return table->row_count / SCAN_INDEX_RANGE_RATIO;
+}
+
+/*
+ * rows a node of a set plan holds true for: known ones are a superset of them, (exact ones are
+ * the very rows) unknown ones could be any row of the table
+ */
+struct bitmap_operand {
+	bool known;
+	bool exact;
+	/* bits is ours, rows of bitmap indexes are referenced otherwise */
+	bool owned;
+	struct roaring bits;
+	const struct roaring *ref;
+};
+
+static const struct roaring* operand_rows(struct bitmap_operand *operand)
+{
+	return operand->owned ? &operand->bits : operand->ref;
+}
+
+static void operand_free(struct bitmap_operand *operand)
+{
+	if (operand->owned)
+		roaring_free(&operand->bits);
+
+	memzero(operand, sizeof(*operand));
+}
+
+static bool has_bitmap_index(struct table *table)
+{
+	for (int i = 0; i < table->column_count; i++) {
+		if (table->indexes[i] && table->indexes[i]->type == IT_BITMAP)
+			return true;
+	}
+
+	return false;
+}
+
+static int bitmap_leaf(struct table *table, struct bc_insn *insn, struct bitmap_operand *out)
+{
+	const struct roaring *rows = NULL, *more = NULL;
+
+	memzero(out, sizeof(*out));
+
+	switch (insn->opcode) {
+	case BC_LOAD_BOOL:
+		/* 'true' is every row, i.e. unknown */
+		if (!insn->imm.bool_val)
+			out->known = out->exact = out->owned = true;
+		return MIDORIDB_OK;
+	case BC_CMP_BOOL_IMM:
+		if (insn->cmp_type == AST_CMP_EQUALS_OP)
+			rows = table_index_bitmap(table, insn->col_idx_1, insn->imm.bool_val);
+		else if (insn->cmp_type == AST_CMP_DIFF_OP)
+			rows = table_index_bitmap(table, insn->col_idx_1, !insn->imm.bool_val);
+		break;
+	case BC_ISNULL:
+		if (!insn->imm.bool_val) {
+			rows = table_index_bitmap(table, insn->col_idx_1, INDEX_BITMAP_NULL);
+		} else {
+			rows = table_index_bitmap(table, insn->col_idx_1, false);
+			more = table_index_bitmap(table, insn->col_idx_1, true);
+		}
+		break;
+	default:
+		break;
+	}
+
+	if (!rows)
+		return MIDORIDB_OK;
+
+	out->known = out->exact = true;
+	out->ref = rows;
+
+	if (!more)
+		return MIDORIDB_OK;
+
+	out->owned = true;
+
+	return roaring_or(&out->bits, rows, more) ? MIDORIDB_OK : -MIDORIDB_NOMEM;
+}
+
+/* combines (and frees) args into out */
+static int bitmap_combine(enum bc_set_op op, struct bitmap_operand *args, size_t n, struct bitmap_operand *out)
+{
+	struct bitmap_operand acc = {0};
+	struct roaring tmp;
+	bool exact = true, ok;
+	int ret = MIDORIDB_OK;
+
+	for (size_t i = 0; i < n; i++) {
+		exact &= args[i].known && args[i].exact;
+
+		/* intersections can leave unknown operands out, unions and differences can't */
+		if ((op == BC_SET_OR && !args[i].known) || (op == BC_SET_XOR && !(args[i].known && args[i].exact)))
+			goto out;
+	}
+
+	for (size_t i = 0; i < n; i++) {
+		if (!args[i].known)
+			continue;
+
+		if (!acc.known) {
+			acc = args[i];
+			args[i].owned = false;
+			continue;
+		}
+
+		roaring_init(&tmp);
+
+		if (op == BC_SET_AND)
+			ok = roaring_and(&tmp, operand_rows(&acc), operand_rows(&args[i]));
+		else if (op == BC_SET_OR)
+			ok = roaring_or(&tmp, operand_rows(&acc), operand_rows(&args[i]));
+		else
+			ok = roaring_xor(&tmp, operand_rows(&acc), operand_rows(&args[i]));
+
+		operand_free(&acc);
+
+		if (!ok) {
+			ret = -MIDORIDB_NOMEM;
+			goto out;
+		}
+
+		acc.known = acc.owned = true;
+		acc.bits = tmp;
+	}
+
+	acc.exact = exact;
+
+out:
+	for (size_t i = 0; i < n; i++)
+		operand_free(&args[i]);
+
+	*out = acc;
+	return ret;
+}
+
+static int bitmap_eval(struct table *table, struct bytecode *prog, struct bitmap_operand *out)
+{
+	struct bc_set_node *nodes = (struct bc_set_node*)prog->set_plan.data;
+	struct bc_insn *insns = (struct bc_insn*)prog->insns.data;
+	size_t count = prog->set_plan.len / sizeof(*nodes);
+	struct bitmap_operand *stack;
+	size_t depth = 0;
+	int ret = MIDORIDB_OK;
+
+	memzero(out, sizeof(*out));
+
+	if (!count)
+		return MIDORIDB_OK;
+
+	if (!(stack = calloc(count, sizeof(*stack))))
+		return -MIDORIDB_NOMEM;
+
+	for (size_t i = 0; i < count && !ret; i++, depth++) {
+		if (nodes[i].op == BC_SET_LEAF) {
+			ret = bitmap_leaf(table, &insns[nodes[i].arg], &stack[depth]);
+			continue;
+		}
+
+		depth -= nodes[i].arg;
+		ret = bitmap_combine(nodes[i].op, &stack[depth], nodes[i].arg, &stack[depth]);
+	}
+
+	if (!ret) {
+		/* something went terribly wrong here if this is true */
+		BUG_ON(depth != 1);
+
+		*out = stack[0];
+		stack[0].owned = false;
+	}
+
+	for (size_t i = 0; i < depth; i++)
+		operand_free(&stack[i]);
+
+	free(stack);
+
+	return ret;
+}
+
+/*
+ * rows matched by every predicate as far as bitmap indexes know, this function returns
+ * -MIDORIDB_ERROR if they don't narrow rows down enough to be worth it
+ */
+static int bitmap_lookup(struct table *table, struct bytecode **progs, size_t count, struct vector *locs)
+{
+	struct bitmap_operand args[2], acc;
+	int ret;
+
+	if (!has_bitmap_index(table))
+		return -MIDORIDB_ERROR;
+
+	if ((ret = bitmap_eval(table, progs[0], &acc)))
+		return ret;
+
+	for (size_t i = 1; i < count; i++) {
+		args[0] = acc;
+
+		if ((ret = bitmap_eval(table, progs[i], &args[1]))) {
+			operand_free(&args[0]);
+			return ret;
+		}
+
+		if ((ret = bitmap_combine(BC_SET_AND, args, ARR_SIZE(args), &acc)))
+			return ret;
+	}
+
+	if (!acc.known || roaring_cardinality(operand_rows(&acc)) > range_scan_limit(table))
+		ret = -MIDORIDB_ERROR;
+	else if (!table_index_bitmap_locs(table, operand_rows(&acc), locs))
+		ret = -MIDORIDB_NOMEM;
+
+	operand_free(&acc);
+
+	return ret;
+}
+
+bool scan_index_lookup(struct table *table, struct bytecode **progs, size_t count, struct vector *locs)
+{
+	struct index_range range = {0};
+	struct row_location *rows;
+	struct bc_insn *insn;
+	struct index *index;
+	size_t pos, matches;
+	int col_idx = -1, ret;
+	bool bounded = false, match;
+
+	/* equalities narrow things down the most */
+	for (size_t i = 0; i < count; i++) {
+		for (pos = 0; (insn = bytecode_next_cmp_imm(progs[i], &pos));) {
+			index = table->indexes[insn->col_idx_1];
+
+			if (insn->cmp_type != AST_CMP_EQUALS_OP || !index || index->type == IT_BITMAP)
+				continue;
+
+			if (!table_index_lookup(table, insn->col_idx_1, insn_key(insn), locs))
+				goto err;
+
+			goto filter;
+		}
+	}
+
+	/* then flags, as a whole */
+	if (!(ret = bitmap_lookup(table, progs, count, locs)))
+		goto filter;
+	else if (ret != -MIDORIDB_ERROR)
+		goto err;
+
+	/* otherwise rows within the bounds of the first ordered index compared to a literal are fetched */
+	for (size_t i = 0; i < count && col_idx < 0; i++) {
+		for (pos = 0; (insn = bytecode_next_cmp_imm(progs[i], &pos));) {
+			index = table->indexes[insn->col_idx_1];
+
+			if (index && index->type == IT_BTREE) {
+				col_idx = insn->col_idx_1;
+				break;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < count && col_idx >= 0; i++)
+		bounded |= scan_index_bounds(table, col_idx, progs[i], &range);
+
+	if (!bounded)
+		return false;
+
+	if (table_index_range(table, col_idx, &range, false, range_scan_limit(table), locs))
+		goto err;
+
+	qsort(locs->data, locs->len / sizeof(struct row_location), sizeof(struct row_location), &row_location_cmp);
+
+filter:
+	/* keep the rows the whole predicate matches */
+	rows = (struct row_location*)locs->data;
+	matches = 0;
+
+	for (size_t i = 0; i < locs->len / sizeof(*rows); i++) {
+		match = true;
+
+		for (size_t j = 0; j < count && match; j++)
+			match = bytecode_run(progs[j], (struct row*)&rows[i].blk->data[rows[i].offset]);
+
+		if (match)
+			rows[matches++] = rows[i];
+	}
+
+	locs->len = matches * sizeof(*rows);
+	return true;
+
+err:
+	/* a full scan still gets us there */
+	vector_clear(locs);
+	return false;
+}
+
+bool morsel_scan_is_parallel(struct worker_pool *pool, struct table *table)
+{
+	if (!pool || pool->nthreads <= 1)
+		return false;
+
+	return table->blocks.len > SCAN_MORSEL_BLOCKS;
+}
+
+bool morsel_scan_init(struct morsel_scan *scan, struct worker_pool *pool, struct table *table,
+		void (*fn)(struct morsel_scan *scan, struct morsel *morsel), void *arg)
+{
+	memzero(scan, sizeof(*scan));
+
+	scan->pool = pool;
+	scan->table = table;
+	scan->fn = fn;
+	scan->arg = arg;
+	scan->pos = 0;
+	scan->cap = (pool ? pool->nthreads : 1) * SCAN_WAVE_MORSELS_PER_THREAD;
+
+	if (!(scan->morsels = calloc(scan->cap, sizeof(*scan->morsels))))
+		return false;
+
+	for (size_t i = 0; i < scan->cap; i++) {
+		if (!vector_init(&scan->morsels[i].out)) {
+			morsel_scan_free(scan);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void morsel_task(void *arg, size_t task)
+{
+	struct morsel_scan *scan = arg;
+
+	scan->fn(scan, &scan->morsels[task]);
+}
+
+size_t morsel_scan_wave(struct morsel_scan *scan)
+{
+	struct morsel *morsel;
+
+	scan->nmorsels = 0;
+
+	/* carve the next datablocks up into morsels */
+	while (scan->nmorsels < scan->cap && scan->pos < scan->table->blocks.len) {
+		morsel = &scan->morsels[scan->nmorsels++];
+		morsel->first = scan->pos;
+		morsel->count = 0;
+		morsel->ret = MIDORIDB_OK;
+		vector_clear(&morsel->out);
+
+		scan->pos = MIN(scan->pos + SCAN_MORSEL_BLOCKS, scan->table->blocks.len);
+		morsel->end = scan->pos;
+	}
+
+	if (scan->nmorsels) {
+		if (scan->pool)
+			worker_pool_run(scan->pool, scan->nmorsels, &morsel_task, scan);
+		else
+			for (size_t i = 0; i < scan->nmorsels; i++)
+				morsel_task(scan, i);
+	}
+
+	return scan->nmorsels;
+}
+
+static bool block_filter(struct table *table, struct datablock *blk, void *arg)
+{
+	return scan_block_may_match(table, blk, arg);
+}
+
+void morsel_scan_match(struct morsel_scan *scan, struct morsel *morsel)
+{
+	struct bytecode *prog = scan->arg;
+	struct scan_cursor cur;
+	struct row_location match;
+	struct row *row;
+
+	scan_cursor_init(&cur, scan->table, morsel->first, morsel->end);
+	scan_cursor_filter(&cur, &block_filter, prog);
+
+	while ((row = scan_cursor_next(&cur, &match.blk, &match.offset))) {
+		if (!bytecode_run(prog, row))
+			continue;
+
+		if (!vector_push(&morsel->out, &match, sizeof(match))) {
+			morsel->ret = -MIDORIDB_NOMEM;
+			return;
+		}
+
+		morsel->count++;
+	}
+}
+
+void morsel_scan_free(struct morsel_scan *scan)
+{
+	if (!scan->morsels)
+		return;
+
+	for (size_t i = 0; i < scan->cap; i++)
+		vector_free(&scan->morsels[i].out);
+
+	free(scan->morsels);
+	scan->morsels = NULL;
+}
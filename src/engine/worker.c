@@ -0,0 +1,173 @@
+/*
+ * worker.c
+ *
+ * Notes to myself:
+ * 	- workers are spawned once (first job) so they all start off generation 0 and can't miss a job.
+ * 	- the submitter waits until every worker has picked the job up, that way nobody can be
+ * 		left behind holding a stale fn/arg when the next job comes in.
+ *
+ *  Created on: 17/10/2026
+ *      Author: paulo
+ */
+
+#include <engine/worker.h>
+#include <unistd.h>
+
+size_t worker_pool_default_threads(void)
+{
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return n > 0 ? (size_t)n : 1;
+}
+
+static void run_tasks(struct worker_pool *pool, void (*fn)(void *arg, size_t task), void *arg, size_t ntasks)
+{
+	size_t task;
+
+	while ((task = __atomic_fetch_add(&pool->next_task, 1, __ATOMIC_RELAXED)) < ntasks)
+		fn(arg, task);
+}
+
+static void* worker_main(void *arg)
+{
+	struct worker_pool *pool = arg;
+	void (*fn)(void *arg, size_t task);
+	void *fn_arg;
+	size_t ntasks;
+	uint64_t generation = 0;
+
+	pthread_mutex_lock(&pool->mutex);
+
+	for (;;) {
+		while (!pool->stop && pool->generation == generation)
+			pthread_cond_wait(&pool->job_cond, &pool->mutex);
+
+		if (pool->stop)
+			break;
+
+		generation = pool->generation;
+		fn = pool->fn;
+		fn_arg = pool->arg;
+		ntasks = pool->ntasks;
+		pool->joined++;
+		pool->active++;
+
+		pthread_mutex_unlock(&pool->mutex);
+
+		run_tasks(pool, fn, fn_arg, ntasks);
+
+		pthread_mutex_lock(&pool->mutex);
+
+		pool->active--;
+		pthread_cond_signal(&pool->done_cond);
+	}
+
+	pthread_mutex_unlock(&pool->mutex);
+
+	return NULL;
+}
+
+static void spawn_workers(struct worker_pool *pool)
+{
+	if (!(pool->threads = calloc(pool->nthreads - 1, sizeof(*pool->threads))))
+		return;
+
+	/* it's fine if we can't get all of them */
+	for (size_t i = 0; i < pool->nthreads - 1; i++) {
+		if (pthread_create(&pool->threads[i], NULL, &worker_main, pool))
+			break;
+
+		pool->nspawned++;
+	}
+}
+
+bool worker_pool_init(struct worker_pool *pool, size_t nthreads)
+{
+	/* sanity check */
+	BUG_ON(!pool);
+
+	memzero(pool, sizeof(*pool));
+	pool->nthreads = nthreads ? nthreads : 1;
+
+	if (pthread_mutex_init(&pool->mutex, NULL))
+		goto err;
+
+	if (pthread_mutex_init(&pool->run_mutex, NULL))
+		goto err_run_mutex;
+
+	if (pthread_cond_init(&pool->job_cond, NULL))
+		goto err_job_cond;
+
+	if (pthread_cond_init(&pool->done_cond, NULL))
+		goto err_done_cond;
+
+	return true;
+
+err_done_cond:
+	pthread_cond_destroy(&pool->job_cond);
+err_job_cond:
+	pthread_mutex_destroy(&pool->run_mutex);
+err_run_mutex:
+	pthread_mutex_destroy(&pool->mutex);
+err:
+	return false;
+}
+
+void worker_pool_destroy(struct worker_pool *pool)
+{
+	pthread_mutex_lock(&pool->mutex);
+	pool->stop = true;
+	pthread_cond_broadcast(&pool->job_cond);
+	pthread_mutex_unlock(&pool->mutex);
+
+	for (size_t i = 0; i < pool->nspawned; i++)
+		pthread_join(pool->threads[i], NULL);
+
+	free(pool->threads);
+	pool->threads = NULL;
+	pool->nspawned = 0;
+
+	pthread_cond_destroy(&pool->done_cond);
+	pthread_cond_destroy(&pool->job_cond);
+	pthread_mutex_destroy(&pool->run_mutex);
+	pthread_mutex_destroy(&pool->mutex);
+}
+
+void worker_pool_run(struct worker_pool *pool, size_t ntasks, void (*fn)(void *arg, size_t task), void *arg)
+{
+	/* nothing to split or somebody else is using the workers: run it ourselves */
+	if (pool->nthreads <= 1 || ntasks <= 1 || pthread_mutex_trylock(&pool->run_mutex))
+		goto serial;
+
+	if (!pool->threads)
+		spawn_workers(pool);
+
+	if (!pool->nspawned) {
+		pthread_mutex_unlock(&pool->run_mutex);
+		goto serial;
+	}
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->fn = fn;
+	pool->arg = arg;
+	pool->ntasks = ntasks;
+	pool->next_task = 0;
+	pool->joined = 0;
+	pool->generation++;
+	pthread_cond_broadcast(&pool->job_cond);
+	pthread_mutex_unlock(&pool->mutex);
+
+	run_tasks(pool, fn, arg, ntasks);
+
+	pthread_mutex_lock(&pool->mutex);
+	while (pool->joined < pool->nspawned || pool->active)
+		pthread_cond_wait(&pool->done_cond, &pool->mutex);
+	pthread_mutex_unlock(&pool->mutex);
+
+	pthread_mutex_unlock(&pool->run_mutex);
+	return;
+
+serial:
+	for (size_t i = 0; i < ntasks; i++)
+		fn(arg, i);
+}
@@ -82,6 +82,8 @@ static struct ast_crt_column_def_node* __must_check build_columndef_node(struct
 			node->attr_auto_inc = true;
 		} else if (strstarts(str, "ATTR UNIQUEKEY")) {
 			node->attr_uniq_key = true;
+		} else if (strstarts(str, "ATTR BLOOM")) {
+			node->attr_bloom = true;
 		} else if (strstarts(str, "ATTR NOTNULL")) {
 			node->attr_null = false;
 			node->attr_not_null = true;
@@ -141,12 +143,13 @@ static struct ast_crt_create_node* __must_check build_table_node(struct queue *p
 
 	str = (char*)queue_poll(parser);
 
-	if (!regex_ext_match_grp(str, "CREATE ([0-9]+) ([0-9]+) ([A-Za-z0-9_]*)", &reg_pars))
+	if (!regex_ext_match_grp(str, "CREATE ([0-9]+) ([0-9]+) (-?[0-9]+) ([A-Za-z0-9_]*)", &reg_pars))
 		goto err_regex;
 
 	node->if_not_exists = atoi((char*)stack_peek_pos(&reg_pars, 0));
 	count = atoi((char*)stack_peek_pos(&reg_pars, 1));
-	strncpy(node->table_name, (char*)stack_peek_pos(&reg_pars, 2), sizeof(node->table_name) - 1 /* NUL-char */);
+	node->block_size = atoi((char*)stack_peek_pos(&reg_pars, 2));
+	strncpy(node->table_name, (char*)stack_peek_pos(&reg_pars, 3), sizeof(node->table_name) - 1 /* NUL-char */);
 
 	for (int i = 0; i < count; i++) {
 		struct ast_crt_column_def_node *col = (struct ast_crt_column_def_node*)stack_pop(tmp_st);
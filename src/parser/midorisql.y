@@ -8,7 +8,7 @@
 #include <datastructure/queue.h>
 
 void yyerror(struct queue*, void*, const char *, ...);
-bool emit(struct queue *q, char *s, ...);
+bool emit(struct queue *q, char *s, ...) __attribute__((format(printf, 2, 3)));
 int yylex(void*, void*);
 %}
 
@@ -31,6 +31,7 @@ int yylex(void*, void*);
 
 %union {
 	int intval;
+	long long numval;
 	double floatval;
 	char *strval;
 	int subtok;
@@ -40,7 +41,7 @@ int yylex(void*, void*);
 
 %token <strval> NAME
 %token <strval> STRING
-%token <intval> INTNUM
+%token <numval> INTNUM
 %token <intval> BOOL
 %token <floatval> APPROXNUM
 
@@ -67,6 +68,8 @@ int yylex(void*, void*);
 %token ASC
 %token AUTO_INCREMENT
 %token BETWEEN
+%token BLOCK_SIZE
+%token BLOOM
 %token BY
 %token CASE
 %token CHAR
@@ -137,7 +140,7 @@ int yylex(void*, void*);
 
 %type <intval> insert_vals insert_vals_list opt_col_names
 %type <intval> opt_if_not_exists update_asgn_list
-%type <intval> column_atts data_type create_col_list
+%type <intval> column_atts data_type create_col_list opt_block_size
 
 %start stmt_list
 
@@ -250,7 +253,7 @@ join_condition:
 expr: NAME          { emit(result, "NAME %s", $1); free($1); }
    | NAME '.' NAME { emit(result, "FIELDNAME %s.%s", $1, $3); free($1); free($3); }
    | STRING        { emit(result, "STRING %s", $1); free($1); }
-   | INTNUM        { emit(result, "NUMBER %d", $1); }
+   | INTNUM        { emit(result, "NUMBER %lld", $1); }
    | APPROXNUM     { emit(result, "FLOAT %g", $1); }
    | BOOL          { emit(result, "BOOL %d", $1); }
    | NULLX         { emit(result, "NULL"); }
@@ -317,7 +320,7 @@ del_opt_where: /* nil */
 
 delete_expr: NAME          { emit(result, "NAME %s", $1); free($1); }
 	   | STRING        { emit(result, "STRING %s", $1); free($1); }
-	   | INTNUM        { emit(result, "NUMBER %d", $1); }
+	   | INTNUM        { emit(result, "NUMBER %lld", $1); }
 	   | APPROXNUM     { emit(result, "FLOAT %g", $1); }
    	   | BOOL          { emit(result, "BOOL %d", $1); }
    	   | NULLX         { emit(result, "NULL"); }
@@ -374,7 +377,7 @@ insert_stmt: INSERT opt_into NAME opt_col_names
 
 insert_expr:
      STRING        { emit(result, "STRING %s", $1); free($1); }
-   | INTNUM        { emit(result, "NUMBER %d", $1); }
+   | INTNUM        { emit(result, "NUMBER %lld", $1); }
    | APPROXNUM     { emit(result, "FLOAT %g", $1); }
    | BOOL          { emit(result, "BOOL %d", $1); }
    | NULLX         { emit(result, "NULL"); }
@@ -413,7 +416,7 @@ update_opt_where: /* nil */ 	{ $$ = 0; }
 
 update_expr: NAME          { emit(result, "NAME %s", $1); free($1); }
 	   | STRING        { emit(result, "STRING %s", $1); free($1); }
-	   | INTNUM        { emit(result, "NUMBER %d", $1); }
+	   | INTNUM        { emit(result, "NUMBER %lld", $1); }
 	   | APPROXNUM     { emit(result, "FLOAT %g", $1); }
    	   | BOOL          { emit(result, "BOOL %d", $1); }
    	   | NULLX         { emit(result, "NULL"); }
@@ -449,7 +452,14 @@ stmt: create_table_stmt { emit(result, "STMT"); }
    ;
 
 create_table_stmt: CREATE TABLE opt_if_not_exists NAME
-   '(' create_col_list ')' { emit(result, "CREATE %d %d %s", $3, $6, $4); free($4); }
+   '(' create_col_list ')' opt_block_size { emit(result, "CREATE %d %d %d %s", $3, $6, $8, $4); free($4); }
+   ;
+
+opt_block_size: /* nil */ { $$ = 0; }
+   | BLOCK_SIZE COMPARISON INTNUM
+       { if ($2 != 4) yyerror(result, scanner, "bad BLOCK_SIZE assignment");
+	 if ($3 < 0 || $3 > INT_MAX) yyerror(result, scanner, "BLOCK_SIZE out of range");
+	 $$ = $3; }
    ;
 
 
@@ -470,6 +480,7 @@ column_atts: /* nil */ { $$ = 0; }
     | column_atts AUTO_INCREMENT        { emit(result, "ATTR AUTOINC"); $$ = $1 + 1; }
     | column_atts UNIQUE 		{ emit(result, "ATTR UNIQUEKEY"); $$ = $1 + 1; }
     | column_atts PRIMARY KEY 		{ emit(result, "ATTR PRIKEY"); $$ = $1 + 1; }
+    | column_atts BLOOM 		{ emit(result, "ATTR BLOOM"); $$ = $1 + 1; }
     ;
 
 data_type:
@@ -479,7 +490,8 @@ data_type:
    | DOUBLE { $$ = 80000; }
    | DATE { $$ = 100000; }
    | DATETIME { $$ = 110000; }
-   | VARCHAR '(' INTNUM ')' { $$ = 130000 + $3; }
+   | VARCHAR '(' INTNUM ')' { if ($3 < 0 || $3 > INT_MAX - 130000) yyerror(result, scanner, "VARCHAR length out of range");
+			      $$ = 130000 + $3; }
    ;
 
 
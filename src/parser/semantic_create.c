@@ -31,6 +31,7 @@ bool semantic_analyse_create_stmt(struct database *db, struct ast_node *node, ch
 	struct list_head *pos1 = NULL;
 	struct list_head *pos2 = NULL;
 	struct ast_node *tmp_entry;
+	int pk_cols = 0;
 
 	if (!hashtable_init(&ht, &hashtable_str_compare, &hashtable_str_hash)) {
 		snprintf(out_err, out_err_len, "semantic phase: internal error\n");
@@ -49,6 +50,12 @@ bool semantic_analyse_create_stmt(struct database *db, struct ast_node *node, ch
 		goto err_table_dup;
 	}
 
+	if (create_node->block_size && (create_node->block_size < 0 || !datablock_size_valid((size_t)create_node->block_size))) {
+		snprintf(out_err, out_err_len, "BLOCK_SIZE must be a power of 2 from %d to %d: '%d'\n",
+				DATABLOCK_PAGE_SIZE, DATABLOCK_MAX_SIZE, create_node->block_size);
+		goto err_block_size;
+	}
+
 	/* validate columns */
 	list_for_each(pos1, create_node->node_children_head)
 	{
@@ -66,6 +73,15 @@ bool semantic_analyse_create_stmt(struct database *db, struct ast_node *node, ch
 				goto err_column_name;
 			}
 
+			pk_cols += coldef_node->attr_prim_key;
+
+			/* fixed-width columns are covered by zone maps already */
+			if (coldef_node->attr_bloom && coldef_node->type != CT_VARCHAR) {
+				snprintf(out_err, out_err_len, "BLOOM is only supported by VARCHAR columns: '%s'\n",
+						coldef_node->name);
+				goto err_bloom_col;
+			}
+
 			/*TODO maybe I should create a Set datastructure -
 			 * that would make this code easier on the eyes*/
 			if (!hashtable_put(&ht, coldef_node->name, strlen(coldef_node->name) + 1,
@@ -92,6 +108,9 @@ bool semantic_analyse_create_stmt(struct database *db, struct ast_node *node, ch
 		if (tmp_entry->node_type == AST_TYPE_CRT_INDEXDEF) {
 			idxdef_node = (struct ast_crt_index_def_node*)tmp_entry;
 
+			if (idxdef_node->is_pk)
+				pk_cols += list_length(idxdef_node->node_children_head);
+
 			list_for_each(pos2, idxdef_node->node_children_head)
 			{
 				idxcol_node = list_entry(pos2, typeof(*idxcol_node), head);
@@ -104,17 +123,26 @@ bool semantic_analyse_create_stmt(struct database *db, struct ast_node *node, ch
 		}
 	}
 
+	/* primary keys are enforced through a hash index on a single column, a composite one can't be */
+	if (pk_cols > 1) {
+		snprintf(out_err, out_err_len, "composite PRIMARY KEY is not supported\n");
+		goto err_composite_pk;
+	}
+
 	/* clean up */
 	hashtable_foreach(&ht, &free_str_entries, NULL);
 	hashtable_free(&ht);
 
 	return true;
 
+err_composite_pk:
 err_idx_pk_col:
 err_ht_put_col:
+err_bloom_col:
 err_column_name:
 err_dup_col_name:
 	hashtable_foreach(&ht, &free_str_entries, NULL);
+err_block_size:
 err_table_dup:
 err_table_name:
 	hashtable_free(&ht);
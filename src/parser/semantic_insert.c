@@ -533,11 +533,7 @@ bool semantic_analyse_insert_stmt(struct database *db, struct ast_node *node, ch
 	if (!validate_values(db, insvals_node, out_err, out_err_len))
 		return false;
 
-	/**
-	 * TODO list:
-	 * 	-> check if unique constraints are not violated (probably later when index management is in place)
-	 *
-	 */
+	/* unique constraints are checked by the executor against the UNIQUE / PRIMARY KEY hash indexes */
 
 	return true;
 }
@@ -0,0 +1,144 @@
+/*
+ * bloom.c
+ *
+ * Notes to myself:
+ * 	- filters of every BLOOM column of a datablock live in a single array, in column order. Their
+ * 		size depends on how many rows fit in a datablock so they're reallocated on rebuilds.
+ * 	- the BLOOM_HASHES bit positions are derived from a single 64-bit hash (double hashing), that
+ * 		way strings are only ever walked once.
+ *
+ *  Created on: 17/10/2026
+ *      Author: paulo
+ */
+
+#include <primitive/bloom.h>
+
+/* only VARCHAR values are hashed, zone maps cover the rest */
+static inline bool has_bloom(struct column *column)
+{
+	return column->bloom && column->type == CT_VARCHAR;
+}
+
+/* words of a single filter */
+static size_t bloom_words(struct table *table)
+{
+	size_t rows = table_block_size(table) / table_calc_row_size(table);
+
+	return (rows * BLOOM_BITS_PER_ROW + 63) / 64;
+}
+
+/* FNV-1a followed by a murmur3 finaliser so the upper bits are as good as the lower ones */
+static uint64_t bloom_hash(const char *str, size_t len)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+
+	for (size_t i = 0; i < len; i++) {
+		hash ^= (unsigned char)str[i];
+		hash *= 0x100000001b3ULL;
+	}
+
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdULL;
+	hash ^= hash >> 33;
+	hash *= 0xc4ceb9fe1a85ec53ULL;
+	hash ^= hash >> 33;
+
+	return hash;
+}
+
+/* filter of a column, NULL if it hasn't got one */
+static uint64_t* column_filter(struct table *table, struct datablock *blk, int col_idx)
+{
+	size_t nth = 0;
+
+	if (!blk->blooms || !has_bloom(&table->columns[col_idx]))
+		return NULL;
+
+	for (int i = 0; i < col_idx; i++)
+		nth += has_bloom(&table->columns[i]);
+
+	return &blk->blooms[nth * bloom_words(table)];
+}
+
+void table_bloom_add_row(struct table *table, struct datablock *blk, struct row *row)
+{
+	struct column *column;
+	uint64_t *filter = blk->blooms;
+	size_t words, nbits, offset = 0;
+	uint64_t hash, step;
+	char *str;
+
+	if (!filter)
+		return;
+
+	words = bloom_words(table);
+	nbits = words * 64;
+
+	for (int i = 0; i < table->column_count; i++) {
+		column = &table->columns[i];
+
+		if (!has_bloom(column)) {
+			offset += table_calc_column_space(column);
+			continue;
+		}
+
+		if (!bit_test(row->null_bitmap, i, sizeof(row->null_bitmap))) {
+			str = *(char**)&row->data[offset];
+			hash = bloom_hash(str, strnlen(str, column->precision));
+			step = (hash >> 32) | 1;
+
+			for (int k = 0; k < BLOOM_HASHES; k++, hash += step)
+				filter[(hash % nbits) / 64] |= 1ULL << (hash % nbits % 64);
+		}
+
+		filter += words;
+		offset += table_calc_column_space(column);
+	}
+}
+
+bool table_bloom_may_contain(struct table *table, struct datablock *blk, int col_idx, const char *key)
+{
+	uint64_t *filter = column_filter(table, blk, col_idx);
+	size_t nbits;
+	uint64_t hash, step;
+
+	if (!filter)
+		return true;
+
+	nbits = bloom_words(table) * 64;
+	hash = bloom_hash(key, strlen(key));
+	step = (hash >> 32) | 1;
+
+	for (int k = 0; k < BLOOM_HASHES; k++, hash += step) {
+		if (!(filter[(hash % nbits) / 64] & (1ULL << (hash % nbits % 64))))
+			return false;
+	}
+
+	return true;
+}
+
+void table_bloom_rebuild(struct table *table, struct datablock *blk)
+{
+	size_t row_size = table_calc_row_size(table);
+	size_t count = 0;
+	struct row *row;
+
+	free(blk->blooms);
+	blk->blooms = NULL;
+
+	for (int i = 0; i < table->column_count; i++)
+		count += has_bloom(&table->columns[i]);
+
+	if (!count || !(blk->blooms = calloc(count * bloom_words(table), sizeof(*blk->blooms))))
+		return;
+
+	for (size_t i = 0; i < table_block_size(table) / row_size; i++) {
+		row = (struct row*)&blk->data[i * row_size];
+
+		if (row->flags.empty)
+			break; /* end of the line */
+
+		if (!row->flags.deleted)
+			table_bloom_add_row(table, blk, row);
+	}
+}
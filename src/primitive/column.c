@@ -8,6 +8,10 @@
 #include <primitive/table.h>
 #include <primitive/column.h>
 #include <primitive/row.h>
+#include <primitive/index.h>
+#include <primitive/zonemap.h>
+#include <primitive/bloom.h>
+#include <primitive/freespace.h>
 
 static inline bool __valid_name(char *name, size_t max_size)
 {
@@ -32,11 +36,33 @@ bool table_validate_column_name(char *name)
 	return __valid_name(name, TABLE_MAX_COLUMN_NAME);
 }
 
+/* zone maps, Bloom filters and free-slot bitmaps of every datablock */
+static void table_summaries_rebuild(struct table *table)
+{
+	struct list_head *pos;
+	struct datablock *entry;
+
+	/* rows have changed size (or datablocks are gone), a vacuum pass under way has to start over */
+	memzero(&table->vacuum, sizeof(table->vacuum));
+
+	list_for_each(pos, table->datablock_head)
+	{
+		entry = list_entry(pos, typeof(*entry), head);
+		table_zone_rebuild(table, entry);
+		table_bloom_rebuild(table, entry);
+		table_free_space_rebuild(table, entry);
+	}
+}
+
 static bool datablock_add_column(struct table *table, size_t row_cur_size, size_t row_nxt_size)
 {
 	struct list_head *old_head, *new_head;
 	struct list_head *old_pos, *new_pos, *tmp_pos;
 	struct datablock *old_entry, *new_entry;
+	struct block_dir new_blocks;
+	/* pairs of struct row_location: where live rows were, where they are now */
+	struct vector moves;
+	struct row_location *moved;
 	size_t blk_offset;
 
 	/* sanity checks */
@@ -53,12 +79,16 @@ static bool datablock_add_column(struct table *table, size_t row_cur_size, size_
 	if (!new_head)
 		goto err;
 
+	if (!vector_init(&moves))
+		goto err_moves;
+
+	block_dir_init(&new_blocks);
+
 	list_for_each(old_pos, old_head)
 	{
 		old_entry = list_entry(old_pos, typeof(*old_entry), head);
 
-		// TODO when moving rows to different blocks, we have to update indexes to point to those
-		for (size_t i = 0; i < (DATABLOCK_PAGE_SIZE / row_cur_size); i++) {
+		for (size_t i = 0; i < (table_block_size(table) / row_cur_size); i++) {
 			struct row *row = (struct row*)&old_entry->data[i * row_cur_size];
 
 			/* are we done yet ? */
@@ -66,40 +96,69 @@ static bool datablock_add_column(struct table *table, size_t row_cur_size, size_
 				break;
 
 			/* is new datablock head empty? can it fit into current data block? */
-			if (!new_entry || (blk_offset + row_nxt_size) >= DATABLOCK_PAGE_SIZE) {
-				new_entry = datablock_alloc(new_head);
+			if (!new_entry || (blk_offset + row_nxt_size) >= table_block_size(table)) {
+				new_entry = datablock_alloc(&table->arena, new_head);
 
 				if (!new_entry)
 					goto err_free;
 
-				table_datablock_init(new_entry, 0, row_nxt_size);
+				if (!block_dir_push(&new_blocks, new_entry))
+					goto err_free;
+
+				table_datablock_init(table, new_entry, 0, row_nxt_size);
 				blk_offset = 0;
 			}
 
 			/* copy row into new datablock */
 			memcpy(&new_entry->data[blk_offset], row, row_cur_size);
+
+			if (!row->flags.deleted) {
+				struct row_location move[] = {
+					{.blk = old_entry, .offset = i * row_cur_size},
+					{.blk = new_entry, .offset = blk_offset}
+				};
+
+				if (!vector_push(&moves, move, sizeof(move)))
+					goto err_free;
+			}
+
 			blk_offset += row_nxt_size;
 		}
 	}
 
+	/*
+	 * every row made it, indexes can follow them now. New datablocks come after old ones so rows
+	 * are moved last to first, that way none of them is moved past one that hasn't been yet
+	 */
+	moved = (struct row_location*)moves.data;
+	for (size_t i = moves.len / sizeof(*moved); i > 0; i -= 2)
+		table_index_move_row(table, moved[i - 2].blk, moved[i - 2].offset, moved[i - 1].blk, moved[i - 1].offset);
+
+	vector_free(&moves);
+
 	/* change table's datablock head */
 	table->datablock_head = new_head;
+	block_dir_free(&table->blocks);
+	table->blocks = new_blocks;
 	table->free_dtbkl_offset = blk_offset;
 
 	/* free old head / old data block */
 	list_for_each_safe(old_pos, tmp_pos, old_head)
 	{
-		datablock_free(list_entry(old_pos, typeof(*old_entry), head));
+		datablock_free(&table->arena, list_entry(old_pos, typeof(*old_entry), head));
 	}
 	free(old_head);
 
 	return true;
 
 err_free:
+	vector_free(&moves);
+	block_dir_free(&new_blocks);
 	list_for_each_safe(new_pos, tmp_pos, new_head)
 	{
-		datablock_free(list_entry(new_pos, typeof(*new_entry), head));
+		datablock_free(&table->arena, list_entry(new_pos, typeof(*new_entry), head));
 	}
+err_moves:
 	free(new_head);
 
 err:
@@ -134,13 +193,27 @@ bool table_add_column(struct table *table, struct column *column)
 	memcpy(&table->columns[table->column_count], column, sizeof(*column));
 	table->column_count++;
 
+	/* datablocks follow the row width until the table gets its first one */
+	if (!table->fixed_block_size && list_is_empty(table->datablock_head) && !table_set_block_size(table, 0))
+		goto err_too_wide;
+
+	/* rows have to fit into datablocks */
+	if (table_calc_row_size(table) >= table_block_size(table))
+		goto err_too_wide;
+
 	/* if table isn't empty than we can to rearrange rows in datablocks */
 	if (!list_is_empty(table->datablock_head)) {
 		if (!datablock_add_column(table, row_cur_size, table_calc_row_size(table)))
 			return false;
+
+		table_summaries_rebuild(table);
 	}
 
 	return true;
+
+err_too_wide:
+	table->column_count--;
+	return false;
 }
 
 static void datablock_rem_column(struct table *table, size_t col_idx)
@@ -172,14 +245,17 @@ static void datablock_rem_column(struct table *table, size_t col_idx)
 		entry = list_entry(pos, typeof(*entry), head);
 		blk_offset = 0;
 
-		// TODO we _may_ have to update indexes to point when making these changes
-		for (size_t i = 0; i < (DATABLOCK_PAGE_SIZE / row_cur_size); i++) {
+		for (size_t i = 0; i < (table_block_size(table) / row_cur_size); i++) {
 			row = (struct row*)&entry->data[i * row_cur_size];
 
 			/* are we done yet? */
 			if (row->flags.empty)
 				break;
 
+			/* rows only move towards the start of their datablock, indexes can just follow */
+			if (!row->flags.deleted)
+				table_index_move_row(table, entry, i * row_cur_size, entry, blk_offset);
+
 			/* if that held a var precision column, we need to free it */
 			if (table_check_var_column(column)) {
 				void **var_ptr = (void**)&row->data[data_offset];
@@ -187,6 +263,15 @@ static void datablock_rem_column(struct table *table, size_t col_idx)
 				memzero(var_ptr, sizeof(*var_ptr));
 			}
 
+			/* columns on the right move one position to the left */
+			for (size_t j = col_idx; j < (size_t)table->column_count - 1; j++) {
+				if (bit_test(row->null_bitmap, j + 1, sizeof(row->null_bitmap)))
+					bit_set(row->null_bitmap, j, sizeof(row->null_bitmap));
+				else
+					bit_clear(row->null_bitmap, j, sizeof(row->null_bitmap));
+			}
+			bit_clear(row->null_bitmap, table->column_count - 1, sizeof(row->null_bitmap));
+
 			/* remove column data */
 			memmove(&row->data[data_offset],
 				&row->data[data_offset + col_prec],
@@ -198,8 +283,8 @@ static void datablock_rem_column(struct table *table, size_t col_idx)
 		}
 
 		/* make it easier for the vacuum process */
-		memzero(&entry->data[blk_offset], sizeof(entry->data) - blk_offset);
-		for (size_t i = blk_offset / row_new_size; i < (DATABLOCK_PAGE_SIZE / row_new_size); i++) {
+		memzero(&entry->data[blk_offset], table_block_size(table) - blk_offset);
+		for (size_t i = blk_offset / row_new_size; i < (table_block_size(table) / row_new_size); i++) {
 			row = (struct row*)&entry->data[i * row_new_size];
 			row->flags.deleted = false;
 			row->flags.empty = true;
@@ -229,6 +314,8 @@ bool table_rem_column(struct table *table, struct column *column)
 	if (!found)
 		return false;
 
+	table_index_destroy(table, pos);
+
 	/* if table isn't empty than we can to rearrange rows in datablocks */
 	if (!list_is_empty(table->datablock_head))
 		datablock_rem_column(table, pos);
@@ -237,8 +324,21 @@ bool table_rem_column(struct table *table, struct column *column)
 		&table->columns[pos + 1],
 		(TABLE_MAX_COLUMNS - (pos + 1)) * sizeof(struct column));
 
+	memmove(&table->indexes[pos],
+		&table->indexes[pos + 1],
+		(TABLE_MAX_COLUMNS - (pos + 1)) * sizeof(*table->indexes));
+	table->indexes[TABLE_MAX_COLUMNS - 1] = NULL;
+
 	table->column_count--;
 
+	/* columns on the right of the one removed have been shifted */
+	table_index_remap_columns(table);
+	table_summaries_rebuild(table);
+
+	/* narrower rows may do with smaller datablocks, can't fail as they fit in bigger ones already */
+	if (!table->fixed_block_size && list_is_empty(table->datablock_head))
+		table_set_block_size(table, 0);
+
 	return true;
 }
 
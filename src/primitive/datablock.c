@@ -1,6 +1,30 @@
+/*
+ * datablock.c
+ *
+ * Notes to myself:
+ * 	- datablock headers live in a malloc'ed array next to the region rather than in front of their
+ * 		data, otherwise a 1MB datablock would take a whole 2MB region and a 512KB one a third of it.
+ * 		Datablocks keep a pointer back to their region instead.
+ * 	- mmap won't align anything past a page so twice the size is mapped and whatever sticks out
+ * 		on either side is unmapped right away.
+ * 	- freed datablocks are reused last in first out, they're more likely to still be cached.
+ * 	- block ids are handed out by the arena on every alloc, reused datablocks included. They must
+ * 		keep growing along the table list, and the table lock already covers its arena. They start
+ * 		over when the arena is reset, by then no datablock of the table is left to compare against.
+ * 	- datablocks are as big as their arena says, regions are sized to hold at least one of them
+ * 		and their data is aligned to the region size, so every datablock is aligned to its own.
+ * 	- block directories grow twice as big whenever they run out of room and never shrink, a
+ * 		table that shrunk is likely to grow back.
+ *
+ *  Created on: 17/10/2026
+ *      Author: paulo
+ */
+
 #include <primitive/datablock.h>
+#include <sys/mman.h>
 
-static uint64_t block_id_acc;
+BUILD_BUG(IS_POWER_OF_2(DATABLOCK_REGION_SIZE), "DATABLOCK_REGION_SIZE must be a power of 2");
+BUILD_BUG(DATABLOCK_REGION_SIZE >= DATABLOCK_PAGE_SIZE, "DATABLOCK_REGION_SIZE must fit at least a datablock");
 
 struct list_head* datablock_init(void)
 {
@@ -11,19 +35,196 @@ struct list_head* datablock_init(void)
 	return ret;
 }
 
-struct datablock* datablock_alloc(struct list_head *head)
+void block_dir_init(struct block_dir *dir)
+{
+	dir->blocks = NULL;
+	dir->len = 0;
+	dir->cap = 0;
+}
+
+void block_dir_free(struct block_dir *dir)
+{
+	free(dir->blocks);
+	block_dir_init(dir);
+}
+
+bool block_dir_push(struct block_dir *dir, struct datablock *block)
+{
+	struct datablock **blocks;
+	size_t cap;
+
+	if (dir->len == dir->cap) {
+		cap = dir->cap ? dir->cap * 2 : 16;
+
+		if (!(blocks = realloc(dir->blocks, cap * sizeof(*blocks))))
+			return false;
+
+		dir->blocks = blocks;
+		dir->cap = cap;
+	}
+
+	dir->blocks[dir->len++] = block;
+	return true;
+}
+
+void block_dir_del(struct block_dir *dir, size_t pos)
+{
+	/* sanity check */
+	BUG_ON(pos >= dir->len);
+
+	memmove(&dir->blocks[pos], &dir->blocks[pos + 1], (dir->len - pos - 1) * sizeof(*dir->blocks));
+	dir->len--;
+}
+
+size_t block_dir_find(const struct block_dir *dir, size_t from, uint64_t block_id)
 {
-	struct datablock *new = NULL;
-	if ((new = malloc(sizeof(*new)))) {
-		new->block_id = block_id_acc++;
-		list_head_init(&new->head);
-		list_add(&new->head, head->prev);
+	size_t lo = from, hi = dir->len, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+
+		if (dir->blocks[mid]->block_id < block_id)
+			lo = mid + 1;
+		else
+			hi = mid;
 	}
+
+	return lo < dir->len && dir->blocks[lo]->block_id == block_id ? lo : dir->len;
+}
+
+bool datablock_size_valid(size_t size)
+{
+	return size >= DATABLOCK_PAGE_SIZE && size <= DATABLOCK_MAX_SIZE && IS_POWER_OF_2(size);
+}
+
+static struct datablock_region* region_map(struct datablock_arena *arena)
+{
+	struct datablock_region *region;
+	size_t size = arena->region_size;
+	uintptr_t addr, aligned;
+	char *ptr;
+
+	if (!(region = malloc(struct_size(region, blocks, arena->region_blocks))))
+		return NULL;
+
+	ptr = mmap(NULL, 2 * size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (ptr == MAP_FAILED) {
+		free(region);
+		return NULL;
+	}
+
+	addr = (uintptr_t)ptr;
+	aligned = (addr + size - 1) & ~((uintptr_t)size - 1);
+
+	if (aligned != addr)
+		munmap(ptr, aligned - addr);
+
+	munmap((char*)aligned + size, addr + size - aligned);
+
+#ifdef MADV_HUGEPAGE
+	/* just a hint, regular pages do if the system won't have it */
+	madvise((void*)aligned, size, MADV_HUGEPAGE);
+#endif
+
+	region->data = (char*)aligned;
+	region->carved = 0;
+	region->used = 0;
+	list_add(&region->head, arena->regions.prev);
+
+	return region;
+}
+
+static void region_unmap(struct datablock_arena *arena, struct datablock_region *region)
+{
+	/* every datablock is on the free list */
+	for (size_t i = 0; i < region->carved; i++)
+		list_del(&region->blocks[i].head);
+
+	list_del(&region->head);
+	munmap(region->data, arena->region_size);
+	free(region);
+}
+
+void datablock_arena_init(struct datablock_arena *arena, size_t block_size)
+{
+	/* sanity check */
+	BUG_ON(!datablock_size_valid(block_size));
+
+	list_head_init(&arena->regions);
+	list_head_init(&arena->free_list);
+
+	arena->block_size = block_size;
+	/* both are powers of 2, the larger one is a multiple of the other */
+	arena->region_size = MAX((size_t)DATABLOCK_REGION_SIZE, block_size);
+	arena->region_blocks = arena->region_size / block_size;
+	arena->next_block_id = 0;
+}
+
+void datablock_arena_destroy(struct datablock_arena *arena)
+{
+	struct datablock_region *region;
+	struct list_head *pos, *tmp_pos;
+
+	list_for_each_safe(pos, tmp_pos, &arena->regions)
+	{
+		region = list_entry(pos, typeof(*region), head);
+		munmap(region->data, arena->region_size);
+		free(region);
+	}
+
+	datablock_arena_init(arena, arena->block_size);
+}
+
+struct datablock* datablock_alloc(struct datablock_arena *arena, struct list_head *head)
+{
+	struct datablock_region *region = NULL;
+	struct datablock *new;
+
+	if (!list_is_empty(&arena->free_list)) {
+		new = list_entry(arena->free_list.next, typeof(*new), head);
+		list_del(&new->head);
+	} else {
+		if (!list_is_empty(&arena->regions))
+			region = list_entry(arena->regions.prev, typeof(*region), head);
+
+		if ((!region || region->carved == arena->region_blocks) && !(region = region_map(arena)))
+			return NULL;
+
+		new = &region->blocks[region->carved];
+		new->region = region;
+		new->data = &region->data[region->carved++ * arena->block_size];
+	}
+
+	new->region->used++;
+
+	new->block_id = arena->next_block_id++;
+	new->zones = NULL;
+	new->blooms = NULL;
+	new->free_slots = NULL;
+	new->free_count = 0;
+	list_head_init(&new->free_link);
+	list_head_init(&new->head);
+	list_add(&new->head, head->prev);
+
 	return new;
 }
 
-void datablock_free(struct datablock *block)
+void datablock_free(struct datablock_arena *arena, struct datablock *block)
 {
+	struct datablock_region *region = block->region;
+
 	list_del(&block->head);
-	free(block);
+	free(block->zones);
+	free(block->blooms);
+	free(block->free_slots);
+
+	if (block->free_count)
+		list_del(&block->free_link);
+
+	list_add(&block->head, &arena->free_list);
+
+	/* the last region is kept around, tables shrinking down to nothing are likely to grow again */
+	if (!--region->used && region->head.next != &arena->regions)
+		region_unmap(arena, region);
 }
@@ -0,0 +1,118 @@
+/*
+ * freespace.c
+ *
+ * Notes to myself:
+ * 	- bitmaps are sized to the number of row slots at the time they're allocated. Column changes
+ * 		change the row size so they rebuild every datablock anyway.
+ * 	- a datablock sits in the free-space map if and only if its free_count isn't 0.
+ *
+ *  Created on: 17/10/2026
+ *      Author: paulo
+ */
+
+#include <primitive/freespace.h>
+#include <primitive/row.h>
+
+#define SLOT_WORDS(slots)	(((slots) + 63) / 64)
+
+/* keep the free-space map in table order, datablocks mostly get holes at the end of the table */
+static void free_space_link(struct table *table, struct datablock *blk)
+{
+	struct list_head *pos;
+	struct datablock *entry;
+
+	for (pos = table->free_space.prev; pos != &table->free_space; pos = pos->prev) {
+		entry = list_entry(pos, typeof(*entry), free_link);
+		if (entry->block_id < blk->block_id)
+			break;
+	}
+
+	list_add(&blk->free_link, pos);
+}
+
+static void free_space_unlink(struct datablock *blk)
+{
+	list_del(&blk->free_link);
+	list_head_init(&blk->free_link);
+}
+
+void table_free_space_rebuild(struct table *table, struct datablock *blk)
+{
+	size_t row_size = table_calc_row_size(table);
+	size_t slots = table_block_size(table) / row_size;
+	struct row *row;
+
+	if (blk->free_count)
+		free_space_unlink(blk);
+
+	free(blk->free_slots);
+	blk->free_slots = NULL;
+	blk->free_count = 0;
+
+	for (size_t i = 0; i < slots; i++) {
+		row = (struct row*)&blk->data[i * row_size];
+
+		if (row->flags.empty)
+			break;
+
+		if (row->flags.deleted)
+			table_free_slot_add(table, blk, i * row_size);
+	}
+}
+
+void table_free_slot_add(struct table *table, struct datablock *blk, size_t offset)
+{
+	size_t row_size = table_calc_row_size(table);
+	size_t slot = offset / row_size;
+
+	if (!blk->free_slots) {
+		blk->free_slots = calloc(SLOT_WORDS(table_block_size(table) / row_size), sizeof(*blk->free_slots));
+
+		if (!blk->free_slots)
+			return;
+	}
+
+	blk->free_slots[slot / 64] |= (uint64_t)1 << (slot % 64);
+
+	if (!blk->free_count++)
+		free_space_link(table, blk);
+}
+
+void table_free_slot_del(struct table *table, struct datablock *blk, size_t offset)
+{
+	size_t slot = offset / table_calc_row_size(table);
+	uint64_t bit = (uint64_t)1 << (slot % 64);
+
+	if (!blk->free_slots || !(blk->free_slots[slot / 64] & bit))
+		return;
+
+	blk->free_slots[slot / 64] &= ~bit;
+
+	if (!--blk->free_count)
+		free_space_unlink(blk);
+}
+
+bool table_free_slot_take(struct table *table, struct datablock **blk, size_t *offset)
+{
+	struct datablock *entry;
+	size_t word = 0;
+
+	if (list_is_empty(&table->free_space))
+		return false;
+
+	entry = list_entry(table->free_space.next, typeof(*entry), free_link);
+
+	while (!entry->free_slots[word])
+		word++;
+
+	*blk = entry;
+	*offset = (word * 64 + __builtin_ctzll(entry->free_slots[word])) * table_calc_row_size(table);
+
+	/* clear lowest bit set */
+	entry->free_slots[word] &= entry->free_slots[word] - 1;
+
+	if (!--entry->free_count)
+		free_space_unlink(entry);
+
+	return true;
+}
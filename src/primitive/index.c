@@ -0,0 +1,1187 @@
+/*
+ * index.c
+ *
+ * Notes to myself:
+ * 	- B+tree keys must be unique so every key maps to the list of rows holding it.
+ * 	- the B+tree references keys rather than copying them, entries are freed only after they've
+ * 		been removed from the tree.
+ * 	- INTEGER/DATE/DATETIME columns get the integer-key B+tree instead (keys inline, SIMD search),
+ * 		the tree_* helpers hide which one an index is using.
+ * 	- keys are copied into the entry itself, that way they don't depend on the rows (or their
+ * 		VARCHAR buffers) staying where they are.
+ * 	- indexes on existing rows are bulk built: (key, row) pairs are merge sorted (runs in parallel
+ * 		when there's a pool and enough rows), grouped into entries and handed to the tree in one go.
+ * 		Ties are broken by storage order so every entry's rows end up in storage order as well.
+ * 	- the rows of every entry are kept in storage order (lookups return them as they are). Vacuum
+ * 		and column changes compact rows towards the start of the table without reordering them, so
+ * 		each move just swaps a location in place (found by binary search) and indexes never have to
+ * 		be rebuilt.
+ * 	- hash indexes don't need any of that, values are unique so each key maps to a single row
+ * 		and the hashtable keeps its own copy of keys.
+ * 	- bitmap indexes hold row ids (block id, offset) rather than locations so NULLs get a bitmap of
+ * 		their own and moves are just a remove and an add. Adds may need memory though: if a move
+ * 		can't be recorded the index is flagged as stale and lookups go back to scanning.
+ *
+ *  Created on: 17/10/2026
+ *      Author: paulo
+ */
+
+#include <primitive/index.h>
+#include <primitive/column.h>
+#include <datastructure/btree.h>
+#include <engine/worker.h>
+
+struct index_entry {
+	/* struct row_location */
+	struct vector locs;
+	/* column value (B+tree key) */
+	__x86_64_align char key[];
+};
+
+static int cmp_int64(void *key1, void *key2)
+{
+	int64_t val_1 = *(int64_t*)key1;
+	int64_t val_2 = *(int64_t*)key2;
+
+	return (val_1 > val_2) - (val_1 < val_2);
+}
+
+static int cmp_double(void *key1, void *key2)
+{
+	double val_1 = *(double*)key1;
+	double val_2 = *(double*)key2;
+
+	return (val_1 > val_2) - (val_1 < val_2);
+}
+
+static int cmp_bool(void *key1, void *key2)
+{
+	return (int)*(bool*)key1 - (int)*(bool*)key2;
+}
+
+static int (*get_cmp_fn(struct column *column))(void*, void*)
+{
+	switch (column->type) {
+	case CT_INTEGER:
+	case CT_DATE:
+	case CT_DATETIME:
+		return &cmp_int64;
+	case CT_DOUBLE:
+		return &cmp_double;
+	case CT_TINYINT:
+		return &cmp_bool;
+	case CT_VARCHAR:
+		return &btree_cmp_str;
+	default:
+		/* something went really wrong here */
+		BUG_GENERIC();
+		return NULL;
+	}
+}
+
+static bool has_int_keys(struct column *column)
+{
+	return column->type == CT_INTEGER || column->type == CT_DATE || column->type == CT_DATETIME;
+}
+
+struct tree_cursor {
+	struct index *index;
+	union {
+		struct bptree_cursor cur;
+		struct bptree_i64_cursor icur;
+	};
+};
+
+static int tree_cmp(struct index *index, void *key1, void *key2)
+{
+	if (index->int_keys)
+		return cmp_int64(key1, key2);
+
+	return index->tree->cmp_fn(key1, key2);
+}
+
+static struct index_entry* tree_lookup(struct index *index, void *key)
+{
+	if (index->int_keys)
+		return bptree_i64_lookup(index->itree, *(int64_t*)key);
+
+	return bptree_lookup(index->tree, key);
+}
+
+static int tree_insert(struct index *index, struct index_entry *entry)
+{
+	if (index->int_keys)
+		return bptree_i64_insert(index->itree, *(int64_t*)entry->key, entry);
+
+	return bptree_insert(index->tree, entry->key, entry);
+}
+
+static bool tree_remove(struct index *index, struct index_entry *entry)
+{
+	if (index->int_keys)
+		return bptree_i64_remove(index->itree, *(int64_t*)entry->key);
+
+	return bptree_remove(index->tree, entry->key);
+}
+
+/*
+ * points cursor to the first key >= @key (last key <= @key if @desc is set), the first (last) one
+ * if @key is NULL
+ */
+static bool tree_seek(struct tree_cursor *cur, struct index *index, void *key, bool desc)
+{
+	cur->index = index;
+
+	if (index->int_keys && desc)
+		return bptree_i64_seek_le(index->itree, &cur->icur, key ? *(int64_t*)key : INT64_MAX);
+	else if (index->int_keys)
+		return bptree_i64_seek_ge(index->itree, &cur->icur, key ? *(int64_t*)key : INT64_MIN);
+	else if (desc)
+		return bptree_seek_le(index->tree, &cur->cur, key);
+
+	return bptree_seek_ge(index->tree, &cur->cur, key);
+}
+
+static bool tree_step(struct tree_cursor *cur, bool desc)
+{
+	if (cur->index->int_keys)
+		return desc ? bptree_i64_prev(&cur->icur) : bptree_i64_next(&cur->icur);
+
+	return desc ? bptree_prev(&cur->cur) : bptree_next(&cur->cur);
+}
+
+static struct index_entry* tree_cursor_entry(struct tree_cursor *cur)
+{
+	if (cur->index->int_keys)
+		return bptree_i64_cursor_value(&cur->icur);
+
+	return bptree_cursor_value(&cur->cur);
+}
+
+static void* row_key(struct table *table, struct index *index, struct row *row)
+{
+	/* NULLs aren't indexed */
+	if (bit_test(row->null_bitmap, index->col_idx, sizeof(row->null_bitmap)))
+		return NULL;
+
+	if (table_check_var_column(&table->columns[index->col_idx]))
+		return *(char**)&row->data[index->col_offset];
+
+	return &row->data[index->col_offset];
+}
+
+/* index of the first location of an entry that isn't before @loc in storage order */
+static size_t locs_lower_bound(struct index_entry *entry, struct row_location *loc)
+{
+	struct row_location *locs = (struct row_location*)entry->locs.data;
+	size_t lo = 0, hi = entry->locs.len / sizeof(*locs), mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+
+		if (row_location_cmp(&locs[mid], loc) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/* index of @loc within an entry, BUG()s if it isn't there */
+static size_t locs_find(struct index_entry *entry, struct row_location *loc)
+{
+	struct row_location *locs = (struct row_location*)entry->locs.data;
+	size_t idx = locs_lower_bound(entry, loc);
+
+	/* something went terribly wrong here if this is true */
+	BUG_ON(idx == entry->locs.len / sizeof(*locs) || row_location_cmp(&locs[idx], loc));
+
+	return idx;
+}
+
+static bool locs_insert(struct index_entry *entry, struct row_location *loc)
+{
+	struct row_location *locs;
+	size_t idx = locs_lower_bound(entry, loc);
+	size_t count = entry->locs.len / sizeof(*locs);
+
+	/* rows are mostly inserted at the end of the table */
+	if (!vector_push(&entry->locs, loc, sizeof(*loc)))
+		return false;
+
+	if (idx == count)
+		return true;
+
+	locs = (struct row_location*)entry->locs.data;
+	memmove(&locs[idx + 1], &locs[idx], (count - idx) * sizeof(*locs));
+	locs[idx] = *loc;
+
+	return true;
+}
+
+static struct index_entry* index_entry_new(struct table *table, struct index *index, void *key)
+{
+	struct index_entry *entry;
+	size_t key_size = table->columns[index->col_idx].precision;
+
+	if (!(entry = zalloc(struct_size(entry, key, key_size))))
+		return NULL;
+
+	memcpy(entry->key, key, key_size);
+
+	if (!vector_init(&entry->locs)) {
+		free(entry);
+		return NULL;
+	}
+
+	return entry;
+}
+
+static void index_entry_free(struct index_entry *entry)
+{
+	vector_free(&entry->locs);
+	free(entry);
+}
+
+static bool btree_index_add(struct table *table, struct index *index, struct row_location *loc)
+{
+	struct row *row = (struct row*)&loc->blk->data[loc->offset];
+	struct index_entry *entry;
+	void *key;
+
+	if (!(key = row_key(table, index, row)))
+		return true;
+
+	if ((entry = tree_lookup(index, key)))
+		return locs_insert(entry, loc);
+
+	if (!(entry = index_entry_new(table, index, key)))
+		return false;
+
+	if (!vector_push(&entry->locs, loc, sizeof(*loc)))
+		goto err;
+
+	if (tree_insert(index, entry))
+		goto err;
+
+	return true;
+
+err:
+	index_entry_free(entry);
+	return false;
+}
+
+static bool btree_index_del(struct table *table, struct index *index, struct row_location *loc)
+{
+	struct row *row = (struct row*)&loc->blk->data[loc->offset];
+	struct index_entry *entry;
+	struct row_location *locs;
+	size_t count, idx;
+	void *key;
+
+	if (!(key = row_key(table, index, row)))
+		return true;
+
+	/* something went terribly wrong here if this is true */
+	BUG_ON(!(entry = tree_lookup(index, key)));
+
+	locs = (struct row_location*)entry->locs.data;
+	count = entry->locs.len / sizeof(*locs);
+	idx = locs_find(entry, loc);
+
+	memmove(&locs[idx], &locs[idx + 1], (count - idx - 1) * sizeof(*locs));
+	entry->locs.len -= sizeof(*locs);
+
+	if (entry->locs.len)
+		return true;
+
+	/* leave the entry as it was, the location is still there past the end */
+	if (!tree_remove(index, entry)) {
+		entry->locs.len += sizeof(*locs);
+		return false;
+	}
+
+	index_entry_free(entry);
+
+	return true;
+}
+
+static void* hash_key(struct column *column, void *key, double *tmp_dbl, size_t *key_len)
+{
+	if (table_check_var_column(column)) {
+		*key_len = strlen(key) + 1;
+		return key;
+	}
+
+	if (column->type == CT_DOUBLE) {
+		/* -0.0 == 0.0 so both have to land on the same bucket */
+		*tmp_dbl = *(double*)key + 0.0;
+		*key_len = sizeof(*tmp_dbl);
+		return tmp_dbl;
+	}
+
+	*key_len = column->precision;
+	return key;
+}
+
+static bool hash_index_add(struct table *table, struct index *index, struct row_location *loc)
+{
+	struct row *row = (struct row*)&loc->blk->data[loc->offset];
+	size_t key_len;
+	double tmp_dbl;
+	void *key;
+
+	if (!(key = row_key(table, index, row)))
+		return true;
+
+	key = hash_key(&table->columns[index->col_idx], key, &tmp_dbl, &key_len);
+
+	/* fails for duplicates too, callers are meant to check for them beforehand */
+	return hashtable_put(index->hash, key, key_len, loc, sizeof(*loc));
+}
+
+static bool hash_index_del(struct table *table, struct index *index, struct row_location *loc)
+{
+	struct row *row = (struct row*)&loc->blk->data[loc->offset];
+	struct hashtable_entry *entry;
+	size_t key_len;
+	double tmp_dbl;
+	void *key;
+
+	if (!(key = row_key(table, index, row)))
+		return true;
+
+	key = hash_key(&table->columns[index->col_idx], key, &tmp_dbl, &key_len);
+
+	/* something went terribly wrong here if this is true */
+	BUG_ON(!(entry = hashtable_remove(index->hash, key, key_len)));
+
+	hashtable_free_entry(entry);
+
+	return true;
+}
+
+/* bitmap a row belongs to */
+static struct roaring* row_bitmap(struct index *index, struct row_location *loc)
+{
+	struct row *row = (struct row*)&loc->blk->data[loc->offset];
+
+	if (bit_test(row->null_bitmap, index->col_idx, sizeof(row->null_bitmap)))
+		return &index->bitmaps[INDEX_BITMAP_NULL];
+
+	return &index->bitmaps[*(bool*)&row->data[index->col_offset]];
+}
+
+static bool bitmap_index_add(struct index *index, struct row_location *loc)
+{
+	if (index->is_stale)
+		return true;
+
+	return roaring_add(row_bitmap(index, loc), table_index_row_id(loc));
+}
+
+static bool bitmap_index_del(struct index *index, struct row_location *loc)
+{
+	if (index->is_stale)
+		return true;
+
+	/* something went terribly wrong here if this is true */
+	BUG_ON(!roaring_remove(row_bitmap(index, loc), table_index_row_id(loc)));
+
+	return true;
+}
+
+static bool index_add(struct table *table, struct index *index, struct row_location *loc)
+{
+	if (index->type == IT_HASH)
+		return hash_index_add(table, index, loc);
+	else if (index->type == IT_BITMAP)
+		return bitmap_index_add(index, loc);
+
+	return btree_index_add(table, index, loc);
+}
+
+static bool index_del(struct table *table, struct index *index, struct row_location *loc)
+{
+	if (index->type == IT_HASH)
+		return hash_index_del(table, index, loc);
+	else if (index->type == IT_BITMAP)
+		return bitmap_index_del(index, loc);
+
+	return btree_index_del(table, index, loc);
+}
+
+static void btree_index_move(struct table *table, struct index *index, struct row_location *from,
+		struct row_location *to)
+{
+	struct row *row = (struct row*)&from->blk->data[from->offset];
+	struct index_entry *entry;
+	void *key;
+
+	if (!(key = row_key(table, index, row)))
+		return;
+
+	/* something went terribly wrong here if this is true */
+	BUG_ON(!(entry = tree_lookup(index, key)));
+
+	/* rows keep their relative order so the location can be swapped in place */
+	((struct row_location*)entry->locs.data)[locs_find(entry, from)] = *to;
+}
+
+static void hash_index_move(struct table *table, struct index *index, struct row_location *from,
+		struct row_location *to)
+{
+	struct row *row = (struct row*)&from->blk->data[from->offset];
+	struct hashtable_value *value;
+	size_t key_len;
+	double tmp_dbl;
+	void *key;
+
+	if (!(key = row_key(table, index, row)))
+		return;
+
+	key = hash_key(&table->columns[index->col_idx], key, &tmp_dbl, &key_len);
+
+	/* something went terribly wrong here if this is true */
+	BUG_ON(!(value = hashtable_get(index->hash, key, key_len)));
+
+	memcpy(value->content, to, sizeof(*to));
+}
+
+static void bitmap_index_move(struct index *index, struct row_location *from, struct row_location *to)
+{
+	struct roaring *bitmap;
+
+	if (index->is_stale)
+		return;
+
+	bitmap = row_bitmap(index, from);
+
+	/* something went terribly wrong here if this is true */
+	BUG_ON(!roaring_remove(bitmap, table_index_row_id(from)));
+
+	if (roaring_add(bitmap, table_index_row_id(to)))
+		return;
+
+	/* the index is missing a row now, it's of no use anymore */
+	for (int i = 0; i < INDEX_BITMAP_COUNT; i++)
+		roaring_free(&index->bitmaps[i]);
+
+	index->is_stale = true;
+}
+
+/* (key, row) pairs bulk builds are made from */
+struct bulk_pair {
+	void *key;
+	struct row_location loc;
+};
+
+struct bulk_sort {
+	struct index *index;
+	struct bulk_pair *pairs;
+	/* scratch space, as big as pairs */
+	struct bulk_pair *tmp;
+	size_t count;
+	/* length of the runs sorted so far */
+	size_t run_len;
+};
+
+/* by key, then storage order so the rows of every entry are kept in storage order too */
+static int bulk_pair_cmp(struct index *index, struct bulk_pair *pair1, struct bulk_pair *pair2)
+{
+	int ret;
+
+	if ((ret = tree_cmp(index, pair1->key, pair2->key)))
+		return ret;
+
+	return row_location_cmp(&pair1->loc, &pair2->loc);
+}
+
+/* merges pairs[0, n1) and pairs[n1, n1 + n2) */
+static void bulk_merge(struct index *index, struct bulk_pair *pairs, struct bulk_pair *tmp, size_t n1, size_t n2)
+{
+	size_t i = 0, j = n1, k = 0;
+
+	/* runs don't overlap, nothing to merge */
+	if (!n1 || !n2 || bulk_pair_cmp(index, &pairs[n1 - 1], &pairs[n1]) < 0)
+		return;
+
+	while (i < n1 && j < n1 + n2)
+		tmp[k++] = bulk_pair_cmp(index, &pairs[j], &pairs[i]) < 0 ? pairs[j++] : pairs[i++];
+
+	/* whatever is left of the second run is in place already */
+	memcpy(&tmp[k], &pairs[i], (n1 - i) * sizeof(*pairs));
+	memcpy(pairs, tmp, (k + n1 - i) * sizeof(*pairs));
+}
+
+static void bulk_merge_sort(struct index *index, struct bulk_pair *pairs, struct bulk_pair *tmp, size_t count)
+{
+	struct bulk_pair pair;
+	size_t half = count / 2;
+
+	if (count <= INDEX_BULK_INSERTION_SORT) {
+		for (size_t i = 1; i < count; i++) {
+			size_t j = i;
+
+			pair = pairs[i];
+			for (; j > 0 && bulk_pair_cmp(index, &pair, &pairs[j - 1]) < 0; j--)
+				pairs[j] = pairs[j - 1];
+			pairs[j] = pair;
+		}
+		return;
+	}
+
+	bulk_merge_sort(index, pairs, tmp, half);
+	bulk_merge_sort(index, &pairs[half], &tmp[half], count - half);
+	bulk_merge(index, pairs, tmp, half, count - half);
+}
+
+static void bulk_sort_run(void *arg, size_t task)
+{
+	struct bulk_sort *sort = arg;
+	size_t first = task * sort->run_len;
+	size_t count = MIN(sort->run_len, sort->count - first);
+
+	bulk_merge_sort(sort->index, &sort->pairs[first], &sort->tmp[first], count);
+}
+
+/* merges runs 2 * task and 2 * task + 1 */
+static void bulk_merge_runs(void *arg, size_t task)
+{
+	struct bulk_sort *sort = arg;
+	size_t first = 2 * task * sort->run_len;
+	size_t n1 = MIN(sort->run_len, sort->count - first);
+	size_t n2 = MIN(sort->run_len, sort->count - first - n1);
+
+	bulk_merge(sort->index, &sort->pairs[first], &sort->tmp[first], n1, n2);
+}
+
+static void bulk_run(struct worker_pool *pool, size_t ntasks, void (*fn)(void *arg, size_t task), void *arg)
+{
+	if (pool && ntasks > 1) {
+		worker_pool_run(pool, ntasks, fn, arg);
+		return;
+	}
+
+	for (size_t i = 0; i < ntasks; i++)
+		fn(arg, i);
+}
+
+/*
+ * every thread sorts a run of its own, runs are then merged pairwise (in parallel as well) until
+ * there's a single one left
+ */
+static void bulk_sort(struct bulk_sort *sort, struct worker_pool *pool)
+{
+	size_t nruns = 1;
+
+	if (pool && sort->count >= INDEX_BULK_PARALLEL_MIN)
+		nruns = pool->nthreads;
+
+	sort->run_len = (sort->count + nruns - 1) / nruns;
+	bulk_run(pool, (sort->count + sort->run_len - 1) / sort->run_len, &bulk_sort_run, sort);
+
+	for (; sort->run_len < sort->count; sort->run_len *= 2)
+		bulk_run(pool, (sort->count + 2 * sort->run_len - 1) / (2 * sort->run_len), &bulk_merge_runs, sort);
+}
+
+static bool bulk_collect(struct table *table, struct index *index, struct vector *pairs)
+{
+	struct list_head *pos;
+	struct bulk_pair pair;
+	struct row *row;
+	size_t row_size = table_calc_row_size(table);
+
+	list_for_each(pos, table->datablock_head)
+	{
+		pair.loc.blk = list_entry(pos, typeof(*pair.loc.blk), head);
+
+		for (size_t i = 0; i < table_block_size(table) / row_size; i++) {
+			pair.loc.offset = i * row_size;
+			row = (struct row*)&pair.loc.blk->data[pair.loc.offset];
+
+			/* nothing else in this datablock */
+			if (row->flags.empty)
+				break;
+
+			if (row->flags.deleted || !(pair.key = row_key(table, index, row)))
+				continue;
+
+			if (!vector_push(pairs, &pair, sizeof(pair)))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+static int bulk_load(struct index *index, struct index_entry **entries, size_t count)
+{
+	int64_t *int_keys;
+	void **keys;
+	int ret;
+
+	if (!index->int_keys) {
+		if (!(keys = malloc(count * sizeof(*keys))))
+			return -MIDORIDB_NOMEM;
+
+		for (size_t i = 0; i < count; i++)
+			keys[i] = entries[i]->key;
+
+		ret = bptree_bulk_load(index->tree, keys, (void**)entries, count);
+		free(keys);
+
+		return ret;
+	}
+
+	if (!(int_keys = malloc(count * sizeof(*int_keys))))
+		return -MIDORIDB_NOMEM;
+
+	for (size_t i = 0; i < count; i++)
+		int_keys[i] = *(int64_t*)entries[i]->key;
+
+	ret = bptree_i64_bulk_load(index->itree, int_keys, (void**)entries, count);
+	free(int_keys);
+
+	return ret;
+}
+
+/*
+ * builds a B+tree bottom-up out of existing rows rather than inserting them one at a time, that
+ * spares all the node splits and keeps leaves full
+ */
+static bool btree_index_bulk_build(struct table *table, struct index *index, struct worker_pool *pool)
+{
+	struct bulk_sort sort = {.index = index};
+	struct index_entry **entries;
+	struct vector pairs;
+	size_t nentries = 0;
+
+	if (!vector_init(&pairs))
+		return false;
+
+	if (!bulk_collect(table, index, &pairs))
+		goto err;
+
+	sort.pairs = (struct bulk_pair*)pairs.data;
+	sort.count = pairs.len / sizeof(*sort.pairs);
+
+	if (!sort.count) {
+		vector_free(&pairs);
+		return true;
+	}
+
+	if (!(sort.tmp = malloc(sort.count * sizeof(*sort.tmp))))
+		goto err;
+
+	bulk_sort(&sort, pool);
+	free(sort.tmp);
+
+	if (!(entries = malloc(sort.count * sizeof(*entries))))
+		goto err;
+
+	/* rows holding the same value are next to each other now */
+	for (size_t i = 0; i < sort.count; i++) {
+		if (!i || tree_cmp(index, sort.pairs[i - 1].key, sort.pairs[i].key)) {
+			if (!(entries[nentries] = index_entry_new(table, index, sort.pairs[i].key)))
+				goto err_entries;
+			nentries++;
+		}
+
+		if (!vector_push(&entries[nentries - 1]->locs, &sort.pairs[i].loc, sizeof(sort.pairs[i].loc)))
+			goto err_entries;
+	}
+
+	if (bulk_load(index, entries, nentries))
+		goto err_entries;
+
+	free(entries);
+	vector_free(&pairs);
+
+	return true;
+
+err_entries:
+	for (size_t i = 0; i < nentries; i++)
+		index_entry_free(entries[i]);
+	free(entries);
+err:
+	vector_free(&pairs);
+	return false;
+}
+
+static bool index_populate(struct table *table, struct index *index, struct worker_pool *pool)
+{
+	struct list_head *pos;
+	struct row_location loc;
+	struct row *row;
+	size_t row_size = table_calc_row_size(table);
+
+	if (index->type == IT_BTREE)
+		return btree_index_bulk_build(table, index, pool);
+
+	list_for_each(pos, table->datablock_head)
+	{
+		loc.blk = list_entry(pos, typeof(*loc.blk), head);
+
+		for (size_t i = 0; i < table_block_size(table) / row_size; i++) {
+			loc.offset = i * row_size;
+			row = (struct row*)&loc.blk->data[loc.offset];
+
+			/* nothing else in this datablock */
+			if (row->flags.empty)
+				break;
+
+			if (row->flags.deleted)
+				continue;
+
+			if (!index_add(table, index, &loc))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+static void free_index_entry(void *key, void *value, void *arg)
+{
+	(void)key;
+	(void)arg;
+
+	index_entry_free(value);
+}
+
+static void free_index_entry_i64(int64_t key, void *value, void *arg)
+{
+	(void)key;
+
+	free_index_entry(NULL, value, arg);
+}
+
+static void free_hash_entry(struct hashtable *hashtable, const void *key, size_t klen, const void *value,
+		size_t vlen, void *arg)
+{
+	(void)value;
+	(void)vlen;
+	(void)arg;
+
+	hashtable_free_entry(hashtable_remove(hashtable, key, klen));
+}
+
+static void index_free_tree(struct index *index)
+{
+	if (index->type == IT_HASH) {
+		hashtable_foreach(index->hash, &free_hash_entry, NULL);
+		hashtable_free(index->hash);
+		free(index->hash);
+		index->hash = NULL;
+	} else if (index->type == IT_BITMAP) {
+		for (int i = 0; i < INDEX_BITMAP_COUNT; i++)
+			roaring_free(&index->bitmaps[i]);
+		free(index->bitmaps);
+		index->bitmaps = NULL;
+	} else if (index->int_keys) {
+		bptree_i64_foreach(index->itree, &free_index_entry_i64, NULL);
+		bptree_i64_destroy(&index->itree);
+	} else {
+		bptree_foreach(index->tree, &free_index_entry, NULL);
+		bptree_destroy(&index->tree);
+	}
+}
+
+static void index_set_column(struct table *table, struct index *index, int col_idx)
+{
+	size_t offset = 0;
+
+	for (int i = 0; i < col_idx; i++)
+		offset += table_calc_column_space(&table->columns[i]);
+
+	index->col_idx = col_idx;
+	index->col_offset = offset;
+}
+
+static bool index_init_tree(struct table *table, struct index *index, struct worker_pool *pool)
+{
+	struct column *column = &table->columns[index->col_idx];
+
+	index_set_column(table, index, index->col_idx);
+
+	if (index->type == IT_HASH) {
+		if (!(index->hash = malloc(sizeof(*index->hash))))
+			return false;
+
+		if (!hashtable_init(index->hash, &hashtable_mem_compare, &hashtable_str_hash)) {
+			free(index->hash);
+			return false;
+		}
+	} else if (index->type == IT_BITMAP) {
+		if (!(index->bitmaps = calloc(INDEX_BITMAP_COUNT, sizeof(*index->bitmaps))))
+			return false;
+	} else if ((index->int_keys = has_int_keys(column))) {
+		if (!(index->itree = bptree_i64_init(INDEX_BPTREE_I64_NODE_SIZE)))
+			return false;
+	} else if (!(index->tree = bptree_init(INDEX_BPTREE_ORDER, get_cmp_fn(column)))) {
+		return false;
+	}
+
+	if (!index_populate(table, index, pool)) {
+		index_free_tree(index);
+		return false;
+	}
+
+	return true;
+}
+
+bool table_index_create(struct table *table, int col_idx, enum INDEX_TYPE type, struct worker_pool *pool)
+{
+	struct index *index;
+
+	/* sanity checks */
+	if (!table || col_idx < 0 || col_idx >= table->column_count || table->indexes[col_idx])
+		return false;
+
+	if (type == IT_BITMAP && table->columns[col_idx].type != CT_TINYINT)
+		return false;
+
+	if (!(index = zalloc(sizeof(*index))))
+		return false;
+
+	index->col_idx = col_idx;
+	index->type = type;
+
+	if (!index_init_tree(table, index, pool)) {
+		free(index);
+		return false;
+	}
+
+	table->indexes[col_idx] = index;
+
+	return true;
+}
+
+void table_index_destroy(struct table *table, int col_idx)
+{
+	struct index *index = table->indexes[col_idx];
+
+	if (!index)
+		return;
+
+	index_free_tree(index);
+	free(index);
+	table->indexes[col_idx] = NULL;
+}
+
+void table_index_move_row(struct table *table, struct datablock *blk, size_t offset, struct datablock *new_blk,
+		size_t new_offset)
+{
+	struct row_location from = {.blk = blk, .offset = offset};
+	struct row_location to = {.blk = new_blk, .offset = new_offset};
+	struct index *index;
+
+	for (int i = 0; i < table->column_count; i++) {
+		if (!(index = table->indexes[i]))
+			continue;
+
+		if (index->type == IT_HASH)
+			hash_index_move(table, index, &from, &to);
+		else if (index->type == IT_BITMAP)
+			bitmap_index_move(index, &from, &to);
+		else
+			btree_index_move(table, index, &from, &to);
+	}
+}
+
+void table_index_remap_columns(struct table *table)
+{
+	for (int i = 0; i < table->column_count; i++) {
+		if (table->indexes[i])
+			index_set_column(table, table->indexes[i], i);
+	}
+}
+
+bool table_index_insert_row(struct table *table, struct datablock *blk, size_t offset)
+{
+	struct row_location loc = {.blk = blk, .offset = offset};
+	int i;
+
+	for (i = 0; i < table->column_count; i++) {
+		if (table->indexes[i] && !index_add(table, table->indexes[i], &loc))
+			goto err;
+	}
+
+	return true;
+
+err:
+	/* undo what has been added so far */
+	while (--i >= 0) {
+		if (table->indexes[i])
+			index_del(table, table->indexes[i], &loc);
+	}
+
+	return false;
+}
+
+bool table_index_delete_row(struct table *table, struct datablock *blk, size_t offset)
+{
+	struct row_location loc = {.blk = blk, .offset = offset};
+	int i;
+
+	for (i = 0; i < table->column_count; i++) {
+		if (table->indexes[i] && !index_del(table, table->indexes[i], &loc))
+			goto err;
+	}
+
+	return true;
+
+err:
+	/* put back what has been removed so far */
+	while (--i >= 0) {
+		if (table->indexes[i])
+			BUG_ON(!index_add(table, table->indexes[i], &loc));
+	}
+
+	return false;
+}
+
+int row_location_cmp(const void *loc1, const void *loc2)
+{
+	const struct row_location *val_1 = loc1;
+	const struct row_location *val_2 = loc2;
+
+	/* datablocks are linked in the order they were allocated */
+	if (val_1->blk != val_2->blk)
+		return val_1->blk->block_id < val_2->blk->block_id ? -1 : 1;
+
+	return (val_1->offset > val_2->offset) - (val_1->offset < val_2->offset);
+}
+
+static struct row_location* hash_index_get(struct table *table, struct index *index, void *key)
+{
+	struct hashtable_value *value;
+	size_t key_len;
+	double tmp_dbl;
+
+	key = hash_key(&table->columns[index->col_idx], key, &tmp_dbl, &key_len);
+
+	if (!(value = hashtable_get(index->hash, key, key_len)))
+		return NULL;
+
+	return value->content;
+}
+
+bool table_index_lookup(struct table *table, int col_idx, void *key, struct vector *out)
+{
+	struct index *index = table->indexes[col_idx];
+	struct index_entry *entry;
+	struct row_location *loc;
+
+	/* sanity checks */
+	BUG_ON(!index);
+
+	if (index->type == IT_HASH) {
+		if (!(loc = hash_index_get(table, index, key)))
+			return true;
+
+		return vector_push(out, loc, sizeof(*loc));
+	}
+
+	if (index->type == IT_BITMAP)
+		return !index->is_stale && table_index_bitmap_locs(table, &index->bitmaps[*(bool*)key], out);
+
+	if (!(entry = tree_lookup(index, key)))
+		return true;
+
+	/* locations are kept in storage order already */
+	return vector_push(out, entry->locs.data, entry->locs.len);
+}
+
+const struct roaring* table_index_bitmap(struct table *table, int col_idx, int value)
+{
+	struct index *index = table->indexes[col_idx];
+
+	if (!index || index->type != IT_BITMAP || index->is_stale)
+		return NULL;
+
+	return &index->bitmaps[value];
+}
+
+bool table_index_bitmap_locs(struct table *table, const struct roaring *rows, struct vector *out)
+{
+	struct roaring_iter iter;
+	struct row_location loc;
+	size_t pos = 0;
+	uint64_t id;
+
+	roaring_iter_init(&iter, rows);
+
+	/* ids and datablocks are both in storage order, datablocks are only ever searched forward */
+	while (roaring_iter_next(&iter, &id)) {
+		loc.blk = block_dir_at(&table->blocks, pos);
+
+		if (!loc.blk || loc.blk->block_id != id >> 32) {
+			pos = block_dir_find(&table->blocks, pos, id >> 32);
+
+			/* something went terribly wrong here if this is true */
+			BUG_ON(pos == table->blocks.len);
+
+			loc.blk = table->blocks.blocks[pos];
+		}
+
+		loc.offset = id & UINT32_MAX;
+
+		if (!vector_push(out, &loc, sizeof(loc)))
+			return false;
+	}
+
+	return true;
+}
+
+void table_index_range_bound(struct table *table, int col_idx, struct index_range *range, void *key,
+		bool lower, bool incl)
+{
+	struct index *index = table->indexes[col_idx];
+	int cmp;
+
+	/* sanity checks */
+	BUG_ON(!index || index->type != IT_BTREE);
+
+	if (lower) {
+		cmp = range->lo ? tree_cmp(index, key, range->lo) : 1;
+
+		/* '> x' is tighter than '>= x' */
+		if (cmp > 0 || (cmp == 0 && !incl)) {
+			range->lo = key;
+			range->lo_incl = incl;
+		}
+	} else {
+		cmp = range->hi ? tree_cmp(index, key, range->hi) : -1;
+
+		if (cmp < 0 || (cmp == 0 && !incl)) {
+			range->hi = key;
+			range->hi_incl = incl;
+		}
+	}
+}
+
+/* whether a key is past the far end of a range, given the direction it's walked in */
+static bool is_past_range(struct index *index, struct index_range *range, void *key, bool desc)
+{
+	int cmp;
+
+	if (desc) {
+		if (!range->lo)
+			return false;
+
+		cmp = tree_cmp(index, key, range->lo);
+		return cmp < 0 || (cmp == 0 && !range->lo_incl);
+	}
+
+	if (!range->hi)
+		return false;
+
+	cmp = tree_cmp(index, key, range->hi);
+	return cmp > 0 || (cmp == 0 && !range->hi_incl);
+}
+
+int table_index_range(struct table *table, int col_idx, struct index_range *range, bool desc, size_t limit,
+		struct vector *out)
+{
+	struct index *index = table->indexes[col_idx];
+	struct tree_cursor cur;
+	struct index_entry *entry;
+	size_t count = 0;
+	void *start = desc ? range->hi : range->lo;
+	bool more;
+
+	/* sanity checks */
+	BUG_ON(!index || index->type != IT_BTREE);
+
+	more = tree_seek(&cur, index, start, desc);
+
+	/* the starting bound may be exclusive */
+	entry = more ? tree_cursor_entry(&cur) : NULL;
+	if (entry && start && tree_cmp(index, entry->key, start) == 0 && !(desc ? range->hi_incl : range->lo_incl))
+		more = tree_step(&cur, desc);
+
+	for (; more; more = tree_step(&cur, desc)) {
+		entry = tree_cursor_entry(&cur);
+
+		if (is_past_range(index, range, entry->key, desc))
+			break;
+
+		count += entry->locs.len / sizeof(struct row_location);
+
+		if (count > limit)
+			return -MIDORIDB_ERROR;
+
+		if (!vector_push(out, entry->locs.data, entry->locs.len))
+			return -MIDORIDB_NOMEM;
+	}
+
+	return MIDORIDB_OK;
+}
+
+bool table_index_is_duplicate(struct table *table, int col_idx, void *key, struct datablock *blk, size_t offset)
+{
+	struct index *index = table->indexes[col_idx];
+	struct row_location *loc;
+
+	/* sanity checks */
+	BUG_ON(!index || index->type != IT_HASH);
+
+	if (!(loc = hash_index_get(table, index, key)))
+		return false;
+
+	return loc->blk != blk || loc->offset != offset;
+}
+
+int table_index_find_duplicates(struct table *table, struct row **rows, size_t count, int *dup_col)
+{
+	struct hashtable seen;
+	struct index *index;
+	size_t key_len;
+	double tmp_dbl;
+	void *key;
+	int rc = MIDORIDB_OK;
+
+	for (int i = 0; i < table->column_count && !rc; i++) {
+		index = table->indexes[i];
+
+		if (!index || index->type != IT_HASH)
+			continue;
+
+		/* values of the new rows, they can't clash with each other either */
+		if (!hashtable_init(&seen, &hashtable_mem_compare, &hashtable_str_hash))
+			return -MIDORIDB_NOMEM;
+
+		for (size_t j = 0; j < count; j++) {
+			if (!(key = row_key(table, index, rows[j])))
+				continue;
+
+			if (table_index_is_duplicate(table, i, key, NULL, 0)) {
+				rc = -MIDORIDB_ERROR;
+				break;
+			}
+
+			key = hash_key(&table->columns[i], key, &tmp_dbl, &key_len);
+
+			if (hashtable_get(&seen, key, key_len)) {
+				rc = -MIDORIDB_ERROR;
+				break;
+			}
+
+			if (!hashtable_put(&seen, key, key_len, &j, sizeof(j))) {
+				rc = -MIDORIDB_NOMEM;
+				break;
+			}
+		}
+
+		if (rc == -MIDORIDB_ERROR)
+			*dup_col = i;
+
+		hashtable_foreach(&seen, &free_hash_entry, NULL);
+		hashtable_free(&seen);
+	}
+
+	return rc;
+}
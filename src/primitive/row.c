@@ -7,6 +7,10 @@
 #include <primitive/table.h>
 #include <primitive/column.h>
 #include <primitive/row.h>
+#include <primitive/index.h>
+#include <primitive/zonemap.h>
+#include <primitive/bloom.h>
+#include <primitive/freespace.h>
 
 size_t table_calc_row_data_size(struct table *table)
 {
@@ -24,40 +28,70 @@ size_t table_calc_row_size(struct table *table)
 }
 
 bool table_insert_row(struct table *table, struct row *row, size_t len)
+{
+	struct datablock *blk;
+	size_t offset;
+
+	return table_insert_row_loc(table, row, len, &blk, &offset);
+}
+
+bool table_insert_row_loc(struct table *table, struct row *row, size_t len, struct datablock **blk, size_t *offset_out)
 {
 	struct datablock *block;
-	bool should_alloc;
+	size_t offset;
+	bool should_alloc, reused;
 
 	/* sanity checks */
 	if (!table || !row || len == 0 || len != table_calc_row_size(table))
 		return false;
 
-	/* is this the first ever item of the table ? */
-	should_alloc = list_is_empty(table->datablock_head);
-	/* or is there enough space to insert that into an existing datablock ? */
-	should_alloc = should_alloc || (table->free_dtbkl_offset + len) >= DATABLOCK_PAGE_SIZE;
-	if (should_alloc) {
-		// Notes to myself, paulo, you should test the crap out of that..
-		// TODO add some sort of POISON/EOF so when reading the datablock
-		// we would know that it's time to  go to the next datablock
-		//
-		// We also have to differentiate between EOF and data deleted.. this will
-		// happen once we implement delete operations
-		if (!(block = datablock_alloc(table->datablock_head)))
-			return false;
-
-		table_datablock_init(block, 0, len);
-		table->free_dtbkl_offset = 0;
-	} else {
-		// since it's a circular linked list then getting the head->prev is the same
-		// as getting the last available data block
-		block = list_entry(table->datablock_head->prev, typeof(*block), head);
+	/* holes left behind by deleted rows are filled before the table grows any further */
+	reused = table_free_slot_take(table, &block, &offset);
+
+	if (!reused) {
+		/* is this the first ever item of the table ? */
+		should_alloc = list_is_empty(table->datablock_head);
+		/* or is there enough space to insert that into an existing datablock ? */
+		should_alloc = should_alloc || (table->free_dtbkl_offset + len) >= table_block_size(table);
+		if (should_alloc) {
+			// Notes to myself, paulo, you should test the crap out of that..
+			// TODO add some sort of POISON/EOF so when reading the datablock
+			// we would know that it's time to  go to the next datablock
+			//
+			// We also have to differentiate between EOF and data deleted.. this will
+			// happen once we implement delete operations
+			if (!(block = datablock_alloc(&table->arena, table->datablock_head)))
+				return false;
+
+			if (!block_dir_push(&table->blocks, block)) {
+				datablock_free(&table->arena, block);
+				return false;
+			}
+
+			table_datablock_init(table, block, 0, len);
+			table_zone_rebuild(table, block);
+			table_bloom_rebuild(table, block);
+			table->free_dtbkl_offset = 0;
+		} else {
+			// since it's a circular linked list then getting the head->prev is the same
+			// as getting the last available data block
+			block = list_entry(table->datablock_head->prev, typeof(*block), head);
+		}
+
+		offset = table->free_dtbkl_offset;
 	}
 
-	struct row *new_row = (struct row*)&block->data[table->free_dtbkl_offset];
+	struct row *new_row = (struct row*)&block->data[offset];
+
+	if (reused) {
+		/* something went terribly wrong here if this is true */
+		BUG_ON(!new_row->flags.deleted || new_row->flags.empty);
+		table_free_row_content(table, new_row);
+	} else {
+		/* something went terribly wrong here if this is true */
+		BUG_ON(new_row->flags.deleted || !new_row->flags.empty);
+	}
 
-	/* something went terribly wrong here if this is true */
-	BUG_ON(new_row->flags.deleted || !new_row->flags.empty);
 	new_row->flags.deleted = false;
 	new_row->flags.empty = false;
 	memcpy(new_row->null_bitmap, row->null_bitmap, sizeof(row->null_bitmap));
@@ -92,7 +126,21 @@ bool table_insert_row(struct table *table, struct row *row, size_t len)
 
 	}
 
-	table->free_dtbkl_offset += len;
+	if (!table_index_insert_row(table, block, offset))
+		goto err;
+
+	table_zone_add_row(table, block, new_row);
+	table_bloom_add_row(table, block, new_row);
+
+	if (reused)
+		table->deleted_row_count--;
+	else
+		table->free_dtbkl_offset += len;
+
+	table->row_count++;
+
+	*blk = block;
+	*offset_out = offset;
 
 	return true;
 
@@ -108,7 +156,7 @@ err:
 	 */
 	pos = 0;
 	for (int i = 0; i < column_idx; i++) {
-		struct column *column = &table->columns[column_idx];
+		struct column *column = &table->columns[i];
 		if (table_check_var_column(column)) {
 			void **col_idx_ptr = (void**)&new_row->data[pos];
 			free(*col_idx_ptr);
@@ -116,9 +164,17 @@ err:
 		pos += table_calc_column_space(column);
 	}
 
-	memzero(new_row->data, table_calc_row_size(table));
-	new_row->flags.empty = true;
-	new_row->flags.deleted = false;
+	memzero(new_row->data, table_calc_row_data_size(table));
+
+	/* a reused slot goes back to being a deleted row, its old content is long gone by now */
+	if (reused) {
+		new_row->flags.empty = false;
+		new_row->flags.deleted = true;
+		table_free_slot_add(table, block, offset);
+	} else {
+		new_row->flags.empty = true;
+		new_row->flags.deleted = false;
+	}
 
 	return false;
 }
@@ -126,7 +182,7 @@ err:
 bool table_delete_row(struct table *table, struct datablock *blk, size_t offset)
 {
 	/* sanity checks */
-	if (!table || !blk || offset >= DATABLOCK_PAGE_SIZE)
+	if (!table || !blk || offset >= table_block_size(table))
 		return false;
 
 	struct row *row = (struct row*)&blk->data[offset];
@@ -134,14 +190,26 @@ bool table_delete_row(struct table *table, struct datablock *blk, size_t offset)
 	/* something went terribly wrong here if this is true */
 	BUG_ON(row->flags.deleted || row->flags.empty);
 
+	if (!table_index_delete_row(table, blk, offset))
+		return false;
+
+	table_zone_del_row(table, blk, row);
 	row->flags.deleted = true;
+	table_free_slot_add(table, blk, offset);
+
+	table->row_count--;
+	table->deleted_row_count++;
+
 	return true;
 }
 
 bool table_update_row(struct table *table, struct datablock *blk, size_t offset, struct row *row, size_t len)
 {
+	struct row *old_row;
+	bool ret = false;
+
 	/* sanity checks */
-	if (!table || !blk || offset >= DATABLOCK_PAGE_SIZE || len != table_calc_row_size(table))
+	if (!table || !blk || offset >= table_block_size(table) || len != table_calc_row_size(table))
 		return false;
 
 	struct row *upd_row = (struct row*)&blk->data[offset];
@@ -149,22 +217,34 @@ bool table_update_row(struct table *table, struct datablock *blk, size_t offset,
 	/* something went terribly wrong here if this is true */
 	BUG_ON(upd_row->flags.deleted || upd_row->flags.empty);
 
-	/* we may have set some data to NULL so we better copy the null_bitmap too */
-	memcpy(upd_row->null_bitmap, row->null_bitmap, sizeof(row->null_bitmap));
+	/* old content is put back if the new one can't be indexed */
+	if (!(old_row = table_dup_row(table, upd_row)))
+		return false;
 
-	size_t pos = 0;
-	for (int i = 0; i < table->column_count; i++) {
-		struct column *column = &table->columns[i];
-		if (table_check_var_column(column)) {
-			void **ptr = (void**)&upd_row->data[pos];
-			memcpy(*ptr, *((char**)((char*)row->data + pos)), column->precision);
-		} else {
-			memcpy(upd_row->data + pos, ((char*)row->data) + pos, column->precision);
-		}
-		pos += table_calc_column_space(column);
+	/* row is re-indexed once its new content is in place */
+	if (!table_index_delete_row(table, blk, offset))
+		goto out;
+
+	table_zone_del_row(table, blk, upd_row);
+	table_copy_row_content(table, upd_row, row);
+	table_zone_add_row(table, blk, upd_row);
+	table_bloom_add_row(table, blk, upd_row);
+
+	if (!(ret = table_index_insert_row(table, blk, offset))) {
+		/* Bloom filters can't drop values, the new ones are just false positives from now on */
+		table_zone_del_row(table, blk, upd_row);
+		table_copy_row_content(table, upd_row, old_row);
+		table_zone_add_row(table, blk, upd_row);
+
+		/* something went terribly wrong here if this is true, these entries were there a moment ago */
+		BUG_ON(!table_index_insert_row(table, blk, offset));
 	}
 
-	return true;
+out:
+	table_free_row_content(table, old_row);
+	free(old_row);
+
+	return ret;
 }
 
 void table_free_row_content(struct table *table, struct row *row)
@@ -186,3 +266,65 @@ void table_free_row_content(struct table *table, struct row *row)
 		data += table_calc_column_space(column);
 	}
 }
+
+struct row* table_dup_row(struct table *table, struct row *row)
+{
+	size_t len = table_calc_row_size(table);
+	struct row *dup;
+	size_t pos = 0;
+	int i;
+
+	dup = malloc(len);
+	if (!dup)
+		return NULL;
+
+	memcpy(dup, row, len);
+
+	for (i = 0; i < table->column_count; i++) {
+		struct column *column = &table->columns[i];
+		if (table_check_var_column(column)) {
+			void **ptr = (void**)&dup->data[pos];
+			void *content = malloc(column->precision);
+
+			if (!content)
+				goto err;
+
+			memcpy(content, *ptr, column->precision);
+			*ptr = content;
+		}
+		pos += table_calc_column_space(column);
+	}
+
+	return dup;
+
+err:
+	/* buffers of the remaining columns still belong to @row */
+	pos = 0;
+	for (int j = 0; j < i; j++) {
+		if (table_check_var_column(&table->columns[j]))
+			free(*(void**)&dup->data[pos]);
+		pos += table_calc_column_space(&table->columns[j]);
+	}
+
+	free(dup);
+	return NULL;
+}
+
+void table_copy_row_content(struct table *table, struct row *dst, struct row *src)
+{
+	size_t pos = 0;
+
+	/* we may have set some data to NULL so we better copy the null_bitmap too */
+	memcpy(dst->null_bitmap, src->null_bitmap, sizeof(src->null_bitmap));
+
+	for (int i = 0; i < table->column_count; i++) {
+		struct column *column = &table->columns[i];
+		if (table_check_var_column(column)) {
+			void **ptr = (void**)&dst->data[pos];
+			memcpy(*ptr, *((char**)((char*)src->data + pos)), column->precision);
+		} else {
+			memcpy(dst->data + pos, ((char*)src->data) + pos, column->precision);
+		}
+		pos += table_calc_column_space(column);
+	}
+}
@@ -8,6 +8,7 @@
 #include <primitive/table.h>
 #include <primitive/column.h>
 #include <primitive/row.h>
+#include <primitive/index.h>
 
 int table_lock(struct table *table)
 {
@@ -25,6 +26,29 @@ int table_unlock(struct table *table)
 	return MIDORIDB_OK;
 }
 
+int table_pin(struct table *table)
+{
+	int rc;
+
+	/* waits for a vacuum step that may be under way */
+	if ((rc = table_lock(table)))
+		return rc;
+
+	table->pins++;
+
+	return table_unlock(table);
+}
+
+void table_unpin(struct table *table)
+{
+	/* something went terribly wrong here if this is true */
+	BUG_ON(table_lock(table));
+	BUG_ON(!table->pins);
+
+	table->pins--;
+	table_unlock(table);
+}
+
 static inline bool __valid_name(char *name, size_t max_size)
 {
 	size_t arg_len;
@@ -61,6 +85,9 @@ struct table* __must_check table_init(char *name)
 
 	ret->column_count = 0;
 	ret->free_dtbkl_offset = 0;
+	ret->row_count = 0;
+	ret->deleted_row_count = 0;
+	ret->pins = 0;
 
 	if (!table_validate_name(name))
 		goto err_free;
@@ -71,6 +98,10 @@ struct table* __must_check table_init(char *name)
 	if (!ret->datablock_head)
 		goto err_free;
 
+	datablock_arena_init(&ret->arena, DATABLOCK_PAGE_SIZE);
+	block_dir_init(&ret->blocks);
+	list_head_init(&ret->free_space);
+
 	if (pthread_mutex_init(&ret->mutex, NULL))
 		goto err_datablock;
 
@@ -86,7 +117,7 @@ err_free:
 static void __free_datablock_content(struct table *table, struct datablock *block)
 {
 	size_t row_size = table_calc_row_size(table);
-	for (size_t i = 0; i < (DATABLOCK_PAGE_SIZE / row_size); i++) {
+	for (size_t i = 0; i < (table_block_size(table) / row_size); i++) {
 		struct row *row = (struct row*)&block->data[row_size * i];
 		table_free_row_content(table, row);
 	}
@@ -105,6 +136,9 @@ bool table_destroy(struct table **table)
 	if (pthread_mutex_destroy(&(*table)->mutex))
 		return false;
 
+	for (int i = 0; i < (*table)->column_count; i++)
+		table_index_destroy(*table, i);
+
 	/* destroy all datablocks if any */
 	list_for_each_safe(pos, tmp_pos, (*table)->datablock_head)
 	{
@@ -112,9 +146,11 @@ bool table_destroy(struct table **table)
 
 		/* free variable precision value as they are alloc'ed separately */
 		__free_datablock_content(*table, entry);
-		datablock_free(entry);
+		datablock_free(&(*table)->arena, entry);
 	}
 	free((*table)->datablock_head);
+	block_dir_free(&(*table)->blocks);
+	datablock_arena_destroy(&(*table)->arena);
 
 	/* destroy table */
 	free(*table);
@@ -123,12 +159,51 @@ bool table_destroy(struct table **table)
 	return true;
 }
 
-void table_datablock_init(struct datablock *block, size_t offset, size_t row_size)
+void table_datablock_init(struct table *table, struct datablock *block, size_t offset, size_t row_size)
 {
-	for (size_t i = offset / row_size; i < DATABLOCK_PAGE_SIZE / row_size; i++) {
+	for (size_t i = offset / row_size; i < table_block_size(table) / row_size; i++) {
 		struct row *row = (struct row*)&block->data[i * row_size];
 		row->flags.empty = true;
 		row->flags.deleted = false;
 		memzero((char* )row + sizeof(row->flags), row_size - offsetof(typeof(*row), null_bitmap));
 	}
 }
+
+size_t table_calc_block_size(size_t row_size)
+{
+	size_t size = DATABLOCK_PAGE_SIZE;
+
+	/* same rule as table_insert_row: a row never ends at the very edge of the datablock */
+	while (size < DATABLOCK_MAX_SIZE && (size - 1) / row_size < TABLE_BLOCK_MIN_ROWS)
+		size *= 2;
+
+	return row_size < size ? size : 0;
+}
+
+bool table_set_block_size(struct table *table, size_t size)
+{
+	bool fixed = size != 0;
+	size_t row_size;
+
+	/* sanity checks */
+	if (!table || !list_is_empty(table->datablock_head))
+		return false;
+
+	row_size = table_calc_row_size(table);
+
+	if (!size && !(size = table_calc_block_size(row_size)))
+		return false;
+
+	if (!datablock_size_valid(size) || row_size >= size)
+		return false;
+
+	/* there are no datablocks in use, regions the arena kept around can go */
+	if (size != table_block_size(table)) {
+		datablock_arena_destroy(&table->arena);
+		datablock_arena_init(&table->arena, size);
+	}
+
+	table->fixed_block_size = fixed;
+
+	return true;
+}
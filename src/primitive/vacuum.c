@@ -1,6 +1,17 @@
 /*
  * vacuum.c
  *
+ * Notes to myself:
+ * 	- update: vacuum is a two-pointer slide now (see struct vacuum_cursor). The old one walked the
+ * 		datablock list from the start for every destination datablock, quadratic on big tables.
+ * 	- rows never move past each other so indexes can just follow them (see table_index_move_row).
+ * 	- slots rows are moved out of become deleted rows rather than empty ones, scans take an empty
+ * 		row as the end of a datablock and they may run in between two steps.
+ * 	- datablocks are filled up to the same point inserts do: a row never ends at the very edge.
+ * 	- the pass keeps positions in the block directory rather than datablock references. src is
+ * 		either dst or the datablock right after it, so releasing the one src is at just lets the
+ * 		next one slide into its position.
+ *
  *  Created on: 8/04/2023
  *      Author: paulo
  */
@@ -8,128 +19,183 @@
 #include <primitive/table.h>
 #include <primitive/column.h>
 #include <primitive/row.h>
+#include <primitive/index.h>
+#include <primitive/zonemap.h>
+#include <primitive/bloom.h>
+#include <primitive/freespace.h>
 
-bool table_vacuum(struct table *table)
+static inline struct row* vacuum_row(struct datablock *blk, size_t slot, size_t row_size)
+{
+	return (struct row*)&blk->data[slot * row_size];
+}
+
+/* zone maps, Bloom filters and free slots of a datablock the pass is done filling up */
+static void vacuum_block_done(struct table *table, struct datablock *blk)
+{
+	table_zone_rebuild(table, blk);
+	table_bloom_rebuild(table, blk);
+	table_free_space_rebuild(table, blk);
+}
+
+/* turn slots from @slot onwards into empty ones, those that were deleted rows are gone for good */
+static void vacuum_trim_block(struct table *table, struct datablock *blk, size_t slot, size_t row_size)
 {
-	struct list_head *dst_pos, *src_pos, *src_tmp_pos;
-	struct datablock *dst_entry, *src_entry;
-	size_t dst_blk_offset, dst_blk_idx;
-	size_t src_blk_offset, src_blk_idx;
 	struct row *row;
-	size_t row_size;
-	bool dst_full;
 
-	/* sanity checks */
-	if (!table)
-		return false;
+	for (size_t i = slot; i < table_block_size(table) / row_size; i++) {
+		row = vacuum_row(blk, i, row_size);
 
-	dst_blk_idx = 0;
-	src_blk_idx = 0;
-	dst_blk_offset = 0;
-	src_blk_offset = 0;
-	dst_entry = NULL;
-	src_entry = NULL;
-	row_size = table_calc_row_size(table);
+		/* something went terribly wrong here if this is true */
+		BUG_ON(!row->flags.deleted && !row->flags.empty);
 
-	list_for_each(dst_pos, table->datablock_head)
-	{
-		dst_entry = list_entry(dst_pos, typeof(*dst_entry), head);
-		dst_blk_offset = 0;
-		dst_full = false;
-
-		size_t tmp_cnt = 0;
-		list_for_each(src_pos, table->datablock_head)
-		{
-			/* skip to the right datablock if needed */
-			if (tmp_cnt < src_blk_idx) {
-				tmp_cnt++;
-				continue;
-			}
+		table->deleted_row_count -= row->flags.deleted;
+		table_free_row_content(table, row);
+	}
 
-			src_entry = list_entry(src_pos, typeof(*src_entry), head);
+	table_datablock_init(table, blk, slot * row_size, row_size);
+}
 
-			for (size_t i = src_blk_offset / row_size; i < DATABLOCK_PAGE_SIZE / row_size; i++) {
+/* datablocks after the released one move a position down */
+static void vacuum_release_block(struct table *table, size_t pos, size_t row_size)
+{
+	struct datablock *blk = block_dir_at(&table->blocks, pos);
 
-				row = (struct row*)&src_entry->data[i * row_size];
+	vacuum_trim_block(table, blk, 0, row_size);
+	block_dir_del(&table->blocks, pos);
+	datablock_free(&table->arena, blk);
+}
 
-				/* is this valid row ? */
-				if (!row->flags.deleted && !row->flags.empty) {
-//					printf("i = %lu\n", (src_blk_idx * (DATABLOCK_PAGE_SIZE / row_size)) + i);
+/* src has made it past every row of the table, whatever comes after dst goes */
+static void vacuum_finish(struct table *table, size_t row_size)
+{
+	struct vacuum_cursor *cur = &table->vacuum;
+	struct datablock *dst;
 
-					/* can this row still fit in the dst datablock ? */
-					if (dst_blk_offset + row_size >= DATABLOCK_PAGE_SIZE) {
-						dst_full = true;
-						break;
-					}
+	while (table->blocks.len > cur->dst + 1)
+		vacuum_release_block(table, table->blocks.len - 1, row_size);
 
-					/* do we need to move the row at all? (common on first datablock) */
-					if (dst_pos == src_pos && dst_blk_offset == i * row_size) {
-						dst_blk_offset += row_size;
-						continue;
-					}
+	dst = block_dir_at(&table->blocks, cur->dst);
+	vacuum_trim_block(table, dst, cur->dst_slot, row_size);
+	vacuum_block_done(table, dst);
 
-					/* free any variable precision resources in old row. (if any) */
-					table_free_row_content(table, (struct row*)&dst_entry->data[dst_blk_offset]);
+	table->free_dtbkl_offset = cur->dst_slot * row_size;
+	memzero(cur, sizeof(*cur));
+}
 
-					/* good to go :) */
-					memmove(&dst_entry->data[dst_blk_offset], row, row_size);
-					dst_blk_offset += row_size;
+/* slide the live row src is at over to dst */
+static void vacuum_move_row(struct table *table, struct datablock *src, struct datablock *dst, size_t row_size)
+{
+	struct vacuum_cursor *cur = &table->vacuum;
+	struct row *from = vacuum_row(src, cur->src_slot, row_size);
+	struct row *to = vacuum_row(dst, cur->dst_slot, row_size);
 
-					/* zero-out row content so we keep things tidy */
-					memzero(row, row_size);
-					row->flags.empty = true;
-					row->flags.deleted = false;
-				}
+	/* rows only ever move towards the start of the table, indexes can just follow */
+	table_index_move_row(table, src, cur->src_slot * row_size, dst, cur->dst_slot * row_size);
+	table_zone_del_row(table, src, from);
 
-				src_blk_offset += row_size;
-			}
+	/* free any variable precision resources in old row. (if any) */
+	table_free_row_content(table, to);
 
-			if (!dst_full) {
-				src_blk_idx++;
-				tmp_cnt++;
-				src_blk_offset = 0;
-			} else {
-				break;
-			}
+	memcpy(to, from, row_size);
+	table_zone_add_row(table, dst, to);
+	table_bloom_add_row(table, dst, to);
 
-		}
+	/* the content belongs to the new row now */
+	memzero(from, row_size);
+	from->flags.empty = false;
+	from->flags.deleted = true;
+}
 
-		dst_blk_idx++;
+bool table_vacuum_step(struct table *table, size_t budget)
+{
+	struct vacuum_cursor *cur;
+	struct datablock *src, *dst;
+	size_t row_size, slots;
+	struct row *row;
 
-		/* have we copied everything that we needed? */
-		if (!dst_full) {
-			break;
-		}
+	/* sanity checks */
+	if (!table)
+		return true;
+
+	cur = &table->vacuum;
+	row_size = table_calc_row_size(table);
+	slots = (table_block_size(table) - 1) / row_size;
+
+	/* a new pass starts where the first hole is, rows before it are where they should be already */
+	if (!cur->active) {
+		if (list_is_empty(&table->free_space))
+			return true;
+
+		dst = list_entry(table->free_space.next, struct datablock, free_link);
+		cur->dst = block_dir_find(&table->blocks, 0, dst->block_id);
+		cur->dst_slot = 0;
+		cur->src = cur->dst;
+		cur->src_slot = 0;
+		cur->active = true;
 	}
 
-	/* adjust offset to next available row */
-	table->free_dtbkl_offset = dst_blk_offset;
+	for (; budget > 0; budget--) {
+		src = block_dir_at(&table->blocks, cur->src);
+		row = cur->src_slot < slots ? vacuum_row(src, cur->src_slot, row_size) : NULL;
 
-	/* turn remaining space of last non-free datablock into empty rows */
-	for (size_t i = dst_blk_offset / row_size; i < DATABLOCK_PAGE_SIZE / row_size; i++) {
-		table_free_row_content(table, (struct row*)&dst_entry->data[i * row_size]);
-	}
-	table_datablock_init(dst_entry, dst_blk_offset, row_size);
-
-	/* free blocks that are no longer used */
-	src_blk_idx = 0;
-	list_for_each_safe(src_pos, src_tmp_pos, table->datablock_head)
-	{
-		/* skip to the right datablock if needed */
-		if (src_blk_idx < dst_blk_idx) {
-			src_blk_idx++;
+		/* end of the datablock src is at */
+		if (!row || row->flags.empty) {
+			if (cur->src + 1 == table->blocks.len) {
+				vacuum_finish(table, row_size);
+				return true;
+			}
+
+			/* nothing but deleted rows were left behind, the next datablock takes its position */
+			if (cur->src != cur->dst)
+				vacuum_release_block(table, cur->src, row_size);
+			else
+				cur->src++;
+
+			cur->src_slot = 0;
 			continue;
 		}
 
-		src_entry = list_entry(src_pos, typeof(*src_entry), head);
+		/* dst is full, the datablock right after it is where src is (or got to first) */
+		if (cur->dst_slot == slots) {
+			vacuum_block_done(table, block_dir_at(&table->blocks, cur->dst));
+			cur->dst++;
+			cur->dst_slot = 0;
+		}
+
+		if (row->flags.deleted) {
+			/* deleted rows in between dst and src are no business of inserts */
+			table_free_slot_del(table, src, cur->src_slot * row_size);
+		} else {
+			if (cur->src != cur->dst || cur->src_slot != cur->dst_slot) {
+				dst = block_dir_at(&table->blocks, cur->dst);
+				vacuum_move_row(table, src, dst, row_size);
+			}
 
-		/* free any variable precision resources in old rows. (if any) */
-		for (size_t i = 0; i < DATABLOCK_PAGE_SIZE / row_size; i++) {
-			table_free_row_content(table, (struct row*)&src_entry->data[i * row_size]);
+			cur->dst_slot++;
 		}
 
-		datablock_free(src_entry);
+		cur->src_slot++;
 	}
 
+	return false;
+}
+
+bool table_vacuum(struct table *table)
+{
+	/* sanity checks */
+	if (!table)
+		return false;
+
+	/* nothing to compact */
+	if (list_is_empty(table->datablock_head))
+		return true;
+
+	/* every datablock gets compacted (and its summaries tightened up), holes or not */
+	memzero(&table->vacuum, sizeof(table->vacuum));
+	table->vacuum.active = true;
+
+	while (!table_vacuum_step(table, SIZE_MAX))
+		;
+
 	return true;
 }
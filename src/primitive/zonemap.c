@@ -0,0 +1,133 @@
+/*
+ * zonemap.c
+ *
+ * Notes to myself:
+ * 	- zone maps live next to the rows of a datablock rather than in the table so they come and go
+ * 		with the datablock itself. (vacuum, column changes)
+ * 	- NaNs would make every comparison to a bound false, a datablock holding one is summarised
+ * 		as [-inf, +inf] instead.
+ *
+ *  Created on: 17/10/2026
+ *      Author: paulo
+ */
+
+#include <primitive/zonemap.h>
+
+static union zone_value read_value(enum COLUMN_TYPE type, const void *ptr)
+{
+	union zone_value val;
+
+	switch (type) {
+	case CT_DOUBLE:
+		val.double_val = *(double*)ptr;
+		break;
+	case CT_TINYINT:
+		val.int_val = *(bool*)ptr;
+		break;
+	case CT_DATE:
+	case CT_DATETIME:
+		val.int_val = *(time_t*)ptr;
+		break;
+	default:
+		val.int_val = *(int64_t*)ptr;
+		break;
+	}
+
+	return val;
+}
+
+static int value_cmp(enum COLUMN_TYPE type, union zone_value *a, union zone_value *b)
+{
+	if (type == CT_DOUBLE)
+		return (a->double_val > b->double_val) - (a->double_val < b->double_val);
+
+	return (a->int_val > b->int_val) - (a->int_val < b->int_val);
+}
+
+int zone_value_cmp(enum COLUMN_TYPE type, union zone_value *val, const void *key)
+{
+	union zone_value tmp = read_value(type, key);
+
+	return value_cmp(type, val, &tmp);
+}
+
+static void zone_widen(struct zone_map *zone, enum COLUMN_TYPE type, union zone_value *val)
+{
+	if (type == CT_DOUBLE && isnan(val->double_val)) {
+		zone->min.double_val = -INFINITY;
+		zone->max.double_val = INFINITY;
+	} else if (!zone->value_count) {
+		zone->min = *val;
+		zone->max = *val;
+	} else if (value_cmp(type, val, &zone->min) < 0) {
+		zone->min = *val;
+	} else if (value_cmp(type, val, &zone->max) > 0) {
+		zone->max = *val;
+	}
+
+	zone->value_count++;
+}
+
+void table_zone_add_row(struct table *table, struct datablock *blk, struct row *row)
+{
+	struct column *column;
+	union zone_value val;
+	size_t offset = 0;
+
+	if (!blk->zones)
+		return;
+
+	for (int i = 0; i < table->column_count; i++) {
+		column = &table->columns[i];
+
+		if (zone_map_tracks(column->type)) {
+			if (bit_test(row->null_bitmap, i, sizeof(row->null_bitmap))) {
+				blk->zones[i].null_count++;
+			} else {
+				val = read_value(column->type, &row->data[offset]);
+				zone_widen(&blk->zones[i], column->type, &val);
+			}
+		}
+
+		offset += table_calc_column_space(column);
+	}
+}
+
+void table_zone_del_row(struct table *table, struct datablock *blk, struct row *row)
+{
+	if (!blk->zones)
+		return;
+
+	for (int i = 0; i < table->column_count; i++) {
+		if (!zone_map_tracks(table->columns[i].type))
+			continue;
+
+		/* bounds stay put, they're still valid just not as tight */
+		if (bit_test(row->null_bitmap, i, sizeof(row->null_bitmap)))
+			blk->zones[i].null_count--;
+		else
+			blk->zones[i].value_count--;
+	}
+}
+
+void table_zone_rebuild(struct table *table, struct datablock *blk)
+{
+	size_t row_size = table_calc_row_size(table);
+	struct row *row;
+
+	/* columns are only ever added by moving rows to new datablocks so there's always room for all of them */
+	if (!blk->zones && !(blk->zones = calloc(table->column_count, sizeof(*blk->zones))))
+		return;
+
+	memzero(blk->zones, table->column_count * sizeof(*blk->zones));
+
+	for (size_t i = 0; i < table_block_size(table) / row_size; i++) {
+		row = (struct row*)&blk->data[i * row_size];
+
+		if (row->flags.empty)
+			break; /* end of the line */
+
+		if (!row->flags.deleted)
+			table_zone_add_row(table, blk, row);
+	}
+}
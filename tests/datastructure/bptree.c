@@ -0,0 +1,254 @@
+#include "tests/datastructure.h"
+#include "datastructure/bptree.h"
+#include "datastructure/btree.h"
+
+/* keys are inserted in an order that's neither ascending nor descending */
+#define SHUFFLE(i, n)	(((i) * 7919) % (n))
+
+void test_bptree_init(void)
+{
+	struct bptree_head *head;
+	uint64_t keys[10000];
+	uint64_t val = 0xB1EE5;
+
+	head = bptree_init(3, &btree_cmp_ul);
+	CU_ASSERT_PTR_NOT_NULL(head);
+	bptree_destroy(&head);
+	CU_ASSERT_PTR_NULL(head);
+
+	/* splits at every level must neither forget nor double free nodes */
+	head = bptree_init(3, &btree_cmp_ul);
+	for (uint64_t i = 0; i < ARR_SIZE(keys); i++) {
+		keys[i] = i;
+		CU_ASSERT_EQUAL_FATAL(bptree_insert(head, &keys[i], &val), 0);
+	}
+
+	CU_ASSERT_EQUAL(head->count, ARR_SIZE(keys));
+	bptree_destroy(&head);
+	CU_ASSERT_PTR_NULL(head);
+}
+
+void test_bptree_insert(void)
+{
+	struct bptree_head *head;
+	uint64_t keys[1000];
+	uint64_t values[1000];
+	uint64_t bogus = 0xFFFFFFFFFF;
+
+	head = bptree_init(4, &btree_cmp_ul);
+	CU_ASSERT_PTR_NOT_NULL(head);
+
+	for (uint64_t i = 0; i < ARR_SIZE(keys); i++) {
+		uint64_t idx = SHUFFLE(i, ARR_SIZE(keys));
+
+		keys[idx] = idx;
+		values[idx] = 0xBEEF + idx;
+		CU_ASSERT_EQUAL_FATAL(bptree_insert(head, &keys[idx], &values[idx]), 0);
+	}
+
+	for (uint64_t i = 0; i < ARR_SIZE(keys); i++)
+		CU_ASSERT_PTR_EQUAL(bptree_lookup(head, &keys[i]), &values[i]);
+
+	/* keys are unique */
+	CU_ASSERT_EQUAL(bptree_insert(head, &keys[500], &values[0]), -MIDORIDB_ERROR);
+	CU_ASSERT_PTR_EQUAL(bptree_lookup(head, &keys[500]), &values[500]);
+	CU_ASSERT_EQUAL(head->count, ARR_SIZE(keys));
+
+	CU_ASSERT_PTR_NULL(bptree_lookup(head, &bogus));
+
+	bptree_destroy(&head);
+}
+
+void test_bptree_remove(void)
+{
+	struct bptree_head *head;
+	uint64_t *keys[1000];
+	uint64_t val = 0xDEADBEEF;
+	uint64_t bogus = 0xFFFFFFFFFF;
+	uint64_t expected;
+	struct bptree_cursor cur;
+
+	head = bptree_init(3, &btree_cmp_ul);
+	CU_ASSERT_PTR_NOT_NULL(head);
+
+	/* keys are freed right after removal, separators must not hold on to them */
+	for (uint64_t i = 0; i < ARR_SIZE(keys); i++) {
+		keys[i] = malloc(sizeof(*keys[i]));
+		*keys[i] = i;
+		CU_ASSERT_EQUAL_FATAL(bptree_insert(head, keys[i], &val), 0);
+	}
+
+	CU_ASSERT_FALSE(bptree_remove(head, &bogus));
+
+	/* remove odd keys */
+	for (uint64_t i = 0; i < ARR_SIZE(keys); i++) {
+		uint64_t idx = SHUFFLE(i, ARR_SIZE(keys));
+
+		if (idx % 2 == 0)
+			continue;
+
+		CU_ASSERT_EQUAL_FATAL(bptree_remove(head, keys[idx]), true);
+		free(keys[idx]);
+		keys[idx] = NULL;
+	}
+
+	CU_ASSERT_EQUAL(head->count, ARR_SIZE(keys) / 2);
+
+	for (uint64_t i = 0; i < ARR_SIZE(keys); i += 2)
+		CU_ASSERT_PTR_EQUAL(bptree_lookup(head, keys[i]), &val);
+
+	/* leaves must still be linked in order */
+	expected = 0;
+	for (bool more = bptree_seek_ge(head, &cur, NULL); more; more = bptree_next(&cur)) {
+		CU_ASSERT_EQUAL(*(uint64_t*)bptree_cursor_key(&cur), expected);
+		expected += 2;
+	}
+	CU_ASSERT_EQUAL(expected, ARR_SIZE(keys));
+
+	/* then everything else */
+	for (uint64_t i = 0; i < ARR_SIZE(keys); i += 2) {
+		CU_ASSERT_EQUAL_FATAL(bptree_remove(head, keys[i]), true);
+		free(keys[i]);
+	}
+
+	CU_ASSERT_EQUAL(head->count, 0);
+	CU_ASSERT_PTR_NULL(head->root);
+	CU_ASSERT_FALSE(bptree_seek_ge(head, &cur, NULL));
+	CU_ASSERT_FALSE(bptree_seek_le(head, &cur, NULL));
+
+	bptree_destroy(&head);
+}
+
+void test_bptree_cursor(void)
+{
+	struct bptree_head *head;
+	uint64_t keys[500];
+	uint64_t val = 0xDEADBEEF;
+	uint64_t bound;
+	struct bptree_cursor cur;
+	int count;
+
+	head = bptree_init(5, &btree_cmp_ul);
+	CU_ASSERT_PTR_NOT_NULL(head);
+
+	/* even keys only: 0, 2, ..., 998 */
+	for (uint64_t i = 0; i < ARR_SIZE(keys); i++) {
+		keys[i] = i * 2;
+		CU_ASSERT_EQUAL_FATAL(bptree_insert(head, &keys[i], &val), 0);
+	}
+
+	/* exact match */
+	bound = 100;
+	CU_ASSERT_EQUAL_FATAL(bptree_seek_ge(head, &cur, &bound), true);
+	CU_ASSERT_EQUAL(*(uint64_t*)bptree_cursor_key(&cur), 100);
+	CU_ASSERT_PTR_EQUAL(bptree_cursor_value(&cur), &val);
+	CU_ASSERT_EQUAL_FATAL(bptree_seek_le(head, &cur, &bound), true);
+	CU_ASSERT_EQUAL(*(uint64_t*)bptree_cursor_key(&cur), 100);
+
+	/* bounds in between keys */
+	bound = 101;
+	CU_ASSERT_EQUAL_FATAL(bptree_seek_ge(head, &cur, &bound), true);
+	CU_ASSERT_EQUAL(*(uint64_t*)bptree_cursor_key(&cur), 102);
+	CU_ASSERT_EQUAL_FATAL(bptree_seek_le(head, &cur, &bound), true);
+	CU_ASSERT_EQUAL(*(uint64_t*)bptree_cursor_key(&cur), 100);
+
+	/* BETWEEN 101 AND 201, ascending */
+	count = 0;
+	bound = 101;
+	for (bool more = bptree_seek_ge(head, &cur, &bound); more; more = bptree_next(&cur)) {
+		if (*(uint64_t*)bptree_cursor_key(&cur) > 201)
+			break;
+		CU_ASSERT_EQUAL(*(uint64_t*)bptree_cursor_key(&cur), 102 + count * 2);
+		count++;
+	}
+	CU_ASSERT_EQUAL(count, 50);
+
+	/* same thing the other way around */
+	count = 0;
+	bound = 201;
+	for (bool more = bptree_seek_le(head, &cur, &bound); more; more = bptree_prev(&cur)) {
+		if (*(uint64_t*)bptree_cursor_key(&cur) < 101)
+			break;
+		CU_ASSERT_EQUAL(*(uint64_t*)bptree_cursor_key(&cur), 200 - count * 2);
+		count++;
+	}
+	CU_ASSERT_EQUAL(count, 50);
+
+	/* out of range */
+	bound = 999;
+	CU_ASSERT_FALSE(bptree_seek_ge(head, &cur, &bound));
+	CU_ASSERT_EQUAL_FATAL(bptree_seek_le(head, &cur, &bound), true);
+	CU_ASSERT_EQUAL(*(uint64_t*)bptree_cursor_key(&cur), 998);
+	CU_ASSERT_FALSE(bptree_next(&cur));
+	CU_ASSERT_FALSE(bptree_next(&cur));
+
+	/* whole tree backwards */
+	count = 0;
+	for (bool more = bptree_seek_le(head, &cur, NULL); more; more = bptree_prev(&cur))
+		count++;
+	CU_ASSERT_EQUAL(count, ARR_SIZE(keys));
+
+	bptree_destroy(&head);
+}
+
+void test_bptree_bulk_load(void)
+{
+	struct bptree_head *head;
+	struct bptree_cursor cur;
+	uint64_t keys[2000];
+	void *key_refs[ARR_SIZE(keys)];
+	void *vals[ARR_SIZE(keys)];
+	uint64_t odd = 1;
+	uint64_t expected;
+	size_t counts[] = {0, 1, 3, 4, 5, 13, 16, 17, 100, ARR_SIZE(keys)};
+
+	/* even keys only so odd ones can be inserted afterwards */
+	for (uint64_t i = 0; i < ARR_SIZE(keys); i++) {
+		keys[i] = i * 2;
+		key_refs[i] = &keys[i];
+		vals[i] = &keys[i];
+	}
+
+	/* every way leaves and inner nodes can be split up, with odd and even orders */
+	for (int order = 3; order <= 4; order++) {
+		for (size_t c = 0; c < ARR_SIZE(counts); c++) {
+			size_t count = counts[c];
+
+			head = bptree_init(order, &btree_cmp_ul);
+			CU_ASSERT_PTR_NOT_NULL_FATAL(head);
+
+			CU_ASSERT_EQUAL_FATAL(bptree_bulk_load(head, key_refs, vals, count), 0);
+			CU_ASSERT_EQUAL(head->count, count);
+
+			for (size_t i = 0; i < count; i++)
+				CU_ASSERT_PTR_EQUAL(bptree_lookup(head, &keys[i]), &keys[i]);
+
+			expected = 0;
+			for (bool more = bptree_seek_ge(head, &cur, NULL); more; more = bptree_next(&cur)) {
+				CU_ASSERT_EQUAL(*(uint64_t*)bptree_cursor_key(&cur), expected);
+				expected += 2;
+			}
+			CU_ASSERT_EQUAL(expected, count * 2);
+
+			/* only empty trees can be bulk loaded */
+			if (count)
+				CU_ASSERT_EQUAL(bptree_bulk_load(head, key_refs, vals, count), -MIDORIDB_ERROR);
+
+			/* the tree can be updated as usual afterwards */
+			CU_ASSERT_EQUAL(bptree_insert(head, &odd, &odd), 0);
+			CU_ASSERT_PTR_EQUAL(bptree_lookup(head, &odd), &odd);
+			CU_ASSERT_EQUAL(bptree_remove(head, &odd), true);
+
+			for (size_t i = 0; i < count; i++) {
+				size_t idx = SHUFFLE(i, count);
+
+				CU_ASSERT_EQUAL_FATAL(bptree_remove(head, &keys[idx]), true);
+			}
+
+			CU_ASSERT_EQUAL(head->count, 0);
+			CU_ASSERT_PTR_NULL(head->root);
+
+			bptree_destroy(&head);
+		}
+	}
+}
@@ -0,0 +1,180 @@
+#include "tests/datastructure.h"
+#include "datastructure/bptree_i64.h"
+
+/* keys are inserted in an order that's neither ascending nor descending */
+#define SHUFFLE(i, n)	(((i) * 7919) % (n))
+
+void test_bptree_i64_insert(void)
+{
+	struct bptree_i64_head *head;
+	int64_t values[3000];
+	int64_t key;
+
+	/* smallest nodes possible (7 keys) so the tree gets a few levels deep */
+	head = bptree_i64_init(BPTREE_I64_CACHE_LINE);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(head);
+
+	/* negative keys too, signed compares must be used */
+	for (int64_t i = 0; i < (int64_t)(ARR_SIZE(values)); i++) {
+		int64_t idx = SHUFFLE(i, (int64_t)(ARR_SIZE(values)));
+
+		values[idx] = idx;
+		CU_ASSERT_EQUAL_FATAL(bptree_i64_insert(head, idx - 1500, &values[idx]), 0);
+	}
+
+	CU_ASSERT_EQUAL(head->count, ARR_SIZE(values));
+
+	for (int64_t i = 0; i < (int64_t)(ARR_SIZE(values)); i++)
+		CU_ASSERT_PTR_EQUAL(bptree_i64_lookup(head, i - 1500), &values[i]);
+
+	/* keys are unique */
+	CU_ASSERT_EQUAL(bptree_i64_insert(head, 0, &values[0]), -MIDORIDB_ERROR);
+	CU_ASSERT_PTR_EQUAL(bptree_i64_lookup(head, 0), &values[1500]);
+
+	CU_ASSERT_PTR_NULL(bptree_i64_lookup(head, -1501));
+	CU_ASSERT_PTR_NULL(bptree_i64_lookup(head, 1500));
+	CU_ASSERT_PTR_NULL(bptree_i64_lookup(head, INT64_MIN));
+	CU_ASSERT_PTR_NULL(bptree_i64_lookup(head, INT64_MAX));
+
+	/* keys at either end of the domain */
+	key = INT64_MAX;
+	CU_ASSERT_EQUAL(bptree_i64_insert(head, key, &values[1]), 0);
+	CU_ASSERT_EQUAL(bptree_i64_insert(head, INT64_MIN, &values[2]), 0);
+	CU_ASSERT_PTR_EQUAL(bptree_i64_lookup(head, INT64_MAX), &values[1]);
+	CU_ASSERT_PTR_EQUAL(bptree_i64_lookup(head, INT64_MIN), &values[2]);
+
+	bptree_i64_destroy(&head);
+	CU_ASSERT_PTR_NULL(head);
+}
+
+void test_bptree_i64_remove(void)
+{
+	struct bptree_i64_head *head;
+	struct bptree_i64_cursor cur;
+	int64_t val = 0xDEADBEEF;
+	int64_t expected;
+
+	head = bptree_i64_init(BPTREE_I64_CACHE_LINE);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(head);
+
+	for (int64_t i = 0; i < 1000; i++)
+		CU_ASSERT_EQUAL_FATAL(bptree_i64_insert(head, i, &val), 0);
+
+	CU_ASSERT_FALSE(bptree_i64_remove(head, 1000));
+
+	/* remove odd keys */
+	for (int64_t i = 0; i < 1000; i++) {
+		int64_t key = SHUFFLE(i, 1000);
+
+		if (key % 2)
+			CU_ASSERT_EQUAL_FATAL(bptree_i64_remove(head, key), true);
+	}
+
+	CU_ASSERT_EQUAL(head->count, 500);
+
+	for (int64_t i = 0; i < 1000; i++)
+		CU_ASSERT_PTR_EQUAL(bptree_i64_lookup(head, i), i % 2 ? NULL : &val);
+
+	/* leaves must still be linked in order */
+	expected = 0;
+	for (bool more = bptree_i64_seek_ge(head, &cur, INT64_MIN); more; more = bptree_i64_next(&cur)) {
+		CU_ASSERT_EQUAL(bptree_i64_cursor_key(&cur), expected);
+		expected += 2;
+	}
+	CU_ASSERT_EQUAL(expected, 1000);
+
+	for (int64_t i = 0; i < 1000; i += 2)
+		CU_ASSERT_EQUAL_FATAL(bptree_i64_remove(head, i), true);
+
+	CU_ASSERT_EQUAL(head->count, 0);
+	CU_ASSERT_PTR_NULL(head->root);
+	CU_ASSERT_FALSE(bptree_i64_seek_ge(head, &cur, INT64_MIN));
+
+	bptree_i64_destroy(&head);
+}
+
+void test_bptree_i64_cursor(void)
+{
+	struct bptree_i64_head *head;
+	struct bptree_i64_cursor cur;
+	int64_t val = 0xDEADBEEF;
+	int count;
+
+	head = bptree_i64_init(BPTREE_I64_DEFAULT_NODE_SIZE);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(head);
+
+	/* even keys only: 0, 2, ..., 9998 */
+	for (int64_t i = 0; i < 5000; i++)
+		CU_ASSERT_EQUAL_FATAL(bptree_i64_insert(head, i * 2, &val), 0);
+
+	/* nodes are searched a vector at a time, every position within them has to work */
+	for (int64_t key = -1; key <= 10000; key++) {
+		CU_ASSERT_EQUAL_FATAL(bptree_i64_seek_ge(head, &cur, key), key < 9999);
+		if (key < 9999)
+			CU_ASSERT_EQUAL(bptree_i64_cursor_key(&cur), key <= 0 ? 0 : key + key % 2);
+
+		CU_ASSERT_EQUAL_FATAL(bptree_i64_seek_le(head, &cur, key), key >= 0);
+		if (key >= 0)
+			CU_ASSERT_EQUAL(bptree_i64_cursor_key(&cur), key >= 9998 ? 9998 : key - key % 2);
+	}
+
+	/* BETWEEN 101 AND 201, backwards */
+	count = 0;
+	for (bool more = bptree_i64_seek_le(head, &cur, 201); more; more = bptree_i64_prev(&cur)) {
+		if (bptree_i64_cursor_key(&cur) < 101)
+			break;
+		CU_ASSERT_EQUAL(bptree_i64_cursor_key(&cur), 200 - count * 2);
+		CU_ASSERT_PTR_EQUAL(bptree_i64_cursor_value(&cur), &val);
+		count++;
+	}
+	CU_ASSERT_EQUAL(count, 50);
+
+	bptree_i64_destroy(&head);
+}
+
+void test_bptree_i64_bulk_load(void)
+{
+	struct bptree_i64_head *head;
+	struct bptree_i64_cursor cur;
+	int64_t keys[5000];
+	void *vals[ARR_SIZE(keys)];
+	int64_t expected;
+	size_t counts[] = {1, 7, 8, 9, 64, 65, ARR_SIZE(keys)};
+
+	for (size_t i = 0; i < ARR_SIZE(keys); i++) {
+		keys[i] = (int64_t)i * 2 - 2500;
+		vals[i] = &keys[i];
+	}
+
+	for (size_t c = 0; c < ARR_SIZE(counts); c++) {
+		size_t count = counts[c];
+
+		/* 7 keys per node */
+		head = bptree_i64_init(BPTREE_I64_CACHE_LINE);
+		CU_ASSERT_PTR_NOT_NULL_FATAL(head);
+
+		CU_ASSERT_EQUAL_FATAL(bptree_i64_bulk_load(head, keys, vals, count), 0);
+		CU_ASSERT_EQUAL(head->count, count);
+		CU_ASSERT_EQUAL(bptree_i64_bulk_load(head, keys, vals, count), -MIDORIDB_ERROR);
+
+		for (size_t i = 0; i < count; i++) {
+			CU_ASSERT_PTR_EQUAL(bptree_i64_lookup(head, keys[i]), &keys[i]);
+			CU_ASSERT_PTR_NULL(bptree_i64_lookup(head, keys[i] + 1));
+		}
+
+		expected = keys[0];
+		for (bool more = bptree_i64_seek_ge(head, &cur, INT64_MIN); more; more = bptree_i64_next(&cur)) {
+			CU_ASSERT_EQUAL(bptree_i64_cursor_key(&cur), expected);
+			expected += 2;
+		}
+		CU_ASSERT_EQUAL(expected, keys[0] + (int64_t)count * 2);
+
+		/* removals must find every node at least half full */
+		for (size_t i = 0; i < count; i++)
+			CU_ASSERT_EQUAL_FATAL(bptree_i64_remove(head, keys[SHUFFLE(i, count)]), true);
+
+		CU_ASSERT_PTR_NULL(head->root);
+
+		bptree_i64_destroy(&head);
+	}
+}
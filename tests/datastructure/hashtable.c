@@ -165,3 +165,17 @@ void test_hashtable_iterate(void)
 	hashtable_foreach(&ht, &free_str_entries, NULL);
 	hashtable_free(&ht);
 }
+
+void test_hashtable_mem_compare(void)
+{
+	int64_t key1 = 42;
+	int64_t key2 = 42;
+	int64_t key3 = -42;
+	int32_t key4 = 42;
+
+	CU_ASSERT(hashtable_mem_compare(&key1, sizeof(key1), &key2, sizeof(key2)));
+	CU_ASSERT_FALSE(hashtable_mem_compare(&key1, sizeof(key1), &key3, sizeof(key3)));
+	/* same leading bytes but different sizes */
+	CU_ASSERT_FALSE(hashtable_mem_compare(&key1, sizeof(key1), &key4, sizeof(key4)));
+	CU_ASSERT_EQUAL(hashtable_str_hash(&key1, sizeof(key1)), hashtable_str_hash(&key2, sizeof(key2)));
+}
@@ -0,0 +1,190 @@
+#include "tests/datastructure.h"
+#include "datastructure/roaring.h"
+
+/* values span three containers: a sparse one, a dense one and one going back and forth */
+#define TEST_ROARING_RANGE	(3 * 65536)
+
+static bool is_dense(uint64_t val)
+{
+	return val >= 65536 && val < 2 * 65536 && val % 3;
+}
+
+static bool is_sparse(uint64_t val, int seed)
+{
+	return (val * 2654435761u + (uint64_t)seed) % 97 < 3;
+}
+
+/* fills bitmap and the reference array with the same values */
+static void fill(struct roaring *bitmap, bool *ref, int seed)
+{
+	memzero(ref, TEST_ROARING_RANGE * sizeof(*ref));
+	roaring_init(bitmap);
+
+	for (uint64_t val = 0; val < TEST_ROARING_RANGE; val++) {
+		ref[val] = is_dense(val) || is_sparse(val, seed);
+
+		if (ref[val])
+			CU_ASSERT_FATAL(roaring_add(bitmap, val));
+	}
+}
+
+static void check_equal(struct roaring *bitmap, bool *ref)
+{
+	struct roaring_iter iter;
+	size_t card = 0;
+	uint64_t val, prev = 0;
+	bool first = true;
+
+	for (uint64_t i = 0; i < TEST_ROARING_RANGE; i++) {
+		CU_ASSERT_EQUAL(roaring_contains(bitmap, i), ref[i]);
+		card += ref[i];
+	}
+
+	CU_ASSERT_EQUAL(roaring_cardinality(bitmap), card);
+
+	/* iteration is in ascending order and only yields values that are there */
+	roaring_iter_init(&iter, bitmap);
+
+	while (roaring_iter_next(&iter, &val)) {
+		CU_ASSERT(first || val > prev);
+		CU_ASSERT_FATAL(val < TEST_ROARING_RANGE);
+		CU_ASSERT(ref[val]);
+		prev = val;
+		first = false;
+		card--;
+	}
+
+	CU_ASSERT_EQUAL(card, 0);
+
+	for (size_t i = 0; i < bitmap->count; i++) {
+		CU_ASSERT_NOT_EQUAL(bitmap->containers[i].card, 0);
+		CU_ASSERT(i == 0 || bitmap->containers[i].key > bitmap->containers[i - 1].key);
+	}
+}
+
+void test_roaring_add(void)
+{
+	struct roaring bitmap;
+	bool *ref = calloc(TEST_ROARING_RANGE, sizeof(*ref));
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL(ref);
+
+	fill(&bitmap, ref, 1);
+	check_equal(&bitmap, ref);
+
+	CU_ASSERT_EQUAL(bitmap.count, 3);
+	CU_ASSERT(!bitmap.containers[0].is_bitmap);
+	CU_ASSERT(bitmap.containers[1].is_bitmap);
+
+	/* adding twice is a no-op */
+	CU_ASSERT(roaring_add(&bitmap, 65537));
+	check_equal(&bitmap, ref);
+
+	/* values way up */
+	CU_ASSERT(roaring_add(&bitmap, UINT64_MAX));
+	CU_ASSERT(roaring_add(&bitmap, (uint64_t)1 << 40));
+	CU_ASSERT(roaring_contains(&bitmap, UINT64_MAX));
+	CU_ASSERT(roaring_contains(&bitmap, (uint64_t)1 << 40));
+	CU_ASSERT(!roaring_contains(&bitmap, UINT64_MAX - 1));
+	CU_ASSERT_EQUAL(bitmap.count, 5);
+
+	roaring_free(&bitmap);
+	CU_ASSERT_EQUAL(bitmap.count, 0);
+	CU_ASSERT(!roaring_contains(&bitmap, 0));
+
+	free(ref);
+}
+
+void test_roaring_remove(void)
+{
+	struct roaring bitmap;
+	bool *ref = calloc(TEST_ROARING_RANGE, sizeof(*ref));
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL(ref);
+
+	fill(&bitmap, ref, 2);
+
+	CU_ASSERT(!roaring_remove(&bitmap, TEST_ROARING_RANGE));
+
+	/* the dense container goes back to being an array */
+	for (uint64_t val = 65536; val < 2 * 65536; val++) {
+		if (val % 20 == 0)
+			continue;
+
+		CU_ASSERT_EQUAL(roaring_remove(&bitmap, val), ref[val]);
+		ref[val] = false;
+	}
+
+	check_equal(&bitmap, ref);
+	CU_ASSERT(!bitmap.containers[1].is_bitmap);
+
+	/* and containers running dry go away */
+	for (uint64_t val = 0; val < 65536; val++) {
+		CU_ASSERT_EQUAL(roaring_remove(&bitmap, val), ref[val]);
+		ref[val] = false;
+	}
+
+	check_equal(&bitmap, ref);
+	CU_ASSERT_EQUAL(bitmap.count, 2);
+	CU_ASSERT_EQUAL(bitmap.containers[0].key, 1);
+
+	roaring_free(&bitmap);
+	free(ref);
+}
+
+void test_roaring_set_ops(void)
+{
+	struct roaring a, b, dst;
+	bool *ref_a = calloc(TEST_ROARING_RANGE, sizeof(*ref_a));
+	bool *ref_b = calloc(TEST_ROARING_RANGE, sizeof(*ref_b));
+	bool *expected = calloc(TEST_ROARING_RANGE, sizeof(*expected));
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL(ref_a);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(ref_b);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(expected);
+
+	fill(&a, ref_a, 3);
+	fill(&b, ref_b, 4);
+
+	/* a loses the third container so there are keys b holds alone */
+	for (uint64_t val = 2 * 65536; val < TEST_ROARING_RANGE; val++) {
+		if (ref_a[val])
+			CU_ASSERT(roaring_remove(&a, val));
+		ref_a[val] = false;
+	}
+
+	roaring_init(&dst);
+	CU_ASSERT_FATAL(roaring_and(&dst, &a, &b));
+	for (size_t i = 0; i < TEST_ROARING_RANGE; i++)
+		expected[i] = ref_a[i] && ref_b[i];
+	check_equal(&dst, expected);
+	roaring_free(&dst);
+
+	CU_ASSERT_FATAL(roaring_or(&dst, &a, &b));
+	for (size_t i = 0; i < TEST_ROARING_RANGE; i++)
+		expected[i] = ref_a[i] || ref_b[i];
+	check_equal(&dst, expected);
+	roaring_free(&dst);
+
+	/* the dense containers mostly cancel out, the result is sparse again */
+	CU_ASSERT_FATAL(roaring_xor(&dst, &a, &b));
+	for (size_t i = 0; i < TEST_ROARING_RANGE; i++)
+		expected[i] = ref_a[i] != ref_b[i];
+	check_equal(&dst, expected);
+	for (size_t i = 0; i < dst.count; i++)
+		CU_ASSERT(!dst.containers[i].is_bitmap);
+	roaring_free(&dst);
+
+	/* an empty operand */
+	roaring_free(&b);
+	CU_ASSERT_FATAL(roaring_and(&dst, &a, &b));
+	CU_ASSERT_EQUAL(dst.count, 0);
+	CU_ASSERT_FATAL(roaring_or(&dst, &a, &b));
+	check_equal(&dst, ref_a);
+	roaring_free(&dst);
+
+	roaring_free(&a);
+	free(ref_a);
+	free(ref_b);
+	free(expected);
+}
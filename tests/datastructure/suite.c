@@ -20,6 +20,21 @@ bool datastructure_init_suite(void)
 	ADD_UNITTEST(suite, test_btree_insert__increase_height);
 	ADD_UNITTEST(suite, test_btree_update);
 	ADD_UNITTEST(suite, test_btree_remove);
+	/* bptree */
+	ADD_UNITTEST(suite, test_bptree_init);
+	ADD_UNITTEST(suite, test_bptree_insert);
+	ADD_UNITTEST(suite, test_bptree_remove);
+	ADD_UNITTEST(suite, test_bptree_cursor);
+	ADD_UNITTEST(suite, test_bptree_bulk_load);
+	/* bptree_i64 */
+	ADD_UNITTEST(suite, test_bptree_i64_insert);
+	ADD_UNITTEST(suite, test_bptree_i64_remove);
+	ADD_UNITTEST(suite, test_bptree_i64_cursor);
+	ADD_UNITTEST(suite, test_bptree_i64_bulk_load);
+	/* roaring */
+	ADD_UNITTEST(suite, test_roaring_add);
+	ADD_UNITTEST(suite, test_roaring_remove);
+	ADD_UNITTEST(suite, test_roaring_set_ops);
 	/* vector */
 	ADD_UNITTEST(suite, test_vector_init);
 	ADD_UNITTEST(suite, test_vector_push);
@@ -46,6 +61,7 @@ bool datastructure_init_suite(void)
 	ADD_UNITTEST(suite, test_hashtable_get);
 	ADD_UNITTEST(suite, test_hashtable_remove);
 	ADD_UNITTEST(suite, test_hashtable_iterate);
+	ADD_UNITTEST(suite, test_hashtable_mem_compare);
 
 	return false;
 }
@@ -7,6 +7,7 @@
 
 #include <tests/engine.h>
 #include <engine/database.h>
+#include <engine/query.h>
 
 void test_database_open(void)
 {
@@ -36,7 +37,9 @@ void test_database_add_table(void)
 
 	/* insert table 1 */
 	table_1 = table_init("test_123");
+	CU_ASSERT_EQUAL(database_lock(&db), MIDORIDB_OK);
 	CU_ASSERT_EQUAL(database_table_add(&db, table_1), MIDORIDB_OK);
+	CU_ASSERT_EQUAL(database_unlock(&db), MIDORIDB_OK);
 
 	/* check for table 1 */
 	entry = hashtable_get(db.tables, table_1->name, sizeof(table_1->name));
@@ -44,7 +47,9 @@ void test_database_add_table(void)
 
 	/* insert table 2 */
 	table_2 = table_init("test_456");
+	CU_ASSERT_EQUAL(database_lock(&db), MIDORIDB_OK);
 	CU_ASSERT_EQUAL(database_table_add(&db, table_2), MIDORIDB_OK);
+	CU_ASSERT_EQUAL(database_unlock(&db), MIDORIDB_OK);
 	/* check for table 1 && table 2*/
 	entry = hashtable_get(db.tables, table_1->name, sizeof(table_1->name));
 	CU_ASSERT_PTR_NOT_NULL(entry);
@@ -67,10 +72,104 @@ void test_database_table_exists(void)
 
 	/* existing table  */
 	table = table_init("test_123");
+	CU_ASSERT_EQUAL(database_lock(&db), MIDORIDB_OK);
 	CU_ASSERT_EQUAL(database_table_add(&db, table), MIDORIDB_OK);
+	CU_ASSERT_EQUAL(database_unlock(&db), MIDORIDB_OK);
 	CU_ASSERT(database_table_exists(&db, table->name));
 	/* non-existing table */
 	CU_ASSERT_FALSE(database_table_exists(&db, "bogus"));
 
 	database_close(&db);	
 }
+
+#define TEST_AUTOVACUUM_ROWS	8000
+
+static bool run_stmt(struct database *db, char *stmt)
+{
+	struct query_output *output;
+	bool ret;
+
+	output = query_execute(db, stmt);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(output);
+	ret = output->status == ST_OK_EXECUTED;
+	query_free(output);
+
+	return ret;
+}
+
+static size_t count_table_datablocks(struct table *table)
+{
+	struct list_head *pos;
+	size_t count = 0;
+
+	CU_ASSERT_EQUAL_FATAL(table_lock(table), MIDORIDB_OK);
+	list_for_each(pos, table->datablock_head)
+		count++;
+	table_unlock(table);
+
+	return count;
+}
+
+void test_database_autovacuum(void)
+{
+	struct database db = {0};
+	struct timespec nap = {.tv_nsec = 2000000};
+	struct table *table;
+	char stmt[65536];
+	size_t len, blocks;
+	bool done = false;
+
+	CU_ASSERT_EQUAL(database_open(&db), MIDORIDB_OK);
+
+	/* look at tables all the time so it runs in between the statements below */
+	CU_ASSERT_EQUAL(database_set_autovacuum(&db, 1), MIDORIDB_OK);
+
+	CU_ASSERT(run_stmt(&db, "CREATE TABLE A (id INT PRIMARY KEY, grp INT, name VARCHAR(16), INDEX(grp));"));
+	table = database_table_get(&db, "A");
+	CU_ASSERT_PTR_NOT_NULL_FATAL(table);
+
+	for (int i = 0; i < TEST_AUTOVACUUM_ROWS; i++) {
+		if (i % 2000 == 0)
+			strcpy(stmt, "INSERT INTO A VALUES ");
+
+		len = strlen(stmt);
+		snprintf(stmt + len, sizeof(stmt) - len, "(%d, %d, 'n%d')%s", i, i % 4, i, (i + 1) % 2000 ? "," : ";");
+
+		if ((i + 1) % 2000 == 0)
+			CU_ASSERT(run_stmt(&db, stmt));
+	}
+
+	blocks = count_table_datablocks(table);
+	CU_ASSERT(run_stmt(&db, "DELETE FROM A WHERE grp > 0;"));
+
+	/* statements keep going while the table gets compacted */
+	for (int i = 0; i < 5000 && !done; i++) {
+		CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM A WHERE grp = 0;"), TEST_AUTOVACUUM_ROWS / 4);
+		CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM A WHERE id = 4000;"), 1);
+
+		CU_ASSERT_EQUAL_FATAL(table_lock(table), MIDORIDB_OK);
+		done = !table->deleted_row_count && !table->vacuum.active;
+		table_unlock(table);
+
+		nanosleep(&nap, NULL);
+	}
+
+	CU_ASSERT(done);
+	CU_ASSERT(count_table_datablocks(table) <= blocks / 4 + 1);
+
+	/* rows and indexes are where they should be */
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM A;"), TEST_AUTOVACUUM_ROWS / 4);
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM A WHERE id = 4001;"), 0);
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM A WHERE id >= 7000 ORDER BY id;"), 250);
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM A WHERE name = 'n7996';"), 1);
+	CU_ASSERT(run_stmt(&db, "INSERT INTO A VALUES (8000, 0, 'n8000');"));
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM A WHERE grp = 0;"), TEST_AUTOVACUUM_ROWS / 4 + 1);
+
+	/* turned off it leaves tables alone */
+	CU_ASSERT_EQUAL(database_set_autovacuum(&db, 0), MIDORIDB_OK);
+	CU_ASSERT(run_stmt(&db, "DELETE FROM A WHERE id < 4000;"));
+	nanosleep(&nap, NULL);
+	CU_ASSERT_EQUAL(table->deleted_row_count, 1000);
+
+	database_close(&db);
+}
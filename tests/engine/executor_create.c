@@ -32,6 +32,9 @@ static void test_create_1(void)
 	CU_ASSERT_STRING_EQUAL(table->name, "TEST");
 	CU_ASSERT_EQUAL(table->column_count, 2);
 	CU_ASSERT_EQUAL(table->free_dtbkl_offset, 0);
+	/* narrow rows, datablocks stay as small as they get */
+	CU_ASSERT_EQUAL(table_block_size(table), DATABLOCK_PAGE_SIZE);
+	CU_ASSERT_FALSE(table->fixed_block_size);
 
 	CU_ASSERT_STRING_EQUAL(table->columns[0].name, "f1");
 	CU_ASSERT_EQUAL(table->columns[0].type, CT_INTEGER);
@@ -433,6 +436,31 @@ static void test_create_7(void)
 	database_close(&db);
 }
 
+static void test_create_8(void)
+{
+	struct database db = {0};
+	struct ast_node *node;
+	struct query_output output = {0};
+	struct hashtable_value *value;
+	struct table *table;
+
+	CU_ASSERT_EQUAL(database_open(&db), MIDORIDB_OK);
+
+	node = build_ast("CREATE TABLE TEST (f1 INT, f2 VARCHAR(32)) BLOCK_SIZE = 65536;");
+	CU_ASSERT_EQUAL(executor_run(&db, node, &output), MIDORIDB_OK);
+
+	value = hashtable_get(db.tables, "TEST", 5);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(value);
+	table = *(struct table**)value->content;
+
+	CU_ASSERT_EQUAL(table->column_count, 2);
+	CU_ASSERT_EQUAL(table_block_size(table), 65536);
+	CU_ASSERT(table->fixed_block_size);
+
+	ast_free(node);
+	database_close(&db);
+}
+
 void test_executor_create(void)
 {
 	/* create table - no index; no pk */
@@ -455,4 +483,7 @@ void test_executor_create(void)
 
 	/* create table - composed pk; multi-field index*/
 	test_create_7();
+
+	/* create table - datablock size */
+	test_create_8();
 }
@@ -2132,6 +2132,20 @@ static void test_delete_30(void)
 	CU_ASSERT(check_row(table, 3, &header_used, exp_row_4));
 	CU_ASSERT(check_row_flags(table, 4, &header_empty));
 
+	/* NOT IN - multiple values (row must differ from all of them) */
+	table = run_create_stmt(&db, "CREATE TABLE D (f1 INT, f2 INT);");
+	CU_ASSERT_EQUAL(run_stmt(&db, "INSERT INTO D VALUES (123, 123);"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(run_stmt(&db, "INSERT INTO D VALUES (456, 123);"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(run_stmt(&db, "INSERT INTO D VALUES (789, 987);"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(run_stmt(&db, "INSERT INTO D VALUES (101112, NULL);"), ST_OK_EXECUTED);
+
+	CU_ASSERT_EQUAL(run_stmt(&db, "DELETE FROM D WHERE f1 NOT IN (123, 456, 101112);"), ST_OK_EXECUTED);
+	CU_ASSERT(check_row(table, 0, &header_used, exp_row_1));
+	CU_ASSERT(check_row(table, 1, &header_used, exp_row_2));
+	CU_ASSERT(check_row_flags(table, 2, &header_deleted));
+	CU_ASSERT(check_row(table, 3, &header_used, exp_row_4));
+	CU_ASSERT(check_row_flags(table, 4, &header_empty));
+
 
 	/* database_close will take care of freeing table reference so free(table) is a noop */
 	database_close(&db);
@@ -2141,6 +2155,43 @@ static void test_delete_30(void)
 	free(exp_row_4);
 }
 
+static void test_delete_31(void)
+{
+	struct database db = {0};
+	struct table *table;
+	char stmt[65536];
+	size_t len;
+
+	CU_ASSERT_EQUAL(database_open(&db), MIDORIDB_OK);
+
+	/* machines running the tests may have a single CPU */
+	CU_ASSERT_EQUAL(database_set_threads(&db, 4), MIDORIDB_OK);
+
+	table = run_create_stmt(&db, "CREATE TABLE A (f1 INT, f2 INT);");
+
+	/* enough datablocks for several waves of morsels */
+	for (int j = 0; j < 40000; j++) {
+		if (j % 2000 == 0)
+			strcpy(stmt, "INSERT INTO A VALUES ");
+
+		len = strlen(stmt);
+		snprintf(stmt + len, sizeof(stmt) - len, "(%d, %d)%s", j, j % 10, (j + 1) % 2000 ? "," : ";");
+
+		if ((j + 1) % 2000 == 0)
+			CU_ASSERT_EQUAL(run_stmt(&db, stmt), ST_OK_EXECUTED);
+	}
+
+	CU_ASSERT_EQUAL(run_stmt(&db, "DELETE FROM A WHERE f2 = 3 OR f1 >= 39000;"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(table->row_count, 35100);
+	CU_ASSERT_EQUAL(table->deleted_row_count, 4900);
+
+	/* fetching a row walks the whole table, a sample will do */
+	for (size_t i = 0; i < 40000; i += 97)
+		CU_ASSERT(check_row_flags(table, i, (i % 10 == 3 || i >= 39000) ? &header_deleted : &header_used));
+
+	database_close(&db);
+}
+
 void test_executor_delete(void)
 {
 
@@ -2233,4 +2284,7 @@ void test_executor_delete(void)
 
 	/* multiple condition - IN / NOT IN*/
 	test_delete_30();
+
+	/* multiple condition - parallel scan */
+	test_delete_31();
 }
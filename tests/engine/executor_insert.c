@@ -239,6 +239,54 @@ static void test_insert_3(void)
 	free(data3_str);
 }
 
+static void test_insert_4(void)
+{
+	struct database db = {0};
+	struct table *table;
+
+	CU_ASSERT_EQUAL(database_open(&db), MIDORIDB_OK);
+
+	table = run_create_stmt(&db, "CREATE TABLE TEST (f1 INT PRIMARY KEY, f2 VARCHAR(4) UNIQUE, f3 DOUBLE UNIQUE);");
+	CU_ASSERT_EQUAL(run_stmt(&db, "INSERT INTO TEST VALUES (1, '1', 1.0);"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(run_stmt(&db, "INSERT INTO TEST VALUES (2, '2', 0.0);"), ST_OK_EXECUTED);
+
+	CU_ASSERT_EQUAL(run_stmt(&db, "INSERT INTO TEST VALUES (1, '3', 3.0);"), ST_ERROR);
+	CU_ASSERT_EQUAL(run_stmt(&db, "INSERT INTO TEST VALUES (3, '2', 3.0);"), ST_ERROR);
+	CU_ASSERT_EQUAL(run_stmt(&db, "INSERT INTO TEST VALUES (3, '3', -0.0);"), ST_ERROR);
+	CU_ASSERT_EQUAL(table->row_count, 2);
+
+	// NULLs never clash
+	CU_ASSERT_EQUAL(run_stmt(&db, "INSERT INTO TEST VALUES (3, NULL, NULL);"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(run_stmt(&db, "INSERT INTO TEST VALUES (4, NULL, NULL);"), ST_OK_EXECUTED);
+
+	// rows of the same stmt clash with each other too
+	CU_ASSERT_EQUAL(run_stmt(&db, "INSERT INTO TEST VALUES (5, '5', 5.0), (6, '5', 6.0);"), ST_ERROR);
+	CU_ASSERT_EQUAL(table->row_count, 4);
+
+	// and none of them makes it in when one clashes
+	CU_ASSERT_EQUAL(run_stmt(&db, "INSERT INTO TEST VALUES (5, '5', 5.0), (7, '7', 7.0), (8, '1', 8.0);"), ST_ERROR);
+	CU_ASSERT_EQUAL(table->row_count, 4);
+	CU_ASSERT_EQUAL(run_stmt(&db, "INSERT INTO TEST VALUES (5, '5', 5.0);"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(table->row_count, 5);
+
+	// values of deleted rows can be taken again
+	CU_ASSERT_EQUAL(run_stmt(&db, "DELETE FROM TEST WHERE f1 = 1;"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(run_stmt(&db, "INSERT INTO TEST VALUES (1, '1', 1.0);"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(table->row_count, 5);
+
+	// composite keys can't be enforced so they're turned down, PKs declared after the columns are enforced
+	CU_ASSERT_EQUAL(run_stmt(&db, "CREATE TABLE TEST2 (f1 INT, f2 INT, PRIMARY KEY (f1, f2));"), ST_ERROR);
+	CU_ASSERT_FALSE(database_table_exists(&db, "TEST2"));
+
+	table = run_create_stmt(&db, "CREATE TABLE TEST2 (f1 INT, f2 INT, PRIMARY KEY (f1));");
+	CU_ASSERT_EQUAL(run_stmt(&db, "INSERT INTO TEST2 VALUES (1, 1), (2, 1);"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(run_stmt(&db, "INSERT INTO TEST2 VALUES (1, 2);"), ST_ERROR);
+	CU_ASSERT_EQUAL(table->row_count, 2);
+
+	/* database_close will take care of freeing table reference so free(table) is a noop */
+	database_close(&db);
+}
+
 void test_executor_insert(void)
 {
 
@@ -251,6 +299,9 @@ void test_executor_insert(void)
 	/* insert table - mixed precision; single row; NULL and NOT NULL */
 	test_insert_3();
 
+	/* insert table - UNIQUE / PRIMARY KEY columns */
+	test_insert_4();
+
 	/*
 	 * TODO insert table - math expressions; fixed-precision; single row; NOT NULL cols; div by NOT 0 allowed (become NULL)
 	 *  Paulo: Add examples with both Div by 0 and without it...
@@ -161,6 +161,8 @@ static void test_select_4(void)
 		i++;
 	}
 
+	CU_ASSERT_EQUAL(i, 2);
+
 	query_free(output);
 	database_close(&db);
 }
@@ -284,6 +286,7 @@ static void test_select_8(void)
 		CU_ASSERT_EQUAL(query_column_int64(&output->results, 0), exp_vals[i][0]);
 		i++;
 	}
+	CU_ASSERT_EQUAL(i, ARR_SIZE(exp_vals));
 
 	query_free(output);
 	database_close(&db);
@@ -404,6 +407,877 @@ static void test_select_12(void)
 	database_close(&db);
 }
 
+static void test_select_13(void)
+{
+	struct database db = {0};
+	struct query_output *output;
+	int64_t exp_vals[][2] = {
+			{10, -2},
+			{20, -4},
+			{40, -2},
+	};
+	int i = 0;
+
+	CU_ASSERT_EQUAL(database_open(&db), MIDORIDB_OK);
+
+	CU_ASSERT_EQUAL(run_stmt(&db, "CREATE TABLE A (id_a INT, f1 INT);"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(run_stmt(&db, "INSERT INTO A VALUES (1, 10), (2, 20), (NULL, 30), (1, 40);"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(run_stmt(&db, "CREATE TABLE B (id_b INT, f2 INT);"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(run_stmt(&db, "INSERT INTO B VALUES (1, -1), (1, -2), (NULL, -3), (2, -4);"), ST_OK_EXECUTED);
+
+	/* duplicated keys on both sides, NULLs never match and remaining predicates still apply */
+	output = run_query(&db, "SELECT f1, f2 FROM A INNER JOIN B ON A.id_a = B.id_b AND B.f2 < -1;");
+
+	while (query_cur_step(&output->results) == MIDORIDB_ROW) {
+		CU_ASSERT_EQUAL(query_column_int64(&output->results, 0), exp_vals[i][0]);
+		CU_ASSERT_EQUAL(query_column_int64(&output->results, 1), exp_vals[i][1]);
+		i++;
+	}
+
+	CU_ASSERT_EQUAL(i, 3);
+
+	query_free(output);
+	database_close(&db);
+}
+
+static void test_select_14(void)
+{
+	struct database db = {0};
+	struct query_output *output;
+	char stmt[8192] = "INSERT INTO A VALUES ";
+	size_t len;
+	int i = 0;
+
+	CU_ASSERT_EQUAL(database_open(&db), MIDORIDB_OK);
+
+	CU_ASSERT_EQUAL(run_stmt(&db, "CREATE TABLE A (id INT);"), ST_OK_EXECUTED);
+
+	for (int j = 0; j < 500; j++) {
+		len = strlen(stmt);
+		snprintf(stmt + len, sizeof(stmt) - len, "(%d)%s", j, j < 499 ? "," : ";");
+	}
+	CU_ASSERT_EQUAL(run_stmt(&db, stmt), ST_OK_EXECUTED);
+
+	output = run_query(&db, "SELECT * FROM A;");
+
+	while (query_cur_step(&output->results) == MIDORIDB_ROW) {
+		CU_ASSERT_EQUAL(query_column_int64(&output->results, 0), i);
+		i++;
+	}
+
+	CU_ASSERT_EQUAL(i, 500);
+
+	query_free(output);
+	database_close(&db);
+}
+
+static void test_select_15(void)
+{
+	struct database db = {0};
+	struct query_output *output;
+	int64_t exp_vals[][3] = {
+			{2, 1, 1},
+			{2, 1, 2},
+			{3, 2, 1},
+			{1, 3, 3},
+	};
+	int i = 0;
+
+	CU_ASSERT_EQUAL(database_open(&db), MIDORIDB_OK);
+
+	CU_ASSERT_EQUAL(run_stmt(&db, "CREATE TABLE A (f1 INT, f2 INT);"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(run_stmt(&db, "INSERT INTO A VALUES (1, 1), (1, 2), (1, 1), (2, 1), (2, 1), (1, 2), (3, 3), (2, 1);"),
+			ST_OK_EXECUTED);
+
+	/* groups are made of the whole tuple rather than of each field separately */
+	output = run_query(&db, "SELECT f1, f2, COUNT(*) FROM A GROUP BY f1, f2;");
+
+	while (query_cur_step(&output->results) == MIDORIDB_ROW) {
+		CU_ASSERT_EQUAL(query_column_int64(&output->results, 0), exp_vals[i][0]);
+		CU_ASSERT_EQUAL(query_column_int64(&output->results, 1), exp_vals[i][1]);
+		CU_ASSERT_EQUAL(query_column_int64(&output->results, 2), exp_vals[i][2]);
+		i++;
+	}
+
+	CU_ASSERT_EQUAL(i, 4);
+
+	query_free(output);
+	database_close(&db);
+}
+
+static void test_select_16(void)
+{
+	struct database db = {0};
+	struct query_output *output;
+	char *stmts[] = {
+			"SELECT COUNT(*) FROM A;",
+			"SELECT COUNT(*) FROM A WHERE id > 1;",
+	};
+	int64_t exp_vals[][2] = {
+			{0, 0},
+			{3, 2},
+			{2, 1},
+	};
+	int i;
+
+	CU_ASSERT_EQUAL(database_open(&db), MIDORIDB_OK);
+
+	CU_ASSERT_EQUAL(run_stmt(&db, "CREATE TABLE A (id INT);"), ST_OK_EXECUTED);
+
+	for (int j = 0; j < 3; j++) {
+		if (j == 1)
+			CU_ASSERT_EQUAL(run_stmt(&db, "INSERT INTO A VALUES (1),(3),(4);"), ST_OK_EXECUTED);
+		if (j == 2)
+			CU_ASSERT_EQUAL(run_stmt(&db, "DELETE FROM A WHERE id = 3;"), ST_OK_EXECUTED);
+
+		for (size_t k = 0; k < ARR_SIZE(stmts); k++) {
+			output = run_query(&db, stmts[k]);
+
+			i = 0;
+			while (query_cur_step(&output->results) == MIDORIDB_ROW) {
+				CU_ASSERT_EQUAL(query_column_int64(&output->results, 0), exp_vals[j][k]);
+				i++;
+			}
+
+			/* COUNT(*) always yields a single row, even for empty tables */
+			CU_ASSERT_EQUAL(i, 1);
+
+			query_free(output);
+		}
+	}
+
+	database_close(&db);
+}
+
+static void test_select_17(void)
+{
+	struct database db = {0};
+	struct query_output *output;
+	int64_t exp_vals[][2] = {
+			{20, -4},
+			{40, -1},
+	};
+	int i = 0;
+
+	CU_ASSERT_EQUAL(database_open(&db), MIDORIDB_OK);
+
+	CU_ASSERT_EQUAL(run_stmt(&db, "CREATE TABLE A (id_a INT, f1 INT);"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(run_stmt(&db, "INSERT INTO A VALUES (1, 10), (2, 20), (NULL, 30), (1, 40), (3, 50);"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(run_stmt(&db, "CREATE TABLE B (id_b INT, f2 INT);"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(run_stmt(&db, "INSERT INTO B VALUES (1, -1), (1, -2), (NULL, -3), (2, -4), (3, -5);"), ST_OK_EXECUTED);
+
+	/* single-table conjuncts are pushed into both sides of the join, the last one is evaluated afterwards */
+	output = run_query(&db, "SELECT f1, f2 FROM A INNER JOIN B ON A.id_a = B.id_b "
+				"WHERE A.f1 > 10 AND B.f2 <> -2 AND (A.f1 < 30 OR B.f2 = -1);");
+
+	while (query_cur_step(&output->results) == MIDORIDB_ROW) {
+		CU_ASSERT_EQUAL(query_column_int64(&output->results, 0), exp_vals[i][0]);
+		CU_ASSERT_EQUAL(query_column_int64(&output->results, 1), exp_vals[i][1]);
+		i++;
+	}
+
+	CU_ASSERT_EQUAL(i, 2);
+	query_free(output);
+
+	/* every conjunct pushed down into a single table scan */
+	i = 0;
+	output = run_query(&db, "SELECT f1 FROM A WHERE f1 > 10 AND id_a = 1;");
+
+	while (query_cur_step(&output->results) == MIDORIDB_ROW) {
+		CU_ASSERT_EQUAL(query_column_int64(&output->results, 0), 40);
+		i++;
+	}
+
+	CU_ASSERT_EQUAL(i, 1);
+
+	query_free(output);
+	database_close(&db);
+}
+
+static void test_select_18(void)
+{
+	struct database db = {0};
+	struct query_output *output;
+	int64_t exp_vals[][2] = {
+			{2, 6},
+			{4, 8},
+	};
+	int i = 0;
+
+	CU_ASSERT_EQUAL(database_open(&db), MIDORIDB_OK);
+
+	CU_ASSERT_EQUAL(run_stmt(&db, "CREATE TABLE A (f1 INT, f2 VARCHAR(32), f3 INT, f4 DOUBLE, f5 INT);"),
+			ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(run_stmt(&db, "INSERT INTO A VALUES (1, 'aaa', 2, 1.5, 5), (2, NULL, 3, 2.5, 6), "
+					"(NULL, 'bbb', 4, 3.5, 7), (4, 'ccc', NULL, 4.5, 8);"), ST_OK_EXECUTED);
+
+	/* only referenced columns are materialised, WHERE-only columns don't make it to the output */
+	output = run_query(&db, "SELECT f1, f5 FROM A WHERE f4 > 2.0 AND f1 > 1;");
+
+	CU_ASSERT_EQUAL(output->results.table->column_count, 2);
+
+	while (query_cur_step(&output->results) == MIDORIDB_ROW) {
+		CU_ASSERT_EQUAL(query_column_int64(&output->results, 0), exp_vals[i][0]);
+		CU_ASSERT_EQUAL(query_column_int64(&output->results, 1), exp_vals[i][1]);
+		i++;
+	}
+
+	CU_ASSERT_EQUAL(i, 2);
+
+	query_free(output);
+	database_close(&db);
+}
+
+static void test_select_19(void)
+{
+	struct database db = {0};
+	struct query_output *output;
+	char stmt[8192] = "INSERT INTO A VALUES ";
+	size_t len;
+	int i = 0;
+
+	CU_ASSERT_EQUAL(database_open(&db), MIDORIDB_OK);
+
+	CU_ASSERT_EQUAL(run_stmt(&db, "CREATE TABLE A (id INT, f1 INT);"), ST_OK_EXECUTED);
+
+	for (int j = 0; j < 500; j++) {
+		len = strlen(stmt);
+		snprintf(stmt + len, sizeof(stmt) - len, "(%d, %d)%s", j, j % 5, j < 499 ? "," : ";");
+	}
+	CU_ASSERT_EQUAL(run_stmt(&db, stmt), ST_OK_EXECUTED);
+
+	/* no blocking operators: rows are pulled on demand rather than materialised up front */
+	output = run_query(&db, "SELECT id FROM A WHERE f1 = 3;");
+
+	CU_ASSERT_PTR_NOT_NULL(output->results.pipeline);
+	CU_ASSERT(list_is_empty(output->results.table->datablock_head));
+
+	while (query_cur_step(&output->results) == MIDORIDB_ROW) {
+		CU_ASSERT_EQUAL(query_column_int64(&output->results, 0), i * 5 + 3);
+		i++;
+	}
+
+	CU_ASSERT_EQUAL(i, 100);
+	CU_ASSERT_EQUAL(query_cur_step(&output->results), MIDORIDB_OK);
+	query_free(output);
+
+	/* giving up half-way through is fine too */
+	output = run_query(&db, "SELECT id FROM A;");
+	CU_ASSERT_EQUAL(query_cur_step(&output->results), MIDORIDB_ROW);
+	CU_ASSERT_EQUAL(query_column_int64(&output->results, 0), 0);
+	query_free(output);
+
+	/* GROUP BY has to see every row first */
+	output = run_query(&db, "SELECT f1, COUNT(*) FROM A GROUP BY f1;");
+	CU_ASSERT_PTR_NULL(output->results.pipeline);
+
+	i = 0;
+	while (query_cur_step(&output->results) == MIDORIDB_ROW)
+		i++;
+
+	CU_ASSERT_EQUAL(i, 5);
+
+	query_free(output);
+	database_close(&db);
+}
+
+static void test_select_20(void)
+{
+	struct database db = {0};
+	struct query_output *output;
+	char stmt[32768] = "INSERT INTO A VALUES ";
+	size_t len;
+	int64_t prev = -1, id;
+	int i = 0;
+
+	CU_ASSERT_EQUAL(database_open(&db), MIDORIDB_OK);
+
+	CU_ASSERT_EQUAL(run_stmt(&db, "CREATE TABLE A (id INT, f1 DOUBLE);"), ST_OK_EXECUTED);
+
+	/* enough rows to span a few batches, every 100th f1 is NULL */
+	for (int j = 0; j < 1500; j++) {
+		len = strlen(stmt);
+		if (j % 100)
+			snprintf(stmt + len, sizeof(stmt) - len, "(%d, %d.5)%s", j, j / 2, j < 1499 ? "," : ";");
+		else
+			snprintf(stmt + len, sizeof(stmt) - len, "(%d, NULL)%s", j, j < 1499 ? "," : ";");
+	}
+	CU_ASSERT_EQUAL(run_stmt(&db, stmt), ST_OK_EXECUTED);
+
+	output = run_query(&db, "SELECT id FROM A WHERE 100 <= id AND f1 < 300.0 AND id <> 150;");
+
+	while (query_cur_step(&output->results) == MIDORIDB_ROW) {
+		id = query_column_int64(&output->results, 0);
+
+		CU_ASSERT(id > prev);
+		CU_ASSERT(id >= 100 && id < 600 && id != 150 && id % 100);
+		prev = id;
+		i++;
+	}
+
+	CU_ASSERT_EQUAL(i, 494);
+	query_free(output);
+
+	/* conjuncts the batch kernels don't know about are evaluated row by row */
+	i = 0;
+	output = run_query(&db, "SELECT id FROM A WHERE id < 1000 AND (id = 7 OR id = 1200 OR f1 = 2.5);");
+
+	while (query_cur_step(&output->results) == MIDORIDB_ROW)
+		i++;
+
+	CU_ASSERT_EQUAL(i, 3); /* 5 and 4 both have f1 = 2.5 */
+
+	query_free(output);
+	database_close(&db);
+}
+
+static void test_select_21(void)
+{
+	struct database db = {0};
+	struct query_output *output;
+	char stmt[65536];
+	size_t len;
+	int64_t prev, id;
+	int i, j;
+
+	CU_ASSERT_EQUAL(database_open(&db), MIDORIDB_OK);
+
+	/* machines running the tests may have a single CPU */
+	CU_ASSERT_EQUAL(database_set_threads(&db, 4), MIDORIDB_OK);
+
+	CU_ASSERT_EQUAL(run_stmt(&db, "CREATE TABLE A (id INT, f1 INT);"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(run_stmt(&db, "CREATE TABLE B (k INT, v INT);"), ST_OK_EXECUTED);
+
+	/* enough datablocks for several waves of morsels */
+	for (j = 0; j < 40000; j++) {
+		if (j % 2000 == 0)
+			strcpy(stmt, "INSERT INTO A VALUES ");
+
+		len = strlen(stmt);
+		snprintf(stmt + len, sizeof(stmt) - len, "(%d, %d)%s", j, j % 10, (j + 1) % 2000 ? "," : ";");
+
+		if ((j + 1) % 2000 == 0)
+			CU_ASSERT_EQUAL(run_stmt(&db, stmt), ST_OK_EXECUTED);
+	}
+
+	for (j = 0; j < 10; j++) {
+		snprintf(stmt, sizeof(stmt), "INSERT INTO B VALUES (%d, %d);", j, j * 2);
+		CU_ASSERT_EQUAL(run_stmt(&db, stmt), ST_OK_EXECUTED);
+	}
+
+	/* morsels are scanned in parallel but rows must still come out in storage order */
+	for (size_t nthreads = 1; nthreads <= 4; nthreads += 3) {
+		CU_ASSERT_EQUAL(database_set_threads(&db, nthreads), MIDORIDB_OK);
+
+		i = 0;
+		prev = -1;
+		output = run_query(&db, "SELECT id FROM A WHERE f1 = 3 AND id >= 1000;");
+
+		while (query_cur_step(&output->results) == MIDORIDB_ROW) {
+			id = query_column_int64(&output->results, 0);
+
+			CU_ASSERT(id > prev);
+			CU_ASSERT(id >= 1000 && id % 10 == 3);
+			prev = id;
+			i++;
+		}
+
+		CU_ASSERT_EQUAL(i, 3900);
+		query_free(output);
+
+		/* inner side of the hash join is scanned in parallel as well */
+		i = 0;
+		prev = -1;
+		output = run_query(&db, "SELECT A.id, B.v FROM B JOIN A ON A.f1 = B.k WHERE A.id < 20000;");
+
+		while (query_cur_step(&output->results) == MIDORIDB_ROW) {
+			id = query_column_int64(&output->results, 0);
+
+			CU_ASSERT_EQUAL(query_column_int64(&output->results, 1), (id % 10) * 2);
+			i++;
+		}
+
+		CU_ASSERT_EQUAL(i, 20000);
+		query_free(output);
+	}
+
+	database_close(&db);
+}
+
+static void test_select_22(void)
+{
+	struct database db = {0};
+	struct query_output *output;
+	char stmt[65536] = "INSERT INTO A VALUES ";
+	size_t len;
+	int64_t prev = -1, id;
+	int i = 0;
+
+	CU_ASSERT_EQUAL(database_open(&db), MIDORIDB_OK);
+
+	CU_ASSERT_EQUAL(run_stmt(&db, "CREATE TABLE A (id INT, f1 INT, f2 VARCHAR(8), INDEX(f1), INDEX(f2));"),
+			ST_OK_EXECUTED);
+
+	for (int j = 0; j < 3000; j++) {
+		len = strlen(stmt);
+		snprintf(stmt + len, sizeof(stmt) - len, "(%d, %d, 'v%d')%s", j, j % 10, j % 7, j < 2999 ? "," : ";");
+	}
+	CU_ASSERT_EQUAL(run_stmt(&db, stmt), ST_OK_EXECUTED);
+
+	/* rows found through the index come out in storage order too */
+	output = run_query(&db, "SELECT id FROM A WHERE f1 = 3 AND id >= 1000;");
+
+	while (query_cur_step(&output->results) == MIDORIDB_ROW) {
+		id = query_column_int64(&output->results, 0);
+
+		CU_ASSERT(id > prev);
+		CU_ASSERT(id >= 1000 && id % 10 == 3);
+		prev = id;
+		i++;
+	}
+
+	CU_ASSERT_EQUAL(i, 200);
+	query_free(output);
+
+	/* indexes keep up with deleted and updated rows */
+	CU_ASSERT_EQUAL(run_stmt(&db, "DELETE FROM A WHERE f1 = 3;"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(run_stmt(&db, "UPDATE A SET f1 = 3 WHERE f2 = 'v5';"), ST_OK_EXECUTED);
+
+	i = 0;
+	output = run_query(&db, "SELECT id FROM A WHERE f1 = 3;");
+
+	while (query_cur_step(&output->results) == MIDORIDB_ROW) {
+		id = query_column_int64(&output->results, 0);
+
+		CU_ASSERT(id % 7 == 5 && id % 10 != 3);
+		i++;
+	}
+
+	CU_ASSERT_EQUAL(i, 385); /* 428 rows with f2 = 'v5', 43 of them were deleted */
+	query_free(output);
+	database_close(&db);
+}
+
+static void test_select_23(void)
+{
+	struct database db = {0};
+	struct query_output *output;
+	char stmt[65536] = "INSERT INTO A VALUES ";
+	size_t len;
+	int64_t prev, id, f1;
+	int i;
+
+	CU_ASSERT_EQUAL(database_open(&db), MIDORIDB_OK);
+
+	CU_ASSERT_EQUAL(run_stmt(&db, "CREATE TABLE A (id INT, f1 INT, INDEX(f1));"), ST_OK_EXECUTED);
+
+	/* f1 goes down as id goes up, every 100th row is NULL */
+	for (int j = 0; j < 3000; j++) {
+		len = strlen(stmt);
+		if (j % 100 == 0)
+			snprintf(stmt + len, sizeof(stmt) - len, "(%d, NULL)%s", j, j < 2999 ? "," : ";");
+		else
+			snprintf(stmt + len, sizeof(stmt) - len, "(%d, %d)%s", j, 2999 - j, j < 2999 ? "," : ";");
+	}
+	CU_ASSERT_EQUAL(run_stmt(&db, stmt), ST_OK_EXECUTED);
+
+	/* range lookups still come out in storage order */
+	i = 0;
+	prev = -1;
+	output = run_query(&db, "SELECT id, f1 FROM A WHERE f1 >= 100 AND f1 < 200;");
+
+	while (query_cur_step(&output->results) == MIDORIDB_ROW) {
+		id = query_column_int64(&output->results, 0);
+		f1 = query_column_int64(&output->results, 1);
+
+		CU_ASSERT(id > prev);
+		CU_ASSERT(f1 >= 100 && f1 < 200);
+		prev = id;
+		i++;
+	}
+
+	CU_ASSERT_EQUAL(i, 99); /* f1 = 199 belongs to a NULL row */
+	query_free(output);
+
+	/* ORDER BY an indexed column, bounded by the WHERE-clause */
+	i = 0;
+	prev = INT64_MAX;
+	output = run_query(&db, "SELECT id, f1 FROM A WHERE f1 > 2900 AND id <> 50 ORDER BY f1 DESC;");
+
+	while (query_cur_step(&output->results) == MIDORIDB_ROW) {
+		f1 = query_column_int64(&output->results, 1);
+
+		CU_ASSERT(f1 < prev && f1 > 2900 && f1 != 2949);
+		prev = f1;
+		i++;
+	}
+
+	CU_ASSERT_EQUAL(i, 97);
+	query_free(output);
+
+	/* NULLs come first in ascending order... */
+	i = 0;
+	prev = -1;
+	output = run_query(&db, "SELECT id, f1 FROM A ORDER BY f1;");
+
+	while (query_cur_step(&output->results) == MIDORIDB_ROW) {
+		id = query_column_int64(&output->results, 0);
+		f1 = query_column_int64(&output->results, 1);
+
+		if (i < 30) {
+			CU_ASSERT_EQUAL(id, i * 100);
+		} else {
+			CU_ASSERT(f1 > prev);
+			prev = f1;
+		}
+		i++;
+	}
+
+	CU_ASSERT_EQUAL(i, 3000);
+	query_free(output);
+
+	/* ...and last in descending order */
+	CU_ASSERT_EQUAL(run_stmt(&db, "DELETE FROM A WHERE f1 < 1000;"), ST_OK_EXECUTED);
+
+	i = 0;
+	prev = INT64_MAX;
+	output = run_query(&db, "SELECT id, f1 FROM A ORDER BY f1 DESC;");
+
+	while (query_cur_step(&output->results) == MIDORIDB_ROW) {
+		id = query_column_int64(&output->results, 0);
+		f1 = query_column_int64(&output->results, 1);
+
+		if (i >= 1980) {
+			CU_ASSERT_EQUAL(id, (i - 1980) * 100);
+		} else {
+			CU_ASSERT(f1 < prev && f1 >= 1000);
+			prev = f1;
+		}
+		i++;
+	}
+
+	CU_ASSERT_EQUAL(i, 2010); /* 990 rows deleted, NULLs are left alone */
+	query_free(output);
+	database_close(&db);
+}
+
+static void test_select_24(void)
+{
+	struct database db = {0};
+	struct query_output *output;
+	char stmt[65536] = "INSERT INTO F VALUES ";
+	size_t len;
+	int64_t prev = -1, f_id, k;
+	int i, expected;
+
+	CU_ASSERT_EQUAL(database_open(&db), MIDORIDB_OK);
+
+	CU_ASSERT_EQUAL(run_stmt(&db, "CREATE TABLE F (id INT, d INT);"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(run_stmt(&db, "CREATE TABLE D (k INT PRIMARY KEY, grp INT, INDEX(grp));"), ST_OK_EXECUTED);
+
+	/* facts point to dimensions 0..59 (50..59 don't exist), every 100th of them to none */
+	for (int j = 0; j < 3000; j++) {
+		len = strlen(stmt);
+		if (j % 100 == 0)
+			snprintf(stmt + len, sizeof(stmt) - len, "(%d, NULL)%s", j, j < 2999 ? "," : ";");
+		else
+			snprintf(stmt + len, sizeof(stmt) - len, "(%d, %d)%s", j, j % 60, j < 2999 ? "," : ";");
+	}
+	CU_ASSERT_EQUAL(run_stmt(&db, stmt), ST_OK_EXECUTED);
+
+	strcpy(stmt, "INSERT INTO D VALUES ");
+	for (int j = 0; j < 50; j++) {
+		len = strlen(stmt);
+		snprintf(stmt + len, sizeof(stmt) - len, "(%d, %d)%s", j, j % 5, j < 49 ? "," : ";");
+	}
+	CU_ASSERT_EQUAL(run_stmt(&db, stmt), ST_OK_EXECUTED);
+
+	/* probing the primary key, rows come out in the order of the outer table (inner columns come first) */
+	i = 0;
+	expected = 0;
+	output = run_query(&db, "SELECT F.id, D.k FROM F INNER JOIN D ON F.d = D.k;");
+
+	while (query_cur_step(&output->results) == MIDORIDB_ROW) {
+		k = query_column_int64(&output->results, 0);
+		f_id = query_column_int64(&output->results, 1);
+
+		CU_ASSERT(f_id > prev);
+		CU_ASSERT_EQUAL(k, f_id % 60);
+		prev = f_id;
+		i++;
+	}
+
+	for (int j = 0; j < 3000; j++)
+		expected += j % 100 && j % 60 < 50;
+
+	CU_ASSERT_EQUAL(i, expected);
+	query_free(output);
+
+	/* probing a non-unique index, inner rows are still filtered by the WHERE-clause */
+	i = 0;
+	expected = 0;
+	output = run_query(&db, "SELECT F.id, D.k FROM F INNER JOIN D ON F.d = D.grp WHERE D.k < 10;");
+
+	while (query_cur_step(&output->results) == MIDORIDB_ROW) {
+		k = query_column_int64(&output->results, 0);
+		f_id = query_column_int64(&output->results, 1);
+
+		CU_ASSERT(k < 10 && k % 5 == f_id % 60);
+		i++;
+	}
+
+	for (int j = 0; j < 3000; j++)
+		expected += (j % 100 && j % 60 < 5) ? 2 : 0;
+
+	CU_ASSERT_EQUAL(i, expected);
+	query_free(output);
+	database_close(&db);
+}
+
+static void test_select_25(void)
+{
+	struct database db = {0};
+	char stmt[65536];
+	size_t len;
+
+	CU_ASSERT_EQUAL(database_open(&db), MIDORIDB_OK);
+	CU_ASSERT_EQUAL(run_stmt(&db, "CREATE TABLE E (id INT, ts INT, v DOUBLE);"), ST_OK_EXECUTED);
+
+	/* events come in time order so every datablock covers a narrow range of ts, every 50th ts is NULL */
+	for (int k = 0; k < 4; k++) {
+		strcpy(stmt, "INSERT INTO E VALUES ");
+
+		for (int j = k * 1000; j < (k + 1) * 1000; j++) {
+			len = strlen(stmt);
+			if (j % 50 == 0)
+				snprintf(stmt + len, sizeof(stmt) - len, "(%d, NULL, %d.5)%s", j, j, j % 1000 < 999 ? "," : ";");
+			else
+				snprintf(stmt + len, sizeof(stmt) - len, "(%d, %d, %d.5)%s", j, j, j, j % 1000 < 999 ? "," : ";");
+		}
+		CU_ASSERT_EQUAL(run_stmt(&db, stmt), ST_OK_EXECUTED);
+	}
+
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM E WHERE ts > 3899;"), 98);
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM E WHERE ts >= 100 AND ts < 200;"), 98);
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM E WHERE ts = 1234;"), 1);
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM E WHERE ts < 0;"), 0);
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM E WHERE v < 10.0;"), 10);
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM E WHERE ts IS NULL;"), 80);
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM E WHERE ts IS NOT NULL;"), 3920);
+
+	/* updated rows widen the range of their datablock */
+	CU_ASSERT_EQUAL(run_stmt(&db, "UPDATE E SET ts = 5 WHERE id = 3999;"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM E WHERE ts < 10;"), 10);
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM E WHERE ts > 3899;"), 97);
+
+	/* whole datablocks are skipped by DELETE and UPDATE too */
+	CU_ASSERT_EQUAL(run_stmt(&db, "DELETE FROM E WHERE ts >= 3000;"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM E WHERE id >= 3000;"), 21);
+	CU_ASSERT_EQUAL(run_stmt(&db, "UPDATE E SET v = 0.0 WHERE ts <= 10;"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM E WHERE v = 0.0;"), 11);
+
+	database_close(&db);
+}
+
+static void test_select_26(void)
+{
+	struct database db = {0};
+	struct query_output *output;
+	char stmt[65536] = "INSERT INTO U VALUES ";
+	size_t len;
+	int i = 0;
+
+	CU_ASSERT_EQUAL(database_open(&db), MIDORIDB_OK);
+	CU_ASSERT_EQUAL(run_stmt(&db, "CREATE TABLE U (id INT, user_id VARCHAR(16) BLOOM);"), ST_OK_EXECUTED);
+
+	for (int j = 0; j < 2000; j++) {
+		len = strlen(stmt);
+		snprintf(stmt + len, sizeof(stmt) - len, "(%d, 'u%d')%s", j, j, j < 1999 ? "," : ";");
+	}
+	CU_ASSERT_EQUAL(run_stmt(&db, stmt), ST_OK_EXECUTED);
+
+	output = run_query(&db, "SELECT id FROM U WHERE user_id = 'u1234';");
+
+	while (query_cur_step(&output->results) == MIDORIDB_ROW) {
+		CU_ASSERT_EQUAL(query_column_int64(&output->results, 0), 1234);
+		i++;
+	}
+
+	CU_ASSERT_EQUAL(i, 1);
+	query_free(output);
+
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM U WHERE user_id = 'nobody';"), 0);
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM U WHERE user_id = 'u7' AND id = 7;"), 1);
+
+	/* new values make it to the filters, old ones linger but rows don't match them anymore */
+	CU_ASSERT_EQUAL(run_stmt(&db, "UPDATE U SET user_id = 'moved' WHERE id = 10;"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM U WHERE user_id = 'moved';"), 1);
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM U WHERE user_id = 'u10';"), 0);
+
+	CU_ASSERT_EQUAL(run_stmt(&db, "DELETE FROM U WHERE user_id = 'u1999';"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM U WHERE id > 1990;"), 8);
+
+	database_close(&db);
+}
+
+static void test_select_27(void)
+{
+	struct database db = {0};
+	char stmt[131072] = "INSERT INTO F VALUES ";
+	size_t len;
+
+	CU_ASSERT_EQUAL(database_open(&db), MIDORIDB_OK);
+	CU_ASSERT_EQUAL(run_stmt(&db, "CREATE TABLE F (id INT, active TINYINT, premium TINYINT, banned TINYINT, "
+			"INDEX(active), INDEX(premium), INDEX(banned));"), ST_OK_EXECUTED);
+
+	/* even rows are active, every 5th is premium (unknown for every 11th) and every 10th + 3 banned */
+	for (int j = 0; j < 2000; j++) {
+		len = strlen(stmt);
+		snprintf(stmt + len, sizeof(stmt) - len, "(%d, %s, %s, %s)%s", j, j % 2 ? "FALSE" : "TRUE",
+				j % 11 == 0 ? "NULL" : (j % 5 ? "FALSE" : "TRUE"), j % 10 == 3 ? "TRUE" : "FALSE",
+				j < 1999 ? "," : ";");
+	}
+	CU_ASSERT_EQUAL(run_stmt(&db, stmt), ST_OK_EXECUTED);
+
+	/* AND, OR, XOR and NOT IN of flags */
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM F WHERE active = TRUE AND premium = TRUE;"), 181);
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM F WHERE (premium = TRUE OR banned = TRUE) AND active = FALSE;"),
+			382);
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM F WHERE premium = TRUE XOR banned = TRUE;"), 563);
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM F WHERE banned NOT IN (FALSE) AND active <> TRUE;"), 200);
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM F WHERE premium IS NULL;"), 182);
+
+	/* flags mixed with anything else */
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM F WHERE active = TRUE AND premium = TRUE AND id < 1000;"), 90);
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM F WHERE premium = TRUE OR id = 1;"), 364);
+
+	/* indexes follow updates and deletes */
+	CU_ASSERT_EQUAL(run_stmt(&db, "UPDATE F SET premium = FALSE WHERE active = TRUE AND premium = TRUE;"),
+			ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM F WHERE active = TRUE AND premium = TRUE;"), 0);
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM F WHERE active = TRUE AND premium = FALSE;"), 909);
+
+	CU_ASSERT_EQUAL(run_stmt(&db, "DELETE FROM F WHERE banned = TRUE AND active = FALSE;"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM F WHERE banned = TRUE;"), 0);
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM F;"), 1800);
+
+	database_close(&db);
+}
+
+static void test_select_28(void)
+{
+	struct database db = {0};
+	struct query_output *output, *other;
+	char stmt[8192] = "INSERT INTO A VALUES ";
+	size_t len;
+	int i = 0;
+
+	CU_ASSERT_EQUAL(database_open(&db), MIDORIDB_OK);
+
+	CU_ASSERT_EQUAL(run_stmt(&db, "CREATE TABLE A (id INT, f1 INT);"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(run_stmt(&db, "CREATE TABLE B (k INT);"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(run_stmt(&db, "INSERT INTO B VALUES (1), (2);"), ST_OK_EXECUTED);
+
+	for (int j = 0; j < 500; j++) {
+		len = strlen(stmt);
+		snprintf(stmt + len, sizeof(stmt) - len, "(%d, %d)%s", j, j % 5, j < 499 ? "," : ";");
+	}
+	CU_ASSERT_EQUAL(run_stmt(&db, stmt), ST_OK_EXECUTED);
+
+	output = run_query(&db, "SELECT id, f1 FROM A;");
+	other = run_query(&db, "SELECT k FROM B;");
+	CU_ASSERT_PTR_NOT_NULL(output->results.pipeline);
+
+	while (i < 250 && query_cur_step(&output->results) == MIDORIDB_ROW)
+		i++;
+
+	/* writes go through, the result set keeps returning rows as they were when it was opened */
+	CU_ASSERT_EQUAL(run_stmt(&db, "DELETE FROM A WHERE id >= 400;"), ST_OK_EXECUTED);
+	CU_ASSERT_PTR_NULL(output->results.pipeline);
+	CU_ASSERT_EQUAL(run_stmt(&db, "INSERT INTO A VALUES (1000, 0);"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(run_stmt(&db, "UPDATE A SET f1 = 9 WHERE id < 300;"), ST_OK_EXECUTED);
+
+	/* the current row is still there */
+	CU_ASSERT_EQUAL(query_column_int64(&output->results, 0), 249);
+
+	while (query_cur_step(&output->results) == MIDORIDB_ROW) {
+		CU_ASSERT_EQUAL(query_column_int64(&output->results, 0), i);
+		CU_ASSERT_EQUAL(query_column_int64(&output->results, 1), i % 5);
+		i++;
+	}
+
+	CU_ASSERT_EQUAL(i, 500);
+	query_free(output);
+
+	/* result sets of other tables are left streaming */
+	CU_ASSERT_PTR_NOT_NULL(other->results.pipeline);
+	query_free(other);
+
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM A;"), 401);
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM A WHERE f1 = 9;"), 300);
+
+	/* same goes for the inner table of a join */
+	output = run_query(&db, "SELECT * FROM A INNER JOIN B ON A.f1 = B.k;");
+	CU_ASSERT_PTR_NOT_NULL(output->results.pipeline);
+	CU_ASSERT_EQUAL(run_stmt(&db, "DELETE FROM B;"), ST_OK_EXECUTED);
+	CU_ASSERT_PTR_NULL(output->results.pipeline);
+
+	i = 0;
+	while (query_cur_step(&output->results) == MIDORIDB_ROW)
+		i++;
+
+	/* ids 301..399 with f1 1 or 2 */
+	CU_ASSERT_EQUAL(i, 40);
+	query_free(output);
+
+	/* and result sets outlive the database */
+	output = run_query(&db, "SELECT id FROM A WHERE id < 10;");
+	CU_ASSERT_EQUAL(query_cur_step(&output->results), MIDORIDB_ROW);
+	database_close(&db);
+
+	i = 1;
+	while (query_cur_step(&output->results) == MIDORIDB_ROW)
+		i++;
+
+	CU_ASSERT_EQUAL(i, 10);
+	query_free(output);
+}
+
+static void test_select_29(void)
+{
+	struct database db = {0};
+	struct query_output *output;
+	int i = 0;
+
+	CU_ASSERT_EQUAL(database_open(&db), MIDORIDB_OK);
+
+	CU_ASSERT_EQUAL(run_stmt(&db, "CREATE TABLE A (id INT, f1 INT);"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(run_stmt(&db, "INSERT INTO A VALUES (1, 5000000000), (2, -5000000000), (3, 705032704);"),
+			ST_OK_EXECUTED);
+
+	/* 5000000000 cut down to 32 bits is 705032704 */
+	output = run_query(&db, "SELECT id, f1 FROM A WHERE f1 = 5000000000;");
+
+	while (query_cur_step(&output->results) == MIDORIDB_ROW) {
+		CU_ASSERT_EQUAL(query_column_int64(&output->results, 0), 1);
+		CU_ASSERT_EQUAL(query_column_int64(&output->results, 1), 5000000000LL);
+		i++;
+	}
+
+	CU_ASSERT_EQUAL(i, 1);
+	query_free(output);
+
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM A WHERE f1 > 4294967296;"), 1);
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM A WHERE f1 < -4294967296;"), 1);
+
+	CU_ASSERT_EQUAL(run_stmt(&db, "UPDATE A SET f1 = 9000000000 WHERE f1 = -5000000000;"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM A WHERE f1 = 9000000000;"), 1);
+	CU_ASSERT_EQUAL(run_stmt(&db, "DELETE FROM A WHERE f1 >= 5000000000;"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(count_rows(&db, "SELECT id FROM A;"), 1);
+
+	database_close(&db);
+}
+
 void test_executor_select(void)
 {
 	/* single field */
@@ -441,4 +1315,47 @@ void test_executor_select(void)
 
 	/* single table - count only */
 	test_select_12();
+
+	/* single join - equi-join with duplicated keys, NULLs and residual predicate */
+	test_select_13();
+
+	/* single table - results spanning multiple datablocks */
+	test_select_14();
+
+	/* single table - group by clause with multiple fields + count */
+	test_select_15();
+
+	/* single table - count only - with and without filters */
+	test_select_16();
+	test_select_17();
+	test_select_18();
+	test_select_19();
+	test_select_20();
+
+	/* single table / single join - parallel scans */
+	test_select_21();
+
+	/* single table - index lookups */
+	test_select_22();
+
+	/* single table - index range lookups + order by */
+	test_select_23();
+
+	/* single join - index nested loop */
+	test_select_24();
+
+	/* single table - datablocks skipped through zone maps */
+	test_select_25();
+
+	/* single table - datablocks skipped through Bloom filters */
+	test_select_26();
+
+	/* single table - flags combined through bitmap indexes */
+	test_select_27();
+
+	/* single table / single join - writes while result sets are open */
+	test_select_28();
+
+	/* single table - integers beyond 32 bits */
+	test_select_29();
 }
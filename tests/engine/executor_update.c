@@ -7,6 +7,7 @@
 
 #include <tests/engine.h>
 #include <engine/executor.h>
+#include <primitive/index.h>
 
 extern struct ast_node* build_ast(char *stmt);
 
@@ -2288,6 +2289,20 @@ static void test_update_30(void)
 	CU_ASSERT(check_row(table, 3, &header_used, aft_row_4));
 	CU_ASSERT(check_row_flags(table, 4, &header_empty));
 
+	/* NOT IN - multiple values (row must differ from all of them) */
+	table = run_create_stmt(&db, "CREATE TABLE D (f1 INT, f2 INT);");
+	CU_ASSERT_EQUAL(run_stmt(&db, "INSERT INTO D VALUES (123, 123);"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(run_stmt(&db, "INSERT INTO D VALUES (456, 123);"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(run_stmt(&db, "INSERT INTO D VALUES (789, 987);"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(run_stmt(&db, "INSERT INTO D VALUES (101112, NULL);"), ST_OK_EXECUTED);
+
+	CU_ASSERT_EQUAL(run_stmt(&db, "UPDATE D SET f1=42, f2=43 WHERE f1 NOT IN (123, 456, 101112);"), ST_OK_EXECUTED);
+	CU_ASSERT(check_row(table, 0, &header_used, aft_row_1));
+	CU_ASSERT(check_row(table, 1, &header_used, aft_row_2));
+	CU_ASSERT(check_row(table, 2, &header_used, aft_row_3));
+	CU_ASSERT(check_row(table, 3, &header_used, aft_row_4));
+	CU_ASSERT(check_row_flags(table, 4, &header_empty));
+
 	/* database_close will take care of freeing table reference so free(table) is a noop */
 	database_close(&db);
 	free(bef_row_1);
@@ -2300,6 +2315,133 @@ static void test_update_30(void)
 	free(aft_row_4);
 }
 
+static void test_update_31(void)
+{
+	struct fp_types_row {
+		int64_t val_1;
+		int64_t val_2;
+	} __packed;
+
+	struct database db = {0};
+	struct table *table;
+	struct fp_types_row exp_data;
+	char stmt[65536];
+	size_t len;
+
+	CU_ASSERT_EQUAL(database_open(&db), MIDORIDB_OK);
+
+	/* machines running the tests may have a single CPU */
+	CU_ASSERT_EQUAL(database_set_threads(&db, 4), MIDORIDB_OK);
+
+	table = run_create_stmt(&db, "CREATE TABLE A (f1 INT, f2 INT);");
+
+	/* enough datablocks for several waves of morsels */
+	for (int j = 0; j < 40000; j++) {
+		if (j % 2000 == 0)
+			strcpy(stmt, "INSERT INTO A VALUES ");
+
+		len = strlen(stmt);
+		snprintf(stmt + len, sizeof(stmt) - len, "(%d, %d)%s", j, j % 10, (j + 1) % 2000 ? "," : ";");
+
+		if ((j + 1) % 2000 == 0)
+			CU_ASSERT_EQUAL(run_stmt(&db, stmt), ST_OK_EXECUTED);
+	}
+
+	CU_ASSERT_EQUAL(run_stmt(&db, "UPDATE A SET f2 = 42 WHERE f2 = 3 OR f1 >= 39000;"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(table->row_count, 40000);
+
+	/* fetching a row walks the whole table, a sample will do */
+	for (size_t i = 0; i < 40000; i += 97) {
+		exp_data.val_1 = i;
+		exp_data.val_2 = (i % 10 == 3 || i >= 39000) ? 42 : i % 10;
+
+		CU_ASSERT(check_row_flags(table, i, &header_used));
+		CU_ASSERT(check_row_data(table, i, &exp_data));
+	}
+
+	database_close(&db);
+}
+
+static void test_update_32(void)
+{
+	struct fp_types_row {
+		int64_t val_1;
+		int64_t val_2;
+	} __packed;
+
+	struct database db = {0};
+	struct table *table;
+	struct fp_types_row exp_data[] = {{1, 10}, {2, 20}, {3, 30}};
+
+	CU_ASSERT_EQUAL(database_open(&db), MIDORIDB_OK);
+
+	table = run_create_stmt(&db, "CREATE TABLE TEST (f1 INT PRIMARY KEY, f2 INT UNIQUE);");
+	CU_ASSERT_EQUAL(run_stmt(&db, "INSERT INTO TEST VALUES (1, 1), (2, 2), (3, 3);"), ST_OK_EXECUTED);
+
+	/* a row may keep its own value */
+	CU_ASSERT_EQUAL(run_stmt(&db, "UPDATE TEST SET f1 = 1, f2 = 10 WHERE f1 = 1;"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(run_stmt(&db, "UPDATE TEST SET f2 = 20 WHERE f1 = 2;"), ST_OK_EXECUTED);
+
+	/* but can't take the one of another row */
+	CU_ASSERT_EQUAL(run_stmt(&db, "UPDATE TEST SET f1 = 2 WHERE f1 = 3;"), ST_ERROR);
+
+	/* nor share it with other rows being updated */
+	CU_ASSERT_EQUAL(run_stmt(&db, "UPDATE TEST SET f2 = 30 WHERE f1 >= 3;"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(run_stmt(&db, "UPDATE TEST SET f2 = 40 WHERE f1 > 0;"), ST_ERROR);
+	CU_ASSERT_EQUAL(run_stmt(&db, "UPDATE TEST SET f2 = 40 WHERE f1 > 5;"), ST_OK_EXECUTED);
+
+	for (size_t i = 0; i < ARR_SIZE(exp_data); i++) {
+		CU_ASSERT(check_row_flags(table, i, &header_used));
+		CU_ASSERT(check_row_data(table, i, &exp_data[i]));
+	}
+
+	database_close(&db);
+}
+
+static void test_update_33(void)
+{
+	struct fp_types_row {
+		int64_t val_1;
+		int64_t val_2;
+	} __packed;
+
+	struct database db = {0};
+	struct table *table;
+	struct vector locs;
+	struct fp_types_row exp_data[] = {{1, 10}, {2, 20}};
+	int64_t key;
+
+	CU_ASSERT_EQUAL(database_open(&db), MIDORIDB_OK);
+
+	table = run_create_stmt(&db, "CREATE TABLE TEST (f1 INT PRIMARY KEY, f2 INT UNIQUE);");
+	CU_ASSERT_EQUAL(run_stmt(&db, "INSERT INTO TEST VALUES (1, 10), (2, 20);"), ST_OK_EXECUTED);
+
+	/* the new value is held by the row itself as far as f2's index is concerned, so it can't be re-indexed */
+	CU_ASSERT_FATAL(vector_init(&locs));
+	key = 1;
+	CU_ASSERT_FATAL(table_index_lookup(table, 0, &key, &locs));
+	CU_ASSERT_EQUAL_FATAL(locs.len, sizeof(struct row_location));
+	key = 30;
+	CU_ASSERT_FATAL(hashtable_put(table->indexes[1]->hash, &key, sizeof(key), locs.data, locs.len));
+
+	CU_ASSERT_EQUAL(run_stmt(&db, "UPDATE TEST SET f1 = 3, f2 = 30 WHERE f1 = 1;"), ST_ERROR);
+
+	hashtable_free_entry(hashtable_remove(table->indexes[1]->hash, &key, sizeof(key)));
+	vector_free(&locs);
+
+	/* row is left as it was, indexes included */
+	for (size_t i = 0; i < ARR_SIZE(exp_data); i++) {
+		CU_ASSERT(check_row_flags(table, i, &header_used));
+		CU_ASSERT(check_row_data(table, i, &exp_data[i]));
+	}
+
+	CU_ASSERT_EQUAL(run_stmt(&db, "UPDATE TEST SET f1 = 3, f2 = 30 WHERE f2 = 10;"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(run_stmt(&db, "DELETE FROM TEST WHERE f1 = 3;"), ST_OK_EXECUTED);
+	CU_ASSERT_EQUAL(table->row_count, 1);
+
+	database_close(&db);
+}
+
 void test_executor_update(void)
 {
 
@@ -2392,4 +2534,13 @@ void test_executor_update(void)
 
 	/* multiple condition - IN / NOT IN*/
 	test_update_30();
+
+	/* multiple condition - parallel scan */
+	test_update_31();
+
+	/* UNIQUE / PRIMARY KEY columns */
+	test_update_32();
+
+	/* rows whose new content can't be indexed */
+	test_update_33();
 }
@@ -0,0 +1,176 @@
+/*
+ * filter.c
+ *
+ *  Created on: 17/10/2026
+ *      Author: paulo
+ */
+
+#include <tests/engine.h>
+#include <engine/filter.h>
+
+#define TEST_FILTER_MAX_VALS 1000
+
+static enum ast_comparison_type cmp_types[] = {
+	AST_CMP_DIFF_OP,
+	AST_CMP_EQUALS_OP,
+	AST_CMP_GTE_OP,
+	AST_CMP_GT_OP,
+	AST_CMP_LTE_OP,
+	AST_CMP_LT_OP,
+};
+
+static size_t val_counts[] = {0, 1, 3, 15, 16, 17, 63, 64, 65, 130, TEST_FILTER_MAX_VALS};
+
+static bool exp_cmp(enum ast_comparison_type cmp_type, double cmp)
+{
+	switch (cmp_type) {
+	case AST_CMP_DIFF_OP:
+		return cmp != 0;
+	case AST_CMP_EQUALS_OP:
+		return cmp == 0;
+	case AST_CMP_GTE_OP:
+		return cmp >= 0;
+	case AST_CMP_GT_OP:
+		return cmp > 0;
+	case AST_CMP_LTE_OP:
+		return cmp <= 0;
+	case AST_CMP_LT_OP:
+		return cmp < 0;
+	default:
+		return false;
+	}
+}
+
+static bool check_bitmap(uint64_t *bitmap, bool *exp, size_t n)
+{
+	for (size_t i = 0; i < FILTER_BITMAP_WORDS(n) * 64; i++) {
+		bool bit = (bitmap[i / 64] >> (i % 64)) & 1;
+
+		/* bits past the last value must be clear */
+		if (bit != (i < n && exp[i]))
+			return false;
+	}
+	return true;
+}
+
+static void test_filter_int64(void)
+{
+	int64_t vals[TEST_FILTER_MAX_VALS];
+	int64_t rhs_vals[] = {0, 42, -42, INT64_MAX, INT64_MIN, 5000000000};
+	uint64_t bitmap[FILTER_BITMAP_WORDS(TEST_FILTER_MAX_VALS)];
+	bool exp[TEST_FILTER_MAX_VALS];
+
+	for (size_t i = 0; i < ARR_SIZE(vals); i++)
+		vals[i] = ((int64_t)(i % 7) - 3) * 14; /* -42..42, so every operator has hits and misses */
+
+	vals[5] = INT64_MAX;
+	vals[6] = INT64_MIN;
+	vals[77] = 5000000000;
+	vals[78] = 705032704; /* 5000000000 truncated to 32-bit */
+
+	for (size_t r = 0; r < ARR_SIZE(rhs_vals); r++) {
+		for (size_t c = 0; c < ARR_SIZE(cmp_types); c++) {
+			for (size_t k = 0; k < ARR_SIZE(val_counts); k++) {
+				size_t n = val_counts[k];
+
+				for (size_t i = 0; i < n; i++)
+					exp[i] = exp_cmp(cmp_types[c], (vals[i] > rhs_vals[r]) - (vals[i] < rhs_vals[r]));
+
+				memset(bitmap, 0xFF, sizeof(bitmap));
+				filter_int64(cmp_types[c], vals, n, rhs_vals[r], bitmap);
+				CU_ASSERT(check_bitmap(bitmap, exp, n));
+			}
+		}
+	}
+}
+
+static void test_filter_double(void)
+{
+	double vals[TEST_FILTER_MAX_VALS];
+	double rhs_vals[] = {0.0, 1.5, -1.5, NAN};
+	uint64_t bitmap[FILTER_BITMAP_WORDS(TEST_FILTER_MAX_VALS)];
+	bool exp[TEST_FILTER_MAX_VALS];
+
+	for (size_t i = 0; i < ARR_SIZE(vals); i++)
+		vals[i] = ((double)(i % 5) - 2) * 0.75; /* -1.5..1.5 */
+
+	vals[9] = NAN;
+	vals[10] = INFINITY;
+	vals[11] = -INFINITY;
+
+	for (size_t r = 0; r < ARR_SIZE(rhs_vals); r++) {
+		for (size_t c = 0; c < ARR_SIZE(cmp_types); c++) {
+			for (size_t k = 0; k < ARR_SIZE(val_counts); k++) {
+				size_t n = val_counts[k];
+
+				for (size_t i = 0; i < n; i++) {
+					/* NaNs only ever match '<>' */
+					if (isnan(vals[i]) || isnan(rhs_vals[r]))
+						exp[i] = cmp_types[c] == AST_CMP_DIFF_OP;
+					else
+						exp[i] = exp_cmp(cmp_types[c], vals[i] - rhs_vals[r]);
+				}
+
+				memset(bitmap, 0xFF, sizeof(bitmap));
+				filter_double(cmp_types[c], vals, n, rhs_vals[r], bitmap);
+				CU_ASSERT(check_bitmap(bitmap, exp, n));
+			}
+		}
+	}
+}
+
+static void test_filter_bool(void)
+{
+	bool vals[TEST_FILTER_MAX_VALS];
+	bool rhs_vals[] = {true, false};
+	uint64_t bitmap[FILTER_BITMAP_WORDS(TEST_FILTER_MAX_VALS)];
+	bool exp[TEST_FILTER_MAX_VALS];
+
+	for (size_t i = 0; i < ARR_SIZE(vals); i++)
+		vals[i] = (i % 3) == 0;
+
+	for (size_t r = 0; r < ARR_SIZE(rhs_vals); r++) {
+		for (size_t c = 0; c < ARR_SIZE(cmp_types); c++) {
+			for (size_t k = 0; k < ARR_SIZE(val_counts); k++) {
+				size_t n = val_counts[k];
+
+				for (size_t i = 0; i < n; i++) {
+					/* booleans are not ordered */
+					if (cmp_types[c] == AST_CMP_EQUALS_OP)
+						exp[i] = vals[i] == rhs_vals[r];
+					else if (cmp_types[c] == AST_CMP_DIFF_OP)
+						exp[i] = vals[i] != rhs_vals[r];
+					else
+						exp[i] = false;
+				}
+
+				memset(bitmap, 0xFF, sizeof(bitmap));
+				filter_bool(cmp_types[c], vals, n, rhs_vals[r], bitmap);
+				CU_ASSERT(check_bitmap(bitmap, exp, n));
+			}
+		}
+	}
+}
+
+void test_filter_run(void)
+{
+	enum filter_isa isas[] = {FILTER_ISA_SCALAR, FILTER_ISA_SSE42, FILTER_ISA_AVX2};
+	enum filter_isa default_isa = filter_isa_get();
+
+	/* the scalar flavour is always there */
+	CU_ASSERT(filter_isa_set(FILTER_ISA_SCALAR));
+
+	/* every flavour the CPU supports must agree with the plain C operators */
+	for (size_t i = 0; i < ARR_SIZE(isas); i++) {
+		if (!filter_isa_set(isas[i]))
+			continue;
+
+		CU_ASSERT_EQUAL(filter_isa_get(), isas[i]);
+
+		test_filter_int64();
+		test_filter_double();
+		test_filter_bool();
+	}
+
+	CU_ASSERT(filter_isa_set(default_isa));
+}
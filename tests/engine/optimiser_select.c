@@ -929,6 +929,41 @@ static void select_case_7(void)
 	database_close(&db);
 }
 
+static void select_case_8(void)
+{
+	struct database db = {0};
+	struct query_output output = {0};
+	struct ast_node *node;
+	char *stmts[] = {
+			"SELECT COUNT(*) FROM A WHERE f1 > 1;",
+			"SELECT f1, COUNT(*) FROM A GROUP BY f1;",
+			"SELECT COUNT(*) FROM A, B;",
+			"SELECT f1 FROM A;",
+	};
+
+	CU_ASSERT_EQUAL(database_open(&db), MIDORIDB_OK);
+
+	prep_helper(&db, "CREATE TABLE A (f1 INT);");
+	prep_helper(&db, "CREATE TABLE B (f2 INT);");
+
+	/* unfiltered COUNT(*) over a single table */
+	node = build_ast("SELECT COUNT(*) FROM A;");
+	CU_ASSERT_FALSE(((struct ast_sel_select_node*)node)->count_from_counter);
+	CU_ASSERT_EQUAL(optimiser_run(&db, node, &output), MIDORIDB_OK);
+	CU_ASSERT(((struct ast_sel_select_node*)node)->count_from_counter);
+	ast_free(node);
+
+	/* anything else has to be scanned */
+	for (size_t i = 0; i < ARR_SIZE(stmts); i++) {
+		node = build_ast(stmts[i]);
+		CU_ASSERT_EQUAL(optimiser_run(&db, node, &output), MIDORIDB_OK);
+		CU_ASSERT_FALSE(((struct ast_sel_select_node*)node)->count_from_counter);
+		ast_free(node);
+	}
+
+	database_close(&db);
+}
+
 void test_optimiser_select(void)
 {
 	/* exprval (name) */
@@ -952,4 +987,7 @@ void test_optimiser_select(void)
 	/* select all + multi-table */
 	select_case_7();
 
+	/* count only - answered from the table's row counter */
+	select_case_8();
+
 }
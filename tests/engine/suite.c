@@ -11,6 +11,7 @@ bool engine_init_suite(void)
 	ADD_UNITTEST(suite, test_database_close);
 	ADD_UNITTEST(suite, test_database_add_table);
 	ADD_UNITTEST(suite, test_database_table_exists);
+	ADD_UNITTEST(suite, test_database_autovacuum);
 
 	/* executor */
 	ADD_UNITTEST(suite, test_optimiser_run);
@@ -18,6 +19,9 @@ bool engine_init_suite(void)
 	/* executor */
 	ADD_UNITTEST(suite, test_executor_run);
 
+	/* filter kernels */
+	ADD_UNITTEST(suite, test_filter_run);
+
 	return false;
 }
 
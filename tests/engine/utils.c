@@ -0,0 +1,32 @@
+/*
+ * utils.c
+ *
+ *  Created on: 17/10/2026
+ *      Author: paulo
+ */
+
+#include <tests/engine.h>
+#include <engine/database.h>
+#include <engine/query.h>
+
+int count_rows(struct database *db, char *query)
+{
+	struct query_output *output;
+	int i = 0;
+
+	output = query_execute(db, query);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(output);
+
+	// helps diagnose issues during unit tests / CI builds
+	if (output->status != ST_OK_WITH_RESULTS) {
+		printf("%s\n", output->error.message);
+	}
+
+	CU_ASSERT_EQUAL_FATAL(output->status, ST_OK_WITH_RESULTS);
+
+	while (query_cur_step(&output->results) == MIDORIDB_ROW)
+		i++;
+
+	query_free(output);
+	return i;
+}
@@ -72,6 +72,34 @@ static void create_tests(void)
 		"	INDEX(f1));",
 		false);
 
+	/* valid case - Bloom filters on VARCHAR column */
+	helper(&db, "CREATE TABLE IF NOT EXISTS G ("
+		"	f1 INTEGER,"
+		"	f2 VARCHAR(32) NOT NULL BLOOM);",
+		false);
+
+	/* invalid case - Bloom filters on fixed-width column */
+	helper(&db, "CREATE TABLE IF NOT EXISTS H ("
+		"	f1 INTEGER BLOOM,"
+		"	f2 VARCHAR(32));",
+		true);
+
+	/* valid case - datablock size chosen at CREATE TABLE */
+	helper(&db, "CREATE TABLE IF NOT EXISTS I ("
+		"	f1 INTEGER,"
+		"	f2 VARCHAR(32)) BLOCK_SIZE = 65536;",
+		false);
+
+	/* invalid case - datablock size isn't a power of 2 */
+	helper(&db, "CREATE TABLE IF NOT EXISTS J ("
+		"	f1 INTEGER) BLOCK_SIZE = 10000;",
+		true);
+
+	/* invalid case - datablock size out of bounds */
+	helper(&db, "CREATE TABLE IF NOT EXISTS K ("
+		"	f1 INTEGER) BLOCK_SIZE = 1024;",
+		true);
+
 	/* invalid case - invalid table name*/
 	helper(&db, "CREATE TABLE iiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiii"
 		"iiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiii"
@@ -97,6 +125,20 @@ static void create_tests(void)
 		"	PRIMARY KEY(f2));",
 		true);
 
+	/* invalid case - composite PK, it can't be enforced */
+	helper(&db, "CREATE TABLE IF NOT EXISTS L ("
+		"	f1 INTEGER,"
+		"	f2 INTEGER,"
+		"	PRIMARY KEY(f1, f2));",
+		true);
+
+	/* invalid case - PK on more than one column definition */
+	helper(&db, "CREATE TABLE IF NOT EXISTS M ("
+		"	f1 INTEGER PRIMARY KEY,"
+		"	f2 INTEGER,"
+		"	PRIMARY KEY(f2));",
+		true);
+
 	/* invalid case - index after column definition points to invalid column name */
 	helper(&db, "CREATE TABLE IF NOT EXISTS F ("
 		"	f1 INTEGER AUTO_INCREMENT,"
@@ -0,0 +1,137 @@
+/*
+ * bloom.c
+ *
+ *  Created on: 17/10/2026
+ *      Author: paulo
+ */
+
+#include <primitive/bloom.h>
+#include <tests/primitive.h>
+
+#define TEST_BLOOM_ROWS 2000
+#define TEST_BLOOM_PROBES 100
+
+struct bloom_test_row {
+	int64_t id;
+	char *user;
+} __packed;
+
+static struct table* create_bloom_test_table(void)
+{
+	struct table *table;
+	struct column column = {0};
+
+	table = table_init("test");
+	CU_ASSERT_PTR_NOT_NULL_FATAL(table);
+
+	strcpy(column.name, "id");
+	column.type = CT_INTEGER;
+	column.precision = (int)table_calc_column_precision(CT_INTEGER);
+	CU_ASSERT_FATAL(table_add_column(table, &column));
+
+	strcpy(column.name, "user");
+	column.type = CT_VARCHAR;
+	column.precision = 16;
+	column.bloom = true;
+	CU_ASSERT_FATAL(table_add_column(table, &column));
+
+	return table;
+}
+
+/* every live row must be found in the filter of its datablock, returns the number of live rows */
+static size_t check_live_rows(struct table *table)
+{
+	struct list_head *pos;
+	struct datablock *blk;
+	struct row *row;
+	size_t row_size = table_calc_row_size(table);
+	size_t count = 0;
+
+	list_for_each(pos, table->datablock_head)
+	{
+		blk = list_entry(pos, typeof(*blk), head);
+		CU_ASSERT_PTR_NOT_NULL_FATAL(blk->blooms);
+
+		for (size_t i = 0; i < DATABLOCK_PAGE_SIZE / row_size; i++) {
+			row = (struct row*)&blk->data[i * row_size];
+
+			if (row->flags.empty || row->flags.deleted)
+				continue;
+
+			CU_ASSERT(table_bloom_may_contain(table, blk, 1, ((struct bloom_test_row*)row->data)->user));
+			count++;
+		}
+	}
+
+	return count;
+}
+
+void test_table_bloom(void)
+{
+	struct bloom_test_row data;
+	struct column column = {0};
+	struct table *table;
+	struct list_head *pos;
+	struct datablock *blk;
+	struct row *row;
+	size_t row_size, blocks = 0, false_positives = 0;
+	char user[16], key[32];
+
+	table = create_bloom_test_table();
+	row_size = table_calc_row_size(table);
+
+	for (int64_t id = 0; id < TEST_BLOOM_ROWS; id++) {
+		snprintf(user, sizeof(user), "user_%d", (int)id);
+		data.id = id;
+		data.user = user;
+
+		row = build_row(&data, sizeof(data), NULL, 0);
+		CU_ASSERT(table_insert_row(table, row, row_size));
+		free(row);
+	}
+
+	CU_ASSERT_EQUAL(check_live_rows(table), TEST_BLOOM_ROWS);
+
+	/* values nobody holds are (mostly) ruled out */
+	list_for_each(pos, table->datablock_head)
+	{
+		blk = list_entry(pos, typeof(*blk), head);
+		blocks++;
+
+		for (int i = 0; i < TEST_BLOOM_PROBES; i++) {
+			snprintf(key, sizeof(key), "absent_%d", i);
+			false_positives += table_bloom_may_contain(table, blk, 1, key);
+		}
+	}
+
+	CU_ASSERT(false_positives < blocks * TEST_BLOOM_PROBES / 20);
+
+	/* columns without filters can't rule anything out */
+	blk = list_entry(table->datablock_head->next, typeof(*blk), head);
+	CU_ASSERT(table_bloom_may_contain(table, blk, 0, "absent"));
+
+	/* filters are rebuilt by vacuum */
+	list_for_each(pos, table->datablock_head)
+	{
+		blk = list_entry(pos, typeof(*blk), head);
+
+		for (size_t i = 0; i < DATABLOCK_PAGE_SIZE / row_size; i += 2) {
+			row = (struct row*)&blk->data[i * row_size];
+
+			if (!row->flags.empty)
+				CU_ASSERT(table_delete_row(table, blk, i * row_size));
+		}
+	}
+
+	CU_ASSERT(table_vacuum(table));
+	CU_ASSERT_EQUAL(check_live_rows(table), table->row_count);
+
+	/* and when rows are moved over to new datablocks */
+	strcpy(column.name, "extra");
+	column.type = CT_INTEGER;
+	column.precision = (int)table_calc_column_precision(CT_INTEGER);
+	CU_ASSERT(table_add_column(table, &column));
+	CU_ASSERT_EQUAL(check_live_rows(table), table->row_count);
+
+	table_destroy(&table);
+}
@@ -13,45 +13,53 @@ void test_datablock_init(void)
 
 void test_datablock_alloc(void)
 {
+	struct datablock_arena arena;
 	struct list_head *head;
 	struct datablock *block;
 
+	datablock_arena_init(&arena, DATABLOCK_PAGE_SIZE);
 	head = datablock_init();
-	block = datablock_alloc(head);
+	block = datablock_alloc(&arena, head);
 	CU_ASSERT_PTR_EQUAL(head->next, &block->head);
 	CU_ASSERT_PTR_EQUAL(block->head.next, head);
-	datablock_free(block);
+	datablock_free(&arena, block);
 
 	free(head);
+	datablock_arena_destroy(&arena);
 }
 
 void test_datablock_free(void)
 {
+	struct datablock_arena arena;
 	struct list_head *head;
 	struct datablock *block;
 
+	datablock_arena_init(&arena, DATABLOCK_PAGE_SIZE);
 	head = datablock_init();
-	block = datablock_alloc(head);
+	block = datablock_alloc(&arena, head);
 
-	datablock_free(block);
+	datablock_free(&arena, block);
 	CU_ASSERT_PTR_NOT_EQUAL(head, NULL);
 	CU_ASSERT_PTR_EQUAL(head->prev, head->next);
 
 	free(head);
+	datablock_arena_destroy(&arena);
 }
 
 void test_datablock_iterate(void)
 {
+	struct datablock_arena arena;
 	struct list_head *head;
 	struct datablock *block1, *block2, *block3;
 	struct datablock *entry = NULL;
 	struct list_head *pos = NULL;
 	uint64_t sum_blk_ids = 0;
 
+	datablock_arena_init(&arena, DATABLOCK_PAGE_SIZE);
 	head = datablock_init();
-	block1 = datablock_alloc(head);
-	block2 = datablock_alloc(head);
-	block3 = datablock_alloc(head);
+	block1 = datablock_alloc(&arena, head);
+	block2 = datablock_alloc(&arena, head);
+	block3 = datablock_alloc(&arena, head);
 
 	list_for_each(pos, head)
 	{
@@ -62,8 +70,138 @@ void test_datablock_iterate(void)
 	CU_ASSERT_EQUAL(sum_blk_ids,
 			block1->block_id + block2->block_id + block3->block_id);
 
-	datablock_free(block1);
-	datablock_free(block2);
-	datablock_free(block3);
+	datablock_free(&arena, block1);
+	datablock_free(&arena, block2);
+	datablock_free(&arena, block3);
 	free(head);
+	datablock_arena_destroy(&arena);
+}
+
+void test_datablock_arena(void)
+{
+	struct datablock_arena arena, other;
+	struct list_head *head, *other_head;
+	struct datablock *blocks[1500], *block;
+	uint64_t block_id;
+
+	datablock_arena_init(&arena, DATABLOCK_PAGE_SIZE);
+	head = datablock_init();
+
+	/* enough datablocks for a few regions, every one of them aligned to its size */
+	for (size_t i = 0; i < ARR_SIZE(blocks); i++) {
+		CU_ASSERT_PTR_NOT_NULL_FATAL((blocks[i] = datablock_alloc(&arena, head)));
+		memset(blocks[i]->data, 0xAB, arena.block_size);
+	}
+
+	CU_ASSERT_EQUAL(list_length(&arena.regions), 3);
+	CU_ASSERT_EQUAL(list_length(head), ARR_SIZE(blocks));
+	CU_ASSERT_EQUAL(((uintptr_t)list_entry(arena.regions.next, struct datablock_region, head)->data)
+			% DATABLOCK_REGION_SIZE, 0);
+
+	/* ids are handed out by the arena itself, in allocation order */
+	for (size_t i = 0; i < ARR_SIZE(blocks); i++)
+		CU_ASSERT_EQUAL(blocks[i]->block_id, i);
+
+	/* freed datablocks are reused, last in first out, with new ids */
+	block_id = blocks[ARR_SIZE(blocks) - 1]->block_id;
+	datablock_free(&arena, blocks[10]);
+	datablock_free(&arena, blocks[20]);
+
+	CU_ASSERT_PTR_EQUAL((block = datablock_alloc(&arena, head)), blocks[20]);
+	CU_ASSERT(block->block_id > block_id);
+	CU_ASSERT_PTR_EQUAL(head->prev, &block->head);
+	CU_ASSERT_PTR_EQUAL(datablock_alloc(&arena, head), blocks[10]);
+	CU_ASSERT_EQUAL(list_length(head), ARR_SIZE(blocks));
+
+	/* other arenas (tables) keep counting on their own */
+	datablock_arena_init(&other, DATABLOCK_PAGE_SIZE);
+	other_head = datablock_init();
+	CU_ASSERT_PTR_NOT_NULL_FATAL((block = datablock_alloc(&other, other_head)));
+	CU_ASSERT_EQUAL(block->block_id, 0);
+	CU_ASSERT_EQUAL(arena.next_block_id, ARR_SIZE(blocks) + 2);
+	datablock_free(&other, block);
+	free(other_head);
+	datablock_arena_destroy(&other);
+
+	/* regions nobody uses anymore are unmapped, all but the last one */
+	for (size_t i = 0; i < ARR_SIZE(blocks); i++)
+		datablock_free(&arena, blocks[i]);
+
+	CU_ASSERT_EQUAL(list_length(&arena.regions), 1);
+	CU_ASSERT_EQUAL(list_length(&arena.free_list),
+			list_entry(arena.regions.next, struct datablock_region, head)->carved);
+	CU_ASSERT(list_is_empty(head));
+
+	free(head);
+	datablock_arena_destroy(&arena);
+	CU_ASSERT(list_is_empty(&arena.regions));
+	CU_ASSERT_EQUAL(arena.next_block_id, 0);
+
+	/* large datablocks are packed just as tight, headers don't eat into the region */
+	for (size_t size = DATABLOCK_PAGE_SIZE; size <= DATABLOCK_MAX_SIZE; size *= 2) {
+		datablock_arena_init(&arena, size);
+		head = datablock_init();
+
+		CU_ASSERT_EQUAL(arena.region_size, DATABLOCK_REGION_SIZE);
+		CU_ASSERT_EQUAL(arena.region_blocks, DATABLOCK_REGION_SIZE / size);
+
+		for (size_t i = 0; i < arena.region_blocks; i++) {
+			CU_ASSERT_PTR_NOT_NULL_FATAL((block = datablock_alloc(&arena, head)));
+			CU_ASSERT_EQUAL((uintptr_t)block->data % size, 0);
+			memset(block->data, 0xAB, size);
+		}
+
+		CU_ASSERT_EQUAL(list_length(&arena.regions), 1);
+		free(head);
+		datablock_arena_destroy(&arena);
+	}
+}
+
+void test_datablock_dir(void)
+{
+	struct datablock_arena arena;
+	struct block_dir dir;
+	struct list_head *head;
+	struct datablock *blocks[100];
+
+	datablock_arena_init(&arena, DATABLOCK_PAGE_SIZE);
+	block_dir_init(&dir);
+	head = datablock_init();
+
+	CU_ASSERT_PTR_NULL(block_dir_at(&dir, 0));
+
+	/* the directory grows as needed */
+	for (size_t i = 0; i < ARR_SIZE(blocks); i++) {
+		CU_ASSERT_PTR_NOT_NULL_FATAL((blocks[i] = datablock_alloc(&arena, head)));
+		CU_ASSERT_FATAL(block_dir_push(&dir, blocks[i]));
+	}
+
+	CU_ASSERT_EQUAL(dir.len, ARR_SIZE(blocks));
+	CU_ASSERT_PTR_EQUAL(block_dir_at(&dir, 42), blocks[42]);
+	CU_ASSERT_PTR_NULL(block_dir_at(&dir, ARR_SIZE(blocks)));
+
+	/* datablocks are found by id, from a given position onwards */
+	CU_ASSERT_EQUAL(block_dir_find(&dir, 0, blocks[0]->block_id), 0);
+	CU_ASSERT_EQUAL(block_dir_find(&dir, 0, blocks[77]->block_id), 77);
+	CU_ASSERT_EQUAL(block_dir_find(&dir, 50, blocks[99]->block_id), 99);
+	CU_ASSERT_EQUAL(block_dir_find(&dir, 50, blocks[10]->block_id), dir.len);
+
+	/* datablocks after the one dropped move a position down */
+	block_dir_del(&dir, 10);
+	CU_ASSERT_EQUAL(dir.len, ARR_SIZE(blocks) - 1);
+	CU_ASSERT_PTR_EQUAL(block_dir_at(&dir, 10), blocks[11]);
+	CU_ASSERT_EQUAL(block_dir_find(&dir, 0, blocks[10]->block_id), dir.len);
+	CU_ASSERT_EQUAL(block_dir_find(&dir, 0, blocks[77]->block_id), 76);
+
+	block_dir_del(&dir, dir.len - 1);
+	CU_ASSERT_PTR_EQUAL(block_dir_at(&dir, dir.len - 1), blocks[98]);
+
+	block_dir_free(&dir);
+	CU_ASSERT_EQUAL(dir.len, 0);
+
+	for (size_t i = 0; i < ARR_SIZE(blocks); i++)
+		datablock_free(&arena, blocks[i]);
+
+	free(head);
+	datablock_arena_destroy(&arena);
 }
@@ -0,0 +1,109 @@
+/*
+ * freespace.c
+ *
+ *  Created on: 17/10/2026
+ *      Author: paulo
+ */
+
+#include <primitive/freespace.h>
+#include <primitive/index.h>
+#include <tests/primitive.h>
+
+#define TEST_FREE_SPACE_BLOCKS	3
+#define TEST_FREE_SPACE_CHURN	5000
+
+static size_t count_free_space(struct table *table)
+{
+	struct list_head *pos;
+	struct datablock *blk, *prev = NULL;
+	size_t slots = 0;
+
+	list_for_each(pos, &table->free_space)
+	{
+		blk = list_entry(pos, typeof(*blk), free_link);
+		CU_ASSERT(blk->free_count > 0);
+		CU_ASSERT(!prev || prev->block_id < blk->block_id);
+		slots += blk->free_count;
+		prev = blk;
+	}
+
+	return slots;
+}
+
+void test_table_free_space(void)
+{
+	struct table *table = create_indexed_test_table();
+	struct row_location loc, holes[3];
+	size_t row_size = table_calc_row_size(table);
+	size_t fit_in_blk = table_block_size(table) / row_size;
+	size_t no_rows = fit_in_blk * TEST_FREE_SPACE_BLOCKS - 1;
+	size_t free_offset, found;
+	int64_t deleted[] = {(int64_t)fit_in_blk * 2 + 5, 7, 3};
+
+	for (size_t i = 0; i < no_rows; i++)
+		indexed_test_insert(table, (int64_t)i);
+
+	CU_ASSERT_EQUAL(count_datablocks(table), TEST_FREE_SPACE_BLOCKS);
+	CU_ASSERT_EQUAL(count_free_space(table), 0);
+	free_offset = table->free_dtbkl_offset;
+
+	/* the free-space map is kept in table order whatever order rows are deleted in */
+	for (size_t i = 0; i < ARR_SIZE(deleted); i++) {
+		CU_ASSERT_PTR_NOT_NULL_FATAL(indexed_test_lookup(table, deleted[i], &holes[i]));
+		CU_ASSERT(table_delete_row(table, holes[i].blk, holes[i].offset));
+	}
+
+	CU_ASSERT_EQUAL(table->deleted_row_count, 3);
+	CU_ASSERT_EQUAL(count_free_space(table), 3);
+	CU_ASSERT_PTR_EQUAL(list_entry(table->free_space.next, struct datablock, free_link), fetch_datablock(table, 0));
+	CU_ASSERT_PTR_EQUAL(list_entry(table->free_space.prev, struct datablock, free_link), fetch_datablock(table, 2));
+
+	/* holes are filled first to last before the table grows any further */
+	for (int64_t id = 0; id < 3; id++) {
+		indexed_test_insert(table, -id - 1);
+		CU_ASSERT_PTR_NOT_NULL(indexed_test_lookup(table, -id - 1, &loc));
+		CU_ASSERT_PTR_EQUAL(loc.blk, holes[2 - id].blk);
+		CU_ASSERT_EQUAL(loc.offset, holes[2 - id].offset);
+		CU_ASSERT_PTR_NULL(indexed_test_lookup(table, deleted[2 - id], &loc));
+	}
+
+	CU_ASSERT_EQUAL(table->deleted_row_count, 0);
+	CU_ASSERT_EQUAL(table->row_count, no_rows);
+	CU_ASSERT_EQUAL(table->free_dtbkl_offset, free_offset);
+	CU_ASSERT_EQUAL(count_free_space(table), 0);
+
+	/* delete / insert churn doesn't make the table any bigger */
+	for (size_t i = 0; i < TEST_FREE_SPACE_CHURN; i++) {
+		int64_t id = (int64_t)((i * 7919) % no_rows);
+
+		if (!indexed_test_lookup(table, id, &loc))
+			continue;
+
+		CU_ASSERT(table_delete_row(table, loc.blk, loc.offset));
+		indexed_test_insert(table, id);
+	}
+
+	CU_ASSERT_EQUAL(count_datablocks(table), TEST_FREE_SPACE_BLOCKS);
+	CU_ASSERT_EQUAL(table->free_dtbkl_offset, free_offset);
+	CU_ASSERT_EQUAL(table->row_count, no_rows);
+
+	/* rows deleted at first are the only ones missing */
+	found = 0;
+	for (int64_t id = -3; id < (int64_t)no_rows; id++)
+		found += indexed_test_lookup(table, id, &loc) != NULL;
+	CU_ASSERT_EQUAL(found, no_rows);
+
+	/* free slots go away with vacuum and come back from deleted rows on column changes */
+	CU_ASSERT_PTR_NOT_NULL_FATAL(indexed_test_lookup(table, 10, &loc));
+	CU_ASSERT(table_delete_row(table, loc.blk, loc.offset));
+	CU_ASSERT_EQUAL(count_free_space(table), 1);
+
+	CU_ASSERT(table_rem_column(table, &table->columns[1]));
+	CU_ASSERT_EQUAL(count_free_space(table), 1);
+
+	CU_ASSERT(table_vacuum(table));
+	CU_ASSERT_EQUAL(count_free_space(table), 0);
+	CU_ASSERT_EQUAL(table->row_count, no_rows - 1);
+
+	CU_ASSERT(table_destroy(&table));
+}
@@ -0,0 +1,479 @@
+/*
+ * index.c
+ *
+ *  Created on: 17/10/2026
+ *      Author: paulo
+ */
+
+#include <primitive/index.h>
+#include <engine/worker.h>
+#include <tests/primitive.h>
+
+#define TEST_INDEX_ROWS 5000
+#define TEST_INDEX_GROUPS 97
+
+struct index_test_row {
+	int64_t id;
+	int64_t grp;
+	char *str;
+} __packed;
+
+static struct table* create_index_test_table(void)
+{
+	struct table *table;
+	struct column column = {0};
+	enum COLUMN_TYPE types[] = {CT_INTEGER, CT_INTEGER, CT_VARCHAR};
+	char *names[] = {"id", "grp", "str"};
+
+	table = table_init("test");
+	CU_ASSERT_PTR_NOT_NULL_FATAL(table);
+
+	for (size_t i = 0; i < ARR_SIZE(types); i++) {
+		strcpy(column.name, names[i]);
+		column.type = types[i];
+		column.precision = types[i] == CT_VARCHAR ? 16 : (int)table_calc_column_precision(types[i]);
+		CU_ASSERT_FATAL(table_add_column(table, &column));
+	}
+
+	return table;
+}
+
+static void insert_index_test_row(struct table *table, int64_t id)
+{
+	struct index_test_row data;
+	struct row *row;
+	char str[16];
+	int null_cols[] = {1};
+
+	snprintf(str, sizeof(str), "str_%d", (int)(id % 13));
+	data.id = id;
+	data.grp = id % TEST_INDEX_GROUPS;
+	data.str = str;
+
+	/* every 10th row has a NULL group */
+	row = build_row(&data, sizeof(data), null_cols, id % 10 == 0 ? ARR_SIZE(null_cols) : 0);
+	CU_ASSERT(table_insert_row(table, row, table_calc_row_size(table)));
+	free(row);
+}
+
+static bool update_index_test_row(struct table *table, int64_t id, int64_t new_id, char *new_str)
+{
+	struct list_head *pos;
+	struct datablock *blk;
+	struct index_test_row data;
+	struct row *row, *new_row;
+	size_t row_size = table_calc_row_size(table);
+	char str[16] = {0};
+	bool ret;
+
+	strncpy(str, new_str, sizeof(str) - 1);
+
+	list_for_each(pos, table->datablock_head)
+	{
+		blk = list_entry(pos, typeof(*blk), head);
+
+		for (size_t i = 0; i < DATABLOCK_PAGE_SIZE / row_size; i++) {
+			row = (struct row*)&blk->data[i * row_size];
+
+			if (row->flags.empty || row->flags.deleted || ((struct index_test_row*)row->data)->id != id)
+				continue;
+
+			memcpy(&data, row->data, sizeof(data));
+			data.id = new_id;
+			data.str = str;
+
+			new_row = build_row(&data, sizeof(data), NULL, 0);
+			memcpy(new_row->null_bitmap, row->null_bitmap, sizeof(row->null_bitmap));
+			ret = table_update_row(table, blk, i * row_size, new_row, row_size);
+			free(new_row);
+			return ret;
+		}
+	}
+
+	return false;
+}
+
+/* looks up a value and checks every row found holds it, returns the number of rows found */
+static size_t lookup(struct table *table, int col_idx, void *key)
+{
+	struct vector locs;
+	struct row_location *loc, *prev = NULL;
+	struct row *row;
+	size_t count;
+	size_t offset = col_idx * sizeof(int64_t);
+
+	CU_ASSERT_FATAL(vector_init(&locs));
+	CU_ASSERT(table_index_lookup(table, col_idx, key, &locs));
+
+	count = locs.len / sizeof(*loc);
+
+	for (size_t i = 0; i < count; i++) {
+		loc = &((struct row_location*)locs.data)[i];
+		row = (struct row*)&loc->blk->data[loc->offset];
+
+		CU_ASSERT(!row->flags.empty && !row->flags.deleted);
+		CU_ASSERT(!bit_test(row->null_bitmap, col_idx, sizeof(row->null_bitmap)));
+
+		if (table->columns[col_idx].type == CT_VARCHAR)
+			CU_ASSERT_STRING_EQUAL(*(char**)&row->data[offset], key)
+		else
+			CU_ASSERT_EQUAL(*(int64_t*)&row->data[offset], *(int64_t*)key);
+
+		/* storage order */
+		if (prev)
+			CU_ASSERT(prev->blk->block_id < loc->blk->block_id
+					|| (prev->blk == loc->blk && prev->offset < loc->offset));
+		prev = loc;
+	}
+
+	vector_free(&locs);
+	return count;
+}
+
+static size_t exp_group_count(int64_t grp, bool (*is_live)(int64_t id))
+{
+	size_t count = 0;
+
+	for (int64_t id = 0; id < TEST_INDEX_ROWS; id++) {
+		if (id % TEST_INDEX_GROUPS == grp && id % 10 && is_live(id))
+			count++;
+	}
+
+	return count;
+}
+
+static size_t exp_str_count(int64_t mod, bool (*is_live)(int64_t id))
+{
+	size_t count = 0;
+
+	for (int64_t id = 0; id < TEST_INDEX_ROWS; id++) {
+		if (id % 13 == mod && is_live(id))
+			count++;
+	}
+
+	return count;
+}
+
+static bool all_live(int64_t id)
+{
+	(void)id;
+	return true;
+}
+
+static bool not_multiple_of_3(int64_t id)
+{
+	return id % 3 != 0;
+}
+
+static void check_indexes(struct table *table, bool (*is_live)(int64_t id), int id_col, int grp_col)
+{
+	for (int64_t id = 0; id < TEST_INDEX_ROWS; id++)
+		CU_ASSERT_EQUAL(lookup(table, id_col, &id), is_live(id) ? 1 : 0);
+
+	for (int64_t grp = 0; grp < TEST_INDEX_GROUPS; grp++)
+		CU_ASSERT_EQUAL(lookup(table, grp_col, &grp), exp_group_count(grp, is_live));
+}
+
+void test_table_index(void)
+{
+	struct column column = {0};
+	struct table *table;
+	struct datablock *blk;
+	struct list_head *pos;
+	struct row *row;
+	size_t row_size;
+	int64_t id;
+
+	table = create_index_test_table();
+	row_size = table_calc_row_size(table);
+
+	/* indexes get populated with existing rows */
+	for (id = 0; id < TEST_INDEX_ROWS / 2; id++)
+		insert_index_test_row(table, id);
+
+	CU_ASSERT(table_index_create(table, 0, IT_HASH, NULL));
+	CU_ASSERT(table_index_create(table, 1, IT_BTREE, NULL));
+	CU_ASSERT(table_index_create(table, 2, IT_BTREE, NULL));
+	CU_ASSERT_FALSE(table_index_create(table, 2, IT_BTREE, NULL));
+
+	for (; id < TEST_INDEX_ROWS; id++)
+		insert_index_test_row(table, id);
+
+	check_indexes(table, &all_live, 0, 1);
+	CU_ASSERT_EQUAL(lookup(table, 2, "str_5"), exp_str_count(5, &all_live));
+	CU_ASSERT_EQUAL(lookup(table, 2, "str_13"), 0);
+
+	/* deleted rows are gone from indexes */
+	list_for_each(pos, table->datablock_head)
+	{
+		blk = list_entry(pos, typeof(*blk), head);
+
+		for (size_t i = 0; i < DATABLOCK_PAGE_SIZE / row_size; i++) {
+			row = (struct row*)&blk->data[i * row_size];
+
+			if (!row->flags.empty && ((struct index_test_row*)row->data)->id % 3 == 0)
+				CU_ASSERT(table_delete_row(table, blk, i * row_size));
+		}
+	}
+
+	check_indexes(table, &not_multiple_of_3, 0, 1);
+
+	/* so are the old values of updated rows */
+	CU_ASSERT(update_index_test_row(table, 1, TEST_INDEX_ROWS, "updated"));
+
+	id = 1;
+	CU_ASSERT_EQUAL(lookup(table, 0, &id), 0);
+	id = TEST_INDEX_ROWS;
+	CU_ASSERT_EQUAL(lookup(table, 0, &id), 1);
+	CU_ASSERT_EQUAL(lookup(table, 2, "updated"), 1);
+
+	CU_ASSERT(update_index_test_row(table, TEST_INDEX_ROWS, 1, "str_1"));
+	check_indexes(table, &not_multiple_of_3, 0, 1);
+
+	/* ids are unique */
+	id = 1;
+	CU_ASSERT(table_index_is_duplicate(table, 0, &id, NULL, 0));
+	id = 3;
+	CU_ASSERT_FALSE(table_index_is_duplicate(table, 0, &id, NULL, 0));
+
+	/* rows taking a value that's taken already are left as they were */
+	CU_ASSERT_FALSE(update_index_test_row(table, 2, 4, "clash"));
+	id = 2;
+	CU_ASSERT_EQUAL(lookup(table, 0, &id), 1);
+	CU_ASSERT_EQUAL(lookup(table, 2, "clash"), 0);
+	CU_ASSERT_EQUAL(lookup(table, 2, "str_2"), exp_str_count(2, &not_multiple_of_3));
+	check_indexes(table, &not_multiple_of_3, 0, 1);
+
+	/* rows are moved around by vacuum */
+	CU_ASSERT(table_vacuum(table));
+	check_indexes(table, &not_multiple_of_3, 0, 1);
+	CU_ASSERT_EQUAL(lookup(table, 2, "str_5"), exp_str_count(5, &not_multiple_of_3));
+
+	/* and when columns are removed (the group index now covers the first column) */
+	CU_ASSERT(table_rem_column(table, &table->columns[0]));
+	CU_ASSERT_PTR_NULL(table->indexes[2]);
+
+	for (int64_t grp = 0; grp < TEST_INDEX_GROUPS; grp++)
+		CU_ASSERT_EQUAL(lookup(table, 0, &grp), exp_group_count(grp, &not_multiple_of_3));
+
+	/* or added (rows are copied over to bigger datablocks) */
+	strcpy(column.name, "extra");
+	column.type = CT_INTEGER;
+	column.precision = (int)table_calc_column_precision(CT_INTEGER);
+	CU_ASSERT(table_add_column(table, &column));
+
+	for (int64_t grp = 0; grp < TEST_INDEX_GROUPS; grp++)
+		CU_ASSERT_EQUAL(lookup(table, 0, &grp), exp_group_count(grp, &not_multiple_of_3));
+
+	table_destroy(&table);
+}
+
+void test_table_index_bulk(void)
+{
+	struct worker_pool pool;
+	struct index_range range = {0};
+	struct table *table;
+	struct vector locs;
+	struct row_location *loc;
+	struct row *row;
+	size_t count = INDEX_BULK_PARALLEL_MIN + 1000;
+	size_t grp_rows = 0, str_rows = 0;
+	int64_t id;
+
+	CU_ASSERT_FATAL(worker_pool_init(&pool, 4));
+	table = create_index_test_table();
+
+	/* rows aren't stored in value order */
+	for (size_t i = 0; i < count; i++)
+		insert_index_test_row(table, (int64_t)((i * 7919) % count));
+
+	/* big enough for the sort to be run by the pool */
+	CU_ASSERT(table_index_create(table, 0, IT_BTREE, &pool));
+	CU_ASSERT(table_index_create(table, 1, IT_BTREE, &pool));
+	CU_ASSERT(table_index_create(table, 2, IT_BTREE, &pool));
+
+	for (id = 0; id < (int64_t)count; id++)
+		CU_ASSERT_EQUAL(lookup(table, 0, &id), 1);
+
+	for (int64_t grp = 0; grp < TEST_INDEX_GROUPS; grp++)
+		grp_rows += lookup(table, 1, &grp);
+	CU_ASSERT_EQUAL(grp_rows, count - (count + 9) / 10);
+
+	for (int mod = 0; mod < 13; mod++) {
+		char str[16];
+
+		snprintf(str, sizeof(str), "str_%d", mod);
+		str_rows += lookup(table, 2, str);
+	}
+	CU_ASSERT_EQUAL(str_rows, count);
+
+	/* ids come back in order */
+	CU_ASSERT_FATAL(vector_init(&locs));
+	CU_ASSERT_EQUAL(table_index_range(table, 0, &range, false, count, &locs), MIDORIDB_OK);
+	CU_ASSERT_EQUAL(locs.len / sizeof(*loc), count);
+
+	for (size_t i = 0; i < locs.len / sizeof(*loc); i++) {
+		loc = &((struct row_location*)locs.data)[i];
+		row = (struct row*)&loc->blk->data[loc->offset];
+		CU_ASSERT_EQUAL(((struct index_test_row*)row->data)->id, (int64_t)i);
+	}
+
+	vector_free(&locs);
+	table_destroy(&table);
+	worker_pool_destroy(&pool);
+}
+
+struct bitmap_test_row {
+	int64_t id;
+	bool flag;
+} __packed;
+
+/* every live row must be in the bitmap of its value and bitmaps can't hold anything else */
+static void check_bitmaps(struct table *table, int col_idx)
+{
+	const struct roaring *bitmaps[INDEX_BITMAP_COUNT];
+	size_t expected[INDEX_BITMAP_COUNT] = {0};
+	struct list_head *pos;
+	struct row_location loc;
+	struct row *row;
+	struct vector locs;
+	size_t row_size = table_calc_row_size(table);
+	size_t offset = col_idx ? sizeof(int64_t) : 0;
+	int value;
+	bool key;
+
+	for (int i = 0; i < INDEX_BITMAP_COUNT; i++)
+		CU_ASSERT_PTR_NOT_NULL_FATAL((bitmaps[i] = table_index_bitmap(table, col_idx, i)));
+
+	list_for_each(pos, table->datablock_head)
+	{
+		loc.blk = list_entry(pos, typeof(*loc.blk), head);
+
+		for (loc.offset = 0; loc.offset + row_size <= DATABLOCK_PAGE_SIZE; loc.offset += row_size) {
+			row = (struct row*)&loc.blk->data[loc.offset];
+
+			if (row->flags.empty || row->flags.deleted)
+				continue;
+
+			if (bit_test(row->null_bitmap, col_idx, sizeof(row->null_bitmap)))
+				value = INDEX_BITMAP_NULL;
+			else
+				value = *(bool*)&row->data[offset];
+
+			CU_ASSERT(roaring_contains(bitmaps[value], table_index_row_id(&loc)));
+			expected[value]++;
+		}
+	}
+
+	for (int i = 0; i < INDEX_BITMAP_COUNT; i++)
+		CU_ASSERT_EQUAL(roaring_cardinality(bitmaps[i]), expected[i]);
+
+	/* lookups turn row ids back into locations */
+	CU_ASSERT_FATAL(vector_init(&locs));
+
+	for (key = false; ; key = true) {
+		CU_ASSERT(table_index_lookup(table, col_idx, &key, &locs));
+		CU_ASSERT_EQUAL(locs.len / sizeof(loc), expected[key]);
+
+		for (size_t i = 0; i < locs.len / sizeof(loc); i++) {
+			loc = ((struct row_location*)locs.data)[i];
+			row = (struct row*)&loc.blk->data[loc.offset];
+			CU_ASSERT(!bit_test(row->null_bitmap, col_idx, sizeof(row->null_bitmap)));
+			CU_ASSERT_EQUAL(*(bool*)&row->data[offset], key);
+		}
+
+		vector_clear(&locs);
+
+		if (key)
+			break;
+	}
+
+	vector_free(&locs);
+}
+
+void test_table_index_bitmap(void)
+{
+	struct bitmap_test_row data;
+	struct column column = {0};
+	struct table *table;
+	struct list_head *pos;
+	struct datablock *blk;
+	struct row *row, *new_row;
+	size_t row_size;
+	int null_cols[] = {1};
+
+	table = table_init("test");
+	CU_ASSERT_PTR_NOT_NULL_FATAL(table);
+
+	strcpy(column.name, "id");
+	column.type = CT_INTEGER;
+	column.precision = (int)table_calc_column_precision(CT_INTEGER);
+	CU_ASSERT_FATAL(table_add_column(table, &column));
+
+	strcpy(column.name, "flag");
+	column.type = CT_TINYINT;
+	column.precision = (int)table_calc_column_precision(CT_TINYINT);
+	CU_ASSERT_FATAL(table_add_column(table, &column));
+
+	row_size = table_calc_row_size(table);
+
+	/* every 7th row has a NULL flag, the index is built out of existing rows and kept up to date afterwards */
+	for (int64_t id = 0; id < TEST_INDEX_ROWS; id++) {
+		if (id == TEST_INDEX_ROWS / 2) {
+			CU_ASSERT(!table_index_create(table, 0, IT_BITMAP, NULL));
+			CU_ASSERT_FATAL(table_index_create(table, 1, IT_BITMAP, NULL));
+			check_bitmaps(table, 1);
+		}
+
+		data.id = id;
+		data.flag = id % 3 == 0;
+
+		row = build_row(&data, sizeof(data), null_cols, id % 7 == 0 ? ARR_SIZE(null_cols) : 0);
+		CU_ASSERT(table_insert_row(table, row, row_size));
+		free(row);
+	}
+
+	check_bitmaps(table, 1);
+
+	/* rows go away, flags are flipped and some of them become NULL */
+	list_for_each(pos, table->datablock_head)
+	{
+		blk = list_entry(pos, typeof(*blk), head);
+
+		for (size_t i = 0; i < DATABLOCK_PAGE_SIZE / row_size; i++) {
+			row = (struct row*)&blk->data[i * row_size];
+
+			if (row->flags.empty || row->flags.deleted)
+				continue;
+
+			memcpy(&data, row->data, sizeof(data));
+
+			if (data.id % 5 == 0) {
+				CU_ASSERT(table_delete_row(table, blk, i * row_size));
+			} else if (data.id % 5 == 1) {
+				data.flag = !data.flag;
+				new_row = build_row(&data, sizeof(data), null_cols, data.id % 2 ? ARR_SIZE(null_cols) : 0);
+				CU_ASSERT(table_update_row(table, blk, i * row_size, new_row, row_size));
+				free(new_row);
+			}
+		}
+	}
+
+	check_bitmaps(table, 1);
+
+	/* rows are moved around */
+	CU_ASSERT(table_vacuum(table));
+	check_bitmaps(table, 1);
+
+	strcpy(column.name, "extra");
+	column.type = CT_INTEGER;
+	column.precision = (int)table_calc_column_precision(CT_INTEGER);
+	CU_ASSERT(table_add_column(table, &column));
+	check_bitmaps(table, 1);
+
+	/* and the flag ends up being the first column */
+	CU_ASSERT(table_rem_column(table, &table->columns[0]));
+	check_bitmaps(table, 0);
+
+	table_destroy(&table);
+}
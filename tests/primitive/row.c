@@ -15,6 +15,8 @@ static struct row_header_flags header_used = {.deleted = false, .empty = false};
 void test_table_insert_row(void)
 {
 	struct table *table;
+	struct datablock *blk;
+	size_t offset;
 
 	int fp_data[] = {0, 1, 2, 3, 0};
 	struct row *row = build_row(fp_data, sizeof(fp_data), NULL, 0);
@@ -49,14 +51,27 @@ void test_table_insert_row(void)
 	CU_ASSERT(check_row(table, 2, &header_used, row));
 	CU_ASSERT(check_row_flags(table, 3, &header_empty));
 
+	CU_ASSERT_EQUAL(table->row_count, 3);
+	CU_ASSERT_EQUAL(table->deleted_row_count, 0);
+
 	CU_ASSERT(table_delete_row(table, fetch_datablock(table, 0), row_size));
 	CU_ASSERT_EQUAL(count_datablocks(table), 1);
+	CU_ASSERT_EQUAL(table->row_count, 2);
+	CU_ASSERT_EQUAL(table->deleted_row_count, 1);
 
 	CU_ASSERT(check_row(table, 0, &header_used, row));
 	CU_ASSERT(check_row(table, 1, &header_deleted, row));
 	CU_ASSERT(check_row(table, 2, &header_used, row));
 	CU_ASSERT(check_row_flags(table, 3, &header_empty));
 
+	/* valid case - fixed precision columns - the caller is told where the row went (the hole) */
+	CU_ASSERT(table_insert_row_loc(table, row, row_size, &blk, &offset));
+	CU_ASSERT_PTR_EQUAL(blk, fetch_datablock(table, 0));
+	CU_ASSERT_EQUAL(offset, row_size);
+	CU_ASSERT(check_row(table, 1, &header_used, row));
+	CU_ASSERT(table_delete_row(table, blk, offset));
+	CU_ASSERT(check_row(table, 1, &header_deleted, row));
+
 	CU_ASSERT(table_destroy(&table));
 
 	/* valid case - fixed precision columns - force allocate new data blocks */
@@ -9,16 +9,30 @@ bool primitive_init_suite(void)
 	ADD_UNITTEST(suite, test_datablock_init);
 	ADD_UNITTEST(suite, test_datablock_alloc);
 	ADD_UNITTEST(suite, test_datablock_free);
+	ADD_UNITTEST(suite, test_datablock_arena);
 	ADD_UNITTEST(suite, test_datablock_iterate);
+	ADD_UNITTEST(suite, test_datablock_dir);
 	/* table */
 	ADD_UNITTEST(suite, test_table_init);
 	ADD_UNITTEST(suite, test_table_destroy);
+	ADD_UNITTEST(suite, test_table_block_size);
 	ADD_UNITTEST(suite, test_table_add_column);
 	ADD_UNITTEST(suite, test_table_rem_column);
 	ADD_UNITTEST(suite, test_table_insert_row);
 	ADD_UNITTEST(suite, test_table_delete_row);
 	ADD_UNITTEST(suite, test_table_update_row);
 	ADD_UNITTEST(suite, test_table_vacuum);
+	ADD_UNITTEST(suite, test_table_vacuum_step);
+	/* index */
+	ADD_UNITTEST(suite, test_table_index);
+	ADD_UNITTEST(suite, test_table_index_bulk);
+	ADD_UNITTEST(suite, test_table_index_bitmap);
+	/* zone map */
+	ADD_UNITTEST(suite, test_table_zone_map);
+	/* bloom filter */
+	ADD_UNITTEST(suite, test_table_bloom);
+	/* free space */
+	ADD_UNITTEST(suite, test_table_free_space);
 
 	return false;
 }
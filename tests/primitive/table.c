@@ -6,8 +6,17 @@
  */
 
 #include <primitive/table.h>
+#include <primitive/row.h>
 #include <tests/primitive.h>
 
+#define TEST_WIDE_ROW_PAYLOAD	6000
+#define TEST_WIDE_ROWS		100
+
+struct wide_test_row {
+	int64_t id;
+	char payload[TEST_WIDE_ROW_PAYLOAD];
+} __packed;
+
 void test_table_init(void)
 {
 	struct table *table;
@@ -66,3 +75,106 @@ void test_table_destroy(void)
 
 }
 
+static bool add_test_column(struct table *table, char *name, int precision)
+{
+	struct column column = {0};
+
+	strcpy(column.name, name);
+	column.type = CT_INTEGER;
+	column.precision = precision;
+
+	return table_add_column(table, &column);
+}
+
+void test_table_block_size(void)
+{
+	struct table *table;
+	struct datablock *blk;
+	struct wide_test_row *data;
+	struct row *row;
+	size_t row_size, fit_in_blk, found = 0;
+
+	table = table_init("test");
+	CU_ASSERT_PTR_NOT_NULL_FATAL(table);
+	CU_ASSERT_EQUAL(table_block_size(table), DATABLOCK_PAGE_SIZE);
+
+	/* narrow rows, datablocks stay as small as they get */
+	CU_ASSERT(add_test_column(table, "id", sizeof(int64_t)));
+	CU_ASSERT_EQUAL(table_block_size(table), DATABLOCK_PAGE_SIZE);
+
+	/* rows wider than a page, datablocks grow with them while the table is empty */
+	CU_ASSERT(add_test_column(table, "payload", TEST_WIDE_ROW_PAYLOAD));
+	row_size = table_calc_row_size(table);
+	CU_ASSERT(row_size > DATABLOCK_PAGE_SIZE);
+	CU_ASSERT_EQUAL(table_block_size(table), table_calc_block_size(row_size));
+	CU_ASSERT(IS_POWER_OF_2(table_block_size(table)));
+
+	fit_in_blk = (table_block_size(table) - 1) / row_size;
+	CU_ASSERT(fit_in_blk >= TABLE_BLOCK_MIN_ROWS);
+	CU_ASSERT(fit_in_blk / 2 < TABLE_BLOCK_MIN_ROWS);
+
+	data = zalloc(sizeof(*data));
+	CU_ASSERT_PTR_NOT_NULL_FATAL(data);
+
+	for (size_t i = 0; i < TEST_WIDE_ROWS; i++) {
+		data->id = (int64_t)i;
+		memset(data->payload, 'a' + (int)(i % 26), sizeof(data->payload));
+		row = build_row(data, sizeof(*data), NULL, 0);
+		CU_ASSERT(table_insert_row(table, row, row_size));
+		free(row);
+	}
+
+	free(data);
+	CU_ASSERT_EQUAL(count_datablocks(table), (TEST_WIDE_ROWS + fit_in_blk - 1) / fit_in_blk);
+
+	/* the size can't change under datablocks, and rows can't outgrow them */
+	CU_ASSERT_FALSE(table_set_block_size(table, DATABLOCK_MAX_SIZE));
+	CU_ASSERT_FALSE(add_test_column(table, "huge", DATABLOCK_MAX_SIZE));
+	CU_ASSERT_EQUAL(table->column_count, 2);
+
+	/* half the rows go, vacuum packs the others together */
+	for (size_t i = 0; i < TEST_WIDE_ROWS; i += 2) {
+		blk = fetch_datablock(table, i / fit_in_blk);
+		CU_ASSERT(table_delete_row(table, blk, (i % fit_in_blk) * row_size));
+	}
+
+	CU_ASSERT(table_vacuum(table));
+	CU_ASSERT_EQUAL(count_datablocks(table), (TEST_WIDE_ROWS / 2 + fit_in_blk - 1) / fit_in_blk);
+
+	for (size_t i = 0; i < count_datablocks(table); i++) {
+		blk = fetch_datablock(table, i);
+
+		for (size_t j = 0; j < fit_in_blk; j++) {
+			row = (struct row*)&blk->data[j * row_size];
+
+			if (row->flags.empty)
+				break;
+
+			data = (struct wide_test_row*)row->data;
+			CU_ASSERT_EQUAL(data->id, (int64_t)(found * 2 + 1));
+			CU_ASSERT_EQUAL(data->payload[TEST_WIDE_ROW_PAYLOAD - 1], 'a' + (int)((found * 2 + 1) % 26));
+			found++;
+		}
+	}
+
+	CU_ASSERT_EQUAL(found, TEST_WIDE_ROWS / 2);
+	CU_ASSERT(table_destroy(&table));
+
+	/* chosen up front, datablocks keep their size whatever columns are added */
+	table = table_init("test");
+	CU_ASSERT_PTR_NOT_NULL_FATAL(table);
+	CU_ASSERT_FALSE(table_set_block_size(table, 10000));
+	CU_ASSERT_FALSE(table_set_block_size(table, DATABLOCK_MAX_SIZE * 2));
+	CU_ASSERT(table_set_block_size(table, 65536));
+
+	CU_ASSERT(add_test_column(table, "id", sizeof(int64_t)));
+	CU_ASSERT(add_test_column(table, "payload", TEST_WIDE_ROW_PAYLOAD));
+	CU_ASSERT_EQUAL(table_block_size(table), 65536);
+	CU_ASSERT_FALSE(add_test_column(table, "huge", 65536));
+
+	/* back to following the row width */
+	CU_ASSERT(table_set_block_size(table, 0));
+	CU_ASSERT_EQUAL(table_block_size(table), table_calc_block_size(table_calc_row_size(table)));
+	CU_ASSERT(table_destroy(&table));
+}
+
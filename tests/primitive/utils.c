@@ -65,3 +65,62 @@ void create_test_table_mixed_precision_columns(struct table **out, size_t column
 
 	free(arr);
 }
+
+struct table* create_indexed_test_table(void)
+{
+	struct table *table;
+	struct column column = {0};
+
+	table = table_init("test");
+	CU_ASSERT_PTR_NOT_NULL_FATAL(table);
+
+	strcpy(column.name, "id");
+	column.type = CT_INTEGER;
+	column.precision = (int)table_calc_column_precision(CT_INTEGER);
+	CU_ASSERT_FATAL(table_add_column(table, &column));
+
+	strcpy(column.name, "str");
+	column.type = CT_VARCHAR;
+	column.precision = 16;
+	CU_ASSERT_FATAL(table_add_column(table, &column));
+
+	CU_ASSERT_FATAL(table_index_create(table, 0, IT_BTREE, NULL));
+
+	return table;
+}
+
+void indexed_test_insert(struct table *table, int64_t id)
+{
+	char str[16];
+	struct indexed_test_row data = {.id = id, .str = str};
+	struct row *row;
+
+	snprintf(str, sizeof(str), "row_%ld", id);
+	row = build_row(&data, sizeof(data), NULL, 0);
+	CU_ASSERT(table_insert_row(table, row, table_calc_row_size(table)));
+	free(row);
+}
+
+struct row* indexed_test_lookup(struct table *table, int64_t id, struct row_location *loc)
+{
+	struct vector locs;
+	struct row *row = NULL;
+	char str[16];
+
+	CU_ASSERT_FATAL(vector_init(&locs));
+	CU_ASSERT(table_index_lookup(table, 0, &id, &locs));
+	CU_ASSERT(locs.len <= sizeof(*loc));
+
+	if (locs.len) {
+		*loc = *(struct row_location*)locs.data;
+		row = (struct row*)&loc->blk->data[loc->offset];
+		snprintf(str, sizeof(str), "row_%ld", id);
+
+		CU_ASSERT(!row->flags.empty && !row->flags.deleted);
+		CU_ASSERT_EQUAL(*(int64_t*)row->data, id);
+		CU_ASSERT_STRING_EQUAL(*(char**)&row->data[sizeof(int64_t)], str);
+	}
+
+	vector_free(&locs);
+	return row;
+}
@@ -6,6 +6,7 @@
  */
 
 #include <primitive/table.h>
+#include <primitive/index.h>
 #include <tests/primitive.h>
 #include <math.h>
 
@@ -82,10 +83,14 @@ void test_table_vacuum(void)
 
 	delete_even_rows(table, no_rows);
 	CU_ASSERT_EQUAL(table->free_dtbkl_offset, 10 * row_size);
+	CU_ASSERT_EQUAL(table->row_count, 5);
+	CU_ASSERT_EQUAL(table->deleted_row_count, 5);
 
 	CU_ASSERT(table_vacuum(table));
 	CU_ASSERT(check_rows_after_vacuum(table, no_rows, row));
 	CU_ASSERT_EQUAL(table->free_dtbkl_offset, 5 * row_size);
+	CU_ASSERT_EQUAL(table->row_count, 5);
+	CU_ASSERT_EQUAL(table->deleted_row_count, 0);
 
 	CU_ASSERT(table_insert_row(table, row, row_size));
 	CU_ASSERT(check_row(table, 5, &header_used, row));
@@ -239,13 +244,13 @@ void test_table_vacuum(void)
 	for (int i = 0; i < no_rows; i++) {
 		CU_ASSERT(table_insert_row(table, row, row_size));
 		CU_ASSERT(check_row(table, i, &header_used, row));
+	}
 
-		if (i < fit_in_blk * 9) {
-			size_t blk_idx = i / fit_in_blk;
-			size_t offset = (i % fit_in_blk) * row_size;
-			table_delete_row(table, fetch_datablock(table, blk_idx), offset);
-		}
-
+	/* rows are deleted once they're all in, inserts would fill the holes otherwise */
+	for (int i = 0; i < fit_in_blk * 9; i++) {
+		size_t blk_idx = i / fit_in_blk;
+		size_t offset = (i % fit_in_blk) * row_size;
+		table_delete_row(table, fetch_datablock(table, blk_idx), offset);
 	}
 	CU_ASSERT_EQUAL(count_datablocks(table), 10);
 	CU_ASSERT_EQUAL(table->free_dtbkl_offset, 10 * row_size);
@@ -285,13 +290,12 @@ void test_table_vacuum(void)
 	for (int i = 0; i < no_rows; i++) {
 		CU_ASSERT(table_insert_row(table, row, row_size));
 		CU_ASSERT(check_row(table, i, &header_used, row));
+	}
 
-		if (i >= fit_in_blk && i < fit_in_blk * 2) {
-			size_t blk_idx = i / fit_in_blk;
-			size_t offset = (i % fit_in_blk) * row_size;
-			table_delete_row(table, fetch_datablock(table, blk_idx), offset);
-		}
-
+	for (int i = fit_in_blk; i < fit_in_blk * 2; i++) {
+		size_t blk_idx = i / fit_in_blk;
+		size_t offset = (i % fit_in_blk) * row_size;
+		table_delete_row(table, fetch_datablock(table, blk_idx), offset);
 	}
 	CU_ASSERT_EQUAL(count_datablocks(table), 3);
 	CU_ASSERT_EQUAL(table->free_dtbkl_offset, 10 * row_size);
@@ -473,3 +477,97 @@ void test_table_vacuum(void)
 	free(row);
 
 }
+
+#define TEST_VACUUM_STEP_BLOCKS	10
+#define TEST_VACUUM_STEP_SLOTS	64
+
+/* every row is where the index says it is and the row counts add up */
+static void vacuum_step_check(struct table *table, const bool *live, int64_t no_ids)
+{
+	struct list_head *pos;
+	struct datablock *blk;
+	struct row_location loc;
+	struct row *row;
+	size_t row_size = table_calc_row_size(table);
+	size_t live_rows = 0, deleted_rows = 0, blocks = 0;
+
+	list_for_each(pos, table->datablock_head)
+	{
+		blk = list_entry(pos, typeof(*blk), head);
+
+		/* the block directory keeps up with datablocks being released */
+		CU_ASSERT_PTR_EQUAL(fetch_datablock(table, blocks++), blk);
+
+		for (size_t i = 0; i < table_block_size(table) / row_size; i++) {
+			row = (struct row*)&blk->data[i * row_size];
+			live_rows += !row->flags.empty && !row->flags.deleted;
+			deleted_rows += row->flags.deleted;
+		}
+	}
+
+	CU_ASSERT_EQUAL(blocks, table->blocks.len);
+	CU_ASSERT_EQUAL(live_rows, table->row_count);
+	CU_ASSERT_EQUAL(deleted_rows, table->deleted_row_count);
+
+	for (int64_t id = 0; id < no_ids; id++)
+		CU_ASSERT_EQUAL(indexed_test_lookup(table, id, &loc) != NULL, live[id]);
+}
+
+void test_table_vacuum_step(void)
+{
+	struct table *table = create_indexed_test_table();
+	struct row_location loc;
+	size_t fit_in_blk = table_block_size(table) / table_calc_row_size(table);
+	int64_t no_rows = (int64_t)(fit_in_blk * TEST_VACUUM_STEP_BLOCKS);
+	int64_t no_ids = no_rows + TEST_VACUUM_STEP_BLOCKS * 8;
+	int64_t next_id = no_rows;
+	size_t blocks, steps = 0;
+	bool *live;
+
+	live = calloc((size_t)no_ids, sizeof(*live));
+	CU_ASSERT_PTR_NOT_NULL_FATAL(live);
+
+	for (int64_t id = 0; id < no_rows; id++) {
+		indexed_test_insert(table, id);
+		live[id] = true;
+	}
+
+	blocks = count_datablocks(table);
+
+	for (int64_t id = 0; id < no_rows; id++) {
+		if (id % 3 == 0)
+			continue;
+
+		CU_ASSERT_PTR_NOT_NULL_FATAL(indexed_test_lookup(table, id, &loc));
+		CU_ASSERT(table_delete_row(table, loc.blk, loc.offset));
+		live[id] = false;
+	}
+
+	/* statements get in between steps: they delete rows the pass is yet to get to and insert some */
+	while (!table_vacuum_step(table, TEST_VACUUM_STEP_SLOTS)) {
+		if (++steps % 4 == 0 && next_id < no_ids) {
+			indexed_test_insert(table, next_id);
+			live[next_id++] = true;
+		}
+
+		if (steps % 5 == 0 && indexed_test_lookup(table, no_rows - (int64_t)steps * 3, &loc)) {
+			CU_ASSERT(table_delete_row(table, loc.blk, loc.offset));
+			live[no_rows - (int64_t)steps * 3] = false;
+		}
+
+		vacuum_step_check(table, live, no_ids);
+	}
+
+	CU_ASSERT(steps > 1);
+	CU_ASSERT(!table->vacuum.active);
+	CU_ASSERT(count_datablocks(table) < blocks / 2);
+	vacuum_step_check(table, live, no_ids);
+
+	/* a full pass leaves nothing deleted behind */
+	CU_ASSERT(table_vacuum(table));
+	CU_ASSERT_EQUAL(table->deleted_row_count, 0);
+	vacuum_step_check(table, live, no_ids);
+
+	free(live);
+	CU_ASSERT(table_destroy(&table));
+}
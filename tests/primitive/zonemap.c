@@ -0,0 +1,194 @@
+/*
+ * zonemap.c
+ *
+ *  Created on: 17/10/2026
+ *      Author: paulo
+ */
+
+#include <primitive/zonemap.h>
+#include <tests/primitive.h>
+
+#define TEST_ZONE_ROWS 1000
+
+struct zone_test_row {
+	int64_t id;
+	double val;
+	bool flag;
+	char *str;
+} __packed;
+
+static struct table* create_zone_test_table(void)
+{
+	struct table *table;
+	struct column column = {0};
+	enum COLUMN_TYPE types[] = {CT_INTEGER, CT_DOUBLE, CT_TINYINT, CT_VARCHAR};
+	char *names[] = {"id", "val", "flag", "str"};
+
+	table = table_init("test");
+	CU_ASSERT_PTR_NOT_NULL_FATAL(table);
+
+	for (size_t i = 0; i < ARR_SIZE(types); i++) {
+		strcpy(column.name, names[i]);
+		column.type = types[i];
+		column.precision = types[i] == CT_VARCHAR ? 16 : (int)table_calc_column_precision(types[i]);
+		CU_ASSERT_FATAL(table_add_column(table, &column));
+	}
+
+	return table;
+}
+
+static double zone_value(struct column *column, union zone_value *val)
+{
+	return column->type == CT_DOUBLE ? val->double_val : (double)val->int_val;
+}
+
+static double row_value(struct column *column, struct row *row, size_t offset)
+{
+	switch (column->type) {
+	case CT_DOUBLE:
+		return *(double*)&row->data[offset];
+	case CT_TINYINT:
+		return *(bool*)&row->data[offset];
+	default:
+		return (double)*(int64_t*)&row->data[offset];
+	}
+}
+
+/* checks zone maps hold every live row, bounds must match them exactly unless they could have been widened */
+static void check_zones(struct table *table, bool exact)
+{
+	struct list_head *pos;
+	struct datablock *blk;
+	struct zone_map *zone;
+	struct column *column;
+	struct row *row;
+	size_t row_size = table_calc_row_size(table);
+	size_t offset = 0;
+
+	for (int col = 0; col < table->column_count; offset += table_calc_column_space(&table->columns[col++])) {
+		column = &table->columns[col];
+
+		if (!zone_map_tracks(column->type))
+			continue;
+
+		list_for_each(pos, table->datablock_head)
+		{
+			double min = INFINITY, max = -INFINITY, val;
+			uint32_t values = 0, nulls = 0;
+
+			blk = list_entry(pos, typeof(*blk), head);
+			CU_ASSERT_PTR_NOT_NULL_FATAL(blk->zones);
+			zone = &blk->zones[col];
+
+			for (size_t i = 0; i < DATABLOCK_PAGE_SIZE / row_size; i++) {
+				row = (struct row*)&blk->data[i * row_size];
+
+				if (row->flags.empty || row->flags.deleted)
+					continue;
+
+				if (bit_test(row->null_bitmap, col, sizeof(row->null_bitmap))) {
+					nulls++;
+					continue;
+				}
+
+				val = row_value(column, row, offset);
+				min = val < min ? val : min;
+				max = val > max ? val : max;
+				values++;
+			}
+
+			CU_ASSERT_EQUAL(zone->value_count, values);
+			CU_ASSERT_EQUAL(zone->null_count, nulls);
+
+			if (!values)
+				continue;
+
+			if (exact) {
+				CU_ASSERT_EQUAL(zone_value(column, &zone->min), min);
+				CU_ASSERT_EQUAL(zone_value(column, &zone->max), max);
+			} else {
+				CU_ASSERT(zone_value(column, &zone->min) <= min);
+				CU_ASSERT(zone_value(column, &zone->max) >= max);
+			}
+		}
+	}
+}
+
+void test_table_zone_map(void)
+{
+	struct zone_test_row data;
+	struct table *table;
+	struct datablock *first, *last, *blk;
+	struct list_head *pos;
+	struct row *row;
+	size_t row_size;
+	char str[16] = "zone";
+	int null_cols[] = {2};
+	int64_t min;
+
+	table = create_zone_test_table();
+	row_size = table_calc_row_size(table);
+
+	/* every 7th row has a NULL flag */
+	for (int64_t id = 0; id < TEST_ZONE_ROWS; id++) {
+		data.id = id;
+		data.val = (double)id / 2;
+		data.flag = id % 2;
+		data.str = str;
+
+		row = build_row(&data, sizeof(data), null_cols, id % 7 == 0 ? 1 : 0);
+		CU_ASSERT(table_insert_row(table, row, row_size));
+		free(row);
+	}
+
+	check_zones(table, true);
+
+	first = list_entry(table->datablock_head->next, typeof(*first), head);
+	last = list_entry(table->datablock_head->prev, typeof(*last), head);
+	CU_ASSERT_NOT_EQUAL(first, last);
+	CU_ASSERT_EQUAL(first->zones[0].min.int_val, 0);
+	CU_ASSERT_EQUAL(last->zones[0].max.int_val, TEST_ZONE_ROWS - 1);
+
+	/* deleting the smallest id doesn't narrow bounds down */
+	min = first->zones[0].min.int_val;
+	CU_ASSERT(table_delete_row(table, first, 0));
+	CU_ASSERT_EQUAL(first->zones[0].min.int_val, min);
+	check_zones(table, false);
+
+	/* updates widen them */
+	row = (struct row*)&last->data[0];
+	memcpy(&data, row->data, sizeof(data));
+	data.id = -5;
+	data.val = 1e9;
+	data.str = str;
+	row = build_row(&data, sizeof(data), null_cols, ARR_SIZE(null_cols));
+	CU_ASSERT(table_update_row(table, last, 0, row, row_size));
+	free(row);
+
+	CU_ASSERT_EQUAL(last->zones[0].min.int_val, -5);
+	CU_ASSERT_EQUAL(last->zones[1].max.double_val, 1e9);
+	check_zones(table, false);
+
+	/* every other row goes away, vacuum makes bounds exact again */
+	list_for_each(pos, table->datablock_head)
+	{
+		blk = list_entry(pos, typeof(*blk), head);
+
+		for (size_t i = 0; i < DATABLOCK_PAGE_SIZE / row_size; i++) {
+			row = (struct row*)&blk->data[i * row_size];
+
+			if (!row->flags.empty && !row->flags.deleted && i % 2)
+				CU_ASSERT(table_delete_row(table, blk, i * row_size));
+		}
+	}
+
+	check_zones(table, false);
+	CU_ASSERT(table_vacuum(table));
+	check_zones(table, true);
+
+	/* so do column changes */
+	CU_ASSERT(table_rem_column(table, &table->columns[0]));
+	check_zones(table, true);
+
+	table_destroy(&table);
+}
@@ -23,24 +23,13 @@ size_t count_datablocks(struct table *table)
 /* This function doesn't ignore empty / deleted rows by design */
 struct row* fetch_row(struct table *table, size_t row_num)
 {
-	size_t row_size = table_calc_row_size(table);
+	size_t fit_in_blk = table_block_size(table) / table_calc_row_size(table);
+	struct datablock *block = fetch_datablock(table, row_num / fit_in_blk);
 
-	struct list_head *pos;
-	size_t i = 0;
-	list_for_each(pos, table->datablock_head)
-	{
-		struct datablock
-		*block = list_entry(pos, typeof(*block), head);
-
-		for (size_t j = 0; j < ARR_SIZE(block->data) / row_size; j++) {
-			struct row *row = (struct row*)&block->data[j * row_size];
-			if (i == row_num)
-				return row;
-			i++;
-		}
-	}
+	if (!block)
+		return NULL;
 
-	return NULL;
+	return (struct row*)&block->data[(row_num % fit_in_blk) * table_calc_row_size(table)];
 }
 
 bool check_row_data(struct table *table, size_t row_num, void *expected)
@@ -80,16 +69,7 @@ bool check_row(struct table *table, size_t row_num, struct row_header_flags *exp
 
 struct datablock* fetch_datablock(struct table *table, size_t idx)
 {
-	struct list_head *pos;
-	size_t i = 0;
-	list_for_each(pos, table->datablock_head)
-	{
-		struct datablock *block = list_entry(pos, typeof(*block), head);
-		if (i == idx)
-			return block;
-		i++;
-	}
-	return NULL;
+	return block_dir_at(&table->blocks, idx);
 }
 
 struct row* build_row(void *data, size_t data_len, int *null_cols_idx, size_t cols_idx_len)